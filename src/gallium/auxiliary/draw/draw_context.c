@@ -1031,6 +1031,20 @@ draw_collect_pipeline_statistics(struct draw_context *draw,
    draw->collect_statistics = enable;
 }
 
+/**
+ * Returns the running totals of post-transform vertex cache hits and
+ * misses of indexed draws, ie. the number of vertex shader invocations
+ * saved and spent by the vertex cache.  The counters are never reset,
+ * callers are expected to take differences.
+ */
+void
+draw_get_vcache_stats(const struct draw_context *draw,
+                      uint64_t *hits, uint64_t *misses)
+{
+   *hits = draw->pt.vcache_hits;
+   *misses = draw->pt.vcache_misses;
+}
+
 /**
  * Computes clipper invocation statistics.
  *
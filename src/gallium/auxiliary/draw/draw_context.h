@@ -276,6 +276,9 @@ void draw_set_force_passthrough( struct draw_context *draw,
 void draw_collect_pipeline_statistics(struct draw_context *draw,
                                       boolean enable);
 
+void draw_get_vcache_stats(const struct draw_context *draw,
+                           uint64_t *hits, uint64_t *misses);
+
 /*******************************************************************************
  * Draw pipeline 
  */
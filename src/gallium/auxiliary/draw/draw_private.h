@@ -170,6 +170,10 @@ struct draw_context
          struct draw_pt_front_end *vsplit;
       } front;
 
+      /** Post-transform vertex cache statistics, see draw_get_vcache_stats() */
+      uint64_t vcache_hits;
+      uint64_t vcache_misses;
+
       struct pipe_vertex_buffer vertex_buffer[PIPE_MAX_ATTRIBS];
       unsigned nr_vertex_buffers;
 
@@ -26,8 +26,10 @@
  **************************************************************************/
 
 #include "util/u_math.h"
+#include "util/u_debug.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "os/os_thread.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_vbuf.h"
@@ -39,6 +41,33 @@
 #include "gallivm/lp_bld_init.h"
 
 
+DEBUG_GET_ONCE_NUM_OPTION(draw_num_threads, "DRAW_NUM_THREADS", 0)
+
+/**
+ * Don't bother splitting the vertex shading of a draw into chunks smaller
+ * than this.
+ */
+#define MIN_VERTICES_PER_THREAD 256
+
+struct llvm_middle_end;
+
+/**
+ * A helper thread running the vertex shader over part of a draw.
+ */
+struct llvm_vs_thread {
+   struct llvm_middle_end *fpme;
+   pipe_thread thread;
+
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+
+   /* Range of fetch_info->count to shade, and the result. */
+   unsigned first;
+   unsigned count;
+   int clipped;
+};
+
+
 struct llvm_middle_end {
    struct draw_pt_middle_end base;
    struct draw_context *draw;
@@ -56,6 +85,15 @@ struct llvm_middle_end {
 
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
+
+   /* Helper threads for vertex shading, see DRAW_NUM_THREADS. */
+   unsigned num_threads;
+   struct llvm_vs_thread *threads;
+   boolean exit_threads;
+
+   /* The draw the helper threads are currently working on. */
+   const struct draw_fetch_info *thread_fetch_info;
+   struct vertex_header *thread_verts;
 };
 
 
@@ -341,6 +379,127 @@ emit(struct pt_emit *emit,
 }
 
 
+/**
+ * Run fetch, the vertex shader and the clip test on vertices
+ * [first, first + count) of the draw described by fetch_info.
+ *
+ * Returns non-zero if any vertex needs clipping.
+ */
+static int
+llvm_shade_vertices(struct llvm_middle_end *fpme,
+                    const struct draw_fetch_info *fetch_info,
+                    struct vertex_header *verts,
+                    unsigned first,
+                    unsigned count)
+{
+   struct draw_context *draw = fpme->draw;
+   struct vertex_header *io = (struct vertex_header *)
+      ((char *) verts + first * fpme->vertex_size);
+
+   if (fetch_info->linear)
+      return fpme->current_variant->jit_func( &fpme->llvm->jit_context,
+                                       io,
+                                       draw->pt.user.vbuffer,
+                                       fetch_info->start + first,
+                                       count,
+                                       fpme->vertex_size,
+                                       draw->pt.vertex_buffer,
+                                       draw->instance_id,
+                                       draw->start_index);
+   else
+      return fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
+                                            io,
+                                            draw->pt.user.vbuffer,
+                                            fetch_info->elts + first,
+                                            draw->pt.user.eltMax,
+                                            count,
+                                            fpme->vertex_size,
+                                            draw->pt.vertex_buffer,
+                                            draw->instance_id,
+                                            draw->pt.user.eltBias);
+}
+
+
+static PIPE_THREAD_ROUTINE(llvm_vs_thread_func, init_data)
+{
+   struct llvm_vs_thread *task = (struct llvm_vs_thread *) init_data;
+   struct llvm_middle_end *fpme = task->fpme;
+
+   while (1) {
+      pipe_semaphore_wait(&task->work_ready);
+
+      if (fpme->exit_threads)
+         break;
+
+      task->clipped = llvm_shade_vertices(fpme,
+                                          fpme->thread_fetch_info,
+                                          fpme->thread_verts,
+                                          task->first,
+                                          task->count);
+
+      pipe_semaphore_signal(&task->work_done);
+   }
+
+   return 0;
+}
+
+
+/**
+ * Shade all the vertices of a draw, splitting large draws between the
+ * calling thread and the helper threads.
+ *
+ * Vertices are written to their final position in verts, so the primitive
+ * order seen by the rest of the pipeline is unchanged.
+ */
+static int
+llvm_shade_draw(struct llvm_middle_end *fpme,
+                const struct draw_fetch_info *fetch_info,
+                struct vertex_header *verts)
+{
+   /* The shader always writes whole SIMD vectors of vertices, so chunks
+    * must be multiples of the vector length not to overwrite each other.
+    */
+   const unsigned vector_length = lp_native_vector_width / 32;
+   unsigned num_chunks, chunk_size, first, i;
+   int clipped;
+
+   num_chunks = MIN2(fpme->num_threads + 1,
+                     fetch_info->count / MIN_VERTICES_PER_THREAD);
+   if (num_chunks <= 1)
+      return llvm_shade_vertices(fpme, fetch_info, verts,
+                                 0, fetch_info->count);
+
+   chunk_size = align((fetch_info->count + num_chunks - 1) / num_chunks,
+                      vector_length);
+
+   fpme->thread_fetch_info = fetch_info;
+   fpme->thread_verts = verts;
+
+   first = chunk_size;
+   for (i = 0; i < num_chunks - 1 && first < fetch_info->count; i++) {
+      struct llvm_vs_thread *task = &fpme->threads[i];
+
+      task->first = first;
+      task->count = MIN2(chunk_size, fetch_info->count - first);
+      pipe_semaphore_signal(&task->work_ready);
+
+      first += chunk_size;
+   }
+
+   /* The first chunk is shaded on this thread. */
+   clipped = llvm_shade_vertices(fpme, fetch_info, verts, 0, chunk_size);
+
+   while (i--) {
+      struct llvm_vs_thread *task = &fpme->threads[i];
+
+      pipe_semaphore_wait(&task->work_done);
+      clipped |= task->clipped;
+   }
+
+   return clipped;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -378,27 +537,7 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       draw->statistics.vs_invocations += fetch_info->count;
    }
 
-   if (fetch_info->linear)
-      clipped = fpme->current_variant->jit_func( &fpme->llvm->jit_context,
-                                       llvm_vert_info.verts,
-                                       draw->pt.user.vbuffer,
-                                       fetch_info->start,
-                                       fetch_info->count,
-                                       fpme->vertex_size,
-                                       draw->pt.vertex_buffer,
-                                       draw->instance_id,
-                                       draw->start_index);
-   else
-      clipped = fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
-                                            llvm_vert_info.verts,
-                                            draw->pt.user.vbuffer,
-                                            fetch_info->elts,
-                                            draw->pt.user.eltMax,
-                                            fetch_info->count,
-                                            fpme->vertex_size,
-                                            draw->pt.vertex_buffer,
-                                            draw->instance_id,
-                                            draw->pt.user.eltBias);
+   clipped = llvm_shade_draw(fpme, fetch_info, llvm_vert_info.verts);
 
    /* Finished with fetch and vs:
     */
@@ -576,6 +715,20 @@ static void
 llvm_middle_end_destroy(struct draw_pt_middle_end *middle)
 {
    struct llvm_middle_end *fpme = llvm_middle_end(middle);
+   unsigned i;
+
+   if (fpme->threads) {
+      fpme->exit_threads = TRUE;
+      for (i = 0; i < fpme->num_threads; i++)
+         pipe_semaphore_signal(&fpme->threads[i].work_ready);
+
+      for (i = 0; i < fpme->num_threads; i++) {
+         pipe_thread_wait(fpme->threads[i].thread);
+         pipe_semaphore_destroy(&fpme->threads[i].work_ready);
+         pipe_semaphore_destroy(&fpme->threads[i].work_done);
+      }
+      FREE(fpme->threads);
+   }
 
    if (fpme->fetch)
       draw_pt_fetch_destroy( fpme->fetch );
@@ -637,6 +790,40 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 
    fpme->current_variant = NULL;
 
+   fpme->num_threads = debug_get_option_draw_num_threads();
+   if (fpme->num_threads) {
+      unsigned i;
+
+      fpme->threads = CALLOC(fpme->num_threads, sizeof *fpme->threads);
+      if (!fpme->threads)
+         fpme->num_threads = 0;
+
+      for (i = 0; i < fpme->num_threads; i++) {
+         struct llvm_vs_thread *task = &fpme->threads[i];
+
+         task->fpme = fpme;
+         pipe_semaphore_init(&task->work_ready, 0);
+         pipe_semaphore_init(&task->work_done, 0);
+         task->thread = pipe_thread_create(llvm_vs_thread_func, task);
+         if (!task->thread) {
+            /* Make do with the threads we have; with none, all vertices
+             * are shaded on the calling thread.
+             */
+            debug_printf("draw: failed to create vertex shader thread %u\n",
+                         i);
+            pipe_semaphore_destroy(&task->work_ready);
+            pipe_semaphore_destroy(&task->work_done);
+            fpme->num_threads = i;
+            break;
+         }
+      }
+
+      if (fpme->num_threads == 0) {
+         FREE(fpme->threads);
+         fpme->threads = NULL;
+      }
+   }
+
    return &fpme->base;
 
  fail:
@@ -23,15 +23,31 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 
 #include "draw/draw_context.h"
 #include "draw/draw_private.h"
 #include "draw/draw_pt.h"
+#include "draw/draw_vbuf.h"
 
 #define SEGMENT_SIZE 1024
-#define MAP_SIZE     256
+
+/* Indexed list primitives only need SEGMENT_SIZE distinct vertices per
+ * segment, so a segment may span several times as many indices.
+ */
+#define DRAW_ELTS_SIZE (4 * SEGMENT_SIZE)
+
+/* The post-transform vertex cache is VCACHE_WAYS-way set associative with
+ * LRU replacement within each set.  Its total size can be changed with
+ * DRAW_VCACHE_SIZE.
+ */
+#define VCACHE_WAYS         4
+#define VCACHE_DEFAULT_SIZE 512
+
+DEBUG_GET_ONCE_NUM_OPTION(draw_vcache_size, "DRAW_VCACHE_SIZE",
+                          VCACHE_DEFAULT_SIZE)
 
 /* The largest possible index withing an index buffer */
 #define MAX_ELT_IDX 0xffffffff
@@ -47,16 +63,26 @@ struct vsplit_frontend {
    unsigned max_vertices;
    ushort segment_size;
 
+   /* Largest number of indices of an indexed segment, and the number of
+    * indices per primitive when segments may be flushed early, see
+    * vsplit_segment_cache_*().
+    */
+   unsigned max_count_elts;
+   unsigned prim_incr;
+
    /* buffers for splitting */
    unsigned fetch_elts[SEGMENT_SIZE];
-   ushort draw_elts[SEGMENT_SIZE];
+   ushort draw_elts[DRAW_ELTS_SIZE];
    ushort identity_draw_elts[SEGMENT_SIZE];
 
    struct {
-      /* map a fetch element to a draw element */
-      unsigned fetches[MAP_SIZE];
-      ushort draws[MAP_SIZE];
-      boolean has_max_fetch;
+      /* map a fetch element to a draw element, most recently used first
+       * within each set
+       */
+      unsigned *fetches;
+      ushort *draws;
+      ubyte *num_valid;
+      unsigned set_mask;
 
       ushort num_fetch_elts;
       ushort num_draw_elts;
@@ -67,8 +93,7 @@ struct vsplit_frontend {
 static void
 vsplit_clear_cache(struct vsplit_frontend *vsplit)
 {
-   memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
-   vsplit->cache.has_max_fetch = FALSE;
+   memset(vsplit->cache.num_valid, 0, vsplit->cache.set_mask + 1);
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
 }
@@ -76,6 +101,12 @@ vsplit_clear_cache(struct vsplit_frontend *vsplit)
 static void
 vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 {
+   struct draw_context *draw = vsplit->draw;
+
+   draw->pt.vcache_misses += vsplit->cache.num_fetch_elts;
+   draw->pt.vcache_hits +=
+      vsplit->cache.num_draw_elts - vsplit->cache.num_fetch_elts;
+
    vsplit->middle->run(vsplit->middle,
          vsplit->fetch_elts, vsplit->cache.num_fetch_elts,
          vsplit->draw_elts, vsplit->cache.num_draw_elts, flags);
@@ -87,23 +118,45 @@ vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 static INLINE void
 vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch, unsigned ofbias)
 {
-   unsigned hash;
-
-   hash = fetch % MAP_SIZE;
-
-   /* If the value isn't in the cache of it's an overflow due to the
-    * element bias */
-   if (vsplit->cache.fetches[hash] != fetch || ofbias) {
-      /* update cache */
-      vsplit->cache.fetches[hash] = fetch;
-      vsplit->cache.draws[hash] = vsplit->cache.num_fetch_elts;
+   const unsigned set = (fetch & vsplit->cache.set_mask) * VCACHE_WAYS;
+   unsigned *fetches = &vsplit->cache.fetches[set];
+   ushort *draws = &vsplit->cache.draws[set];
+   unsigned num_valid = vsplit->cache.num_valid[set / VCACHE_WAYS];
+   unsigned way;
+   ushort draw;
+
+   /* An overflow due to the element bias is never cached */
+   way = num_valid;
+   if (!ofbias) {
+      for (way = 0; way < num_valid; way++) {
+         if (fetches[way] == fetch)
+            break;
+      }
+   }
 
-      /* add fetch */
+   if (way < num_valid) {
+      draw = draws[way];
+   }
+   else {
+      /* add fetch, evicting the least recently used entry if full */
       assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
+      draw = vsplit->cache.num_fetch_elts;
       vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
+
+      if (num_valid < VCACHE_WAYS)
+         vsplit->cache.num_valid[set / VCACHE_WAYS] = ++num_valid;
+      way = num_valid - 1;
+   }
+
+   /* move to the front of the set */
+   for (; way > 0; way--) {
+      fetches[way] = fetches[way - 1];
+      draws[way] = draws[way - 1];
    }
+   fetches[0] = fetch;
+   draws[0] = draw;
 
-   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[hash];
+   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = draw;
 }
 
 /**
@@ -198,16 +251,7 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
                       unsigned start, unsigned fetch, int elt_bias)
 {
    struct draw_context *draw = vsplit->draw;
-   unsigned raw_elem_idx = start + fetch + elt_bias;
    VSPLIT_CREATE_IDX(elts, start, fetch, elt_bias);
-
-   /* special care for DRAW_MAX_FETCH_IDX */
-   if (raw_elem_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = fetch % MAP_SIZE;
-      vsplit->cache.fetches[hash] = raw_elem_idx - 1; /* force update */
-      vsplit->cache.has_max_fetch = TRUE;
-   }
-
    vsplit_add_cache(vsplit, elt_idx, ofbias);
 }
 
@@ -237,6 +281,7 @@ static void vsplit_prepare(struct draw_pt_front_end *frontend,
                            unsigned opt)
 {
    struct vsplit_frontend *vsplit = (struct vsplit_frontend *) frontend;
+   unsigned first, incr, max_elts;
 
    switch (vsplit->draw->pt.user.eltSize) {
    case 0:
@@ -263,6 +308,26 @@ static void vsplit_prepare(struct draw_pt_front_end *frontend,
    middle->prepare(middle, vsplit->prim, opt, &vsplit->max_vertices);
 
    vsplit->segment_size = MIN2(SEGMENT_SIZE, vsplit->max_vertices);
+
+   /* Segments of list primitives can be flushed at any primitive boundary
+    * once the fetch elements run out, so let them cover more indices and
+    * keep the cache warm for longer.  The emit stage hands the indices of
+    * a segment to a vbuf render in one go, so don't exceed what it takes.
+    */
+   max_elts = DRAW_ELTS_SIZE;
+   if (vsplit->draw->render)
+      max_elts = MIN2(max_elts, vsplit->draw->render->max_indices);
+
+   draw_pt_split_prim(in_prim, &first, &incr);
+   if (first == incr && incr <= vsplit->segment_size &&
+       max_elts > vsplit->segment_size) {
+      vsplit->prim_incr = incr;
+      vsplit->max_count_elts = max_elts - max_elts % incr;
+   }
+   else {
+      vsplit->prim_incr = 0;
+      vsplit->max_count_elts = vsplit->segment_size;
+   }
 }
 
 
@@ -279,18 +344,38 @@ static void vsplit_flush(struct draw_pt_front_end *frontend, unsigned flags)
 
 static void vsplit_destroy(struct draw_pt_front_end *frontend)
 {
-   FREE(frontend);
+   struct vsplit_frontend *vsplit = (struct vsplit_frontend *) frontend;
+
+   FREE(vsplit->cache.fetches);
+   FREE(vsplit->cache.draws);
+   FREE(vsplit->cache.num_valid);
+   FREE(vsplit);
 }
 
 
 struct draw_pt_front_end *draw_pt_vsplit(struct draw_context *draw)
 {
    struct vsplit_frontend *vsplit = CALLOC_STRUCT(vsplit_frontend);
+   unsigned cache_size, num_sets;
    ushort i;
 
    if (!vsplit)
       return NULL;
 
+   cache_size = debug_get_option_draw_vcache_size();
+   cache_size = CLAMP(cache_size, VCACHE_WAYS, SEGMENT_SIZE);
+   num_sets = util_next_power_of_two(cache_size / VCACHE_WAYS);
+
+   vsplit->cache.set_mask = num_sets - 1;
+   vsplit->cache.fetches = MALLOC(num_sets * VCACHE_WAYS * sizeof(unsigned));
+   vsplit->cache.draws = MALLOC(num_sets * VCACHE_WAYS * sizeof(ushort));
+   vsplit->cache.num_valid = CALLOC(num_sets, sizeof(ubyte));
+   if (!vsplit->cache.fetches || !vsplit->cache.draws ||
+       !vsplit->cache.num_valid) {
+      vsplit_destroy(&vsplit->base);
+      return NULL;
+   }
+
    vsplit->base.prepare = vsplit_prepare;
    vsplit->base.run     = NULL;
    vsplit->base.flush   = vsplit_flush;
@@ -141,7 +141,7 @@ CONCAT(vsplit_segment_cache_, ELT_TYPE)(struct vsplit_frontend *vsplit,
    const int ibias = draw->pt.user.eltBias;
    unsigned i;
 
-   assert(icount + !!close <= vsplit->segment_size);
+   assert(icount + !!close <= vsplit->max_count_elts);
 
    vsplit_clear_cache(vsplit);
 
@@ -184,14 +184,52 @@ CONCAT(vsplit_segment_cache_, ELT_TYPE)(struct vsplit_frontend *vsplit,
    vsplit_flush_cache(vsplit, flags);
 }
 
+/**
+ * Like vsplit_segment_cache_*(), for list primitives.  The segment may have
+ * more indices than there is room for fetch elements, in which case it is
+ * flushed early at a primitive boundary.
+ */
+static INLINE void
+CONCAT(vsplit_segment_list_, ELT_TYPE)(struct vsplit_frontend *vsplit,
+                                       unsigned flags,
+                                       unsigned istart, unsigned icount)
+{
+   struct draw_context *draw = vsplit->draw;
+   const ELT_TYPE *ib = (const ELT_TYPE *) draw->pt.user.elts;
+   const int ibias = draw->pt.user.eltBias;
+   const unsigned incr = vsplit->prim_incr;
+   unsigned i = 0, j;
+
+   assert(icount <= vsplit->max_count_elts);
+   assert(icount % incr == 0);
+
+   vsplit_clear_cache(vsplit);
+
+   while (i < icount) {
+      if (vsplit->cache.num_fetch_elts + incr > vsplit->segment_size) {
+         vsplit_flush_cache(vsplit, flags | DRAW_SPLIT_AFTER);
+         vsplit_clear_cache(vsplit);
+         flags |= DRAW_SPLIT_BEFORE;
+      }
+
+      for (j = 0; j < incr; j++, i++)
+         ADD_CACHE(vsplit, ib, istart, i, ibias);
+   }
+
+   vsplit_flush_cache(vsplit, flags);
+}
+
 static void
 CONCAT(vsplit_segment_simple_, ELT_TYPE)(struct vsplit_frontend *vsplit,
                                          unsigned flags,
                                          unsigned istart,
                                          unsigned icount)
 {
-   CONCAT(vsplit_segment_cache_, ELT_TYPE)(vsplit,
-         flags, istart, icount, FALSE, 0, FALSE, 0);
+   if (vsplit->prim_incr)
+      CONCAT(vsplit_segment_list_, ELT_TYPE)(vsplit, flags, istart, icount);
+   else
+      CONCAT(vsplit_segment_cache_, ELT_TYPE)(vsplit,
+            flags, istart, icount, FALSE, 0, FALSE, 0);
 }
 
 static void
@@ -223,7 +261,7 @@ CONCAT(vsplit_segment_fan_, ELT_TYPE)(struct vsplit_frontend *vsplit,
 #define LOCAL_VARS                                                         \
    struct vsplit_frontend *vsplit = (struct vsplit_frontend *) frontend;   \
    const unsigned prim = vsplit->prim;                                     \
-   const unsigned max_count_simple = vsplit->segment_size;                 \
+   const unsigned max_count_simple = vsplit->max_count_elts;               \
    const unsigned max_count_loop = vsplit->segment_size - 1;               \
    const unsigned max_count_fan = vsplit->segment_size;
 
@@ -39,6 +39,7 @@
 
 #include <llvm-c/Analysis.h>
 #include <llvm-c/Transforms/Scalar.h>
+#include <llvm-c/BitReader.h>
 #include <llvm-c/BitWriter.h>
 
 
@@ -329,12 +330,46 @@ fail:
 static LLVMContextRef gallivm_context = NULL;
 
 
+/**
+ * Parse an LLVM module previously written with gallivm_write_bitcode().
+ * \return  the module or NULL on failure
+ */
+static LLVMModuleRef
+read_bitcode(LLVMContextRef context, const char *filename)
+{
+   LLVMMemoryBufferRef buffer;
+   LLVMModuleRef module = NULL;
+   char *error = NULL;
+
+   if (LLVMCreateMemoryBufferWithContentsOfFile(filename, &buffer, &error)) {
+      LLVMDisposeMessage(error);
+      return NULL;
+   }
+
+   if (LLVMParseBitcodeInContext(context, buffer, &module, &error)) {
+      if (gallivm_debug & GALLIVM_DEBUG_PERF)
+         debug_printf("%s: %s: %s\n", __FUNCTION__, filename, error);
+      LLVMDisposeMessage(error);
+      module = NULL;
+   }
+
+   LLVMDisposeMemoryBuffer(buffer);
+
+   return module;
+}
+
+
 /**
  * Allocate gallivm LLVM objects.
+ * \param context  the LLVM context to use, or NULL for the global one
+ * \param bitcode_filename  if not NULL, the module is read from this file
+ *                          instead of starting out empty
  * \return  TRUE for success, FALSE for failure
  */
 static boolean
-init_gallivm_state(struct gallivm_state *gallivm)
+init_gallivm_state(struct gallivm_state *gallivm,
+                   LLVMContextRef context,
+                   const char *bitcode_filename)
 {
    assert(!gallivm->context);
    assert(!gallivm->module);
@@ -342,15 +377,23 @@ init_gallivm_state(struct gallivm_state *gallivm)
 
    lp_build_init();
 
-   if (!gallivm_context) {
-      gallivm_context = LLVMContextCreate();
+   if (!context) {
+      if (!gallivm_context) {
+         gallivm_context = LLVMContextCreate();
+      }
+      context = gallivm_context;
    }
-   gallivm->context = gallivm_context;
+   gallivm->context = context;
    if (!gallivm->context)
       goto fail;
 
-   gallivm->module = LLVMModuleCreateWithNameInContext("gallivm",
-                                                       gallivm->context);
+   if (bitcode_filename) {
+      gallivm->module = read_bitcode(gallivm->context, bitcode_filename);
+   }
+   else {
+      gallivm->module = LLVMModuleCreateWithNameInContext("gallivm",
+                                                          gallivm->context);
+   }
    if (!gallivm->module)
       goto fail;
 
@@ -535,7 +578,7 @@ gallivm_create(void)
 
    gallivm = CALLOC_STRUCT(gallivm_state);
    if (gallivm) {
-      if (!init_gallivm_state(gallivm)) {
+      if (!init_gallivm_state(gallivm, NULL, NULL)) {
          FREE(gallivm);
          gallivm = NULL;
       }
@@ -549,6 +592,92 @@ gallivm_create(void)
 }
 
 
+/**
+ * Create a new gallivm_state object using the given LLVM context instead
+ * of the global one.
+ *
+ * LLVM contexts must not be used from several threads at once, so this
+ * allows code to be generated on a separate thread.  All gallivm objects
+ * created in a context must then be destroyed on the thread owning it.
+ */
+struct gallivm_state *
+gallivm_create_in_context(LLVMContextRef context)
+{
+#if HAVE_LLVM <= 0x206
+   /* Only the singleton is supported */
+   (void) context;
+   return NULL;
+#else
+   struct gallivm_state *gallivm;
+
+   assert(context);
+
+   gallivm = CALLOC_STRUCT(gallivm_state);
+   if (gallivm) {
+      if (!init_gallivm_state(gallivm, context, NULL)) {
+         FREE(gallivm);
+         gallivm = NULL;
+      }
+   }
+
+   return gallivm;
+#endif
+}
+
+
+/**
+ * Create a new gallivm_state object whose module is loaded from an LLVM
+ * bitcode file written by gallivm_write_bitcode().  The functions in it
+ * have already been optimized, so they can be passed straight to
+ * gallivm_compile_module() and gallivm_jit_function().
+ * \param context  the LLVM context to use, or NULL for the global one
+ * \return  NULL if the file can't be read or parsed
+ */
+struct gallivm_state *
+gallivm_create_from_bitcode(LLVMContextRef context,
+                            const char *filename)
+{
+#if HAVE_LLVM <= 0x206
+   /* Can't replace the module of the singleton */
+   (void) context;
+   (void) filename;
+   return NULL;
+#else
+   struct gallivm_state *gallivm;
+
+   gallivm = CALLOC_STRUCT(gallivm_state);
+   if (gallivm) {
+      if (!init_gallivm_state(gallivm, context, filename)) {
+         FREE(gallivm);
+         gallivm = NULL;
+      }
+   }
+
+   return gallivm;
+#endif
+}
+
+
+/**
+ * Write the (verified and optimized) module to an LLVM bitcode file.
+ * Must be called before gallivm_compile_module(), as function bodies are
+ * freed once they have been JIT compiled.  Modules which embed pointers
+ * into this process are refused.
+ * \return  TRUE for success, FALSE for failure
+ */
+boolean
+gallivm_write_bitcode(struct gallivm_state *gallivm,
+                      const char *filename)
+{
+   assert(!gallivm->compiled);
+
+   if (gallivm->has_pointer_constants)
+      return FALSE;
+
+   return LLVMWriteBitcodeToFile(gallivm->module, filename) == 0;
+}
+
+
 /**
  * Destroy a gallivm_state object.
  */
@@ -46,6 +46,8 @@ struct gallivm_state
    LLVMContextRef context;
    LLVMBuilderRef builder;
    unsigned compiled;
+   /** Code embeds process-specific addresses, see lp_build_const_int_pointer */
+   boolean has_pointer_constants;
 };
 
 
@@ -56,6 +58,17 @@ lp_build_init(void);
 struct gallivm_state *
 gallivm_create(void);
 
+struct gallivm_state *
+gallivm_create_in_context(LLVMContextRef context);
+
+struct gallivm_state *
+gallivm_create_from_bitcode(LLVMContextRef context,
+                            const char *filename);
+
+boolean
+gallivm_write_bitcode(struct gallivm_state *gallivm,
+                      const char *filename);
+
 void
 gallivm_destroy(struct gallivm_state *gallivm);
 
@@ -63,6 +63,7 @@ struct lp_build_mask_context;
 struct gallivm_state;
 struct lp_derivatives;
 struct lp_build_tgsi_gs_iface;
+struct lp_build_tgsi_cs_iface;
 
 
 enum lp_build_tex_modifier {
@@ -157,6 +158,12 @@ struct lp_bld_tgsi_system_values {
    LLVMValueRef instance_id;
    LLVMValueRef vertex_id;
    LLVMValueRef prim_id;
+
+   /* Compute shaders: per-lane thread ids, scalar block id and sizes */
+   LLVMValueRef thread_id[3];
+   LLVMValueRef block_id[3];
+   LLVMValueRef block_size[3];
+   LLVMValueRef grid_size[3];
 };
 
 
@@ -231,7 +238,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef (*outputs)[4],
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface);
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface);
 
 
 void
@@ -422,6 +430,39 @@ struct lp_build_tgsi_gs_iface
                        LLVMValueRef emitted_prims_vec);
 };
 
+/**
+ * Compute shader memory interface.
+ *
+ * Turns a scalar byte address in one of the TGSI_RESOURCE_* address
+ * spaces (global, local, private or input) into a pointer the shader
+ * can load from and store to.
+ */
+struct lp_build_tgsi_cs_iface
+{
+   LLVMValueRef (*resource_ptr)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                                struct lp_build_tgsi_context *bld_base,
+                                unsigned resource,
+                                LLVMValueRef address);
+
+   /**
+    * Optional.  Called for BARRIER; top_level is FALSE when
+    * the instruction is inside control flow or a subroutine.  The
+    * interface may start executing other threads of the block from here
+    * on, replacing the thread ids and the storage of the temporaries.
+    */
+   void (*barrier)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                   struct lp_build_tgsi_context *bld_base,
+                   boolean top_level,
+                   struct lp_bld_tgsi_system_values *system_values,
+                   LLVMValueRef *temps_array);
+
+   /**
+    * Optional.  Storage for the temporaries, as an array of vectors,
+    * instead of a private alloca.
+    */
+   LLVMValueRef temps_array;
+};
+
 struct lp_build_tgsi_soa_context
 {
    struct lp_build_tgsi_context bld_base;
@@ -435,6 +476,8 @@ struct lp_build_tgsi_soa_context
    LLVMValueRef emitted_vertices_vec_ptr;
    LLVMValueRef max_output_vertices_vec;
 
+   const struct lp_build_tgsi_cs_iface *cs_iface;
+
    LLVMValueRef consts_ptr;
    LLVMValueRef const_sizes_ptr;
    const LLVMValueRef (*inputs)[TGSI_NUM_CHANNELS];
@@ -1535,6 +1535,36 @@ emit_fetch_system_value(
       atype = TGSI_TYPE_UNSIGNED;
       break;
 
+   case TGSI_SEMANTIC_THREAD_ID:
+      res = swizzle < 3 ? bld->system_values.thread_id[swizzle] :
+                          bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_ID:
+      res = swizzle < 3 ?
+            lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                      bld->system_values.block_id[swizzle]) :
+            bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+      res = swizzle < 3 ?
+            lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                      bld->system_values.block_size[swizzle]) :
+            bld_base->uint_bld.one;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_GRID_SIZE:
+      res = swizzle < 3 ?
+            lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                      bld->system_values.grid_size[swizzle]) :
+            bld_base->uint_bld.one;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
    default:
       assert(!"unexpected semantic in emit_fetch_system_value");
       res = bld_base->base.zero;
@@ -1836,6 +1866,10 @@ emit_store(
    unsigned chan_index;
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
 
+   /* STORE writes the resource itself, there's no register to update */
+   if (info->num_dst && inst->Dst[0].Register.File == TGSI_FILE_RESOURCE)
+      return;
+
    if(info->num_dst) {
       LLVMValueRef pred[TGSI_NUM_CHANNELS];
 
@@ -3188,6 +3222,176 @@ end_primitive(
    }
 }
 
+/**
+ * Per-lane LOAD/STORE through the compute memory interface.
+ *
+ * Lanes are handled one at a time under the execution mask, since the
+ * addresses are arbitrary and inactive lanes may hold garbage.  Channel
+ * n of each lane accesses the dword at address + 4 * n.
+ */
+static void
+emit_resource_access(struct lp_build_tgsi_soa_context *bld,
+                     unsigned resource,
+                     LLVMValueRef address,
+                     unsigned writemask,
+                     LLVMValueRef *values,
+                     boolean is_store)
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld->bld_base.uint_bld;
+   LLVMTypeRef i32_ptr_type =
+      LLVMPointerType(LLVMInt32TypeInContext(gallivm->context), 0);
+   LLVMValueRef mask = mask_vec(&bld->bld_base);
+   LLVMValueRef res_ptr[TGSI_NUM_CHANNELS];
+   unsigned i, chan;
+
+   address = LLVMBuildBitCast(builder, address, uint_bld->vec_type, "");
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (!(writemask & (1 << chan)))
+         continue;
+      if (is_store)
+         values[chan] = LLVMBuildBitCast(builder, values[chan],
+                                         uint_bld->vec_type, "");
+      else
+         res_ptr[chan] = lp_build_alloca(gallivm, uint_bld->vec_type, "");
+   }
+
+   for (i = 0; i < uint_bld->type.length; i++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, i);
+      LLVMValueRef active, ptr;
+      struct lp_build_if_state ifthen;
+
+      active = LLVMBuildExtractElement(builder, mask, index, "");
+      active = LLVMBuildICmp(builder, LLVMIntNE, active,
+                             lp_build_const_int32(gallivm, 0), "");
+      lp_build_if(&ifthen, gallivm, active);
+
+      ptr = bld->cs_iface->resource_ptr(bld->cs_iface, &bld->bld_base,
+                                        resource,
+                                        LLVMBuildExtractElement(builder,
+                                                                address,
+                                                                index, ""));
+      ptr = LLVMBuildBitCast(builder, ptr, i32_ptr_type, "");
+
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         LLVMValueRef chan_index = lp_build_const_int32(gallivm, chan);
+         LLVMValueRef chan_ptr;
+
+         if (!(writemask & (1 << chan)))
+            continue;
+
+         chan_ptr = LLVMBuildGEP(builder, ptr, &chan_index, 1, "");
+         if (is_store) {
+            LLVMBuildStore(builder,
+                           LLVMBuildExtractElement(builder, values[chan],
+                                                   index, ""),
+                           chan_ptr);
+         }
+         else {
+            LLVMValueRef vec = LLVMBuildLoad(builder, res_ptr[chan], "");
+            vec = LLVMBuildInsertElement(builder, vec,
+                                         LLVMBuildLoad(builder, chan_ptr, ""),
+                                         index, "");
+            LLVMBuildStore(builder, vec, res_ptr[chan]);
+         }
+      }
+
+      lp_build_endif(&ifthen);
+   }
+
+   if (!is_store) {
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         if (writemask & (1 << chan))
+            values[chan] = LLVMBuildBitCast(builder,
+                                            LLVMBuildLoad(builder,
+                                                          res_ptr[chan], ""),
+                                            bld->bld_base.base.vec_type, "");
+      }
+   }
+}
+
+static void
+load_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+
+   assert(inst->Src[0].Register.File == TGSI_FILE_RESOURCE);
+
+   emit_resource_access(bld, inst->Src[0].Register.Index,
+                        lp_build_emit_fetch(bld_base, inst, 1, TGSI_CHAN_X),
+                        inst->Dst[0].Register.WriteMask,
+                        emit_data->output, FALSE);
+}
+
+static void
+store_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   unsigned writemask = inst->Dst[0].Register.WriteMask;
+   LLVMValueRef values[TGSI_NUM_CHANNELS];
+   unsigned chan;
+
+   assert(inst->Dst[0].Register.File == TGSI_FILE_RESOURCE);
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (writemask & (1 << chan))
+         values[chan] = lp_build_emit_fetch(bld_base, inst, 1, chan);
+   }
+
+   emit_resource_access(bld, inst->Dst[0].Register.Index,
+                        lp_build_emit_fetch(bld_base, inst, 0, TGSI_CHAN_X),
+                        writemask, values, TRUE);
+}
+
+static void
+mfence_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   /* The threads of a block run in lockstep, or one vector after another,
+    * so they already see each other's accesses in order.  Without atomics
+    * blocks have no way to observe an ordering among themselves.
+    */
+}
+
+static void
+barrier_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context *bld = lp_soa_context(bld_base);
+   struct lp_exec_mask *mask = &bld->exec_mask;
+   struct function_ctx *ctx = func_ctx(mask);
+   boolean top_level;
+
+   /* The threads of one SIMD vector always execute in lockstep, so
+    * within a vector there is nothing to do.
+    */
+   if (!bld->cs_iface->barrier)
+      return;
+
+   top_level = mask->function_stack_size == 1 &&
+               !mask->ret_in_main &&
+               ctx->cond_stack_size == 0 &&
+               ctx->loop_stack_size == 0 &&
+               ctx->switch_stack_size == 0;
+
+   bld->cs_iface->barrier(bld->cs_iface, bld_base, top_level,
+                          &bld->system_values, &bld->temps_array);
+}
+
 static void
 cal_emit(
    const struct lp_build_tgsi_action * action,
@@ -3488,7 +3692,10 @@ static void emit_prologue(struct lp_build_tgsi_context * bld_base)
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
    struct gallivm_state * gallivm = bld_base->base.gallivm;
 
-   if (bld->indirect_files & (1 << TGSI_FILE_TEMPORARY)) {
+   if (bld->cs_iface && bld->cs_iface->temps_array) {
+      bld->temps_array = bld->cs_iface->temps_array;
+   }
+   else if (bld->indirect_files & (1 << TGSI_FILE_TEMPORARY)) {
       LLVMValueRef array_size =
          lp_build_const_int32(gallivm,
                          bld_base->info->file_max[TGSI_FILE_TEMPORARY] * 4 + 4);
@@ -3623,7 +3830,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS],
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface)
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface)
 {
    struct lp_build_tgsi_soa_context bld;
 
@@ -3754,6 +3962,17 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                                 max_output_vertices);
    }
 
+   if (cs_iface) {
+      bld.cs_iface = cs_iface;
+      if (cs_iface->temps_array) {
+         bld.indirect_files |= (1 << TGSI_FILE_TEMPORARY);
+      }
+      bld.bld_base.op_actions[TGSI_OPCODE_LOAD].emit = load_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_STORE].emit = store_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_MFENCE].emit = mfence_emit;
+   }
+
    lp_exec_mask_init(&bld.exec_mask, &bld.bld_base.int_bld);
 
    bld.system_values = *system_values;
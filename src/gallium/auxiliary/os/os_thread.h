@@ -46,6 +46,10 @@
 #include <signal.h>
 #endif
 
+#if defined(PIPE_OS_LINUX) && defined(HAVE_PTHREAD)
+#include <sched.h>
+#endif
+
 
 /* pipe_thread
  */
@@ -85,6 +89,28 @@ static INLINE int pipe_thread_destroy( pipe_thread thread )
    return thrd_detach( thread );
 }
 
+/**
+ * Restrict the calling thread to run on the given CPU only.
+ * Returns FALSE if thread affinity is not supported on this platform
+ * or the request failed.
+ */
+static INLINE boolean pipe_thread_pin_to_cpu( unsigned cpu )
+{
+#if defined(PIPE_OS_LINUX) && defined(HAVE_PTHREAD) && defined(CPU_SET)
+   cpu_set_t cpuset;
+
+   if (cpu >= CPU_SETSIZE)
+      return FALSE;
+
+   CPU_ZERO(&cpuset);
+   CPU_SET(cpu, &cpuset);
+   return pthread_setaffinity_np(pthread_self(), sizeof cpuset, &cpuset) == 0;
+#else
+   (void) cpu;
+   return FALSE;
+#endif
+}
+
 
 /* pipe_mutex
  */
@@ -158,10 +158,32 @@ pb_slab_range_manager_create(struct pb_manager *provider,
  * Time-based buffer cache.
  *
  * This manager keeps a cache of destroyed buffers during a time interval. 
+ * If maximum_size is not zero, the least recently destroyed buffers are
+ * freed early to keep the total size of the cached buffers below it.
  */
 struct pb_manager *
 pb_cache_manager_create(struct pb_manager *provider, 
-                     	unsigned usecs); 
+                     	unsigned usecs,
+                        uint64_t maximum_size);
+
+
+/**
+ * Buffer cache statistics, see pb_cache_manager_get_stats().
+ */
+struct pb_cache_stats
+{
+   uint64_t hits;          /**< buffers reused from the cache */
+   uint64_t misses;        /**< buffers created by the provider */
+   uint64_t evictions;     /**< buffers freed to stay below maximum_size */
+   uint64_t expired;       /**< buffers freed after the time interval */
+   unsigned num_buffers;   /**< buffers currently cached */
+   uint64_t cache_size;    /**< total size of the cached buffers */
+};
+
+
+void
+pb_cache_manager_get_stats(struct pb_manager *mgr,
+                           struct pb_cache_stats *stats);
 
 
 struct pb_fence_ops;
@@ -39,6 +39,7 @@
 #include "os/os_thread.h"
 #include "util/u_memory.h"
 #include "util/u_double_list.h"
+#include "util/u_math.h"
 #include "util/u_time.h"
 
 #include "pb_buffer.h"
@@ -51,6 +52,16 @@
 #define SUPER(__derived) (&(__derived)->base)
 
 
+/**
+ * Cached buffers are bucketed by the log2 of their size and a hash of
+ * their usage flags.  A buffer can only be reused for a request at most
+ * half its size, so a lookup only has to look at two size classes.
+ */
+#define PB_CACHE_SIZE_CLASSES 32
+#define PB_CACHE_USAGE_BUCKETS 8
+#define PB_CACHE_NUM_BUCKETS (PB_CACHE_SIZE_CLASSES * PB_CACHE_USAGE_BUCKETS)
+
+
 struct pb_cache_manager;
 
 
@@ -67,7 +78,11 @@ struct pb_cache_buffer
    /** Caching time interval */
    int64_t start, end;
 
+   /** Position in the manager's delayed list, oldest first */
    struct list_head head;
+
+   /** Position in the bucket list, oldest first */
+   struct list_head bucket_head;
 };
 
 
@@ -82,6 +97,14 @@ struct pb_cache_manager
    
    struct list_head delayed;
    pb_size numDelayed;
+
+   struct list_head buckets[PB_CACHE_NUM_BUCKETS];
+
+   /** Total size of the delayed buffers, kept below maximum_size if set */
+   uint64_t cache_size;
+   uint64_t maximum_size;
+
+   struct pb_cache_stats stats;
 };
 
 
@@ -101,6 +124,17 @@ pb_cache_manager(struct pb_manager *mgr)
 }
 
 
+static INLINE unsigned
+pb_cache_bucket(pb_size size, unsigned usage)
+{
+   unsigned size_class = util_logbase2(MAX2(size, 1));
+   unsigned usage_hash = (usage ^ (usage >> 3) ^ (usage >> 6) ^ (usage >> 9)) &
+                         (PB_CACHE_USAGE_BUCKETS - 1);
+
+   return size_class * PB_CACHE_USAGE_BUCKETS + usage_hash;
+}
+
+
 /**
  * Actually destroy the buffer.
  */
@@ -110,8 +144,10 @@ _pb_cache_buffer_destroy(struct pb_cache_buffer *buf)
    struct pb_cache_manager *mgr = buf->mgr;
 
    LIST_DEL(&buf->head);
+   LIST_DEL(&buf->bucket_head);
    assert(mgr->numDelayed);
    --mgr->numDelayed;
+   mgr->cache_size -= buf->base.size;
    assert(!pipe_is_referenced(&buf->base.reference));
    pb_reference(&buf->buffer, NULL);
    FREE(buf);
@@ -139,6 +175,7 @@ _pb_cache_buffer_list_check_free(struct pb_cache_manager *mgr)
 	 break;
 	 
       _pb_cache_buffer_destroy(buf);
+      ++mgr->stats.expired;
 
       curr = next; 
       next = curr->next;
@@ -156,11 +193,32 @@ pb_cache_buffer_destroy(struct pb_buffer *_buf)
    assert(!pipe_is_referenced(&buf->base.reference));
    
    _pb_cache_buffer_list_check_free(mgr);
-   
+
+   /* Don't keep buffers which would never fit in the cache at all */
+   if (mgr->maximum_size && buf->base.size > mgr->maximum_size) {
+      pipe_mutex_unlock(mgr->mutex);
+      pb_reference(&buf->buffer, NULL);
+      FREE(buf);
+      return;
+   }
+
+   /* Evict the least recently released buffers to make room */
+   while (mgr->maximum_size &&
+          mgr->cache_size + buf->base.size > mgr->maximum_size) {
+      struct pb_cache_buffer *oldest =
+         LIST_ENTRY(struct pb_cache_buffer, mgr->delayed.next, head);
+      _pb_cache_buffer_destroy(oldest);
+      ++mgr->stats.evictions;
+   }
+
    buf->start = os_time_get();
    buf->end = buf->start + mgr->usecs;
    LIST_ADDTAIL(&buf->head, &mgr->delayed);
+   LIST_ADDTAIL(&buf->bucket_head,
+                &mgr->buckets[pb_cache_bucket(buf->base.size,
+                                              buf->base.usage)]);
    ++mgr->numDelayed;
+   mgr->cache_size += buf->base.size;
    pipe_mutex_unlock(mgr->mutex);
 }
 
@@ -256,6 +314,34 @@ pb_cache_is_buffer_compat(struct pb_cache_buffer *buf,
 }
 
 
+/**
+ * Look for a reusable buffer in the given bucket.  Buffers are in the
+ * order they were released, so once one is found busy, the later ones
+ * are most likely busy too.
+ */
+static struct pb_cache_buffer *
+pb_cache_bucket_find(struct pb_cache_manager *mgr, unsigned bucket,
+                     pb_size size, const struct pb_desc *desc)
+{
+   struct list_head *curr;
+
+   for (curr = mgr->buckets[bucket].next;
+        curr != &mgr->buckets[bucket];
+        curr = curr->next) {
+      struct pb_cache_buffer *buf =
+         LIST_ENTRY(struct pb_cache_buffer, curr, bucket_head);
+      int ret = pb_cache_is_buffer_compat(buf, size, desc);
+
+      if (ret > 0)
+         return buf;
+      if (ret == -1)
+         break;
+   }
+
+   return NULL;
+}
+
+
 static struct pb_buffer *
 pb_cache_manager_create_buffer(struct pb_manager *_mgr, 
                                pb_size size,
@@ -263,60 +349,35 @@ pb_cache_manager_create_buffer(struct pb_manager *_mgr,
 {
    struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
    struct pb_cache_buffer *buf;
-   struct pb_cache_buffer *curr_buf;
-   struct list_head *curr, *next;
-   int64_t now;
-   int ret = 0;
+   unsigned bucket;
 
    pipe_mutex_lock(mgr->mutex);
 
-   buf = NULL;
-   curr = mgr->delayed.next;
-   next = curr->next;
-   
-   /* search in the expired buffers, freeing them in the process */
-   now = os_time_get();
-   while(curr != &mgr->delayed) {
-      curr_buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-      if(!buf && (ret = pb_cache_is_buffer_compat(curr_buf, size, desc) > 0))
-         buf = curr_buf;
-      else if(os_time_timeout(curr_buf->start, curr_buf->end, now))
-         _pb_cache_buffer_destroy(curr_buf);
-      else
-         /* This buffer (and all hereafter) are still hot in cache */
-         break;
-      if (ret == -1)
-         break;
-      curr = next; 
-      next = curr->next;
-   }
+   bucket = pb_cache_bucket(size, desc->usage);
+   buf = pb_cache_bucket_find(mgr, bucket, size, desc);
+   if (!buf && bucket + PB_CACHE_USAGE_BUCKETS < PB_CACHE_NUM_BUCKETS)
+      buf = pb_cache_bucket_find(mgr, bucket + PB_CACHE_USAGE_BUCKETS,
+                                 size, desc);
 
-   /* keep searching in the hot buffers */
-   if(!buf && ret != -1) {
-      while(curr != &mgr->delayed) {
-         curr_buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-         ret = pb_cache_is_buffer_compat(curr_buf, size, desc);
-         if (ret > 0) {
-            buf = curr_buf;
-            break;
-         }
-         if (ret == -1)
-            break;
-         /* no need to check the timeout here */
-         curr = next;
-         next = curr->next;
-      }
-   }
-   
    if(buf) {
       LIST_DEL(&buf->head);
+      LIST_DEL(&buf->bucket_head);
       --mgr->numDelayed;
+      mgr->cache_size -= buf->base.size;
+      ++mgr->stats.hits;
+   }
+   else
+      ++mgr->stats.misses;
+
+   /* free the expired buffers in the process */
+   _pb_cache_buffer_list_check_free(mgr);
+
+   if(buf) {
       pipe_mutex_unlock(mgr->mutex);
       /* Increase refcount */
       pipe_reference_init(&buf->base.reference, 1);
       return &buf->base;
    }
-   
    pipe_mutex_unlock(mgr->mutex);
 
    buf = CALLOC_STRUCT(pb_cache_buffer);
@@ -385,11 +446,27 @@ pb_cache_manager_destroy(struct pb_manager *mgr)
 }
 
 
+void
+pb_cache_manager_get_stats(struct pb_manager *_mgr,
+                           struct pb_cache_stats *stats)
+{
+   struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
+
+   pipe_mutex_lock(mgr->mutex);
+   *stats = mgr->stats;
+   stats->num_buffers = mgr->numDelayed;
+   stats->cache_size = mgr->cache_size;
+   pipe_mutex_unlock(mgr->mutex);
+}
+
+
 struct pb_manager *
 pb_cache_manager_create(struct pb_manager *provider, 
-                     	unsigned usecs) 
+                     	unsigned usecs,
+                        uint64_t maximum_size)
 {
    struct pb_cache_manager *mgr;
+   unsigned i;
 
    if(!provider)
       return NULL;
@@ -403,8 +480,11 @@ pb_cache_manager_create(struct pb_manager *provider,
    mgr->base.flush = pb_cache_manager_flush;
    mgr->provider = provider;
    mgr->usecs = usecs;
+   mgr->maximum_size = maximum_size;
    LIST_INITHEAD(&mgr->delayed);
    mgr->numDelayed = 0;
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++)
+      LIST_INITHEAD(&mgr->buckets[i]);
    pipe_mutex_init(mgr->mutex);
       
    return &mgr->base;
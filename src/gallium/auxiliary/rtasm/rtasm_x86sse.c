@@ -68,6 +68,9 @@ void x86_print_reg( struct x86_reg reg )
    case file_x87:
       debug_printf( "fp%u", reg.idx );
       break;
+   case file_YMM:
+      debug_printf( "YMM%u", reg.idx );
+      break;
    }
 
    if (reg.mod == mod_DISP8 ||
@@ -1508,6 +1511,187 @@ void sse2_rcpss( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+/***********************************************************************
+ * AVX, AVX2 and F16C instructions
+ */
+
+/* Values for the opcode map and implied prefix fields of the VEX prefix
+ */
+#define VEX_MAP_0F    1
+#define VEX_MAP_0F38  2
+#define VEX_MAP_0F3A  3
+
+#define VEX_PP_NONE   0
+#define VEX_PP_66     1
+
+/* Emit a VEX prefix followed by the opcode.  vvvv is the extra source
+ * register of the non-destructive forms, or 0 when there is none (it is
+ * stored inverted).  Registers are restricted to the first eight, like
+ * everywhere else in this file, so the inverted R/X/B bits are all set.
+ */
+static void emit_vex( struct x86_function *p,
+                      unsigned map, unsigned pp, unsigned w, unsigned l,
+                      unsigned vvvv, unsigned char op )
+{
+   unsigned char vl = ((~vvvv & 0xf) << 3) | (l << 2) | pp;
+
+   if (map == VEX_MAP_0F && !w)
+      emit_3ub(p, 0xc5, 0x80 | vl, op);
+   else {
+      emit_3ub(p, 0xc4, 0xe0 | map, (w << 7) | vl);
+      emit_1ub(p, op);
+   }
+}
+
+static unsigned vex_l( struct x86_reg dst, struct x86_reg src )
+{
+   return (dst.mod == mod_REG ? dst.file : src.file) == file_YMM;
+}
+
+void avx_vzeroupper( struct x86_function *p )
+{
+   DUMP();
+   emit_3ub(p, 0xc5, 0xf8, 0x77);
+}
+
+void avx_vmovups( struct x86_function *p,
+                  struct x86_reg dst,
+                  struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   if (dst.mod == mod_REG) {
+      emit_vex(p, VEX_MAP_0F, VEX_PP_NONE, 0, vex_l(dst, src), 0, 0x10);
+      emit_modrm( p, dst, src );
+   }
+   else {
+      assert(src.mod == mod_REG);
+      emit_vex(p, VEX_MAP_0F, VEX_PP_NONE, 0, vex_l(dst, src), 0, 0x11);
+      emit_modrm( p, src, dst );
+   }
+}
+
+void avx_vcvtdq2ps( struct x86_function *p,
+                    struct x86_reg dst,
+                    struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_vex(p, VEX_MAP_0F, VEX_PP_NONE, 0, vex_l(dst, src), 0, 0x5b);
+   emit_modrm( p, dst, src );
+}
+
+void avx_vmulps( struct x86_function *p,
+                 struct x86_reg dst,
+                 struct x86_reg src0,
+                 struct x86_reg src1 )
+{
+   DUMP_RR( dst, src1 );
+   assert(src0.mod == mod_REG);
+   emit_vex(p, VEX_MAP_0F, VEX_PP_NONE, 0, vex_l(dst, src1), src0.idx, 0x59);
+   emit_modrm( p, dst, src1 );
+}
+
+void avx_vshufps( struct x86_function *p,
+                  struct x86_reg dst,
+                  struct x86_reg src0,
+                  struct x86_reg src1,
+                  unsigned char shuf )
+{
+   DUMP_RRI( dst, src1, shuf );
+   assert(src0.mod == mod_REG);
+   emit_vex(p, VEX_MAP_0F, VEX_PP_NONE, 0, vex_l(dst, src1), src0.idx, 0xc6);
+   emit_modrm( p, dst, src1 );
+   emit_1ub(p, shuf);
+}
+
+/* The register source form needs AVX2.
+ */
+void avx_vbroadcastss( struct x86_function *p,
+                       struct x86_reg dst,
+                       struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_vex(p, VEX_MAP_0F38, VEX_PP_66, 0, vex_l(dst, src), 0, 0x18);
+   emit_modrm( p, dst, src );
+}
+
+/* dst = src0 with the 128-bit half selected by imm replaced by src1
+ */
+void avx_vinsertf128( struct x86_function *p,
+                      struct x86_reg dst,
+                      struct x86_reg src0,
+                      struct x86_reg src1,
+                      unsigned char imm )
+{
+   DUMP_RRI( dst, src1, imm );
+   assert(dst.file == file_YMM && src0.file == file_YMM);
+   emit_vex(p, VEX_MAP_0F3A, VEX_PP_66, 0, 1, src0.idx, 0x18);
+   emit_modrm( p, dst, src1 );
+   emit_1ub(p, imm);
+}
+
+/* dst = the 128-bit half of src selected by imm
+ */
+void avx_vextractf128( struct x86_function *p,
+                       struct x86_reg dst,
+                       struct x86_reg src,
+                       unsigned char imm )
+{
+   DUMP_RRI( dst, src, imm );
+   assert(src.file == file_YMM);
+   emit_vex(p, VEX_MAP_0F3A, VEX_PP_66, 0, 1, 0, 0x19);
+   emit_modrm( p, src, dst );
+   emit_1ub(p, imm);
+}
+
+/* The 128-bit forms of the vpmov[sz]x* instructions only need AVX.
+ */
+void avx2_vpmovzxbd( struct x86_function *p,
+                     struct x86_reg dst,
+                     struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_vex(p, VEX_MAP_0F38, VEX_PP_66, 0, dst.file == file_YMM, 0, 0x31);
+   emit_modrm( p, dst, src );
+}
+
+void avx2_vpmovzxwd( struct x86_function *p,
+                     struct x86_reg dst,
+                     struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_vex(p, VEX_MAP_0F38, VEX_PP_66, 0, dst.file == file_YMM, 0, 0x33);
+   emit_modrm( p, dst, src );
+}
+
+void avx2_vpmovsxbd( struct x86_function *p,
+                     struct x86_reg dst,
+                     struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_vex(p, VEX_MAP_0F38, VEX_PP_66, 0, dst.file == file_YMM, 0, 0x21);
+   emit_modrm( p, dst, src );
+}
+
+void avx2_vpmovsxwd( struct x86_function *p,
+                     struct x86_reg dst,
+                     struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_vex(p, VEX_MAP_0F38, VEX_PP_66, 0, dst.file == file_YMM, 0, 0x23);
+   emit_modrm( p, dst, src );
+}
+
+/* Convert four (xmm dst) or eight (ymm dst) half floats to floats.
+ */
+void f16c_vcvtph2ps( struct x86_function *p,
+                     struct x86_reg dst,
+                     struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_vex(p, VEX_MAP_0F38, VEX_PP_66, 0, dst.file == file_YMM, 0, 0x13);
+   emit_modrm( p, dst, src );
+}
+
 /***********************************************************************
  * x87 instructions
  */
@@ -2164,6 +2348,12 @@ static void x86_init_func_common( struct x86_function *p )
       p->caps |= X86_SSE3;
    if(util_cpu_caps.has_sse4_1)
       p->caps |= X86_SSE4_1;
+   if(util_cpu_caps.has_avx)
+      p->caps |= X86_AVX;
+   if(util_cpu_caps.has_avx2)
+      p->caps |= X86_AVX2;
+   if(util_cpu_caps.has_avx && util_cpu_caps.has_f16c)
+      p->caps |= X86_F16C;
    p->csr = p->store;
    DUMP_START();
 }
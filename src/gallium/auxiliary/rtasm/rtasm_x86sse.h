@@ -35,7 +35,7 @@
  * for mmx/sse/sse2 support on the cpu.
  */
 struct x86_reg {
-   unsigned file:2;
+   unsigned file:3;
    unsigned idx:4;
    unsigned mod:2;		/* mod_REG if this is just a register */
    int      disp:24;		/* only +/- 23bits of offset - should be enough... */
@@ -47,6 +47,9 @@ struct x86_reg {
 #define X86_SSE2 8
 #define X86_SSE3 0x10
 #define X86_SSE4_1 0x20
+#define X86_AVX 0x40
+#define X86_AVX2 0x80
+#define X86_F16C 0x100
 
 struct x86_function {
    unsigned caps;
@@ -65,7 +68,8 @@ enum x86_reg_file {
    file_REG32,
    file_MMX,
    file_XMM,
-   file_x87
+   file_x87,
+   file_YMM
 };
 
 /* Values for mod field of modr/m byte
@@ -270,6 +274,30 @@ void sse2_pshuflw( struct x86_function *p, struct x86_reg dst, struct x86_reg sr
 void sse2_pshufhw( struct x86_function *p, struct x86_reg dst, struct x86_reg src, uint8_t imm );
 void sse2_pshufd( struct x86_function *p, struct x86_reg dst, struct x86_reg src, uint8_t imm );
 
+/* VEX encoded instructions.  The vector length comes from the register
+ * operands: file_YMM registers give the 256-bit form, file_XMM ones the
+ * 128-bit form, which zeroes the upper half of the destination.
+ */
+void avx_vzeroupper( struct x86_function *p );
+void avx_vmovups( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void avx_vcvtdq2ps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void avx_vmulps( struct x86_function *p, struct x86_reg dst, struct x86_reg src0,
+                 struct x86_reg src1 );
+void avx_vshufps( struct x86_function *p, struct x86_reg dst, struct x86_reg src0,
+                  struct x86_reg src1, unsigned char shuf );
+void avx_vbroadcastss( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void avx_vinsertf128( struct x86_function *p, struct x86_reg dst, struct x86_reg src0,
+                      struct x86_reg src1, unsigned char imm );
+void avx_vextractf128( struct x86_function *p, struct x86_reg dst, struct x86_reg src,
+                       unsigned char imm );
+
+void avx2_vpmovzxbd( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void avx2_vpmovzxwd( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void avx2_vpmovsxbd( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void avx2_vpmovsxwd( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+
+void f16c_vcvtph2ps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+
 void sse_prefetchnta( struct x86_function *p, struct x86_reg ptr);
 void sse_prefetch0( struct x86_function *p, struct x86_reg ptr);
 void sse_prefetch1( struct x86_function *p, struct x86_reg ptr);
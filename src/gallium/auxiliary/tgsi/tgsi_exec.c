@@ -60,6 +60,7 @@
 #include "tgsi_exec.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
+#include "util/u_sse.h"
 
 
 #define DEBUG_EXECUTION 0
@@ -632,6 +633,178 @@ tgsi_check_soa_dependencies(const struct tgsi_full_instruction *inst)
 }
 
 
+/*
+ * Pre-decoded operands.
+ *
+ * Most operands are direct accesses to a register file, which only need
+ * the register file, index and swizzle to be decoded once, when the shader
+ * is bound.  decode_operands() resolves those to pointers (or constant
+ * buffer offsets) so that fetch_operand() and store_operand() can skip
+ * fetch_source() and store_dest().  Everything else (indirect addressing,
+ * 2D register files, predicated writes, GS outputs) is left to the
+ * generic paths.
+ */
+
+enum tgsi_exec_operand_kind
+{
+   TGSI_EXEC_OPERAND_GENERIC = 0,
+   TGSI_EXEC_OPERAND_CHANNEL,    /**< register channels */
+   TGSI_EXEC_OPERAND_IMMEDIATE,  /**< immediate components */
+   TGSI_EXEC_OPERAND_CONSTANT    /**< constant buffer components */
+};
+
+struct tgsi_exec_src_operand
+{
+   enum tgsi_exec_operand_kind Kind;
+
+   /** TGSI_EXEC_OPERAND_CHANNEL: the swizzled channels */
+   const union tgsi_exec_channel *Chan[TGSI_NUM_CHANNELS];
+
+   /** TGSI_EXEC_OPERAND_IMMEDIATE/CONSTANT: offsets of the swizzled
+    * components in mach->Imms or in the constant buffer
+    */
+   uint Pos[TGSI_NUM_CHANNELS];
+   uint Buffer;
+};
+
+struct tgsi_exec_dst_operand
+{
+   enum tgsi_exec_operand_kind Kind;
+
+   /** TGSI_EXEC_OPERAND_CHANNEL: the destination channels */
+   union tgsi_exec_channel *Chan[TGSI_NUM_CHANNELS];
+};
+
+struct tgsi_exec_operands
+{
+   struct tgsi_exec_src_operand Src[TGSI_FULL_MAX_SRC_REGISTERS];
+   struct tgsi_exec_dst_operand Dst;
+};
+
+
+static void
+decode_src_operand(struct tgsi_exec_machine *mach,
+                   const struct tgsi_full_src_register *reg,
+                   struct tgsi_exec_src_operand *op)
+{
+   const uint index = reg->Register.Index;
+   uint chan;
+
+   op->Kind = TGSI_EXEC_OPERAND_GENERIC;
+
+   if (reg->Register.Indirect)
+      return;
+
+   if (reg->Register.Dimension) {
+      /* only constant buffers can be selected directly */
+      if (reg->Register.File != TGSI_FILE_CONSTANT ||
+          reg->Dimension.Indirect ||
+          reg->Dimension.Index >= PIPE_MAX_CONSTANT_BUFFERS)
+         return;
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      const uint swizzle = tgsi_util_get_full_src_register_swizzle(reg, chan);
+
+      switch (reg->Register.File) {
+      case TGSI_FILE_TEMPORARY:
+         op->Chan[chan] = &mach->Temps[index].xyzw[swizzle];
+         break;
+      case TGSI_FILE_INPUT:
+         op->Chan[chan] = &mach->Inputs[index].xyzw[swizzle];
+         break;
+      case TGSI_FILE_OUTPUT:
+         op->Chan[chan] = &mach->Outputs[index].xyzw[swizzle];
+         break;
+      case TGSI_FILE_SYSTEM_VALUE:
+         /* not swizzled, see fetch_src_file_channel() */
+         op->Chan[chan] = &mach->SystemValue[index];
+         break;
+      case TGSI_FILE_IMMEDIATE:
+      case TGSI_FILE_CONSTANT:
+         op->Pos[chan] = index * 4 + swizzle;
+         break;
+      default:
+         return;
+      }
+   }
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_IMMEDIATE:
+      op->Kind = TGSI_EXEC_OPERAND_IMMEDIATE;
+      break;
+   case TGSI_FILE_CONSTANT:
+      op->Kind = TGSI_EXEC_OPERAND_CONSTANT;
+      op->Buffer = reg->Register.Dimension ? reg->Dimension.Index : 0;
+      break;
+   default:
+      op->Kind = TGSI_EXEC_OPERAND_CHANNEL;
+      break;
+   }
+}
+
+static void
+decode_dst_operand(struct tgsi_exec_machine *mach,
+                   const struct tgsi_full_instruction *inst,
+                   struct tgsi_exec_dst_operand *op)
+{
+   const struct tgsi_full_dst_register *reg = &inst->Dst[0];
+   const uint index = reg->Register.Index;
+   uint chan;
+
+   op->Kind = TGSI_EXEC_OPERAND_GENERIC;
+
+   if (inst->Instruction.NumDstRegs == 0 ||
+       inst->Instruction.Predicate ||
+       reg->Register.Indirect ||
+       reg->Register.Dimension)
+      return;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      switch (reg->Register.File) {
+      case TGSI_FILE_TEMPORARY:
+         op->Chan[chan] = &mach->Temps[index].xyzw[chan];
+         break;
+      case TGSI_FILE_OUTPUT:
+         /* GS outputs move along with each emitted vertex */
+         if (mach->Processor == TGSI_PROCESSOR_GEOMETRY)
+            return;
+         op->Chan[chan] = &mach->Outputs[index].xyzw[chan];
+         break;
+      case TGSI_FILE_ADDRESS:
+         op->Chan[chan] = &mach->Addrs[index].xyzw[chan];
+         break;
+      default:
+         return;
+      }
+   }
+
+   op->Kind = TGSI_EXEC_OPERAND_CHANNEL;
+}
+
+/**
+ * Resolve the operands of all the instructions of the bound shader.
+ */
+static void
+decode_operands(struct tgsi_exec_machine *mach)
+{
+   uint i, j;
+
+   for (i = 0; i < mach->NumInstructions; i++) {
+      const struct tgsi_full_instruction *inst = &mach->Instructions[i];
+      struct tgsi_exec_operands *ops = &mach->Operands[i];
+
+      for (j = 0; j < TGSI_FULL_MAX_SRC_REGISTERS; j++) {
+         if (j < inst->Instruction.NumSrcRegs)
+            decode_src_operand(mach, &inst->Src[j], &ops->Src[j]);
+         else
+            ops->Src[j].Kind = TGSI_EXEC_OPERAND_GENERIC;
+      }
+      decode_dst_operand(mach, inst, &ops->Dst);
+   }
+}
+
+
 /**
  * Initialize machine state by expanding tokens to full instructions,
  * allocating temporary storage, setting up constants, etc.
@@ -670,6 +843,9 @@ tgsi_exec_machine_bind_shader(
       mach->Instructions = NULL;
       mach->NumInstructions = 0;
 
+      FREE(mach->Operands);
+      mach->Operands = NULL;
+
       return;
    }
 
@@ -804,6 +980,17 @@ tgsi_exec_machine_bind_shader(
    FREE(mach->Instructions);
    mach->Instructions = instructions;
    mach->NumInstructions = numInstructions;
+
+   FREE(mach->Operands);
+   mach->Operands = (struct tgsi_exec_operands *)
+      MALLOC(MAX2(numInstructions, 1) * sizeof(struct tgsi_exec_operands));
+   if (!mach->Operands) {
+      FREE(mach->Instructions);
+      mach->Instructions = NULL;
+      mach->NumInstructions = 0;
+      return;
+   }
+   decode_operands(mach);
 }
 
 
@@ -865,6 +1052,7 @@ tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
 {
    if (mach) {
       FREE(mach->Instructions);
+      FREE(mach->Operands);
       FREE(mach->Declarations);
 
       align_free(mach->Inputs);
@@ -1009,6 +1197,96 @@ micro_sub(union tgsi_exec_channel *dst,
    dst->f[3] = src0->f[3] - src1->f[3];
 }
 
+
+/*
+ * Wide micro ops.
+ *
+ * These operate on all TGSI_NUM_CHANNELS * TGSI_QUAD_SIZE lanes of a
+ * vector, one SSE quad at a time, and are used instead of the per-channel
+ * micro ops above when an instruction writes all four channels.  Without
+ * SSE they fall back to plain C.  The machine itself still executes one
+ * quad per channel.
+ *
+ * Results must be bit-identical to the narrow versions, so MAD is never
+ * fused, and MIN/MAX rely on the SSE semantics of returning the second
+ * operand when either is NaN, which is what micro_min/max do.
+ */
+
+#define TGSI_EXEC_VECTOR_LANES (TGSI_NUM_CHANNELS * TGSI_QUAD_SIZE)
+
+#if defined(PIPE_ARCH_SSE)
+
+#define TGSI_EXEC_SIMD_WIDTH 4
+typedef __m128 simd_float;
+#define simd_load(p)       _mm_loadu_ps(p)
+#define simd_store(p, v)   _mm_storeu_ps(p, v)
+#define simd_add(a, b)     _mm_add_ps(a, b)
+#define simd_sub(a, b)     _mm_sub_ps(a, b)
+#define simd_mul(a, b)     _mm_mul_ps(a, b)
+#define simd_min(a, b)     _mm_min_ps(a, b)
+#define simd_max(a, b)     _mm_max_ps(a, b)
+
+#else
+
+#define TGSI_EXEC_SIMD_WIDTH 1
+typedef float simd_float;
+#define simd_load(p)       (*(p))
+#define simd_store(p, v)   (*(p) = (v))
+#define simd_add(a, b)     ((a) + (b))
+#define simd_sub(a, b)     ((a) - (b))
+#define simd_mul(a, b)     ((a) * (b))
+#define simd_min(a, b)     ((a) < (b) ? (a) : (b))
+#define simd_max(a, b)     ((a) > (b) ? (a) : (b))
+
+#endif
+
+#define WIDE_BINARY_OP(NAME, EXPR)                                          \
+static void                                                                 \
+micro_wide_##NAME(struct tgsi_exec_vector *dst,                             \
+                  const struct tgsi_exec_vector *src0,                      \
+                  const struct tgsi_exec_vector *src1)                      \
+{                                                                           \
+   const float *a = &src0->xyzw[0].f[0];                                    \
+   const float *b = &src1->xyzw[0].f[0];                                    \
+   float *d = &dst->xyzw[0].f[0];                                           \
+   unsigned i;                                                              \
+                                                                            \
+   for (i = 0; i < TGSI_EXEC_VECTOR_LANES; i += TGSI_EXEC_SIMD_WIDTH) {     \
+      simd_float x = simd_load(a + i);                                      \
+      simd_float y = simd_load(b + i);                                      \
+      simd_store(d + i, EXPR);                                              \
+   }                                                                        \
+}
+
+WIDE_BINARY_OP(add, simd_add(x, y))
+WIDE_BINARY_OP(sub, simd_sub(x, y))
+WIDE_BINARY_OP(mul, simd_mul(x, y))
+WIDE_BINARY_OP(min, simd_min(x, y))
+WIDE_BINARY_OP(max, simd_max(x, y))
+
+#undef WIDE_BINARY_OP
+
+static void
+micro_wide_mad(struct tgsi_exec_vector *dst,
+               const struct tgsi_exec_vector *src0,
+               const struct tgsi_exec_vector *src1,
+               const struct tgsi_exec_vector *src2)
+{
+   const float *a = &src0->xyzw[0].f[0];
+   const float *b = &src1->xyzw[0].f[0];
+   const float *c = &src2->xyzw[0].f[0];
+   float *d = &dst->xyzw[0].f[0];
+   unsigned i;
+
+   for (i = 0; i < TGSI_EXEC_VECTOR_LANES; i += TGSI_EXEC_SIMD_WIDTH) {
+      simd_float x = simd_load(a + i);
+      simd_float y = simd_load(b + i);
+      simd_float z = simd_load(c + i);
+      simd_store(d + i, simd_add(simd_mul(x, y), z));
+   }
+}
+
+
 static void
 fetch_src_file_channel(const struct tgsi_exec_machine *mach,
                        const uint chan_index,
@@ -1130,6 +1408,28 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
    }
 }
 
+static INLINE void
+apply_src_modifiers(union tgsi_exec_channel *chan,
+                    const struct tgsi_full_src_register *reg,
+                    enum tgsi_exec_datatype src_datatype)
+{
+   if (reg->Register.Absolute) {
+      if (src_datatype == TGSI_EXEC_DATA_FLOAT) {
+         micro_abs(chan, chan);
+      } else {
+         micro_iabs(chan, chan);
+      }
+   }
+
+   if (reg->Register.Negate) {
+      if (src_datatype == TGSI_EXEC_DATA_FLOAT) {
+         micro_neg(chan, chan);
+      } else {
+         micro_ineg(chan, chan);
+      }
+   }
+}
+
 static void
 fetch_source(const struct tgsi_exec_machine *mach,
              union tgsi_exec_channel *chan,
@@ -1279,20 +1579,50 @@ fetch_source(const struct tgsi_exec_machine *mach,
                           &index2D,
                           chan);
 
-   if (reg->Register.Absolute) {
-      if (src_datatype == TGSI_EXEC_DATA_FLOAT) {
-         micro_abs(chan, chan);
-      } else {
-         micro_iabs(chan, chan);
-      }
-   }
+   apply_src_modifiers(chan, reg, src_datatype);
+}
 
-   if (reg->Register.Negate) {
-      if (src_datatype == TGSI_EXEC_DATA_FLOAT) {
-         micro_neg(chan, chan);
-      } else {
-         micro_ineg(chan, chan);
-      }
+static INLINE void
+store_channel(union tgsi_exec_channel *dst,
+              const union tgsi_exec_channel *chan,
+              uint execmask,
+              uint saturate)
+{
+   uint i;
+
+   switch (saturate) {
+   case TGSI_SAT_NONE:
+      for (i = 0; i < TGSI_QUAD_SIZE; i++)
+         if (execmask & (1 << i))
+            dst->i[i] = chan->i[i];
+      break;
+
+   case TGSI_SAT_ZERO_ONE:
+      for (i = 0; i < TGSI_QUAD_SIZE; i++)
+         if (execmask & (1 << i)) {
+            if (chan->f[i] < 0.0f)
+               dst->f[i] = 0.0f;
+            else if (chan->f[i] > 1.0f)
+               dst->f[i] = 1.0f;
+            else
+               dst->i[i] = chan->i[i];
+         }
+      break;
+
+   case TGSI_SAT_MINUS_PLUS_ONE:
+      for (i = 0; i < TGSI_QUAD_SIZE; i++)
+         if (execmask & (1 << i)) {
+            if (chan->f[i] < -1.0f)
+               dst->f[i] = -1.0f;
+            else if (chan->f[i] > 1.0f)
+               dst->f[i] = 1.0f;
+            else
+               dst->i[i] = chan->i[i];
+         }
+      break;
+
+   default:
+      assert( 0 );
    }
 }
 
@@ -1512,47 +1842,89 @@ store_dest(struct tgsi_exec_machine *mach,
       }
    }
 
-   switch (inst->Instruction.Saturate) {
-   case TGSI_SAT_NONE:
-      for (i = 0; i < TGSI_QUAD_SIZE; i++)
-         if (execmask & (1 << i))
-            dst->i[i] = chan->i[i];
+   store_channel(dst, chan, execmask, inst->Instruction.Saturate);
+}
+
+
+/**
+ * Like fetch_source(), for source src_index of an instruction of the bound
+ * shader, using the pre-decoded operand when possible.
+ */
+static INLINE void
+fetch_operand(const struct tgsi_exec_machine *mach,
+              union tgsi_exec_channel *chan,
+              const struct tgsi_full_instruction *inst,
+              uint src_index,
+              uint chan_index,
+              enum tgsi_exec_datatype src_datatype)
+{
+   const struct tgsi_full_src_register *reg = &inst->Src[src_index];
+   const struct tgsi_exec_src_operand *op =
+      &mach->Operands[inst - mach->Instructions].Src[src_index];
+
+   switch (op->Kind) {
+   case TGSI_EXEC_OPERAND_CHANNEL:
+      *chan = *op->Chan[chan_index];
       break;
 
-   case TGSI_SAT_ZERO_ONE:
-      for (i = 0; i < TGSI_QUAD_SIZE; i++)
-         if (execmask & (1 << i)) {
-            if (chan->f[i] < 0.0f)
-               dst->f[i] = 0.0f;
-            else if (chan->f[i] > 1.0f)
-               dst->f[i] = 1.0f;
-            else
-               dst->i[i] = chan->i[i];
-         }
+   case TGSI_EXEC_OPERAND_IMMEDIATE:
+      chan->f[0] =
+      chan->f[1] =
+      chan->f[2] =
+      chan->f[3] = (&mach->Imms[0][0])[op->Pos[chan_index]];
       break;
 
-   case TGSI_SAT_MINUS_PLUS_ONE:
-      for (i = 0; i < TGSI_QUAD_SIZE; i++)
-         if (execmask & (1 << i)) {
-            if (chan->f[i] < -1.0f)
-               dst->f[i] = -1.0f;
-            else if (chan->f[i] > 1.0f)
-               dst->f[i] = 1.0f;
-            else
-               dst->i[i] = chan->i[i];
-         }
+   case TGSI_EXEC_OPERAND_CONSTANT:
+      {
+         const uint *buf = (const uint *) mach->Consts[op->Buffer];
+         const uint pos = op->Pos[chan_index];
+
+         assert(buf);
+
+         /* const buffer bounds check */
+         chan->u[0] =
+         chan->u[1] =
+         chan->u[2] =
+         chan->u[3] = pos < mach->ConstsSize[op->Buffer] ? buf[pos] : 0;
+      }
       break;
 
    default:
-      assert( 0 );
+      fetch_source(mach, chan, reg, chan_index, src_datatype);
+      return;
+   }
+
+   apply_src_modifiers(chan, reg, src_datatype);
+}
+
+/**
+ * Like store_dest(), for the destination of an instruction of the bound
+ * shader, using the pre-decoded operand when possible.
+ */
+static INLINE void
+store_operand(struct tgsi_exec_machine *mach,
+              const union tgsi_exec_channel *chan,
+              const struct tgsi_full_instruction *inst,
+              uint chan_index,
+              enum tgsi_exec_datatype dst_datatype)
+{
+   const struct tgsi_exec_dst_operand *op =
+      &mach->Operands[inst - mach->Instructions].Dst;
+
+   if (op->Kind == TGSI_EXEC_OPERAND_CHANNEL) {
+      store_channel(op->Chan[chan_index], chan, mach->ExecMask,
+                    inst->Instruction.Saturate);
+   }
+   else {
+      store_dest(mach, chan, &inst->Dst[0], inst, chan_index, dst_datatype);
    }
 }
 
 #define FETCH(VAL,INDEX,CHAN)\
-    fetch_source(mach, VAL, &inst->Src[INDEX], CHAN, TGSI_EXEC_DATA_FLOAT)
+    fetch_operand(mach, VAL, inst, INDEX, CHAN, TGSI_EXEC_DATA_FLOAT)
 
 #define IFETCH(VAL,INDEX,CHAN)\
-    fetch_source(mach, VAL, &inst->Src[INDEX], CHAN, TGSI_EXEC_DATA_INT)
+    fetch_operand(mach, VAL, inst, INDEX, CHAN, TGSI_EXEC_DATA_INT)
 
 
 /**
@@ -1857,7 +2229,7 @@ exec_tex(struct tgsi_exec_machine *mach,
 
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &r[chan], &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &r[chan], inst, chan, TGSI_EXEC_DATA_FLOAT);
       }
    }
 }
@@ -1963,7 +2335,7 @@ exec_txd(struct tgsi_exec_machine *mach,
 
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &r[chan], &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &r[chan], inst, chan, TGSI_EXEC_DATA_FLOAT);
       }
    }
 }
@@ -2035,15 +2407,15 @@ exec_txf(struct tgsi_exec_machine *mach,
 
       for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
          if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-            store_dest(mach, &r[swizzles[chan]],
-                       &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+            store_operand(mach, &r[swizzles[chan]],
+                       inst, chan, TGSI_EXEC_DATA_FLOAT);
          }
       }
    }
    else {
       for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
          if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-            store_dest(mach, &r[chan], &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+            store_operand(mach, &r[chan], inst, chan, TGSI_EXEC_DATA_FLOAT);
          }
       }
    }
@@ -2059,7 +2431,7 @@ exec_txq(struct tgsi_exec_machine *mach,
    uint chan;
    int i,j;
 
-   fetch_source(mach, &src, &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_INT);
+   fetch_operand(mach, &src, inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_INT);
 
    /* XXX: This interface can't return per-pixel values */
    mach->Sampler->get_dims(mach->Sampler, unit, src.i[0], result);
@@ -2072,7 +2444,7 @@ exec_txq(struct tgsi_exec_machine *mach,
 
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &r[chan], &inst->Dst[0], inst, chan,
+         store_operand(mach, &r[chan], inst, chan,
                     TGSI_EXEC_DATA_INT);
       }
    }
@@ -2203,8 +2575,8 @@ exec_sample(struct tgsi_exec_machine *mach,
 
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &r[swizzles[chan]],
-                    &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &r[swizzles[chan]],
+                    inst, chan, TGSI_EXEC_DATA_FLOAT);
       }
    }
 }
@@ -2285,8 +2657,8 @@ exec_sample_d(struct tgsi_exec_machine *mach,
 
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &r[swizzles[chan]],
-                    &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &r[swizzles[chan]],
+                    inst, chan, TGSI_EXEC_DATA_FLOAT);
       }
    }
 }
@@ -2467,7 +2839,7 @@ exec_vector(struct tgsi_exec_machine *mach,
          union tgsi_exec_channel dst;
 
          op(&dst);
-         store_dest(mach, &dst, &inst->Dst[0], inst, chan, dst_datatype);
+         store_operand(mach, &dst, inst, chan, dst_datatype);
       }
    }
 }
@@ -2486,11 +2858,11 @@ exec_scalar_unary(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel src;
    union tgsi_exec_channel dst;
 
-   fetch_source(mach, &src, &inst->Src[0], TGSI_CHAN_X, src_datatype);
+   fetch_operand(mach, &src, inst, 0, TGSI_CHAN_X, src_datatype);
    op(&dst, &src);
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &dst, &inst->Dst[0], inst, chan, dst_datatype);
+         store_operand(mach, &dst, inst, chan, dst_datatype);
       }
    }
 }
@@ -2509,13 +2881,13 @@ exec_vector_unary(struct tgsi_exec_machine *mach,
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
          union tgsi_exec_channel src;
 
-         fetch_source(mach, &src, &inst->Src[0], chan, src_datatype);
+         fetch_operand(mach, &src, inst, 0, chan, src_datatype);
          op(&dst.xyzw[chan], &src);
       }
    }
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &dst.xyzw[chan], &inst->Dst[0], inst, chan, dst_datatype);
+         store_operand(mach, &dst.xyzw[chan], inst, chan, dst_datatype);
       }
    }
 }
@@ -2535,12 +2907,12 @@ exec_scalar_binary(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel src[2];
    union tgsi_exec_channel dst;
 
-   fetch_source(mach, &src[0], &inst->Src[0], TGSI_CHAN_X, src_datatype);
-   fetch_source(mach, &src[1], &inst->Src[1], TGSI_CHAN_X, src_datatype);
+   fetch_operand(mach, &src[0], inst, 0, TGSI_CHAN_X, src_datatype);
+   fetch_operand(mach, &src[1], inst, 1, TGSI_CHAN_X, src_datatype);
    op(&dst, &src[0], &src[1]);
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &dst, &inst->Dst[0], inst, chan, dst_datatype);
+         store_operand(mach, &dst, inst, chan, dst_datatype);
       }
    }
 }
@@ -2559,14 +2931,14 @@ exec_vector_binary(struct tgsi_exec_machine *mach,
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
          union tgsi_exec_channel src[2];
 
-         fetch_source(mach, &src[0], &inst->Src[0], chan, src_datatype);
-         fetch_source(mach, &src[1], &inst->Src[1], chan, src_datatype);
+         fetch_operand(mach, &src[0], inst, 0, chan, src_datatype);
+         fetch_operand(mach, &src[1], inst, 1, chan, src_datatype);
          op(&dst.xyzw[chan], &src[0], &src[1]);
       }
    }
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &dst.xyzw[chan], &inst->Dst[0], inst, chan, dst_datatype);
+         store_operand(mach, &dst.xyzw[chan], inst, chan, dst_datatype);
       }
    }
 }
@@ -2590,19 +2962,78 @@ exec_vector_trinary(struct tgsi_exec_machine *mach,
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
          union tgsi_exec_channel src[3];
 
-         fetch_source(mach, &src[0], &inst->Src[0], chan, src_datatype);
-         fetch_source(mach, &src[1], &inst->Src[1], chan, src_datatype);
-         fetch_source(mach, &src[2], &inst->Src[2], chan, src_datatype);
+         fetch_operand(mach, &src[0], inst, 0, chan, src_datatype);
+         fetch_operand(mach, &src[1], inst, 1, chan, src_datatype);
+         fetch_operand(mach, &src[2], inst, 2, chan, src_datatype);
          op(&dst.xyzw[chan], &src[0], &src[1], &src[2]);
       }
    }
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &dst.xyzw[chan], &inst->Dst[0], inst, chan, dst_datatype);
+         store_operand(mach, &dst.xyzw[chan], inst, chan, dst_datatype);
       }
    }
 }
 
+typedef void (* micro_wide_binary_op)(struct tgsi_exec_vector *dst,
+                                      const struct tgsi_exec_vector *src0,
+                                      const struct tgsi_exec_vector *src1);
+
+/**
+ * Like exec_vector_binary(), but when all channels are written, fetch the
+ * whole source vectors and execute the wide version of the op on them.
+ */
+static void
+exec_vector_binary_wide(struct tgsi_exec_machine *mach,
+                        const struct tgsi_full_instruction *inst,
+                        micro_wide_binary_op wide_op,
+                        micro_binary_op op)
+{
+   unsigned int chan;
+   struct tgsi_exec_vector src[2];
+   struct tgsi_exec_vector dst;
+
+   if (inst->Dst[0].Register.WriteMask != TGSI_WRITEMASK_XYZW) {
+      exec_vector_binary(mach, inst, op,
+                         TGSI_EXEC_DATA_FLOAT, TGSI_EXEC_DATA_FLOAT);
+      return;
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      fetch_operand(mach, &src[0].xyzw[chan], inst, 0, chan, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &src[1].xyzw[chan], inst, 1, chan, TGSI_EXEC_DATA_FLOAT);
+   }
+   wide_op(&dst, &src[0], &src[1]);
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      store_operand(mach, &dst.xyzw[chan], inst, chan, TGSI_EXEC_DATA_FLOAT);
+   }
+}
+
+static void
+exec_mad(struct tgsi_exec_machine *mach,
+         const struct tgsi_full_instruction *inst)
+{
+   unsigned int chan;
+   struct tgsi_exec_vector src[3];
+   struct tgsi_exec_vector dst;
+
+   if (inst->Dst[0].Register.WriteMask != TGSI_WRITEMASK_XYZW) {
+      exec_vector_trinary(mach, inst, micro_mad,
+                          TGSI_EXEC_DATA_FLOAT, TGSI_EXEC_DATA_FLOAT);
+      return;
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      fetch_operand(mach, &src[0].xyzw[chan], inst, 0, chan, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &src[1].xyzw[chan], inst, 1, chan, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &src[2].xyzw[chan], inst, 2, chan, TGSI_EXEC_DATA_FLOAT);
+   }
+   micro_wide_mad(&dst, &src[0], &src[1], &src[2]);
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      store_operand(mach, &dst.xyzw[chan], inst, chan, TGSI_EXEC_DATA_FLOAT);
+   }
+}
+
 static void
 exec_dp3(struct tgsi_exec_machine *mach,
          const struct tgsi_full_instruction *inst)
@@ -2610,19 +3041,19 @@ exec_dp3(struct tgsi_exec_machine *mach,
    unsigned int chan;
    union tgsi_exec_channel arg[3];
 
-   fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &arg[1], &inst->Src[1], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 1, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    micro_mul(&arg[2], &arg[0], &arg[1]);
 
    for (chan = TGSI_CHAN_Y; chan <= TGSI_CHAN_Z; chan++) {
-      fetch_source(mach, &arg[0], &inst->Src[0], chan, TGSI_EXEC_DATA_FLOAT);
-      fetch_source(mach, &arg[1], &inst->Src[1], chan, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &arg[0], inst, 0, chan, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &arg[1], inst, 1, chan, TGSI_EXEC_DATA_FLOAT);
       micro_mad(&arg[2], &arg[0], &arg[1], &arg[2]);
    }
 
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &arg[2], &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &arg[2], inst, chan, TGSI_EXEC_DATA_FLOAT);
       }
    }
 }
@@ -2634,19 +3065,19 @@ exec_dp4(struct tgsi_exec_machine *mach,
    unsigned int chan;
    union tgsi_exec_channel arg[3];
 
-   fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &arg[1], &inst->Src[1], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 1, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    micro_mul(&arg[2], &arg[0], &arg[1]);
 
    for (chan = TGSI_CHAN_Y; chan <= TGSI_CHAN_W; chan++) {
-      fetch_source(mach, &arg[0], &inst->Src[0], chan, TGSI_EXEC_DATA_FLOAT);
-      fetch_source(mach, &arg[1], &inst->Src[1], chan, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &arg[0], inst, 0, chan, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &arg[1], inst, 1, chan, TGSI_EXEC_DATA_FLOAT);
       micro_mad(&arg[2], &arg[0], &arg[1], &arg[2]);
    }
 
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &arg[2], &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &arg[2], inst, chan, TGSI_EXEC_DATA_FLOAT);
       }
    }
 }
@@ -2658,20 +3089,20 @@ exec_dp2a(struct tgsi_exec_machine *mach,
    unsigned int chan;
    union tgsi_exec_channel arg[3];
 
-   fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &arg[1], &inst->Src[1], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 1, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    micro_mul(&arg[2], &arg[0], &arg[1]);
 
-   fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &arg[1], &inst->Src[1], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 1, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
    micro_mad(&arg[0], &arg[0], &arg[1], &arg[2]);
 
-   fetch_source(mach, &arg[1], &inst->Src[2], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 2, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    micro_add(&arg[0], &arg[0], &arg[1]);
 
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &arg[0], &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &arg[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
       }
    }
 }
@@ -2683,24 +3114,24 @@ exec_dph(struct tgsi_exec_machine *mach,
    unsigned int chan;
    union tgsi_exec_channel arg[3];
 
-   fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &arg[1], &inst->Src[1], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 1, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    micro_mul(&arg[2], &arg[0], &arg[1]);
 
-   fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &arg[1], &inst->Src[1], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 1, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
    micro_mad(&arg[2], &arg[0], &arg[1], &arg[2]);
 
-   fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &arg[1], &inst->Src[1], TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 1, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
    micro_mad(&arg[0], &arg[0], &arg[1], &arg[2]);
 
-   fetch_source(mach, &arg[1], &inst->Src[1], TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 1, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    micro_add(&arg[0], &arg[0], &arg[1]);
 
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &arg[0], &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &arg[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
       }
    }
 }
@@ -2712,17 +3143,17 @@ exec_dp2(struct tgsi_exec_machine *mach,
    unsigned int chan;
    union tgsi_exec_channel arg[3];
 
-   fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &arg[1], &inst->Src[1], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 1, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    micro_mul(&arg[2], &arg[0], &arg[1]);
 
-   fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &arg[1], &inst->Src[1], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[1], inst, 1, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
    micro_mad(&arg[2], &arg[0], &arg[1], &arg[2]);
 
    for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
-         store_dest(mach, &arg[2], &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &arg[2], inst, chan, TGSI_EXEC_DATA_FLOAT);
       }
    }
 }
@@ -2735,13 +3166,13 @@ exec_nrm4(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel arg[4];
    union tgsi_exec_channel scale;
 
-   fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    micro_mul(&scale, &arg[0], &arg[0]);
 
    for (chan = TGSI_CHAN_Y; chan <= TGSI_CHAN_W; chan++) {
       union tgsi_exec_channel product;
 
-      fetch_source(mach, &arg[chan], &inst->Src[0], chan, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &arg[chan], inst, 0, chan, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&product, &arg[chan], &arg[chan]);
       micro_add(&scale, &scale, &product);
    }
@@ -2751,7 +3182,7 @@ exec_nrm4(struct tgsi_exec_machine *mach,
    for (chan = TGSI_CHAN_X; chan <= TGSI_CHAN_W; chan++) {
       if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
          micro_mul(&arg[chan], &arg[chan], &scale);
-         store_dest(mach, &arg[chan], &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &arg[chan], inst, chan, TGSI_EXEC_DATA_FLOAT);
       }
    }
 }
@@ -2765,13 +3196,13 @@ exec_nrm3(struct tgsi_exec_machine *mach,
       union tgsi_exec_channel arg[3];
       union tgsi_exec_channel scale;
 
-      fetch_source(mach, &arg[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &arg[0], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&scale, &arg[0], &arg[0]);
 
       for (chan = TGSI_CHAN_Y; chan <= TGSI_CHAN_Z; chan++) {
          union tgsi_exec_channel product;
 
-         fetch_source(mach, &arg[chan], &inst->Src[0], chan, TGSI_EXEC_DATA_FLOAT);
+         fetch_operand(mach, &arg[chan], inst, 0, chan, TGSI_EXEC_DATA_FLOAT);
          micro_mul(&product, &arg[chan], &arg[chan]);
          micro_add(&scale, &scale, &product);
       }
@@ -2781,13 +3212,13 @@ exec_nrm3(struct tgsi_exec_machine *mach,
       for (chan = TGSI_CHAN_X; chan <= TGSI_CHAN_Z; chan++) {
          if (inst->Dst[0].Register.WriteMask & (1 << chan)) {
             micro_mul(&arg[chan], &arg[chan], &scale);
-            store_dest(mach, &arg[chan], &inst->Dst[0], inst, chan, TGSI_EXEC_DATA_FLOAT);
+            store_operand(mach, &arg[chan], inst, chan, TGSI_EXEC_DATA_FLOAT);
          }
       }
    }
 
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_W) {
-      store_dest(mach, &OneVec, &inst->Dst[0], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &OneVec, inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    }
 }
 
@@ -2799,22 +3230,22 @@ exec_scs(struct tgsi_exec_machine *mach,
       union tgsi_exec_channel arg;
       union tgsi_exec_channel result;
 
-      fetch_source(mach, &arg, &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &arg, inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
 
       if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_X) {
          micro_cos(&result, &arg);
-         store_dest(mach, &result, &inst->Dst[0], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &result, inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
       }
       if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Y) {
          micro_sin(&result, &arg);
-         store_dest(mach, &result, &inst->Dst[0], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &result, inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
       }
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Z) {
-      store_dest(mach, &ZeroVec, &inst->Dst[0], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &ZeroVec, inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_W) {
-      store_dest(mach, &OneVec, &inst->Dst[0], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &OneVec, inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    }
 }
 
@@ -2825,37 +3256,37 @@ exec_x2d(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel r[4];
    union tgsi_exec_channel d[2];
 
-   fetch_source(mach, &r[0], &inst->Src[1], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &r[1], &inst->Src[1], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &r[0], inst, 1, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &r[1], inst, 1, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_XZ) {
-      fetch_source(mach, &r[2], &inst->Src[2], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[2], inst, 2, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&r[2], &r[2], &r[0]);
-      fetch_source(mach, &r[3], &inst->Src[2], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[3], inst, 2, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&r[3], &r[3], &r[1]);
       micro_add(&r[2], &r[2], &r[3]);
-      fetch_source(mach, &r[3], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[3], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
       micro_add(&d[0], &r[2], &r[3]);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_YW) {
-      fetch_source(mach, &r[2], &inst->Src[2], TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[2], inst, 2, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&r[2], &r[2], &r[0]);
-      fetch_source(mach, &r[3], &inst->Src[2], TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[3], inst, 2, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&r[3], &r[3], &r[1]);
       micro_add(&r[2], &r[2], &r[3]);
-      fetch_source(mach, &r[3], &inst->Src[0], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[3], inst, 0, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
       micro_add(&d[1], &r[2], &r[3]);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_X) {
-      store_dest(mach, &d[0], &inst->Dst[0], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &d[0], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Y) {
-      store_dest(mach, &d[1], &inst->Dst[0], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &d[1], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Z) {
-      store_dest(mach, &d[0], &inst->Dst[0], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &d[0], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_W) {
-      store_dest(mach, &d[1], &inst->Dst[0], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &d[1], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    }
 }
 
@@ -2867,22 +3298,22 @@ exec_rfl(struct tgsi_exec_machine *mach,
 
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_XYZ) {
       /* r0 = dp3(src0, src0) */
-      fetch_source(mach, &r[2], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[2], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&r[0], &r[2], &r[2]);
-      fetch_source(mach, &r[4], &inst->Src[0], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[4], inst, 0, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&r[8], &r[4], &r[4]);
       micro_add(&r[0], &r[0], &r[8]);
-      fetch_source(mach, &r[6], &inst->Src[0], TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[6], inst, 0, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&r[8], &r[6], &r[6]);
       micro_add(&r[0], &r[0], &r[8]);
 
       /* r1 = dp3(src0, src1) */
-      fetch_source(mach, &r[3], &inst->Src[1], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[3], inst, 1, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&r[1], &r[2], &r[3]);
-      fetch_source(mach, &r[5], &inst->Src[1], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[5], inst, 1, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&r[8], &r[4], &r[5]);
       micro_add(&r[1], &r[1], &r[8]);
-      fetch_source(mach, &r[7], &inst->Src[1], TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[7], inst, 1, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&r[8], &r[6], &r[7]);
       micro_add(&r[1], &r[1], &r[8]);
 
@@ -2893,21 +3324,21 @@ exec_rfl(struct tgsi_exec_machine *mach,
       if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_X) {
          micro_mul(&r[2], &r[2], &r[1]);
          micro_sub(&r[2], &r[2], &r[3]);
-         store_dest(mach, &r[2], &inst->Dst[0], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &r[2], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
       }
       if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Y) {
          micro_mul(&r[4], &r[4], &r[1]);
          micro_sub(&r[4], &r[4], &r[5]);
-         store_dest(mach, &r[4], &inst->Dst[0], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &r[4], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
       }
       if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Z) {
          micro_mul(&r[6], &r[6], &r[1]);
          micro_sub(&r[6], &r[6], &r[7]);
-         store_dest(mach, &r[6], &inst->Dst[0], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &r[6], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
       }
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_W) {
-      store_dest(mach, &OneVec, &inst->Dst[0], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &OneVec, inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    }
 }
 
@@ -2918,22 +3349,22 @@ exec_xpd(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel r[6];
    union tgsi_exec_channel d[3];
 
-   fetch_source(mach, &r[0], &inst->Src[0], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &r[1], &inst->Src[1], TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &r[0], inst, 0, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &r[1], inst, 1, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
 
    micro_mul(&r[2], &r[0], &r[1]);
 
-   fetch_source(mach, &r[3], &inst->Src[0], TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
-   fetch_source(mach, &r[4], &inst->Src[1], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &r[3], inst, 0, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &r[4], inst, 1, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
 
    micro_mul(&r[5], &r[3], &r[4] );
    micro_sub(&d[TGSI_CHAN_X], &r[2], &r[5]);
 
-   fetch_source(mach, &r[2], &inst->Src[1], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &r[2], inst, 1, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
 
    micro_mul(&r[3], &r[3], &r[2]);
 
-   fetch_source(mach, &r[5], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &r[5], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
 
    micro_mul(&r[1], &r[1], &r[5]);
    micro_sub(&d[TGSI_CHAN_Y], &r[3], &r[1]);
@@ -2943,16 +3374,16 @@ exec_xpd(struct tgsi_exec_machine *mach,
    micro_sub(&d[TGSI_CHAN_Z], &r[5], &r[0]);
 
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_X) {
-      store_dest(mach, &d[TGSI_CHAN_X], &inst->Dst[0], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &d[TGSI_CHAN_X], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Y) {
-      store_dest(mach, &d[TGSI_CHAN_Y], &inst->Dst[0], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &d[TGSI_CHAN_Y], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Z) {
-      store_dest(mach, &d[TGSI_CHAN_Z], &inst->Dst[0], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &d[TGSI_CHAN_Z], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_W) {
-      store_dest(mach, &OneVec, &inst->Dst[0], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &OneVec, inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    }
 }
 
@@ -2964,28 +3395,28 @@ exec_dst(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel d[4];
 
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Y) {
-      fetch_source(mach, &r[0], &inst->Src[0], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
-      fetch_source(mach, &r[1], &inst->Src[1], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[0], inst, 0, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[1], inst, 1, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
       micro_mul(&d[TGSI_CHAN_Y], &r[0], &r[1]);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Z) {
-      fetch_source(mach, &d[TGSI_CHAN_Z], &inst->Src[0], TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &d[TGSI_CHAN_Z], inst, 0, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_W) {
-      fetch_source(mach, &d[TGSI_CHAN_W], &inst->Src[1], TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &d[TGSI_CHAN_W], inst, 1, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    }
 
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_X) {
-      store_dest(mach, &OneVec, &inst->Dst[0], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &OneVec, inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Y) {
-      store_dest(mach, &d[TGSI_CHAN_Y], &inst->Dst[0], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &d[TGSI_CHAN_Y], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Z) {
-      store_dest(mach, &d[TGSI_CHAN_Z], &inst->Dst[0], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &d[TGSI_CHAN_Z], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_W) {
-      store_dest(mach, &d[TGSI_CHAN_W], &inst->Dst[0], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &d[TGSI_CHAN_W], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    }
 }
 
@@ -2995,23 +3426,23 @@ exec_log(struct tgsi_exec_machine *mach,
 {
    union tgsi_exec_channel r[3];
 
-   fetch_source(mach, &r[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &r[0], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    micro_abs(&r[2], &r[0]);  /* r2 = abs(r0) */
    micro_lg2(&r[1], &r[2]);  /* r1 = lg2(r2) */
    micro_flr(&r[0], &r[1]);  /* r0 = floor(r1) */
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_X) {
-      store_dest(mach, &r[0], &inst->Dst[0], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &r[0], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Y) {
       micro_exp2(&r[0], &r[0]);       /* r0 = 2 ^ r0 */
       micro_div(&r[0], &r[2], &r[0]); /* r0 = r2 / r0 */
-      store_dest(mach, &r[0], &inst->Dst[0], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &r[0], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Z) {
-      store_dest(mach, &r[1], &inst->Dst[0], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &r[1], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_W) {
-      store_dest(mach, &OneVec, &inst->Dst[0], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &OneVec, inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    }
 }
 
@@ -3021,22 +3452,22 @@ exec_exp(struct tgsi_exec_machine *mach,
 {
    union tgsi_exec_channel r[3];
 
-   fetch_source(mach, &r[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+   fetch_operand(mach, &r[0], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    micro_flr(&r[1], &r[0]);  /* r1 = floor(r0) */
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_X) {
       micro_exp2(&r[2], &r[1]);       /* r2 = 2 ^ r1 */
-      store_dest(mach, &r[2], &inst->Dst[0], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &r[2], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Y) {
       micro_sub(&r[2], &r[0], &r[1]); /* r2 = r0 - r1 */
-      store_dest(mach, &r[2], &inst->Dst[0], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &r[2], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Z) {
       micro_exp2(&r[2], &r[0]);       /* r2 = 2 ^ r0 */
-      store_dest(mach, &r[2], &inst->Dst[0], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &r[2], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_W) {
-      store_dest(mach, &OneVec, &inst->Dst[0], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &OneVec, inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    }
 }
 
@@ -3048,29 +3479,29 @@ exec_lit(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel d[3];
 
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_YZ) {
-      fetch_source(mach, &r[0], &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      fetch_operand(mach, &r[0], inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
       if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Z) {
-         fetch_source(mach, &r[1], &inst->Src[0], TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+         fetch_operand(mach, &r[1], inst, 0, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
          micro_max(&r[1], &r[1], &ZeroVec);
 
-         fetch_source(mach, &r[2], &inst->Src[0], TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+         fetch_operand(mach, &r[2], inst, 0, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
          micro_min(&r[2], &r[2], &P128Vec);
          micro_max(&r[2], &r[2], &M128Vec);
          micro_pow(&r[1], &r[1], &r[2]);
          micro_lt(&d[TGSI_CHAN_Z], &ZeroVec, &r[0], &r[1], &ZeroVec);
-         store_dest(mach, &d[TGSI_CHAN_Z], &inst->Dst[0], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &d[TGSI_CHAN_Z], inst, TGSI_CHAN_Z, TGSI_EXEC_DATA_FLOAT);
       }
       if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_Y) {
          micro_max(&d[TGSI_CHAN_Y], &r[0], &ZeroVec);
-         store_dest(mach, &d[TGSI_CHAN_Y], &inst->Dst[0], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
+         store_operand(mach, &d[TGSI_CHAN_Y], inst, TGSI_CHAN_Y, TGSI_EXEC_DATA_FLOAT);
       }
    }
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_X) {
-      store_dest(mach, &OneVec, &inst->Dst[0], inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &OneVec, inst, TGSI_CHAN_X, TGSI_EXEC_DATA_FLOAT);
    }
 
    if (inst->Dst[0].Register.WriteMask & TGSI_WRITEMASK_W) {
-      store_dest(mach, &OneVec, &inst->Dst[0], inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
+      store_operand(mach, &OneVec, inst, TGSI_CHAN_W, TGSI_EXEC_DATA_FLOAT);
    }
 }
 
@@ -3099,7 +3530,7 @@ exec_switch(struct tgsi_exec_machine *mach,
    assert(mach->BreakStackTop < TGSI_EXEC_MAX_BREAK_STACK);
 
    mach->SwitchStack[mach->SwitchStackTop++] = mach->Switch;
-   fetch_source(mach, &mach->Switch.selector, &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_UINT);
+   fetch_operand(mach, &mach->Switch.selector, inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_UINT);
    mach->Switch.mask = 0x0;
    mach->Switch.defaultMask = 0x0;
 
@@ -3117,7 +3548,7 @@ exec_case(struct tgsi_exec_machine *mach,
    union tgsi_exec_channel src;
    uint mask = 0;
 
-   fetch_source(mach, &src, &inst->Src[0], TGSI_CHAN_X, TGSI_EXEC_DATA_UINT);
+   fetch_operand(mach, &src, inst, 0, TGSI_CHAN_X, TGSI_EXEC_DATA_UINT);
 
    if (mach->Switch.selector.u[0] == src.u[0]) {
       mask |= 0x1;
@@ -3610,11 +4041,11 @@ exec_instruction(
       break;
 
    case TGSI_OPCODE_MUL:
-      exec_vector_binary(mach, inst, micro_mul, TGSI_EXEC_DATA_FLOAT, TGSI_EXEC_DATA_FLOAT);
+      exec_vector_binary_wide(mach, inst, micro_wide_mul, micro_mul);
       break;
 
    case TGSI_OPCODE_ADD:
-      exec_vector_binary(mach, inst, micro_add, TGSI_EXEC_DATA_FLOAT, TGSI_EXEC_DATA_FLOAT);
+      exec_vector_binary_wide(mach, inst, micro_wide_add, micro_add);
       break;
 
    case TGSI_OPCODE_DP3:
@@ -3630,11 +4061,11 @@ exec_instruction(
       break;
 
    case TGSI_OPCODE_MIN:
-      exec_vector_binary(mach, inst, micro_min, TGSI_EXEC_DATA_FLOAT, TGSI_EXEC_DATA_FLOAT);
+      exec_vector_binary_wide(mach, inst, micro_wide_min, micro_min);
       break;
 
    case TGSI_OPCODE_MAX:
-      exec_vector_binary(mach, inst, micro_max, TGSI_EXEC_DATA_FLOAT, TGSI_EXEC_DATA_FLOAT);
+      exec_vector_binary_wide(mach, inst, micro_wide_max, micro_max);
       break;
 
    case TGSI_OPCODE_SLT:
@@ -3646,11 +4077,11 @@ exec_instruction(
       break;
 
    case TGSI_OPCODE_MAD:
-      exec_vector_trinary(mach, inst, micro_mad, TGSI_EXEC_DATA_FLOAT, TGSI_EXEC_DATA_FLOAT);
+      exec_mad(mach, inst);
       break;
 
    case TGSI_OPCODE_SUB:
-      exec_vector_binary(mach, inst, micro_sub, TGSI_EXEC_DATA_FLOAT, TGSI_EXEC_DATA_FLOAT);
+      exec_vector_binary_wide(mach, inst, micro_wide_sub, micro_sub);
       break;
 
    case TGSI_OPCODE_LRP:
@@ -350,6 +350,9 @@ struct tgsi_exec_machine
    struct tgsi_full_instruction *Instructions;
    uint NumInstructions;
 
+   /** Pre-decoded operands of Instructions, see decode_operands() */
+   struct tgsi_exec_operands *Operands;
+
    struct tgsi_full_declaration *Declarations;
    uint NumDeclarations;
 
@@ -455,27 +455,47 @@ emit_memcpy(struct translate_sse *p, struct x86_reg dst, struct x86_reg src,
    }
 }
 
+/* Compare everything but the channels' positions.
+ */
 static boolean
-translate_attr_convert(struct translate_sse *p,
-                       const struct translate_element *a,
-                       struct x86_reg src, struct x86_reg dst)
+channels_match(const struct util_format_channel_description *a,
+               const struct util_format_channel_description *b)
 {
-   const struct util_format_description *input_desc =
-      util_format_description(a->input_format);
-   const struct util_format_description *output_desc =
-      util_format_description(a->output_format);
+   return a->type == b->type &&
+          a->normalized == b->normalized &&
+          a->pure_integer == b->pure_integer &&
+          a->size == b->size;
+}
+
+
+static boolean
+is_float32_output(enum pipe_format format)
+{
+   return format == PIPE_FORMAT_R32_FLOAT
+      || format == PIPE_FORMAT_R32G32_FLOAT
+      || format == PIPE_FORMAT_R32G32B32_FLOAT
+      || format == PIPE_FORMAT_R32G32B32A32_FLOAT;
+}
+
+
+/* Check that the element's formats can be handled channel by channel and
+ * set swizzle[i] to the input channel (or SWIZZLE_0/1) output channel i
+ * comes from.
+ */
+static boolean
+get_convert_swizzle(const struct translate_element *a, unsigned swizzle[4])
+{
+   const struct util_format_description *input_desc;
+   const struct util_format_description *output_desc;
    unsigned i;
-   boolean id_swizzle = TRUE;
-   unsigned swizzle[4] =
-      { UTIL_FORMAT_SWIZZLE_NONE, UTIL_FORMAT_SWIZZLE_NONE,
-        UTIL_FORMAT_SWIZZLE_NONE, UTIL_FORMAT_SWIZZLE_NONE };
-   unsigned needed_chans = 0;
-   unsigned imms[2] = { 0, 0x3f800000 };
 
    if (a->output_format == PIPE_FORMAT_NONE
        || a->input_format == PIPE_FORMAT_NONE)
       return FALSE;
 
+   input_desc = util_format_description(a->input_format);
+   output_desc = util_format_description(a->output_format);
+
    if (input_desc->channel[0].size & 7)
       return FALSE;
 
@@ -483,44 +503,156 @@ translate_attr_convert(struct translate_sse *p,
       return FALSE;
 
    for (i = 1; i < input_desc->nr_channels; ++i) {
-      if (memcmp
-          (&input_desc->channel[i], &input_desc->channel[0],
-           sizeof(input_desc->channel[0])))
+      if (!channels_match(&input_desc->channel[i], &input_desc->channel[0]))
          return FALSE;
    }
 
    for (i = 1; i < output_desc->nr_channels; ++i) {
-      if (memcmp
-          (&output_desc->channel[i], &output_desc->channel[0],
-           sizeof(output_desc->channel[0]))) {
+      if (!channels_match(&output_desc->channel[i], &output_desc->channel[0]))
          return FALSE;
-      }
    }
 
+   for (i = 0; i < 4; ++i)
+      swizzle[i] = UTIL_FORMAT_SWIZZLE_NONE;
+
    for (i = 0; i < output_desc->nr_channels; ++i) {
       if (output_desc->swizzle[i] < 4)
          swizzle[output_desc->swizzle[i]] = input_desc->swizzle[i];
    }
 
-   if ((x86_target_caps(p->func) & X86_SSE) &&
-       (0 || a->output_format == PIPE_FORMAT_R32_FLOAT
-        || a->output_format == PIPE_FORMAT_R32G32_FLOAT
-        || a->output_format == PIPE_FORMAT_R32G32B32_FLOAT
-        || a->output_format == PIPE_FORMAT_R32G32B32A32_FLOAT)) {
-      struct x86_reg dataXMM = x86_make_reg(file_XMM, 0);
+   return TRUE;
+}
 
-      for (i = 0; i < output_desc->nr_channels; ++i) {
-         if (swizzle[i] == UTIL_FORMAT_SWIZZLE_0
-             && i >= input_desc->nr_channels)
-            swizzle[i] = i;
+
+/* Channels missing from the input are read from the zero padding of the
+ * loaded register rather than stored as constants.  Returns how many
+ * input channels have to be loaded.
+ */
+static unsigned
+get_needed_chans(const struct util_format_description *input_desc,
+                 const struct util_format_description *output_desc,
+                 unsigned swizzle[4], boolean *id_swizzle)
+{
+   unsigned needed_chans = 0;
+   unsigned i;
+
+   for (i = 0; i < output_desc->nr_channels; ++i) {
+      if (swizzle[i] == UTIL_FORMAT_SWIZZLE_0
+          && i >= input_desc->nr_channels)
+         swizzle[i] = i;
+   }
+
+   *id_swizzle = TRUE;
+   for (i = 0; i < output_desc->nr_channels; ++i) {
+      if (swizzle[i] < 4)
+         needed_chans = MAX2(needed_chans, swizzle[i] + 1);
+      if (swizzle[i] < UTIL_FORMAT_SWIZZLE_0 && swizzle[i] != i)
+         *id_swizzle = FALSE;
+   }
+
+   return needed_chans;
+}
+
+
+/* Store the float32 channels of dataXMM picked by swizzle to dst, or
+ * the constant 0.0/1.0 for SWIZZLE_0/SWIZZLE_1.  Clobbers dataXMM.
+ */
+static void
+emit_store_float32(struct translate_sse *p, struct x86_reg dst,
+                   struct x86_reg dataXMM,
+                   const struct util_format_description *output_desc,
+                   const unsigned swizzle[4])
+{
+   unsigned imms[2] = { 0, 0x3f800000 };
+
+   if (output_desc->nr_channels >= 4
+       && swizzle[0] < UTIL_FORMAT_SWIZZLE_0
+       && swizzle[1] < UTIL_FORMAT_SWIZZLE_0
+       && swizzle[2] < UTIL_FORMAT_SWIZZLE_0
+       && swizzle[3] < UTIL_FORMAT_SWIZZLE_0) {
+      sse_movups(p->func, dst, dataXMM);
+   }
+   else {
+      if (output_desc->nr_channels >= 2
+          && swizzle[0] < UTIL_FORMAT_SWIZZLE_0
+          && swizzle[1] < UTIL_FORMAT_SWIZZLE_0) {
+         sse_movlps(p->func, dst, dataXMM);
       }
+      else {
+         if (swizzle[0] < UTIL_FORMAT_SWIZZLE_0) {
+            sse_movss(p->func, dst, dataXMM);
+         }
+         else {
+            x86_mov_imm(p->func, dst,
+                        imms[swizzle[0] - UTIL_FORMAT_SWIZZLE_0]);
+         }
 
-      for (i = 0; i < output_desc->nr_channels; ++i) {
-         if (swizzle[i] < 4)
-            needed_chans = MAX2(needed_chans, swizzle[i] + 1);
-         if (swizzle[i] < UTIL_FORMAT_SWIZZLE_0 && swizzle[i] != i)
-            id_swizzle = FALSE;
+         if (output_desc->nr_channels >= 2) {
+            if (swizzle[1] < UTIL_FORMAT_SWIZZLE_0) {
+               sse_shufps(p->func, dataXMM, dataXMM, SHUF(1, 1, 2, 3));
+               sse_movss(p->func, x86_make_disp(dst, 4), dataXMM);
+            }
+            else {
+               x86_mov_imm(p->func, x86_make_disp(dst, 4),
+                           imms[swizzle[1] - UTIL_FORMAT_SWIZZLE_0]);
+            }
+         }
+      }
+
+      if (output_desc->nr_channels >= 3) {
+         if (output_desc->nr_channels >= 4
+             && swizzle[2] < UTIL_FORMAT_SWIZZLE_0
+             && swizzle[3] < UTIL_FORMAT_SWIZZLE_0) {
+            sse_movhps(p->func, x86_make_disp(dst, 8), dataXMM);
+         }
+         else {
+            if (swizzle[2] < UTIL_FORMAT_SWIZZLE_0) {
+               sse_shufps(p->func, dataXMM, dataXMM, SHUF(2, 2, 2, 3));
+               sse_movss(p->func, x86_make_disp(dst, 8), dataXMM);
+            }
+            else {
+               x86_mov_imm(p->func, x86_make_disp(dst, 8),
+                           imms[swizzle[2] - UTIL_FORMAT_SWIZZLE_0]);
+            }
+
+            if (output_desc->nr_channels >= 4) {
+               if (swizzle[3] < UTIL_FORMAT_SWIZZLE_0) {
+                  sse_shufps(p->func, dataXMM, dataXMM, SHUF(3, 3, 3, 3));
+                  sse_movss(p->func, x86_make_disp(dst, 12), dataXMM);
+               }
+               else {
+                  x86_mov_imm(p->func, x86_make_disp(dst, 12),
+                              imms[swizzle[3] - UTIL_FORMAT_SWIZZLE_0]);
+               }
+            }
+         }
       }
+   }
+}
+
+
+static boolean
+translate_attr_convert(struct translate_sse *p,
+                       const struct translate_element *a,
+                       struct x86_reg src, struct x86_reg dst)
+{
+   const struct util_format_description *input_desc =
+      util_format_description(a->input_format);
+   const struct util_format_description *output_desc =
+      util_format_description(a->output_format);
+   boolean id_swizzle;
+   unsigned swizzle[4];
+   unsigned needed_chans;
+
+   if (!get_convert_swizzle(a, swizzle))
+      return FALSE;
+
+   if ((x86_target_caps(p->func) & X86_SSE) &&
+       is_float32_output(a->output_format)) {
+      struct x86_reg dataXMM = x86_make_reg(file_XMM, 0);
+
+      needed_chans = get_needed_chans(input_desc, output_desc, swizzle,
+                                      &id_swizzle);
 
       if (needed_chans > 0) {
          switch (input_desc->channel[0].type) {
@@ -626,16 +758,24 @@ translate_attr_convert(struct translate_sse *p,
 
             break;
          case UTIL_FORMAT_TYPE_FLOAT:
-            if (input_desc->channel[0].size != 32
+            if (input_desc->channel[0].size != 16
+                && input_desc->channel[0].size != 32
                 && input_desc->channel[0].size != 64) {
                return FALSE;
             }
             if (swizzle[3] == UTIL_FORMAT_SWIZZLE_1
+                && input_desc->channel[0].size != 16
                 && input_desc->nr_channels <= 3) {
                swizzle[3] = UTIL_FORMAT_SWIZZLE_W;
                needed_chans = CHANNELS_0001;
             }
             switch (input_desc->channel[0].size) {
+            case 16:
+               if (!(x86_target_caps(p->func) & X86_F16C))
+                  return FALSE;
+               emit_load_sse2(p, dataXMM, src, input_desc->nr_channels * 2);
+               f16c_vcvtph2ps(p->func, dataXMM, dataXMM);
+               break;
             case 32:
                emit_load_float32(p, dataXMM, src, needed_chans,
                                  input_desc->nr_channels);
@@ -660,69 +800,7 @@ translate_attr_convert(struct translate_sse *p,
          }
       }
 
-      if (output_desc->nr_channels >= 4
-          && swizzle[0] < UTIL_FORMAT_SWIZZLE_0
-          && swizzle[1] < UTIL_FORMAT_SWIZZLE_0
-          && swizzle[2] < UTIL_FORMAT_SWIZZLE_0
-          && swizzle[3] < UTIL_FORMAT_SWIZZLE_0) {
-         sse_movups(p->func, dst, dataXMM);
-      }
-      else {
-         if (output_desc->nr_channels >= 2
-             && swizzle[0] < UTIL_FORMAT_SWIZZLE_0
-             && swizzle[1] < UTIL_FORMAT_SWIZZLE_0) {
-            sse_movlps(p->func, dst, dataXMM);
-         }
-         else {
-            if (swizzle[0] < UTIL_FORMAT_SWIZZLE_0) {
-               sse_movss(p->func, dst, dataXMM);
-            }
-            else {
-               x86_mov_imm(p->func, dst,
-                           imms[swizzle[0] - UTIL_FORMAT_SWIZZLE_0]);
-            }
-
-            if (output_desc->nr_channels >= 2) {
-               if (swizzle[1] < UTIL_FORMAT_SWIZZLE_0) {
-                  sse_shufps(p->func, dataXMM, dataXMM, SHUF(1, 1, 2, 3));
-                  sse_movss(p->func, x86_make_disp(dst, 4), dataXMM);
-               }
-               else {
-                  x86_mov_imm(p->func, x86_make_disp(dst, 4),
-                              imms[swizzle[1] - UTIL_FORMAT_SWIZZLE_0]);
-               }
-            }
-         }
-
-         if (output_desc->nr_channels >= 3) {
-            if (output_desc->nr_channels >= 4
-                && swizzle[2] < UTIL_FORMAT_SWIZZLE_0
-                && swizzle[3] < UTIL_FORMAT_SWIZZLE_0) {
-               sse_movhps(p->func, x86_make_disp(dst, 8), dataXMM);
-            }
-            else {
-               if (swizzle[2] < UTIL_FORMAT_SWIZZLE_0) {
-                  sse_shufps(p->func, dataXMM, dataXMM, SHUF(2, 2, 2, 3));
-                  sse_movss(p->func, x86_make_disp(dst, 8), dataXMM);
-               }
-               else {
-                  x86_mov_imm(p->func, x86_make_disp(dst, 8),
-                              imms[swizzle[2] - UTIL_FORMAT_SWIZZLE_0]);
-               }
-
-               if (output_desc->nr_channels >= 4) {
-                  if (swizzle[3] < UTIL_FORMAT_SWIZZLE_0) {
-                     sse_shufps(p->func, dataXMM, dataXMM, SHUF(3, 3, 3, 3));
-                     sse_movss(p->func, x86_make_disp(dst, 12), dataXMM);
-                  }
-                  else {
-                     x86_mov_imm(p->func, x86_make_disp(dst, 12),
-                                 imms[swizzle[3] - UTIL_FORMAT_SWIZZLE_0]);
-                  }
-               }
-            }
-         }
-      }
+      emit_store_float32(p, dst, dataXMM, output_desc, swizzle);
       return TRUE;
    }
    else if ((x86_target_caps(p->func) & X86_SSE2)
@@ -741,19 +819,8 @@ translate_attr_convert(struct translate_sse *p,
       struct x86_reg tmp = p->tmp_EAX;
       unsigned imms[2] = { 0, 1 };
 
-      for (i = 0; i < output_desc->nr_channels; ++i) {
-         if (swizzle[i] == UTIL_FORMAT_SWIZZLE_0
-             && i >= input_desc->nr_channels) {
-            swizzle[i] = i;
-         }
-      }
-
-      for (i = 0; i < output_desc->nr_channels; ++i) {
-         if (swizzle[i] < 4)
-            needed_chans = MAX2(needed_chans, swizzle[i] + 1);
-         if (swizzle[i] < UTIL_FORMAT_SWIZZLE_0 && swizzle[i] != i)
-            id_swizzle = FALSE;
-      }
+      needed_chans = get_needed_chans(input_desc, output_desc, swizzle,
+                                      &id_swizzle);
 
       if (needed_chans > 0) {
          emit_load_sse2(p, dataXMM, src,
@@ -883,8 +950,8 @@ translate_attr_convert(struct translate_sse *p,
       }
       return TRUE;
    }
-   else if (!memcmp(&output_desc->channel[0], &input_desc->channel[0],
-                    sizeof(output_desc->channel[0]))) {
+   else if (channels_match(&output_desc->channel[0],
+                           &input_desc->channel[0])) {
       struct x86_reg tmp = p->tmp_EAX;
       unsigned i;
 
@@ -1069,6 +1136,145 @@ translate_attr(struct translate_sse *p,
 }
 
 
+/* Whether translate_attr_convert_x2() can handle the element: 8 and 16-bit
+ * integers and half floats converted to float32.
+ */
+static boolean
+can_convert_x2(struct translate_sse *p, const struct translate_element *a)
+{
+   const struct util_format_description *input_desc;
+   unsigned swizzle[4];
+   unsigned size;
+
+   if (!(x86_target_caps(p->func) & X86_AVX2)
+       || !is_float32_output(a->output_format)
+       || !get_convert_swizzle(a, swizzle))
+      return FALSE;
+
+   input_desc = util_format_description(a->input_format);
+   size = input_desc->channel[0].size;
+
+   switch (input_desc->channel[0].type) {
+   case UTIL_FORMAT_TYPE_UNSIGNED:
+   case UTIL_FORMAT_TYPE_SIGNED:
+      if (size != 8 && size != 16)
+         return FALSE;
+      break;
+   case UTIL_FORMAT_TYPE_FLOAT:
+      if (size != 16 || !(x86_target_caps(p->func) & X86_F16C))
+         return FALSE;
+      break;
+   default:
+      return FALSE;
+   }
+
+   /* three 16-bit channels would need emit_load_sse2()'s temporary */
+   return size * input_desc->nr_channels != 48;
+}
+
+
+/* Convert an attribute of two vertices at once, one per 128-bit lane of
+ * ymm0.  The loads and stores are still done one vertex at a time.
+ */
+static boolean
+translate_attr_convert_x2(struct translate_sse *p,
+                          const struct translate_element *a,
+                          struct x86_reg src0, struct x86_reg dst0,
+                          struct x86_reg src1, struct x86_reg dst1)
+{
+   const struct util_format_description *input_desc =
+      util_format_description(a->input_format);
+   const struct util_format_description *output_desc =
+      util_format_description(a->output_format);
+   struct x86_reg dataXMM = x86_make_reg(file_XMM, 0);
+   struct x86_reg tmpXMM = x86_make_reg(file_XMM, 1);
+   struct x86_reg dataYMM = x86_make_reg(file_YMM, 0);
+   struct x86_reg tmpYMM = x86_make_reg(file_YMM, 1);
+   unsigned size = input_desc->channel[0].size;
+   unsigned type = input_desc->channel[0].type;
+   unsigned swizzle[4];
+   unsigned needed_chans;
+   boolean id_swizzle;
+
+   get_convert_swizzle(a, swizzle);
+   needed_chans = get_needed_chans(input_desc, output_desc, swizzle,
+                                   &id_swizzle);
+   if (needed_chans == 0)
+      return FALSE;
+
+   /* Put the second vertex's data right after the first's, padded to
+    * four bytes for the 8-bit formats and to eight for the 16-bit ones,
+    * so that widening to dwords leaves each vertex in its own lane.
+    */
+   emit_load_sse2(p, dataXMM, src0, size * input_desc->nr_channels >> 3);
+   emit_load_sse2(p, tmpXMM, src1, size * input_desc->nr_channels >> 3);
+   if (size == 8)
+      sse2_punpckldq(p->func, dataXMM, tmpXMM);
+   else
+      sse2_punpcklqdq(p->func, dataXMM, tmpXMM);
+
+   if (type == UTIL_FORMAT_TYPE_FLOAT) {
+      f16c_vcvtph2ps(p->func, dataYMM, dataXMM);
+   }
+   else {
+      if (type == UTIL_FORMAT_TYPE_UNSIGNED) {
+         if (size == 8)
+            avx2_vpmovzxbd(p->func, dataYMM, dataXMM);
+         else
+            avx2_vpmovzxwd(p->func, dataYMM, dataXMM);
+      }
+      else {
+         if (size == 8)
+            avx2_vpmovsxbd(p->func, dataYMM, dataXMM);
+         else
+            avx2_vpmovsxwd(p->func, dataYMM, dataXMM);
+      }
+      avx_vcvtdq2ps(p->func, dataYMM, dataYMM);
+
+      if (input_desc->channel[0].normalized) {
+         unsigned factor;
+         if (type == UTIL_FORMAT_TYPE_UNSIGNED)
+            factor = size == 8 ? CONST_INV_255 : CONST_INV_65535;
+         else
+            factor = size == 8 ? CONST_INV_127 : CONST_INV_32767;
+
+         avx_vbroadcastss(p->func, tmpYMM,
+                          x86_make_disp(p->machine_EDI,
+                                        get_offset(p, &p->consts[factor][0])));
+         avx_vmulps(p->func, dataYMM, dataYMM, tmpYMM);
+      }
+   }
+
+   if (!id_swizzle) {
+      avx_vshufps(p->func, dataYMM, dataYMM, dataYMM,
+                  SHUF(swizzle[0], swizzle[1], swizzle[2], swizzle[3]));
+   }
+
+   avx_vextractf128(p->func, tmpXMM, dataYMM, 1);
+
+   /* the rest of the loop is legacy SSE code */
+   avx_vzeroupper(p->func);
+
+   emit_store_float32(p, dst0, dataXMM, output_desc, swizzle);
+   emit_store_float32(p, dst1, tmpXMM, output_desc, swizzle);
+   return TRUE;
+}
+
+
+static boolean
+translate_attr_x2(struct translate_sse *p,
+                  const struct translate_element *a,
+                  struct x86_reg src0, struct x86_reg dst0,
+                  struct x86_reg src1, struct x86_reg dst1)
+{
+   if (a->input_format != a->output_format && can_convert_x2(p, a) &&
+       translate_attr_convert_x2(p, a, src0, dst0, src1, dst1))
+      return TRUE;
+
+   return translate_attr(p, a, src0, dst0) && translate_attr(p, a, src1, dst1);
+}
+
+
 static boolean
 init_inputs(struct translate_sse *p, unsigned index_size)
 {
@@ -1270,6 +1476,81 @@ incr_inputs(struct translate_sse *p, unsigned index_size)
 }
 
 
+/* With AVX2, the linear single buffer case runs two vertices per loop
+ * iteration when that lets some attribute be converted a pair at a time.
+ */
+static boolean
+use_vertex_pairs(struct translate_sse *p, unsigned index_size)
+{
+   unsigned j;
+
+   if (index_size || p->nr_buffer_variants != 1 ||
+       p->buffer_variant[0].instance_divisor)
+      return FALSE;
+
+   for (j = 0; j < p->translate.key.nr_elements; j++) {
+      const struct translate_element *a = &p->translate.key.element[j];
+
+      if (a->type == TRANSLATE_ELEMENT_NORMAL &&
+          a->input_format != a->output_format && can_convert_x2(p, a))
+         return TRUE;
+   }
+
+   return FALSE;
+}
+
+
+/* Emit the loop body for two consecutive vertices of the linear case:
+ * ESI points to the first, ECX is set to point to the second.
+ */
+static boolean
+emit_vertex_pair(struct translate_sse *p)
+{
+   struct x86_reg stride =
+      x86_make_disp(p->machine_EDI, get_offset(p, &p->buffer[0].stride));
+   unsigned output_stride = p->translate.key.output_stride;
+   unsigned j;
+
+   x86_mov(p->func, p->src_ECX, stride);
+   x64_rexw(p->func);
+   x86_add(p->func, p->src_ECX, p->idx_ESI);
+
+   for (j = 0; j < p->translate.key.nr_elements; j++) {
+      const struct translate_element *a = &p->translate.key.element[j];
+      struct x86_reg vb0, vb1;
+
+      if (p->element_to_buffer_variant[j] == ELEMENT_BUFFER_INSTANCE_ID) {
+         vb0 = vb1 = get_buffer_ptr(p, 0, ELEMENT_BUFFER_INSTANCE_ID,
+                                    p->idx_ESI);
+      }
+      else {
+         vb0 = p->idx_ESI;
+         vb1 = p->src_ECX;
+      }
+
+      if (!translate_attr_x2(p, a,
+                             x86_make_disp(vb0, a->input_offset),
+                             x86_make_disp(p->outbuf_EBX, a->output_offset),
+                             x86_make_disp(vb1, a->input_offset),
+                             x86_make_disp(p->outbuf_EBX,
+                                           output_stride + a->output_offset)))
+         return FALSE;
+   }
+
+   x64_rexw(p->func);
+   x86_lea(p->func, p->outbuf_EBX,
+           x86_make_disp(p->outbuf_EBX, 2 * output_stride));
+
+   x64_rexw(p->func);
+   x86_mov(p->func, p->idx_ESI, p->src_ECX);
+   x64_rexw(p->func);
+   x86_add(p->func, p->idx_ESI, stride);
+   sse_prefetchnta(p->func, x86_make_disp(p->idx_ESI, 192));
+
+   return TRUE;
+}
+
+
 /* Build run( struct translate *machine,
  *            unsigned start,
  *            unsigned count,
@@ -1291,6 +1572,7 @@ build_vertex_emit(struct translate_sse *p,
                   struct x86_function *func, unsigned index_size)
 {
    int fixup, label;
+   int fixup_done = 0;
    unsigned j;
 
    memset(p->reg_to_const, 0xff, sizeof(p->reg_to_const));
@@ -1368,6 +1650,31 @@ build_vertex_emit(struct translate_sse *p,
     */
    init_inputs(p, index_size);
 
+   if (use_vertex_pairs(p, index_size)) {
+      int fixup_single;
+
+      x86_cmp_imm(p->func, p->count_EBP, 2);
+      fixup_single = x86_jcc_forward(p->func, cc_NAE);
+
+      label = x86_get_label(p->func);
+      if (!emit_vertex_pair(p))
+         return FALSE;
+
+      x86_sub_imm(p->func, p->count_EBP, 2);
+      x86_cmp_imm(p->func, p->count_EBP, 2);
+      x86_jcc(p->func, cc_AE, label);
+
+      /* at most one vertex left, which goes through the loop below */
+      x86_cmp_imm(p->func, p->count_EBP, 0);
+      fixup_done = x86_jcc_forward(p->func, cc_E);
+
+      x86_fixup_fwd_jump(p->func, fixup_single);
+
+      /* the constants loaded above may not be in registers here */
+      memset(p->reg_to_const, 0xff, sizeof(p->reg_to_const));
+      memset(p->const_to_reg, 0xff, sizeof(p->const_to_reg));
+   }
+
    /* Note address for loop jump
     */
    label = x86_get_label(p->func);
@@ -1414,9 +1721,11 @@ build_vertex_emit(struct translate_sse *p,
    if (p->func->need_emms)
       mmx_emms(p->func);
 
-   /* Land forward jump here:
+   /* Land forward jumps here:
     */
    x86_fixup_fwd_jump(p->func, fixup);
+   if (fixup_done)
+      x86_fixup_fwd_jump(p->func, fixup_done);
 
    /* Pop regs and return
     */
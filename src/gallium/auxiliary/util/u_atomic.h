@@ -62,6 +62,12 @@ p_atomic_inc(int32_t *v)
    __asm__ __volatile__("lock; incl %0":"+m"(*v));
 }
 
+static INLINE int32_t
+p_atomic_inc_return(int32_t *v)
+{
+   return __sync_add_and_fetch(v, 1);
+}
+
 static INLINE void
 p_atomic_dec(int32_t *v)
 {
@@ -109,6 +115,12 @@ p_atomic_inc(int32_t *v)
    __asm__ __volatile__("lock; incl %0":"+m"(*v));
 }
 
+static INLINE int32_t
+p_atomic_inc_return(int32_t *v)
+{
+   return __sync_add_and_fetch(v, 1);
+}
+
 static INLINE void
 p_atomic_dec(int32_t *v)
 {
@@ -154,6 +166,12 @@ p_atomic_inc(int32_t *v)
    (void) __sync_add_and_fetch(v, 1);
 }
 
+static INLINE int32_t
+p_atomic_inc_return(int32_t *v)
+{
+   return __sync_add_and_fetch(v, 1);
+}
+
 static INLINE void
 p_atomic_dec(int32_t *v)
 {
@@ -185,6 +203,7 @@ p_atomic_cmpxchg(int32_t *v, int32_t old, int32_t _new)
 #define p_atomic_read(_v) (*(_v))
 #define p_atomic_dec_zero(_v) ((boolean) --(*(_v)))
 #define p_atomic_inc(_v) ((void) (*(_v))++)
+#define p_atomic_inc_return(_v) (++(*(_v)))
 #define p_atomic_dec(_v) ((void) (*(_v))--)
 #define p_atomic_cmpxchg(_v, old, _new) (*(_v) == old ? *(_v) = (_new) : *(_v))
 
@@ -227,6 +246,22 @@ p_atomic_inc(int32_t *v)
    }
 }
 
+static INLINE int32_t
+p_atomic_inc_return(int32_t *v)
+{
+   int32_t n;
+
+   __asm {
+      mov       ecx, [v]
+      mov       eax, 1
+      lock xadd dword ptr [ecx], eax
+      inc       eax
+      mov       [n], eax
+   }
+
+   return n;
+}
+
 static INLINE void
 p_atomic_dec(int32_t *v)
 {
@@ -288,6 +323,12 @@ p_atomic_inc(int32_t *v)
    _InterlockedIncrement((long *)v);
 }
 
+static INLINE int32_t
+p_atomic_inc_return(int32_t *v)
+{
+   return _InterlockedIncrement((long *)v);
+}
+
 static INLINE void
 p_atomic_dec(int32_t *v)
 {
@@ -328,6 +369,7 @@ p_atomic_dec_zero(int32_t *v)
 }
 
 #define p_atomic_inc(_v) atomic_inc_32((uint32_t *) _v)
+#define p_atomic_inc_return(_v) ((int32_t) atomic_inc_32_nv((uint32_t *) _v))
 #define p_atomic_dec(_v) atomic_dec_32((uint32_t *) _v)
 
 #define p_atomic_cmpxchg(_v, _old, _new) \
@@ -0,0 +1,277 @@
+/**************************************************************************
+ *
+ * Copyright 2009 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Pool of threads for compiling shader variants in the background.
+ */
+
+#include "util/u_atomic.h"
+#include "util/u_memory.h"
+
+#include "lp_debug.h"
+#include "lp_compile_queue.h"
+
+
+struct lp_compile_worker
+{
+   struct lp_compile_queue *queue;
+
+   pipe_thread thread;
+
+   /** Pending jobs, protected by the queue's mutex */
+   struct list_head jobs;
+   pipe_condvar jobs_cond;
+};
+
+
+struct lp_compile_queue
+{
+   pipe_mutex mutex;
+   boolean exit_flag;
+
+   unsigned num_workers;
+   unsigned next_worker;  /**< for round-robin job distribution */
+   struct lp_compile_worker *workers;
+};
+
+
+static PIPE_THREAD_ROUTINE( worker_thread_function, init_data )
+{
+   struct lp_compile_worker *worker = (struct lp_compile_worker *) init_data;
+   struct lp_compile_queue *queue = worker->queue;
+   LLVMContextRef context;
+
+   /* Like the global gallivm context, this one is never freed, as
+    * destroying LLVM contexts crashes with some LLVM versions.
+    */
+   context = LLVMContextCreate();
+
+   pipe_mutex_lock(queue->mutex);
+
+   while (1) {
+      struct lp_compile_job *job;
+
+      while (LIST_IS_EMPTY(&worker->jobs) && !queue->exit_flag) {
+         pipe_condvar_wait(worker->jobs_cond, queue->mutex);
+      }
+
+      /* Finish all pending jobs before exiting, as they may free
+       * objects living in this thread's context.
+       */
+      if (LIST_IS_EMPTY(&worker->jobs))
+         break;
+
+      job = LIST_ENTRY(struct lp_compile_job, worker->jobs.next, list);
+      LIST_DEL(&job->list);
+
+      pipe_mutex_unlock(queue->mutex);
+
+      job->execute(job, context);
+
+      if (job->autofree) {
+         lp_compile_job_destroy(job);
+      }
+      else {
+         p_atomic_set(&job->done, 1);
+         pipe_semaphore_signal(&job->done_sema);
+      }
+
+      pipe_mutex_lock(queue->mutex);
+   }
+
+   pipe_mutex_unlock(queue->mutex);
+
+   return 0;
+}
+
+
+/**
+ * Create a queue with the given number of worker threads.
+ */
+struct lp_compile_queue *
+lp_compile_queue_create(unsigned num_threads)
+{
+   struct lp_compile_queue *queue;
+   unsigned i;
+
+   assert(num_threads > 0);
+
+   queue = CALLOC_STRUCT(lp_compile_queue);
+   if (!queue)
+      return NULL;
+
+   queue->workers = CALLOC(num_threads, sizeof *queue->workers);
+   if (!queue->workers) {
+      FREE(queue);
+      return NULL;
+   }
+
+   pipe_mutex_init(queue->mutex);
+
+   for (i = 0; i < num_threads; i++) {
+      struct lp_compile_worker *worker = &queue->workers[i];
+
+      worker->queue = queue;
+      LIST_INITHEAD(&worker->jobs);
+      pipe_condvar_init(worker->jobs_cond);
+
+      worker->thread = pipe_thread_create(worker_thread_function, worker);
+      if (!worker->thread) {
+         pipe_condvar_destroy(worker->jobs_cond);
+         break;
+      }
+
+      queue->num_workers++;
+   }
+
+   if (!queue->num_workers) {
+      lp_compile_queue_destroy(queue);
+      return NULL;
+   }
+
+   return queue;
+}
+
+
+/**
+ * Run all pending jobs and stop the worker threads.
+ */
+void
+lp_compile_queue_destroy(struct lp_compile_queue *queue)
+{
+   unsigned i;
+
+   pipe_mutex_lock(queue->mutex);
+   queue->exit_flag = TRUE;
+   for (i = 0; i < queue->num_workers; i++) {
+      pipe_condvar_signal(queue->workers[i].jobs_cond);
+   }
+   pipe_mutex_unlock(queue->mutex);
+
+   for (i = 0; i < queue->num_workers; i++) {
+      pipe_thread_wait(queue->workers[i].thread);
+      pipe_condvar_destroy(queue->workers[i].jobs_cond);
+   }
+
+   pipe_mutex_destroy(queue->mutex);
+   FREE(queue->workers);
+   FREE(queue);
+}
+
+
+/**
+ * \param autofree  if TRUE the job is freed with FREE() as soon as it has
+ *                  run and can't be waited for, otherwise the submitter
+ *                  must call lp_compile_job_destroy() after waiting
+ */
+void
+lp_compile_job_init(struct lp_compile_job *job,
+                    lp_compile_job_func execute,
+                    boolean autofree)
+{
+   job->execute = execute;
+   job->autofree = autofree;
+   job->worker = NULL;
+   job->done = 0;
+   pipe_semaphore_init(&job->done_sema, 0);
+}
+
+
+/**
+ * Queue a job on the given worker.
+ */
+void
+lp_compile_queue_submit_to(struct lp_compile_worker *worker,
+                           struct lp_compile_job *job)
+{
+   struct lp_compile_queue *queue = worker->queue;
+
+   job->worker = worker;
+
+   pipe_mutex_lock(queue->mutex);
+   assert(!queue->exit_flag);
+   LIST_ADDTAIL(&job->list, &worker->jobs);
+   pipe_condvar_signal(worker->jobs_cond);
+   pipe_mutex_unlock(queue->mutex);
+}
+
+
+/**
+ * Queue a job on the next worker.
+ */
+void
+lp_compile_queue_submit(struct lp_compile_queue *queue,
+                        struct lp_compile_job *job)
+{
+   struct lp_compile_worker *worker;
+
+   pipe_mutex_lock(queue->mutex);
+   worker = &queue->workers[queue->next_worker];
+   queue->next_worker = (queue->next_worker + 1) % queue->num_workers;
+   pipe_mutex_unlock(queue->mutex);
+
+   lp_compile_queue_submit_to(worker, job);
+}
+
+
+/**
+ * Block until the job has run.
+ */
+void
+lp_compile_job_wait(struct lp_compile_job *job)
+{
+   assert(!job->autofree);
+
+   if (LP_DEBUG & DEBUG_FS) {
+      if (!lp_compile_job_is_done(job))
+         debug_printf("llvmpipe: waiting for background compile\n");
+   }
+
+   /* Keep the semaphore signalled so that this can be called again */
+   pipe_semaphore_wait(&job->done_sema);
+   pipe_semaphore_signal(&job->done_sema);
+}
+
+
+/**
+ * Non-blocking check whether the job has run.  The job's results may only
+ * be accessed after lp_compile_job_wait(), which won't block in that case.
+ */
+boolean
+lp_compile_job_is_done(struct lp_compile_job *job)
+{
+   return p_atomic_read(&job->done) != 0;
+}
+
+
+void
+lp_compile_job_destroy(struct lp_compile_job *job)
+{
+   pipe_semaphore_destroy(&job->done_sema);
+   FREE(job);
+}
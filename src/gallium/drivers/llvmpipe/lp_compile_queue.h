@@ -0,0 +1,106 @@
+/**************************************************************************
+ *
+ * Copyright 2009 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Pool of threads for compiling shader variants in the background.
+ *
+ * Each worker thread owns its own LLVM context, since LLVM contexts can't
+ * be shared between threads.  A job is run on one worker, and anything it
+ * creates in that worker's context (e.g. a variant's gallivm object) must
+ * later be destroyed by another job on the same worker, see
+ * lp_compile_queue_submit_to().
+ */
+
+#ifndef LP_COMPILE_QUEUE_H
+#define LP_COMPILE_QUEUE_H
+
+#include "os/os_thread.h"
+#include "util/u_double_list.h"
+#include "gallivm/lp_bld.h"
+
+
+struct lp_compile_queue;
+struct lp_compile_worker;
+struct lp_compile_job;
+
+typedef void (*lp_compile_job_func)(struct lp_compile_job *job,
+                                    LLVMContextRef context);
+
+
+/**
+ * Base class for jobs.  Submitters embed it as the first member of their
+ * own job structure, which must be allocated with MALLOC/CALLOC.
+ */
+struct lp_compile_job
+{
+   struct list_head list;
+
+   lp_compile_job_func execute;
+
+   /** Delete the job automatically once it has run */
+   boolean autofree;
+
+   /** Worker which ran (or will run) the job */
+   struct lp_compile_worker *worker;
+
+   /** Set once execute() has returned */
+   int32_t done;
+   pipe_semaphore done_sema;
+};
+
+
+struct lp_compile_queue *
+lp_compile_queue_create(unsigned num_threads);
+
+void
+lp_compile_queue_destroy(struct lp_compile_queue *queue);
+
+void
+lp_compile_job_init(struct lp_compile_job *job,
+                    lp_compile_job_func execute,
+                    boolean autofree);
+
+void
+lp_compile_queue_submit(struct lp_compile_queue *queue,
+                        struct lp_compile_job *job);
+
+void
+lp_compile_queue_submit_to(struct lp_compile_worker *worker,
+                           struct lp_compile_job *job);
+
+void
+lp_compile_job_wait(struct lp_compile_job *job);
+
+boolean
+lp_compile_job_is_done(struct lp_compile_job *job);
+
+void
+lp_compile_job_destroy(struct lp_compile_job *job);
+
+
+#endif /* LP_COMPILE_QUEUE_H */
@@ -95,6 +95,10 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
       pipe_resource_reference(&llvmpipe->vertex_buffer[i].buffer, NULL);
    }
 
+   for (i = 0; i < Elements(llvmpipe->global_buffers); i++) {
+      pipe_resource_reference(&llvmpipe->global_buffers[i], NULL);
+   }
+
    lp_delete_setup_variants(llvmpipe);
 
    align_free( llvmpipe );
@@ -161,6 +165,7 @@ llvmpipe_create_context( struct pipe_screen *screen, void *priv )
    llvmpipe_init_fs_funcs(llvmpipe);
    llvmpipe_init_vs_funcs(llvmpipe);
    llvmpipe_init_gs_funcs(llvmpipe);
+   llvmpipe_init_compute_funcs(llvmpipe);
    llvmpipe_init_rasterizer_funcs(llvmpipe);
    llvmpipe_init_context_resource_funcs( &llvmpipe->pipe );
    llvmpipe_init_surface_functions(llvmpipe);
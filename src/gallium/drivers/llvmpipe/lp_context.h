@@ -48,6 +48,7 @@ struct draw_context;
 struct draw_stage;
 struct lp_fragment_shader;
 struct lp_vertex_shader;
+struct lp_compute_shader;
 struct lp_blend_state;
 struct lp_setup_context;
 struct lp_setup_variant;
@@ -65,6 +66,7 @@ struct llvmpipe_context {
    struct lp_fragment_shader *fs;
    const struct lp_vertex_shader *vs;
    const struct lp_geometry_shader *gs;
+   struct lp_compute_shader *cs;
    const struct lp_velems_state *velems;
    const struct lp_so_state *so;
 
@@ -85,6 +87,9 @@ struct llvmpipe_context {
    struct pipe_resource *mapped_vs_tex[PIPE_MAX_SHADER_SAMPLER_VIEWS];
    struct pipe_resource *mapped_gs_tex[PIPE_MAX_SHADER_SAMPLER_VIEWS];
 
+   /** Buffers bound with set_global_binding */
+   struct pipe_resource *global_buffers[LP_MAX_GLOBAL_BUFFERS];
+
    unsigned num_samplers[PIPE_SHADER_TYPES];
    unsigned num_sampler_views[PIPE_SHADER_TYPES];
 
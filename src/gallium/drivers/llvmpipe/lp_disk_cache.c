@@ -0,0 +1,284 @@
+/**************************************************************************
+ *
+ * Copyright 2009 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * On-disk cache of optimized LLVM IR for shader variants.
+ *
+ * Each entry consists of two files in LP_SHADER_CACHE_DIR, named after a
+ * hash of the entry's identifier:
+ *  - <hash>.bc holds the LLVM bitcode of the variant's module,
+ *  - <hash>.id holds the full identifier, which is compared on lookup so
+ *    that hash collisions and stale entries are treated as misses.
+ *
+ * The identifier is prefixed with a header describing everything outside
+ * of the variant key which influences code generation (Mesa and LLVM
+ * version, CPU features, debug flags).
+ *
+ * Both files are written to temporary names and then renamed, with the
+ * .id file last, so concurrent processes never see a partial entry.
+ */
+
+#include <stdio.h>
+
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_hash.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "os/os_time.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_type.h"
+
+#include "lp_debug.h"
+#include "lp_perf.h"
+#include "lp_disk_cache.h"
+
+
+#define LP_DISK_CACHE_MAGIC "LPCACHE1"
+
+
+struct lp_disk_cache_header
+{
+   char magic[8];
+   char mesa_version[32];
+   unsigned llvm_version;
+   unsigned pointer_size;
+   unsigned native_vector_width;
+   struct util_cpu_caps cpu_caps;
+   unsigned gallivm_debug;
+   int lp_perf;
+   unsigned id_size;
+};
+
+
+DEBUG_GET_ONCE_OPTION(cache_dir, "LP_SHADER_CACHE_DIR", NULL)
+
+
+boolean
+lp_disk_cache_enabled(void)
+{
+   return debug_get_option_cache_dir() != NULL;
+}
+
+
+/**
+ * Build the full identifier of a cache entry: header plus caller's id.
+ * The returned buffer must be freed with FREE().
+ */
+static void *
+make_entry_id(const void *id, unsigned id_size, unsigned *size)
+{
+   struct lp_disk_cache_header *header;
+   unsigned total_size = sizeof *header + id_size;
+
+   /* zeroed so that the struct padding is deterministic */
+   header = CALLOC(1, total_size);
+   if (!header)
+      return NULL;
+
+   memcpy(header->magic, LP_DISK_CACHE_MAGIC, sizeof header->magic);
+#ifdef PACKAGE_VERSION
+   util_snprintf(header->mesa_version, sizeof header->mesa_version,
+                 "%s", PACKAGE_VERSION);
+#endif
+   header->llvm_version = HAVE_LLVM;
+   header->pointer_size = sizeof(void *);
+   header->native_vector_width = lp_native_vector_width;
+   header->cpu_caps = util_cpu_caps;
+   header->cpu_caps.nr_cpus = 0;  /* doesn't affect code generation */
+   header->gallivm_debug = gallivm_debug;
+   header->lp_perf = LP_PERF;
+   header->id_size = id_size;
+
+   memcpy(header + 1, id, id_size);
+
+   *size = total_size;
+   return header;
+}
+
+
+static void
+make_filename(char *filename, size_t size,
+              uint32_t hash, const char *suffix)
+{
+   util_snprintf(filename, size, "%s/%08x.%s",
+                 debug_get_option_cache_dir(), hash, suffix);
+}
+
+
+/**
+ * Check that the .id file of an entry matches the expected identifier.
+ */
+static boolean
+entry_id_matches(const char *filename, const void *entry_id, unsigned size)
+{
+   boolean match = FALSE;
+   void *data;
+   FILE *f;
+
+   f = fopen(filename, "rb");
+   if (!f)
+      return FALSE;
+
+   data = MALLOC(size + 1);
+   if (data) {
+      /* read one more byte than expected to detect longer files */
+      match = fread(data, 1, size + 1, f) == size &&
+              memcmp(data, entry_id, size) == 0;
+      FREE(data);
+   }
+
+   fclose(f);
+   return match;
+}
+
+
+/**
+ * Look up a cache entry.
+ * \param context  LLVM context to load the module into, or NULL for the
+ *                 global one
+ * \return  a gallivm object holding the cached (already optimized) module,
+ *          or NULL on cache miss
+ */
+struct gallivm_state *
+lp_disk_cache_load(LLVMContextRef context,
+                   const void *id, unsigned id_size)
+{
+   struct gallivm_state *gallivm = NULL;
+   char filename[1024];
+   void *entry_id;
+   unsigned size;
+   uint32_t hash;
+
+   if (!lp_disk_cache_enabled())
+      return NULL;
+
+   entry_id = make_entry_id(id, id_size, &size);
+   if (!entry_id)
+      return NULL;
+
+   hash = util_hash_crc32(entry_id, size);
+
+   make_filename(filename, sizeof filename, hash, "id");
+   if (entry_id_matches(filename, entry_id, size)) {
+      make_filename(filename, sizeof filename, hash, "bc");
+      gallivm = gallivm_create_from_bitcode(context, filename);
+   }
+
+   FREE(entry_id);
+
+   if (gallivm) {
+      LP_COUNT(nr_disk_cache_hits);
+   }
+   else {
+      LP_COUNT(nr_disk_cache_misses);
+   }
+
+   if (LP_DEBUG & DEBUG_FS) {
+      debug_printf("llvmpipe: shader cache %s for %08x\n",
+                   gallivm ? "hit" : "miss", hash);
+   }
+
+   return gallivm;
+}
+
+
+/**
+ * Write data to a temporary file and rename it into place.
+ */
+static boolean
+write_file(const char *filename, const void *data, unsigned size)
+{
+   char tmp_filename[1024 + 32];
+   boolean ok;
+   FILE *f;
+
+   util_snprintf(tmp_filename, sizeof tmp_filename, "%s.%llx",
+                 filename, (unsigned long long) os_time_get_nano());
+
+   f = fopen(tmp_filename, "wb");
+   if (!f)
+      return FALSE;
+
+   ok = fwrite(data, 1, size, f) == size;
+   ok = fclose(f) == 0 && ok;
+
+   if (ok)
+      ok = rename(tmp_filename, filename) == 0;
+
+   if (!ok)
+      remove(tmp_filename);
+
+   return ok;
+}
+
+
+/**
+ * Store the module of a freshly built variant.  Must be called after
+ * all functions have been verified and optimized, but before
+ * gallivm_compile_module().  Failures are silently ignored.
+ */
+void
+lp_disk_cache_store(struct gallivm_state *gallivm,
+                    const void *id, unsigned id_size)
+{
+   char filename[1024];
+   char tmp_filename[1024 + 32];
+   void *entry_id;
+   unsigned size;
+   uint32_t hash;
+
+   if (!lp_disk_cache_enabled())
+      return;
+
+   /* Code referencing addresses in this process can't be reused */
+   if (gallivm->has_pointer_constants)
+      return;
+
+   entry_id = make_entry_id(id, id_size, &size);
+   if (!entry_id)
+      return;
+
+   hash = util_hash_crc32(entry_id, size);
+
+   make_filename(filename, sizeof filename, hash, "bc");
+   util_snprintf(tmp_filename, sizeof tmp_filename, "%s.%llx",
+                 filename, (unsigned long long) os_time_get_nano());
+
+   if (gallivm_write_bitcode(gallivm, tmp_filename) &&
+       rename(tmp_filename, filename) == 0) {
+      make_filename(filename, sizeof filename, hash, "id");
+      write_file(filename, entry_id, size);
+   }
+   else {
+      remove(tmp_filename);
+   }
+
+   FREE(entry_id);
+}
@@ -0,0 +1,61 @@
+/**************************************************************************
+ *
+ * Copyright 2009 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * On-disk cache of optimized LLVM IR for shader variants.
+ *
+ * When LP_SHADER_CACHE_DIR is set, the LLVM module of each freshly built
+ * variant is written there as bitcode, keyed by an identifier supplied by
+ * the caller (typically the TGSI tokens plus the variant key).  Later
+ * processes can then skip TGSI translation and the IR optimization passes
+ * for that variant and go straight to code generation.
+ */
+
+#ifndef LP_DISK_CACHE_H
+#define LP_DISK_CACHE_H
+
+#include "pipe/p_compiler.h"
+#include "gallivm/lp_bld.h"
+
+
+struct gallivm_state;
+
+
+boolean
+lp_disk_cache_enabled(void);
+
+struct gallivm_state *
+lp_disk_cache_load(LLVMContextRef context,
+                   const void *id, unsigned id_size);
+
+void
+lp_disk_cache_store(struct gallivm_state *gallivm,
+                    const void *id, unsigned id_size);
+
+
+#endif /* LP_DISK_CACHE_H */
@@ -248,6 +248,24 @@ typedef void
                     unsigned depth_stride);
 
 
+/**
+ * Run one block of a compute grid.  block_size and grid_size point to
+ * three dwords each; global holds the base addresses of the buffers
+ * bound with set_global_binding.  temps has room for the temporaries of
+ * every vector of threads in the block, if the shader has barriers.
+ */
+typedef void
+(*lp_jit_cs_func)(const void *input,
+                  uint8_t *local_mem,
+                  uint8_t **global,
+                  const uint32_t *block_size,
+                  const uint32_t *grid_size,
+                  uint32_t block_x,
+                  uint32_t block_y,
+                  uint32_t block_z,
+                  uint8_t *temps);
+
+
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen);
 
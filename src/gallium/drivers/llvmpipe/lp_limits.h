@@ -50,6 +50,27 @@
 #define LP_MAX_TEXTURE_ARRAY_LAYERS 512 /* 8K x 512 / 8K x 8K x 512 */
 
 
+/**
+ * Multisample render targets.  Only 4x is supported; the sample
+ * positions are in lp_rast_priv.h.
+ */
+#define LP_MAX_SAMPLES 4
+
+
+/**
+ * Compute resources.  Global buffers are addressed with 32-bit handles
+ * holding the binding slot above LP_GLOBAL_OFFSET_BITS and the byte
+ * offset below, which limits each buffer to 16MB.
+ */
+#define LP_MAX_GLOBAL_BUFFERS 32
+#define LP_GLOBAL_OFFSET_BITS 24
+#define LP_MAX_LOCAL_SIZE (32 * 1024)
+#define LP_MAX_INPUT_SIZE 4096
+#define LP_MAX_THREADS_PER_BLOCK 1024
+#define LP_MAX_BLOCK_SIZE_XY 1024
+#define LP_MAX_BLOCK_SIZE_Z 64
+
+
 /** This must be the larger of LP_MAX_TEXTURE_2D/3D_LEVELS */
 #define LP_MAX_TEXTURE_LEVELS LP_MAX_TEXTURE_2D_LEVELS
 
@@ -61,7 +82,13 @@
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
 
-#define LP_MAX_THREADS 16
+/**
+ * Default number of scenes per context.  While one scene is being
+ * rasterized, setup bins into the next free one; more scenes let setup
+ * run further ahead of the rasterizer threads at the cost of memory.
+ * Can be overridden with the LP_NUM_SCENES environment variable.
+ */
+#define LP_DEFAULT_NUM_SCENES 2
 
 
 /**
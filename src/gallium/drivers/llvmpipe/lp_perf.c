@@ -98,13 +98,23 @@ lp_print_counters(void)
       debug_printf("llvmpipe:   nr_empty_4x4:               %9u (%3.0f%% of %u)\n", lp_count.nr_empty_4, p1, total_4);
       debug_printf("llvmpipe:   nr_non_empty_4x4:           %9u (%3.0f%% of %u)\n", lp_count.nr_non_empty_4, p4, total_4);
 
+      debug_printf("llvmpipe: nr_hiz_rejected_16x16:        %9u\n", lp_count.nr_hiz_rejected_16);
+      debug_printf("llvmpipe: nr_hiz_rejected_4x4:          %9u\n", lp_count.nr_hiz_rejected_4);
+
       debug_printf("llvmpipe: nr_color_tile_clear:          %9u\n", lp_count.nr_color_tile_clear);
       debug_printf("llvmpipe: nr_color_tile_load:           %9u\n", lp_count.nr_color_tile_load);
       debug_printf("llvmpipe: nr_color_tile_store:          %9u\n", lp_count.nr_color_tile_store);
 
+      debug_printf("llvmpipe: nr_scenes:                    %9u\n", lp_count.nr_scenes);
+      debug_printf("llvmpipe:   nr_scene_stalls:            %9u (%3.0f%% of %u)\n", lp_count.nr_scene_stalls,
+                   100.0 * (float) lp_count.nr_scene_stalls / (float) lp_count.nr_scenes, lp_count.nr_scenes);
+      debug_printf("llvmpipe: total scene stall time:       %.2f sec\n", lp_count.scene_stall_time / 1000000.0);
+
       debug_printf("llvmpipe: nr_llvm_compiles:             %u\n", lp_count.nr_llvm_compiles);
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
+      debug_printf("llvmpipe: nr_disk_cache_hits:           %u\n", lp_count.nr_disk_cache_hits);
+      debug_printf("llvmpipe: nr_disk_cache_misses:         %u\n", lp_count.nr_disk_cache_misses);
 
    }
 }
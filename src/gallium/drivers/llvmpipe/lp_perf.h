@@ -56,7 +56,14 @@ struct lp_counters
    unsigned nr_fully_covered_4;
    unsigned nr_partially_covered_4;
    unsigned nr_non_empty_4;
+   unsigned nr_hiz_rejected_16;
+   unsigned nr_hiz_rejected_4;
+   unsigned nr_scenes;
+   unsigned nr_scene_stalls;   /**< setup had to wait for a free scene */
+   int64_t scene_stall_time;   /**< total, in microseconds */
    unsigned nr_llvm_compiles;
+   unsigned nr_disk_cache_hits;
+   unsigned nr_disk_cache_misses;
    int64_t llvm_compile_time;  /**< total, in microseconds */
 
    unsigned nr_color_tile_clear;
@@ -52,13 +52,23 @@ static struct pipe_query *
 llvmpipe_create_query(struct pipe_context *pipe, 
                       unsigned type)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   unsigned num_threads = MAX2(1, screen->num_threads);
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          type == LP_QUERY_VCACHE_HITS ||
+          type == LP_QUERY_VCACHE_MISSES);
 
-   pq = CALLOC_STRUCT( llvmpipe_query );
+   /* The per-thread start/end counters are allocated along with the
+    * query since the number of rasterizer threads is only known at
+    * runtime.
+    */
+   pq = CALLOC(1, sizeof *pq + 2 * num_threads * sizeof(uint64_t));
 
    if (pq) {
+      pq->start = (uint64_t *) (pq + 1);
+      pq->end = pq->start + num_threads;
       pq->type = type;
    }
 
@@ -88,6 +98,21 @@ llvmpipe_destroy_query(struct pipe_context *pipe, struct pipe_query *q)
 }
 
 
+/**
+ * Current value of the draw module's vertex cache counter for the given
+ * LP_QUERY_VCACHE_* query.
+ */
+static uint64_t
+llvmpipe_vcache_count(struct llvmpipe_context *llvmpipe, unsigned type)
+{
+   uint64_t hits, misses;
+
+   draw_get_vcache_stats(llvmpipe->draw, &hits, &misses);
+
+   return type == LP_QUERY_VCACHE_HITS ? hits : misses;
+}
+
+
 static boolean
 llvmpipe_get_query_result(struct pipe_context *pipe, 
                           struct pipe_query *q,
@@ -174,6 +199,10 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
       *stats = pq->stats;
    }
       break;
+   case LP_QUERY_VCACHE_HITS:
+   case LP_QUERY_VCACHE_MISSES:
+      *result = pq->vcache_count;
+      break;
    default:
       assert(0);
       break;
@@ -187,6 +216,8 @@ static void
 llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
 {
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   unsigned num_threads = MAX2(1, screen->num_threads);
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
    /* Check if the query is already in the scene.  If so, we need to
@@ -198,8 +229,8 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    }
 
 
-   memset(pq->start, 0, sizeof(pq->start));
-   memset(pq->end, 0, sizeof(pq->end));
+   memset(pq->start, 0, num_threads * sizeof(pq->start[0]));
+   memset(pq->end, 0, num_threads * sizeof(pq->end[0]));
    lp_setup_begin_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -231,6 +262,10 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
       llvmpipe->active_occlusion_queries++;
       llvmpipe->dirty |= LP_NEW_OCCLUSION_QUERY;
       break;
+   case LP_QUERY_VCACHE_HITS:
+   case LP_QUERY_VCACHE_MISSES:
+      pq->vcache_count = llvmpipe_vcache_count(llvmpipe, pq->type);
+      break;
    default:
       break;
    }
@@ -293,6 +328,11 @@ llvmpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
       llvmpipe->active_occlusion_queries--;
       llvmpipe->dirty |= LP_NEW_OCCLUSION_QUERY;
       break;
+   case LP_QUERY_VCACHE_HITS:
+   case LP_QUERY_VCACHE_MISSES:
+      pq->vcache_count =
+         llvmpipe_vcache_count(llvmpipe, pq->type) - pq->vcache_count;
+      break;
    default:
       break;
    }
@@ -318,6 +358,27 @@ llvmpipe_check_render_cond(struct llvmpipe_context *lp)
       return TRUE;
 }
 
+int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   static const struct pipe_driver_query_info queries[] = {
+      {"vertex-cache-hits", LP_QUERY_VCACHE_HITS, 0, FALSE},
+      {"vertex-cache-misses", LP_QUERY_VCACHE_MISSES, 0, FALSE}
+   };
+
+   if (!info)
+      return Elements(queries);
+
+   if (index >= Elements(queries))
+      return 0;
+
+   *info = queries[index];
+   return 1;
+}
+
+
 void llvmpipe_init_query_funcs(struct llvmpipe_context *llvmpipe )
 {
    llvmpipe->pipe.create_query = llvmpipe_create_query;
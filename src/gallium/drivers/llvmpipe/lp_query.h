@@ -39,15 +39,23 @@
 
 
 struct llvmpipe_context;
+struct pipe_driver_query_info;
+struct pipe_screen;
+
+
+/* Driver queries, see llvmpipe_get_driver_query_info() */
+#define LP_QUERY_VCACHE_HITS    (PIPE_QUERY_DRIVER_SPECIFIC + 0)
+#define LP_QUERY_VCACHE_MISSES  (PIPE_QUERY_DRIVER_SPECIFIC + 1)
 
 
 struct llvmpipe_query {
-   uint64_t start[LP_MAX_THREADS];  /* start count value for each thread */
-   uint64_t end[LP_MAX_THREADS];    /* end count value for each thread */
+   uint64_t *start;                 /* start count value for each thread */
+   uint64_t *end;                   /* end count value for each thread */
    struct lp_fence *fence;          /* fence from last scene this was binned in */
    unsigned type;                   /* PIPE_QUERY_* */
    unsigned num_primitives_generated;
    unsigned num_primitives_written;
+   uint64_t vcache_count;           /* LP_QUERY_VCACHE_* */
 
    struct pipe_query_data_pipeline_statistics stats;
 };
@@ -55,6 +63,11 @@ struct llvmpipe_query {
 
 extern void llvmpipe_init_query_funcs(struct llvmpipe_context * );
 
+extern int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info);
+
 extern boolean llvmpipe_check_render_cond(struct llvmpipe_context *);
 
 #endif /* LP_QUERY_H */
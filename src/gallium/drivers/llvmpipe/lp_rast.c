@@ -27,10 +27,12 @@
 
 #include <limits.h>
 #include "util/u_memory.h"
+#include "util/u_atomic.h"
 #include "util/u_math.h"
 #include "util/u_rect.h"
 #include "util/u_surface.h"
 #include "util/u_pack_color.h"
+#include "util/u_cpu_detect.h"
 
 #include "os/os_time.h"
 
@@ -80,6 +82,20 @@ lp_rast_end( struct lp_rasterizer *rast )
 }
 
 
+/**
+ * Forget the Hi-Z bounds of the current tile.
+ */
+static void
+lp_rast_hiz_invalidate(struct lp_rasterizer_task *task)
+{
+   unsigned i, j;
+
+   for (i = 0; i < LP_HIZ_BLOCKS; i++)
+      for (j = 0; j < LP_HIZ_BLOCKS; j++)
+         task->hiz_zmax[i][j] = FLT_MAX;
+}
+
+
 /**
  * Begining rasterization of a tile.
  * \param x  window X position of the tile, in pixels
@@ -103,6 +119,9 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
    task->thread_data.vis_counter = 0;
    task->ps_invocations = 0;
 
+   /* depth contents from earlier scenes are unknown */
+   lp_rast_hiz_invalidate(task);
+
    /* reset pointers to color and depth tile(s) */
    memset(task->color_tiles, 0, sizeof(task->color_tiles));
    task->depth_tile = NULL;
@@ -128,6 +147,35 @@ is_fb_pure_integer(const struct pipe_framebuffer_state *fb)
 }
 
 
+/**
+ * Fill the current tile of color buffer 'buf' with a packed color,
+ * in all layers and samples.
+ */
+static void
+clear_color_samples(struct lp_rasterizer_task *task,
+                    unsigned buf,
+                    enum pipe_format format,
+                    const union util_color *uc)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned s;
+
+   for (s = 0; s < scene->fb_samples; s++) {
+      util_fill_box(scene->cbufs[buf].map + s * scene->cbufs[buf].sample_stride,
+                    format,
+                    scene->cbufs[buf].stride,
+                    scene->cbufs[buf].layer_stride,
+                    task->x,
+                    task->y,
+                    0,
+                    task->width,
+                    task->height,
+                    scene->fb_max_layer + 1,
+                    (union util_color *) uc);
+   }
+}
+
+
 /**
  * Clear the rasterizer's current color tile.
  * This is a bin command called during bin processing.
@@ -166,17 +214,7 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
                util_format_write_4ui(format, arg.clear_color.ui, 0, &uc, 0, 0, 0, 1, 1);
             }
 
-            util_fill_box(scene->cbufs[i].map,
-                          format,
-                          scene->cbufs[i].stride,
-                          scene->cbufs[i].layer_stride,
-                          task->x,
-                          task->y,
-                          0,
-                          task->width,
-                          task->height,
-                          scene->fb_max_layer + 1,
-                          &uc);
+            clear_color_samples(task, i, format, &uc);
          }
       }
       else {
@@ -197,17 +235,7 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
                util_pack_color(arg.clear_color.f,
                                scene->fb.cbufs[i]->format, &uc);
 
-               util_fill_box(scene->cbufs[i].map,
-                             scene->fb.cbufs[i]->format,
-                             scene->cbufs[i].stride,
-                             scene->cbufs[i].layer_stride,
-                             task->x,
-                             task->y,
-                             0,
-                             task->width,
-                             task->height,
-                             scene->fb_max_layer + 1,
-                             &uc);
+               clear_color_samples(task, i, scene->fb.cbufs[i]->format, &uc);
             }
          }
       }
@@ -219,6 +247,59 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
 
 
 
+/**
+ * Update the Hi-Z bounds of the current tile for a z/stencil clear.
+ * Only a clear of all depth bits yields a known bound; a partial one
+ * leaves the depth values unknown.
+ */
+static void
+lp_rast_hiz_clear(struct lp_rasterizer_task *task,
+                  enum pipe_format format,
+                  uint64_t value, uint64_t mask)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   const struct util_format_channel_description *chan;
+   uint64_t depth_bits, depth_mask;
+   float zmax = FLT_MAX;
+   unsigned i, j;
+
+   if (desc->swizzle[0] >= 4)
+      return;  /* stencil only */
+
+   chan = &desc->channel[desc->swizzle[0]];
+   depth_bits = chan->size >= 64 ? ~0ULL : (1ULL << chan->size) - 1;
+   depth_mask = depth_bits << chan->shift;
+
+   if (!(mask & depth_mask))
+      return;  /* depth untouched */
+
+   if ((mask & depth_mask) == depth_mask) {
+      uint64_t z = (value >> chan->shift) & depth_bits;
+
+      if (chan->type == UTIL_FORMAT_TYPE_FLOAT) {
+         union fi fz;
+         assert(chan->size == 32);
+         fz.ui = (uint32_t) z;
+         zmax = fz.f;
+      }
+      else {
+         assert(chan->type == UTIL_FORMAT_TYPE_UNSIGNED);
+         zmax = (float) ((double) z / (double) depth_bits);
+      }
+   }
+
+   /* Later commands of this bin may still draw with the current state
+    * without setting it again.
+    */
+   if (task->state && !task->state->variant->hiz_keep)
+      zmax = FLT_MAX;
+
+   for (i = 0; i < LP_HIZ_BLOCKS; i++)
+      for (j = 0; j < LP_HIZ_BLOCKS; j++)
+         task->hiz_zmax[i][j] = zmax;
+}
+
+
 /**
  * Clear the rasterizer's current z/stencil tile.
  * This is a bin command called during bin processing.
@@ -248,14 +329,21 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
     */
 
    if (scene->fb.zsbuf) {
-      unsigned layer;
-      uint8_t *dst_layer = lp_rast_get_unswizzled_depth_tile_pointer(task, LP_TEX_USAGE_READ_WRITE);
+      const unsigned num_layers = scene->fb_max_layer + 1;
+      unsigned image;
+      uint8_t *dst_tile = lp_rast_get_unswizzled_depth_tile_pointer(task, LP_TEX_USAGE_READ_WRITE);
       block_size = util_format_get_blocksize(scene->fb.zsbuf->format);
 
+      lp_rast_hiz_clear(task, scene->fb.zsbuf->format,
+                        clear_value64, clear_mask64);
+
       clear_value &= clear_mask;
 
-      for (layer = 0; layer <= scene->fb_max_layer; layer++) {
-         dst = dst_layer;
+      /* every layer of every sample */
+      for (image = 0; image < num_layers * scene->fb_samples; image++) {
+         dst = dst_tile +
+               (image / num_layers) * scene->zsbuf.sample_stride +
+               (image % num_layers) * scene->zsbuf.layer_stride;
 
          switch (block_size) {
          case 1:
@@ -328,7 +416,6 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
             assert(0);
             break;
          }
-         dst_layer += scene->zsbuf.layer_stride;
       }
    }
 }
@@ -336,35 +423,19 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
 
 
 /**
- * Run the shader on all blocks in a tile.  This is used when a tile is
- * completely contained inside a triangle.
- * This is a bin command called during bin processing.
+ * Run the shader on all 4x4 blocks of the tile, for the sample in
+ * task->sample.
  */
 static void
-lp_rast_shade_tile(struct lp_rasterizer_task *task,
-                   const union lp_rast_cmd_arg arg)
+shade_tile_blocks(struct lp_rasterizer_task *task,
+                  const struct lp_rast_shader_inputs *inputs)
 {
    const struct lp_scene *scene = task->scene;
-   const struct lp_rast_shader_inputs *inputs = arg.shade_tile;
-   const struct lp_rast_state *state;
-   struct lp_fragment_shader_variant *variant;
+   const struct lp_rast_state *state = task->state;
+   struct lp_fragment_shader_variant *variant = state->variant;
    const unsigned tile_x = task->x, tile_y = task->y;
    unsigned x, y;
 
-   if (inputs->disable) {
-      /* This command was partially binned and has been disabled */
-      return;
-   }
-
-   LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
-
-   state = task->state;
-   assert(state);
-   if (!state) {
-      return;
-   }
-   variant = state->variant;
-
    /* render the whole 64x64 tile in 4x4 chunks */
    for (y = 0; y < task->height; y += 4){
       for (x = 0; x < task->width; x += 4) {
@@ -374,6 +445,9 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          unsigned depth_stride = 0;
          unsigned i;
 
+         if (lp_rast_hiz_reject(task, inputs, tile_x + x, tile_y + y, 4))
+            continue;
+
          /* color buffer */
          for (i = 0; i < scene->fb.nr_cbufs; i++){
             stride[i] = scene->cbufs[i].stride;
@@ -411,6 +485,52 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
 }
 
 
+/**
+ * Run the shader on all blocks in a tile.  This is used when a tile is
+ * completely contained inside a triangle.
+ * This is a bin command called during bin processing.
+ */
+static void
+lp_rast_shade_tile(struct lp_rasterizer_task *task,
+                   const union lp_rast_cmd_arg arg)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct lp_rast_shader_inputs *inputs = arg.shade_tile;
+   unsigned x, y;
+
+   if (inputs->disable) {
+      /* This command was partially binned and has been disabled */
+      return;
+   }
+
+   LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
+
+   assert(task->state);
+   if (!task->state) {
+      return;
+   }
+
+   if (scene->fb_samples > 1) {
+      /* setup only bins this when all samples of the tile are covered */
+      unsigned sample_mask = lp_rast_sample_mask(task);
+
+      while (sample_mask) {
+         task->sample = ffs(sample_mask) - 1;
+         sample_mask &= ~(1 << task->sample);
+         shade_tile_blocks(task, inputs);
+      }
+      task->sample = 0;
+   }
+   else {
+      shade_tile_blocks(task, inputs);
+   }
+
+   for (y = 0; y < task->height; y += LP_HIZ_BLOCK)
+      for (x = 0; x < task->width; x += LP_HIZ_BLOCK)
+         lp_rast_hiz_cover(task, inputs, task->x + x, task->y + y);
+}
+
+
 /**
  * Run the shader on all blocks in a tile.  This is used when a tile is
  * completely contained inside a triangle, and the shader is opaque.
@@ -580,6 +700,12 @@ lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg)
 {
    task->state = arg.state;
+
+   /* Depth writes with this state may raise the stored depth anywhere in
+    * the tile.
+    */
+   if (!arg.state->variant->hiz_keep)
+      lp_rast_hiz_invalidate(task);
 }
 
 
@@ -685,20 +811,6 @@ rasterize_bin(struct lp_rasterizer_task *task,
 }
 
 
-/* An empty bin is one that just loads the contents of the tile and
- * stores them again unchanged.  This typically happens when bins have
- * been flushed for some reason in the middle of a frame, or when
- * incremental updates are being made to a render target.
- * 
- * Try to avoid doing pointless work in this case.
- */
-static boolean
-is_empty_bin( const struct cmd_bin *bin )
-{
-   return bin->head == NULL;
-}
-
-
 /**
  * Rasterize/execute all bins within a scene.
  * Called per thread.
@@ -716,10 +828,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
          int i, j;
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
-            if (!is_empty_bin( bin ))
-               rasterize_bin(task, bin, i, j);
-         }
+         while ((bin = lp_scene_bin_iter_next(scene, &i, &j)))
+            rasterize_bin(task, bin, i, j);
       }
    }
 
@@ -793,6 +903,57 @@ lp_rast_finish( struct lp_rasterizer *rast )
 }
 
 
+/**
+ * Run blocks of a compute grid until there are none left.  Blocks are
+ * handed out one at a time so that threads which finish early keep
+ * picking up work.
+ */
+static void
+compute_blocks(struct lp_rasterizer_task *task,
+               struct lp_rast_compute_job *job)
+{
+   int32_t block;
+
+   while ((block = p_atomic_inc_return(&job->next_block) - 1) <
+          (int32_t) job->num_blocks) {
+      job->run(job->data, block, task->thread_index);
+   }
+}
+
+
+/**
+ * Run a compute grid on the rasterizer threads and wait for it to
+ * complete.  Like scenes, the caller must hold the screen's rast_mutex.
+ */
+void
+lp_rast_compute( struct lp_rasterizer *rast,
+                 struct lp_rast_compute_job *job )
+{
+   job->next_block = 0;
+
+   if (rast->num_threads == 0) {
+      unsigned fpstate = util_fpstate_get();
+
+      util_fpstate_set_denorms_to_zero(fpstate);
+      compute_blocks(&rast->tasks[0], job);
+      util_fpstate_set(fpstate);
+   }
+   else {
+      unsigned i;
+
+      rast->curr_compute = job;
+
+      for (i = 0; i < rast->num_threads; i++) {
+         pipe_semaphore_signal(&rast->tasks[i].work_ready);
+      }
+
+      lp_rast_finish(rast);
+
+      rast->curr_compute = NULL;
+   }
+}
+
+
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
@@ -812,6 +973,15 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
     */
    util_fpstate_set_denorms_to_zero(fpstate);
 
+   /* Keep each thread on its own CPU so that the framebuffer tiles and
+    * scene data it touches stay in that CPU's caches (and, with the
+    * kernel's first-touch policy, in its local NUMA node).
+    */
+   if (rast->pin_threads &&
+       !pipe_thread_pin_to_cpu(task->thread_index % util_cpu_caps.nr_cpus)) {
+      debug_printf("llvmpipe: failed to pin thread %u\n", task->thread_index);
+   }
+
    while (1) {
       /* wait for work */
       if (debug)
@@ -821,6 +991,12 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
       if (rast->exit_flag)
          break;
 
+      if (rast->curr_compute) {
+         compute_blocks(task, rast->curr_compute);
+         pipe_semaphore_signal(&task->work_done);
+         continue;
+      }
+
       if (task->thread_index == 0) {
          /* thread[0]:
           *  - get next scene to rasterize
@@ -902,7 +1078,20 @@ lp_rast_create( unsigned num_threads )
       goto no_full_scenes;
    }
 
-   for (i = 0; i < Elements(rast->tasks); i++) {
+   /* Task 0 is used for synchronous rendering when there are no threads */
+   rast->tasks = CALLOC(MAX2(1, num_threads), sizeof *rast->tasks);
+   if (!rast->tasks) {
+      goto no_tasks;
+   }
+
+   if (num_threads) {
+      rast->threads = CALLOC(num_threads, sizeof *rast->threads);
+      if (!rast->threads) {
+         goto no_threads;
+      }
+   }
+
+   for (i = 0; i < MAX2(1, num_threads); i++) {
       struct lp_rasterizer_task *task = &rast->tasks[i];
       task->rast = rast;
       task->thread_index = i;
@@ -911,6 +1100,7 @@ lp_rast_create( unsigned num_threads )
    rast->num_threads = num_threads;
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
+   rast->pin_threads = debug_get_bool_option("LP_PIN_THREADS", FALSE);
 
    create_rast_threads(rast);
 
@@ -921,6 +1111,10 @@ lp_rast_create( unsigned num_threads )
 
    return rast;
 
+no_threads:
+   FREE(rast->tasks);
+no_tasks:
+   lp_scene_queue_destroy(rast->full_scenes);
 no_full_scenes:
    FREE(rast);
 no_rast:
@@ -959,6 +1153,8 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
 
    lp_scene_queue_destroy(rast->full_scenes);
 
+   FREE(rast->threads);
+   FREE(rast->tasks);
    FREE(rast);
 }
 
@@ -87,6 +87,9 @@ struct lp_rast_state {
     * the tile color/z/stencil data somehow
      */
    struct lp_fragment_shader_variant *variant;
+
+   /* Enabled samples, for multisample framebuffers */
+   unsigned sample_mask;
 };
 
 
@@ -95,14 +98,22 @@ struct lp_rast_state {
  * First coefficient is position.
  * These pointers point into the bin data buffer.
  */
+/**
+ * lp_rast_shader_inputs::zmax is a 0.24 unorm, rounded up, so that it
+ * fits next to the flags.
+ */
+#define LP_RAST_ZMAX_ONE 0xffffff
+
 struct lp_rast_shader_inputs {
    unsigned frontfacing:1;      /** True for front-facing */
    unsigned disable:1;          /** Partially binned, disable this command */
    unsigned opaque:1;           /** Is opaque */
-   unsigned pad0:29;            /* wasted space */
+   unsigned hiz:1;              /** May be rejected against Hi-Z, see zmin */
+   unsigned viewport_index:4;   /* the active viewport index (from gs, already clamped) */
+   unsigned zmax:24;            /** upper bound of window z, see LP_RAST_ZMAX_ONE */
    unsigned stride;             /* how much to advance data between a0, dadx, dady */
    unsigned layer;              /* the layer to render to (from gs, already clamped) */
-   unsigned viewport_index;     /* the active viewport index (from gs, already clamped) */
+   float zmin;                  /* lower bound of the primitive's window z */
    /* followed by a0, dadx, dady and planes[] */
 };
 
@@ -157,6 +168,24 @@ void
 lp_rast_finish( struct lp_rasterizer *rast );
 
 
+/**
+ * A compute grid to run on the rasterizer threads.  Each of the
+ * num_blocks blocks is passed to run() exactly once, on whichever
+ * thread picks it up first.
+ */
+struct lp_rast_compute_job {
+   void (*run)(void *data, unsigned block, unsigned thread_index);
+   void *data;
+   unsigned num_blocks;
+
+   int32_t next_block;   /**< private to the rasterizer */
+};
+
+void
+lp_rast_compute( struct lp_rasterizer *rast,
+                 struct lp_rast_compute_job *job );
+
+
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
    struct {
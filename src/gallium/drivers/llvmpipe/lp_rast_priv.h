@@ -30,6 +30,7 @@
 
 #include "os/os_thread.h"
 #include "util/u_format.h"
+#include "util/u_math.h"
 #include "gallivm/lp_bld_debug.h"
 #include "lp_memory.h"
 #include "lp_rast.h"
@@ -37,11 +38,19 @@
 #include "lp_state.h"
 #include "lp_texture.h"
 #include "lp_limits.h"
+#include "lp_perf.h"
 
 
 #define TILE_VECTOR_HEIGHT 4
 #define TILE_VECTOR_WIDTH 4
 
+/** Hi-Z granularity, in pixels */
+#define LP_HIZ_BLOCK 16
+#define LP_HIZ_BLOCKS (TILE_SIZE / LP_HIZ_BLOCK)
+
+/** Slack for interpolation rounding and unorm depth quantization */
+#define LP_HIZ_EPSILON (1.0f / 32768.0f)
+
 /* If we crash in a jitted function, we can examine jit_line and jit_state
  * to get some info.  This is not thread-safe, however.
  */
@@ -91,6 +100,9 @@ struct lp_rasterizer_task
    uint8_t *color_tiles[PIPE_MAX_COLOR_BUFS];
    uint8_t *depth_tile;
 
+   /** Sample being rasterized, for multisample framebuffers */
+   unsigned sample;
+
    /** "back" pointer */
    struct lp_rasterizer *rast;
 
@@ -102,6 +114,13 @@ struct lp_rasterizer_task
    uint64_t ps_invocations;
    uint8_t ps_inv_multiplier;
 
+   /**
+    * Upper bound of the layer 0 depth values in each 16x16 block of the
+    * current tile, or FLT_MAX if unknown.  Established by depth clears
+    * and lowered by primitives fully covering a block.
+    */
+   float hiz_zmax[LP_HIZ_BLOCKS][LP_HIZ_BLOCKS];
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -123,11 +142,17 @@ struct lp_rasterizer
    /** The scene currently being rasterized by the threads */
    struct lp_scene *curr_scene;
 
-   /** A task object for each rasterization thread */
-   struct lp_rasterizer_task tasks[LP_MAX_THREADS];
+   /** The compute grid currently being run by the threads, if any */
+   struct lp_rast_compute_job *curr_compute;
+
+   /** A task object for each rasterization thread (at least one) */
+   struct lp_rasterizer_task *tasks;
 
    unsigned num_threads;
-   pipe_thread threads[LP_MAX_THREADS];
+   pipe_thread *threads;
+
+   /** Pin each rasterization thread to a single CPU */
+   boolean pin_threads;
 
    /** For synchronizing the rasterization threads */
    pipe_barrier barrier;
@@ -140,6 +165,17 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                          unsigned x, unsigned y,
                          unsigned mask);
 
+#ifdef HAVE_LP_RAST_AVX2
+/* lp_rast_tri_avx2.c, only call when util_cpu_caps.has_avx2 is set */
+void
+lp_rast_block_16_avx2(struct lp_rasterizer_task *task,
+                      const struct lp_rast_shader_inputs *inputs,
+                      const struct lp_rast_plane *plane,
+                      unsigned nr_planes,
+                      int x, int y,
+                      const int32_t *c);
+#endif
+
 
 
 /**
@@ -230,6 +266,10 @@ lp_rast_get_unswizzled_color_block_pointer(struct lp_rasterizer_task *task,
       color += layer * task->scene->cbufs[buf].layer_stride;
    }
 
+   if (task->sample) {
+      color += task->sample * task->scene->cbufs[buf].sample_stride;
+   }
+
    assert(lp_check_alignment(color, llvmpipe_get_format_alignment(task->scene->fb.cbufs[buf]->format)));
    return color;
 }
@@ -266,12 +306,112 @@ lp_rast_get_unswizzled_depth_block_pointer(struct lp_rasterizer_task *task,
       depth += layer * task->scene->zsbuf.layer_stride;
    }
 
+   if (task->sample) {
+      depth += task->sample * task->scene->zsbuf.sample_stride;
+   }
+
    assert(lp_check_alignment(depth, llvmpipe_get_format_alignment(task->scene->fb.zsbuf->format)));
    return depth;
 }
 
 
 
+/**
+ * Samples of a multisample framebuffer enabled for the current state.
+ */
+static INLINE unsigned
+lp_rast_sample_mask(const struct lp_rasterizer_task *task)
+{
+   return task->state->sample_mask & ((1 << task->scene->fb_samples) - 1);
+}
+
+
+/**
+ * Offset of the edge function value at a sample position from its value
+ * at the pixel center.  The 4x pattern is the usual rotated grid, in
+ * 1/FIXED_ONE pixel units relative to the pixel center.
+ */
+static INLINE int64_t
+lp_rast_sample_c_offset(const struct lp_rast_plane *plane, unsigned sample)
+{
+   static const int sample_pos[LP_MAX_SAMPLES][2] = {
+      { -FIXED_ONE / 8, -FIXED_ONE * 3 / 8 },
+      {  FIXED_ONE * 3 / 8, -FIXED_ONE / 8 },
+      { -FIXED_ONE * 3 / 8,  FIXED_ONE / 8 },
+      {  FIXED_ONE / 8,  FIXED_ONE * 3 / 8 }
+   };
+
+   assert(sample < LP_MAX_SAMPLES);
+
+   /*
+    * Edge planes have dcdx/dcdy scaled by FIXED_ONE, so this is exact.
+    * Scissor and bounding box planes step one per pixel and truncate to
+    * zero, keeping those tests per pixel.
+    */
+   return (IMUL64(plane->dcdy, sample_pos[sample][1]) -
+           IMUL64(plane->dcdx, sample_pos[sample][0])) / FIXED_ONE;
+}
+
+
+/**
+ * Test whether every fragment of a primitive in a size x size block
+ * would fail the depth test, using the Hi-Z bounds of the task.
+ * \param x, y location of the block in window coords
+ */
+static INLINE boolean
+lp_rast_hiz_reject(const struct lp_rasterizer_task *task,
+                   const struct lp_rast_shader_inputs *inputs,
+                   unsigned x, unsigned y, unsigned size)
+{
+   unsigned bx0, by0, bx1, by1, bx, by;
+   float zmax = 0.0f;
+
+   if (!inputs->hiz || inputs->layer != 0)
+      return FALSE;
+
+   bx0 = (x % TILE_SIZE) / LP_HIZ_BLOCK;
+   by0 = (y % TILE_SIZE) / LP_HIZ_BLOCK;
+   bx1 = MIN2((x % TILE_SIZE) + size - 1, TILE_SIZE - 1) / LP_HIZ_BLOCK;
+   by1 = MIN2((y % TILE_SIZE) + size - 1, TILE_SIZE - 1) / LP_HIZ_BLOCK;
+
+   for (by = by0; by <= by1; by++)
+      for (bx = bx0; bx <= bx1; bx++)
+         zmax = MAX2(zmax, task->hiz_zmax[by][bx]);
+
+   if (inputs->zmin > zmax + LP_HIZ_EPSILON) {
+      if (size == 4)
+         LP_COUNT(nr_hiz_rejected_4);
+      else
+         LP_COUNT(nr_hiz_rejected_16);
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
+
+/**
+ * Lower the Hi-Z bound of the 16x16 block at x, y after a primitive has
+ * covered all of it.  Every fragment then either wrote its z, which is
+ * at most the primitive's zmax, or failed the depth test against a
+ * smaller one.
+ */
+static INLINE void
+lp_rast_hiz_cover(struct lp_rasterizer_task *task,
+                  const struct lp_rast_shader_inputs *inputs,
+                  unsigned x, unsigned y)
+{
+   if (inputs->hiz && inputs->layer == 0 &&
+       task->state->variant->hiz_write &&
+       task->scene->fb_samples == 1) {
+      float *zmax = &task->hiz_zmax[(y % TILE_SIZE) / LP_HIZ_BLOCK]
+                                   [(x % TILE_SIZE) / LP_HIZ_BLOCK];
+
+      *zmax = MIN2(*zmax, (float) inputs->zmax / (float) LP_RAST_ZMAX_ONE);
+   }
+}
+
+
 /**
  * Shade all pixels in a 4x4 block.  The fragment code omits the
  * triangle in/out tests.
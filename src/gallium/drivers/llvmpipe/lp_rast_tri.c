@@ -31,6 +31,7 @@
 
 #include <limits.h>
 #include "util/u_math.h"
+#include "util/u_cpu_detect.h"
 #include "lp_debug.h"
 #include "lp_perf.h"
 #include "lp_rast_priv.h"
@@ -61,6 +62,8 @@ block_full_16(struct lp_rasterizer_task *task,
    for (iy = 0; iy < 16; iy += 4)
       for (ix = 0; ix < 16; ix += 4)
 	 block_full_4(task, tri, x + ix, y + iy);
+
+   lp_rast_hiz_cover(task, &tri->inputs, x, y);
 }
 
 static INLINE unsigned
@@ -301,7 +304,22 @@ lp_rast_triangle_32_3_16(struct lp_rasterizer_task *task,
    __m128i span_1;                /* 0,dcdx,2dcdx,3dcdx for plane 1 */
    __m128i span_2;                /* 0,dcdx,2dcdx,3dcdx for plane 2 */
    __m128i unused;
-   
+
+   if (lp_rast_hiz_reject(task, &tri->inputs, x, y, 16))
+      return;
+
+#ifdef HAVE_LP_RAST_AVX2
+   if (util_cpu_caps.has_avx2) {
+      int32_t c16[NR_PLANES];
+
+      for (i = 0; i < NR_PLANES; i++)
+         c16[i] = plane[i].c + plane[i].dcdy * y - plane[i].dcdx * x;
+
+      lp_rast_block_16_avx2(task, &tri->inputs, plane, NR_PLANES, x, y, c16);
+      return;
+   }
+#endif
+
    transpose4_epi32(&p0, &p1, &p2, &zero,
                     &c, &dcdx, &dcdy, &rej4);
 
@@ -411,6 +429,9 @@ lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
    __m128i span_2;                /* 0,dcdx,2dcdx,3dcdx for plane 2 */
    __m128i unused;
 
+   if (lp_rast_hiz_reject(task, &tri->inputs, x, y, 4))
+      return;
+
    transpose4_epi32(&p0, &p1, &p2, &zero,
                     &c, &dcdx, &dcdy, &unused);
 
@@ -519,6 +540,13 @@ lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
 #define BUILD_MASK_LINEAR(c, dcdx, dcdy) build_mask_linear_32((int)c, dcdx, dcdy)
 #endif
 
+/* The 32-bit rasterizers evaluate partial 16x16 blocks with AVX2 when
+ * the CPU has it.
+ */
+#ifdef HAVE_LP_RAST_AVX2
+#define BLOCK_16_AVX2
+#endif
+
 #define TAG(x) x##_32_1
 #define NR_PLANES 1
 #include "lp_rast_tri_tmp.h"
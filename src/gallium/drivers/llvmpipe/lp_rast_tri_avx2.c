@@ -0,0 +1,112 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * AVX2 coverage for 16x16 blocks of the 32-bit triangle rasterizers.
+ *
+ * This file is built with -mavx2, so nothing in it may run before
+ * util_cpu_caps.has_avx2 has been checked.
+ */
+
+#include "lp_rast_priv.h"
+#include "lp_perf.h"
+
+#if defined(HAVE_LP_RAST_AVX2)
+
+#include <immintrin.h>
+
+
+/**
+ * Shade the pixels of a 16x16 block which are inside all nr_planes
+ * planes.  c[j] is plane j's edge function at pixel (x, y), and must fit
+ * in 32 bits over the whole block.
+ *
+ * Each plane is evaluated for a row of 16 pixels at a time, in two
+ * vectors of eight.  The sign bits then give which pixels of the row are
+ * outside that plane.
+ */
+void
+lp_rast_block_16_avx2(struct lp_rasterizer_task *task,
+                      const struct lp_rast_shader_inputs *inputs,
+                      const struct lp_rast_plane *plane,
+                      unsigned nr_planes,
+                      int x, int y,
+                      const int32_t *c)
+{
+   unsigned outside[16];
+   unsigned row, bx, by, j;
+
+   memset(outside, 0, sizeof outside);
+
+   for (j = 0; j < nr_planes; j++) {
+      const __m256i dcdx = _mm256_set1_epi32(-plane[j].dcdx);
+      const __m256i dcdy = _mm256_set1_epi32(plane[j].dcdy);
+
+      /* Subtract one so that the sign bit alone tells c <= 0 */
+      __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(c[j] - 1),
+                                    _mm256_mullo_epi32(dcdx,
+                                       _mm256_setr_epi32(0, 1, 2, 3,
+                                                         4, 5, 6, 7)));
+      __m256i c1 = _mm256_add_epi32(c0, _mm256_slli_epi32(dcdx, 3));
+
+      for (row = 0; row < 16; row++) {
+         outside[row] |= _mm256_movemask_ps(_mm256_castsi256_ps(c0)) |
+                         _mm256_movemask_ps(_mm256_castsi256_ps(c1)) << 8;
+         c0 = _mm256_add_epi32(c0, dcdy);
+         c1 = _mm256_add_epi32(c1, dcdy);
+      }
+   }
+
+   /* Regroup the row masks into 4x4 masks, bit (iy * 4 + ix) */
+   for (by = 0; by < 4; by++) {
+      const unsigned *rows = &outside[by * 4];
+
+      for (bx = 0; bx < 4; bx++) {
+         const unsigned shift = bx * 4;
+         unsigned mask = 0xffff & ~(((rows[0] >> shift) & 0xf) |
+                                    ((rows[1] >> shift) & 0xf) << 4 |
+                                    ((rows[2] >> shift) & 0xf) << 8 |
+                                    ((rows[3] >> shift) & 0xf) << 12);
+
+         if (mask == 0xffff) {
+            LP_COUNT(nr_fully_covered_4);
+            lp_rast_shade_quads_all(task, inputs, x + shift, y + by * 4);
+         }
+         else if (mask) {
+            LP_COUNT(nr_partially_covered_4);
+            lp_rast_shade_quads_mask(task, inputs, x + shift, y + by * 4,
+                                     mask);
+         }
+         else {
+            LP_COUNT(nr_empty_4);
+         }
+      }
+   }
+}
+
+#endif /* HAVE_LP_RAST_AVX2 */
@@ -75,6 +75,18 @@ TAG(do_block_16)(struct lp_rasterizer_task *task,
    unsigned outmask, inmask, partmask, partial_mask;
    unsigned j;
 
+#ifdef BLOCK_16_AVX2
+   if (util_cpu_caps.has_avx2) {
+      int32_t c32[NR_PLANES];
+
+      for (j = 0; j < NR_PLANES; j++)
+         c32[j] = (int32_t)c[j];
+
+      lp_rast_block_16_avx2(task, &tri->inputs, plane, NR_PLANES, x, y, c32);
+      return;
+   }
+#endif
+
    outmask = 0;                 /* outside one or more trivial reject planes */
    partmask = 0;                /* outside one or more trivial accept planes */
 
@@ -149,11 +161,11 @@ TAG(do_block_16)(struct lp_rasterizer_task *task,
 
 /**
  * Scan the tile in chunks and figure out which pixels to rasterize
- * for this triangle.
+ * for this triangle, for the sample in task->sample.
  */
-void
-TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
-                      const union lp_rast_cmd_arg arg)
+static void
+TAG(rasterize_triangle)(struct lp_rasterizer_task *task,
+                        const union lp_rast_cmd_arg arg)
 {
    const struct lp_rast_triangle *tri = arg.triangle.tri;
    unsigned plane_mask = arg.triangle.plane_mask;
@@ -177,6 +189,8 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
       plane[j] = tri_plane[i];
       plane_mask &= ~(1 << i);
       c[j] = plane[j].c + IMUL64(plane[j].dcdy, y) - IMUL64(plane[j].dcdx, x);
+      if (task->sample)
+         c[j] += lp_rast_sample_c_offset(&plane[j], task->sample);
 
       {
          const int64_t dcdx = -IMUL64(plane[j].dcdx, 16);
@@ -228,6 +242,9 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
 
       partial_mask &= ~(1 << i);
 
+      if (lp_rast_hiz_reject(task, &tri->inputs, px, py, 16))
+         continue;
+
       LP_COUNT(nr_partially_covered_16);
       TAG(do_block_16)(task, tri, plane, px, py, cx);
    }
@@ -243,11 +260,38 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
 
       inmask &= ~(1 << i);
 
+      if (lp_rast_hiz_reject(task, &tri->inputs, px, py, 16))
+         continue;
+
       LP_COUNT(nr_fully_covered_16);
       block_full_16(task, tri, px, py);
    }
 }
 
+
+/**
+ * Rasterize a triangle into a tile, once per enabled sample when the
+ * framebuffer is multisampled.
+ */
+void
+TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
+                      const union lp_rast_cmd_arg arg)
+{
+   if (task->scene->fb_samples > 1) {
+      unsigned sample_mask = lp_rast_sample_mask(task);
+
+      while (sample_mask) {
+         task->sample = ffs(sample_mask) - 1;
+         sample_mask &= ~(1 << task->sample);
+         TAG(rasterize_triangle)(task, arg);
+      }
+      task->sample = 0;
+   }
+   else {
+      TAG(rasterize_triangle)(task, arg);
+   }
+}
+
 #if defined(PIPE_ARCH_SSE) && defined(TRI_16)
 /* XXX: special case this when intersection is not required.
  *      - tile completely within bbox,
@@ -272,6 +316,21 @@ TRI_16(struct lp_rasterizer_task *task,
    x += task->x;
    y += task->y;
 
+   if (lp_rast_hiz_reject(task, &tri->inputs, x, y, 16))
+      return;
+
+#ifdef BLOCK_16_AVX2
+   if (util_cpu_caps.has_avx2) {
+      int32_t c[NR_PLANES];
+
+      for (j = 0; j < NR_PLANES; j++)
+         c[j] = plane[j].c + plane[j].dcdy * y - plane[j].dcdx * x;
+
+      lp_rast_block_16_avx2(task, &tri->inputs, plane, NR_PLANES, x, y, c);
+      return;
+   }
+#endif
+
    for (j = 0; j < NR_PLANES; j++) {
       const int dcdx = -plane[j].dcdx * 4;
       const int dcdy = plane[j].dcdy * 4;
@@ -337,6 +396,9 @@ TRI_4(struct lp_rasterizer_task *task,
    const int y = task->y + (mask >> 8);
    unsigned j;
 
+   if (lp_rast_hiz_reject(task, &tri->inputs, x, y, 4))
+      return;
+
    /* Iterate over partials:
     */
    {
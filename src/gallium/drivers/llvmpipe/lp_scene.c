@@ -62,8 +62,6 @@ lp_scene_create( struct pipe_context *pipe )
    scene->data.head =
       CALLOC_STRUCT(data_block);
 
-   pipe_mutex_init(scene->mutex);
-
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
    {
@@ -90,7 +88,6 @@ void
 lp_scene_destroy(struct lp_scene *scene)
 {
    lp_fence_reference(&scene->fence, NULL);
-   pipe_mutex_destroy(scene->mutex);
    assert(scene->data.head->next == NULL);
    FREE(scene->data.head);
    FREE(scene);
@@ -160,6 +157,7 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
       if (!cbuf) {
          scene->cbufs[i].stride = 0;
          scene->cbufs[i].layer_stride = 0;
+         scene->cbufs[i].sample_stride = 0;
          scene->cbufs[i].map = NULL;
          continue;
       }
@@ -174,12 +172,15 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
                                                      cbuf->u.tex.level,
                                                      cbuf->u.tex.first_layer,
                                                      LP_TEX_USAGE_READ_WRITE);
+         /* only known once the storage is allocated by the map */
+         scene->cbufs[i].sample_stride = llvmpipe_sample_stride(cbuf->texture);
       }
       else {
          struct llvmpipe_resource *lpr = llvmpipe_resource(cbuf->texture);
          unsigned pixstride = util_format_get_blocksize(cbuf->format);
          scene->cbufs[i].stride = cbuf->texture->width0;
          scene->cbufs[i].layer_stride = 0;
+         scene->cbufs[i].sample_stride = 0;
          scene->cbufs[i].map = lpr->data;
          scene->cbufs[i].map += cbuf->u.buf.first_element * pixstride;
       }
@@ -194,6 +195,7 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
                                                zsbuf->u.tex.level,
                                                zsbuf->u.tex.first_layer,
                                                LP_TEX_USAGE_READ_WRITE);
+      scene->zsbuf.sample_stride = llvmpipe_sample_stride(zsbuf->texture);
    }
 }
 
@@ -447,61 +449,54 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+void
+lp_scene_bin_iter_begin( struct lp_scene *scene )
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
-   }
-   return TRUE;
+   p_atomic_set(&scene->curr_bin, -1);
 }
 
 
-void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
+/* An empty bin is one that just loads the contents of the tile and
+ * stores them again unchanged.  This typically happens when bins have
+ * been flushed for some reason in the middle of a frame, or when
+ * incremental updates are being made to a render target.
+ *
+ * Such bins are never handed out to the rasterizer threads.
+ */
+static INLINE boolean
+is_empty_bin( const struct cmd_bin *bin )
 {
-   scene->curr_x = scene->curr_y = -1;
+   return bin->head == NULL;
 }
 
 
 /**
- * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
+ * Return pointer to next non-empty bin to be rendered.
  * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * of work (a bin) to work on.  Bins are claimed with an atomic
+ * increment of lp_scene::curr_bin, so no lock is taken and a thread
+ * which finishes its bin early simply claims the next one.
  */
 struct cmd_bin *
 lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
 {
-   struct cmd_bin *bin = NULL;
-
-   pipe_mutex_lock(scene->mutex);
-
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
+   const int32_t num_bins = lp_scene_get_num_bins(scene);
+   int32_t i;
+
+   while ((i = p_atomic_inc_return(&scene->curr_bin)) < num_bins) {
+      const int bin_x = i % scene->tiles_x;
+      const int bin_y = i / scene->tiles_x;
+      struct cmd_bin *bin = lp_scene_get_bin(scene, bin_x, bin_y);
+
+      if (!is_empty_bin(bin)) {
+         *x = bin_x;
+         *y = bin_y;
+         return bin;
+      }
    }
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
-
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   pipe_mutex_unlock(scene->mutex);
-   return bin;
+   /* no more bins left */
+   return NULL;
 }
 
 
@@ -544,6 +539,9 @@ void lp_scene_begin_binning( struct lp_scene *scene,
       max_layer = MIN2(max_layer, zsbuf->u.tex.last_layer - zsbuf->u.tex.first_layer);
    }
    scene->fb_max_layer = max_layer;
+
+   scene->fb_samples = util_framebuffer_get_num_samples(fb);
+   assert(scene->fb_samples == 1 || scene->fb_samples == LP_MAX_SAMPLES);
 }
 
 
@@ -36,6 +36,7 @@
 #define LP_SCENE_H
 
 #include "os/os_thread.h"
+#include "util/u_atomic.h"
 #include "lp_rast.h"
 #include "lp_debug.h"
 
@@ -142,11 +143,15 @@ struct lp_scene {
       uint8_t *map;
       unsigned stride;
       unsigned layer_stride;
+      unsigned sample_stride;
    } zsbuf, cbufs[PIPE_MAX_COLOR_BUFS];
 
    /* The amount of layers in the fb (minimum of all attachments) */
    unsigned fb_max_layer;
 
+   /* Samples per pixel of the fb, 1 or LP_MAX_SAMPLES */
+   unsigned fb_samples;
+
    /** the framebuffer to render the scene into */
    struct pipe_framebuffer_state fb;
 
@@ -173,8 +178,7 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   pipe_mutex mutex;
+   int32_t curr_bin;  /**< for iterating over bins, updated atomically */
 
    struct cmd_bin tile[TILES_X][TILES_Y];
    struct data_block_list data;
@@ -47,6 +47,8 @@
 #include "lp_public.h"
 #include "lp_limits.h"
 #include "lp_rast.h"
+#include "lp_query.h"
+#include "lp_compile_queue.h"
 
 #include "state_tracker/sw_winsys.h"
 
@@ -202,7 +204,7 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_QUADS_FOLLOW_PROVOKING_VERTEX_CONVENTION:
       return 0;
    case PIPE_CAP_COMPUTE:
-      return 0;
+      return 1;
    case PIPE_CAP_USER_VERTEX_BUFFERS:
    case PIPE_CAP_USER_INDEX_BUFFERS:
       return 1;
@@ -252,6 +254,17 @@ llvmpipe_get_shader_param(struct pipe_screen *screen, unsigned shader, enum pipe
       default:
          return gallivm_get_shader_param(param);
       }
+   case PIPE_SHADER_COMPUTE:
+      switch (param) {
+      /* compute shaders get no samplers or constant buffers yet */
+      case PIPE_SHADER_CAP_MAX_TEXTURE_SAMPLERS:
+      case PIPE_SHADER_CAP_MAX_SAMPLER_VIEWS:
+      case PIPE_SHADER_CAP_MAX_CONST_BUFFERS:
+      case PIPE_SHADER_CAP_MAX_CONSTS:
+         return 0;
+      default:
+         return gallivm_get_shader_param(param);
+      }
    case PIPE_SHADER_VERTEX:
    case PIPE_SHADER_GEOMETRY:
       switch (param) {
@@ -277,6 +290,95 @@ llvmpipe_get_shader_param(struct pipe_screen *screen, unsigned shader, enum pipe
    }
 }
 
+static int
+llvmpipe_get_compute_param(struct pipe_screen *screen,
+                           enum pipe_compute_cap param,
+                           void *ret)
+{
+   union {
+      uint64_t grid_dimension;
+      uint64_t max_grid_size[3];
+      uint64_t max_block_size[3];
+      uint64_t max_threads_per_block;
+      uint64_t max_global_size;
+      uint64_t max_local_size;
+      uint64_t max_private_size;
+      uint64_t max_input_size;
+      uint64_t max_mem_alloc_size;
+   } val;
+   const void *ptr;
+   int size;
+
+   switch (param) {
+   case PIPE_COMPUTE_CAP_IR_TARGET:
+      ptr = "TGSI";
+      size = sizeof("TGSI");
+      break;
+   case PIPE_COMPUTE_CAP_GRID_DIMENSION:
+      val.grid_dimension = Elements(val.max_grid_size);
+      ptr = &val.grid_dimension;
+      size = sizeof(val.grid_dimension);
+      break;
+   case PIPE_COMPUTE_CAP_MAX_GRID_SIZE:
+      val.max_grid_size[0] = 65535;
+      val.max_grid_size[1] = 65535;
+      val.max_grid_size[2] = 65535;
+      ptr = &val.max_grid_size;
+      size = sizeof(val.max_grid_size);
+      break;
+   case PIPE_COMPUTE_CAP_MAX_BLOCK_SIZE:
+      val.max_block_size[0] = LP_MAX_BLOCK_SIZE_XY;
+      val.max_block_size[1] = LP_MAX_BLOCK_SIZE_XY;
+      val.max_block_size[2] = LP_MAX_BLOCK_SIZE_Z;
+      ptr = &val.max_block_size;
+      size = sizeof(val.max_block_size);
+      break;
+   case PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK:
+      /* shaders with barriers inside control flow get one vector, see
+       * lp_state_cs.c
+       */
+      val.max_threads_per_block = LP_MAX_THREADS_PER_BLOCK;
+      ptr = &val.max_threads_per_block;
+      size = sizeof(val.max_threads_per_block);
+      break;
+   case PIPE_COMPUTE_CAP_MAX_GLOBAL_SIZE:
+      val.max_global_size = (uint64_t)LP_MAX_GLOBAL_BUFFERS <<
+                            LP_GLOBAL_OFFSET_BITS;
+      ptr = &val.max_global_size;
+      size = sizeof(val.max_global_size);
+      break;
+   case PIPE_COMPUTE_CAP_MAX_LOCAL_SIZE:
+      val.max_local_size = LP_MAX_LOCAL_SIZE;
+      ptr = &val.max_local_size;
+      size = sizeof(val.max_local_size);
+      break;
+   case PIPE_COMPUTE_CAP_MAX_PRIVATE_SIZE:
+      val.max_private_size = 0;
+      ptr = &val.max_private_size;
+      size = sizeof(val.max_private_size);
+      break;
+   case PIPE_COMPUTE_CAP_MAX_INPUT_SIZE:
+      val.max_input_size = LP_MAX_INPUT_SIZE;
+      ptr = &val.max_input_size;
+      size = sizeof(val.max_input_size);
+      break;
+   case PIPE_COMPUTE_CAP_MAX_MEM_ALLOC_SIZE:
+      val.max_mem_alloc_size = 1 << LP_GLOBAL_OFFSET_BITS;
+      ptr = &val.max_mem_alloc_size;
+      size = sizeof(val.max_mem_alloc_size);
+      break;
+   default:
+      ptr = NULL;
+      size = 0;
+      break;
+   }
+
+   if (ret && ptr)
+      memcpy(ret, ptr, size);
+
+   return size;
+}
+
 static float
 llvmpipe_get_paramf(struct pipe_screen *screen, enum pipe_capf param)
 {
@@ -334,8 +436,24 @@ llvmpipe_is_format_supported( struct pipe_screen *_screen,
           target == PIPE_TEXTURE_3D ||
           target == PIPE_TEXTURE_CUBE);
 
-   if (sample_count > 1)
-      return FALSE;
+   /*
+    * Multisampling is limited to render targets and depth buffers which
+    * only get resolved with a blit; they can't be sampled or displayed.
+    */
+   if (sample_count > 1) {
+      if (sample_count != LP_MAX_SAMPLES)
+         return FALSE;
+      if (target != PIPE_TEXTURE_2D &&
+          target != PIPE_TEXTURE_2D_ARRAY &&
+          target != PIPE_TEXTURE_RECT)
+         return FALSE;
+      if (!(bind & (PIPE_BIND_RENDER_TARGET | PIPE_BIND_DEPTH_STENCIL)) ||
+          (bind & (PIPE_BIND_SAMPLER_VIEW |
+                   PIPE_BIND_DISPLAY_TARGET |
+                   PIPE_BIND_SCANOUT |
+                   PIPE_BIND_SHARED)))
+         return FALSE;
+   }
 
    if (bind & PIPE_BIND_RENDER_TARGET) {
       if (format_desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB) {
@@ -432,6 +550,9 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    if (screen->rast)
       lp_rast_destroy(screen->rast);
 
+   if (screen->compile_queue)
+      lp_compile_queue_destroy(screen->compile_queue);
+
    lp_jit_screen_cleanup(screen);
 
    if(winsys->destroy)
@@ -527,6 +648,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_vendor = llvmpipe_get_vendor;
    screen->base.get_param = llvmpipe_get_param;
    screen->base.get_shader_param = llvmpipe_get_shader_param;
+   screen->base.get_compute_param = llvmpipe_get_compute_param;
    screen->base.get_paramf = llvmpipe_get_paramf;
    screen->base.is_format_supported = llvmpipe_is_format_supported;
 
@@ -537,6 +659,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.fence_finish = llvmpipe_fence_finish;
 
    screen->base.get_timestamp = llvmpipe_get_timestamp;
+   screen->base.get_driver_query_info = llvmpipe_get_driver_query_info;
 
    llvmpipe_init_screen_resource_funcs(&screen->base);
 
@@ -547,7 +670,9 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->num_threads = 0;
 #endif
    screen->num_threads = debug_get_num_option("LP_NUM_THREADS", screen->num_threads);
-   screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
+
+   screen->num_scenes = debug_get_num_option("LP_NUM_SCENES", LP_DEFAULT_NUM_SCENES);
+   screen->num_scenes = MAX2(screen->num_scenes, 1);
 
    screen->rast = lp_rast_create(screen->num_threads);
    if (!screen->rast) {
@@ -557,6 +682,14 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    pipe_mutex_init(screen->rast_mutex);
 
+   {
+      unsigned num_compile_threads =
+         debug_get_num_option("LP_ASYNC_COMPILE", 0);
+
+      if (num_compile_threads)
+         screen->compile_queue = lp_compile_queue_create(num_compile_threads);
+   }
+
    util_format_s3tc_init();
 
    return &screen->base;
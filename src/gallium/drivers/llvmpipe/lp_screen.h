@@ -41,6 +41,7 @@
 
 
 struct sw_winsys;
+struct lp_compile_queue;
 
 
 struct llvmpipe_screen
@@ -50,6 +51,7 @@ struct llvmpipe_screen
    struct sw_winsys *winsys;
 
    unsigned num_threads;
+   unsigned num_scenes;   /**< scenes per setup context */
 
    /* Increments whenever textures are modified.  Contexts can track this.
     */
@@ -57,6 +59,9 @@ struct llvmpipe_screen
 
    struct lp_rasterizer *rast;
    pipe_mutex rast_mutex;
+
+   /** Background shader compilation threads, NULL if disabled */
+   struct lp_compile_queue *compile_queue;
 };
 
 
@@ -47,6 +47,7 @@
 #include "lp_texture.h"
 #include "lp_debug.h"
 #include "lp_fence.h"
+#include "lp_perf.h"
 #include "lp_query.h"
 #include "lp_rast.h"
 #include "lp_setup_context.h"
@@ -69,16 +70,28 @@ lp_setup_get_empty_scene(struct lp_setup_context *setup)
    assert(setup->scene == NULL);
 
    setup->scene_idx++;
-   setup->scene_idx %= Elements(setup->scenes);
+   setup->scene_idx %= setup->num_scenes;
 
+   /* Scenes are rasterized in the order they were queued, so the next
+    * scene in the ring is always the oldest one and the first to become
+    * free.  Only block if it is still being rasterized.
+    */
    setup->scene = setup->scenes[setup->scene_idx];
 
-   if (setup->scene->fence) {
+   LP_COUNT(nr_scenes);
+
+   if (setup->scene->fence &&
+       !lp_fence_signalled(setup->scene->fence)) {
+      int64_t start = os_time_get();
+
       if (LP_DEBUG & DEBUG_SETUP)
          debug_printf("%s: wait for scene %d\n",
                       __FUNCTION__, setup->scene->fence->id);
 
       lp_fence_wait(setup->scene->fence);
+
+      LP_COUNT(nr_scene_stalls);
+      LP_COUNT_ADD(scene_stall_time, os_time_get() - start);
    }
 
    lp_scene_begin_binning(setup->scene, &setup->fb, setup->rasterizer_discard);
@@ -359,6 +372,7 @@ lp_setup_bind_framebuffer( struct lp_setup_context *setup,
     * scene.
     */
    util_copy_framebuffer_state(&setup->fb, fb);
+   setup->fb_samples = util_framebuffer_get_num_samples(fb);
    setup->framebuffer.x0 = 0;
    setup->framebuffer.y0 = 0;
    setup->framebuffer.x1 = fb->width-1;
@@ -570,6 +584,18 @@ lp_setup_set_alpha_ref_value( struct lp_setup_context *setup,
    }
 }
 
+void
+lp_setup_set_sample_mask( struct lp_setup_context *setup,
+                          unsigned sample_mask )
+{
+   LP_DBG(DEBUG_SETUP, "%s 0x%x\n", __FUNCTION__, sample_mask);
+
+   if (setup->fs.current.sample_mask != sample_mask) {
+      setup->fs.current.sample_mask = sample_mask;
+      setup->dirty |= LP_SETUP_NEW_FS;
+   }
+}
+
 void
 lp_setup_set_stencil_ref_values( struct lp_setup_context *setup,
                                  const ubyte refs[2] )
@@ -890,7 +916,7 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
    }
 
    /* check textures referenced by the scene */
-   for (i = 0; i < Elements(setup->scenes); i++) {
+   for (i = 0; i < setup->num_scenes; i++) {
       if (lp_scene_is_resource_referenced(setup->scenes[i], texture)) {
          return LP_REFERENCED_FOR_READ;
       }
@@ -1187,7 +1213,7 @@ lp_setup_destroy( struct lp_setup_context *setup )
    }
 
    /* free the scenes in the 'empty' queue */
-   for (i = 0; i < Elements(setup->scenes); i++) {
+   for (i = 0; i < setup->num_scenes; i++) {
       struct lp_scene *scene = setup->scenes[i];
 
       if (scene->fence)
@@ -1198,6 +1224,7 @@ lp_setup_destroy( struct lp_setup_context *setup )
 
    lp_fence_reference(&setup->last_fence, NULL);
 
+   FREE( setup->scenes );
    FREE( setup );
 }
 
@@ -1237,7 +1264,13 @@ lp_setup_create( struct pipe_context *pipe,
    draw_set_render(draw, &setup->base);
 
    /* create some empty scenes */
-   for (i = 0; i < MAX_SCENES; i++) {
+   setup->num_scenes = screen->num_scenes;
+   setup->scenes = CALLOC(setup->num_scenes, sizeof *setup->scenes);
+   if (!setup->scenes) {
+      goto no_scenes;
+   }
+
+   for (i = 0; i < setup->num_scenes; i++) {
       setup->scenes[i] = lp_scene_create( pipe );
       if (!setup->scenes[i]) {
          goto no_scenes;
@@ -1247,16 +1280,22 @@ lp_setup_create( struct pipe_context *pipe,
    setup->triangle = first_triangle;
    setup->line     = first_line;
    setup->point    = first_point;
+
+   setup->fs.current.sample_mask = ~0;
+   setup->fb_samples = 1;
    
    setup->dirty = ~0;
 
    return setup;
 
 no_scenes:
-   for (i = 0; i < MAX_SCENES; i++) {
-      if (setup->scenes[i]) {
-         lp_scene_destroy(setup->scenes[i]);
+   if (setup->scenes) {
+      for (i = 0; i < setup->num_scenes; i++) {
+         if (setup->scenes[i]) {
+            lp_scene_destroy(setup->scenes[i]);
+         }
       }
+      FREE(setup->scenes);
    }
 
    setup->vbuf->destroy(setup->vbuf);
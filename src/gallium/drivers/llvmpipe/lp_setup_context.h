@@ -53,9 +53,6 @@
 struct lp_setup_variant;
 
 
-/** Max number of scenes */
-#define MAX_SCENES 2
-
 
 
 /**
@@ -85,8 +82,9 @@ struct lp_setup_context
     */
    struct draw_stage *vbuf;
    unsigned num_threads;
+   unsigned num_scenes;
    unsigned scene_idx;
-   struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
+   struct lp_scene **scenes;             /**< all the scenes */
    struct lp_scene *scene;               /**< current scene being built */
 
    struct lp_fence *last_fence;
@@ -109,6 +107,7 @@ struct lp_setup_context
    int face_slot;
 
    struct pipe_framebuffer_state fb;
+   unsigned fb_samples;       /**< 1 or LP_MAX_SAMPLES */
    struct u_rect framebuffer;
    struct u_rect scissors[PIPE_MAX_VIEWPORTS];
    struct u_rect draw_regions[PIPE_MAX_VIEWPORTS];   /* intersection of fb & scissor */
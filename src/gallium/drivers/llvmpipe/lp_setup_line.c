@@ -564,6 +564,14 @@ try_setup_line( struct lp_setup_context *setup,
        */
       bbox.x1--;
       bbox.y1--;
+
+      /* Sample positions lie up to half a pixel off the pixel centers */
+      if (setup->fb_samples > 1) {
+         bbox.x0--;
+         bbox.y0--;
+         bbox.x1++;
+         bbox.y1++;
+      }
    }
 
    if (bbox.x1 < bbox.x0 ||
@@ -636,6 +644,8 @@ try_setup_line( struct lp_setup_context *setup,
    line->inputs.opaque = FALSE;
    line->inputs.layer = layer;
    line->inputs.viewport_index = viewport_index;
+   line->inputs.hiz = FALSE;
+   line->inputs.zmin = 0.0f;
 
    for (i = 0; i < 4; i++) {
 
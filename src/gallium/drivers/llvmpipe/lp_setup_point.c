@@ -488,6 +488,8 @@ try_setup_point( struct lp_setup_context *setup,
    point->inputs.opaque = FALSE;
    point->inputs.layer = layer;
    point->inputs.viewport_index = viewport_index;
+   point->inputs.hiz = FALSE;
+   point->inputs.zmin = 0.0f;
 
    {
       struct lp_rast_plane *plane = GET_PLANES(point);
@@ -231,8 +231,12 @@ lp_setup_whole_tile(struct lp_setup_context *setup,
        * were just active we also can't do the optimization since to get
        * accurate query results we unfortunately need to execute the rendering
        * commands.
+       * - A sample mask which leaves out some samples keeps their contents.
        */
-      if (!scene->fb.zsbuf && scene->fb_max_layer == 0 && !scene->had_queries) {
+      const unsigned all_samples = (1 << setup->fb_samples) - 1;
+
+      if (!scene->fb.zsbuf && scene->fb_max_layer == 0 && !scene->had_queries &&
+          (setup->fs.current.sample_mask & all_samples) == all_samples) {
          /*
           * All previous rendering will be overwritten so reset the bin.
           */
@@ -314,6 +318,14 @@ do_triangle_ccw(struct lp_setup_context *setup,
       /* Inclusive / exclusive depending upon adj (bottom-left or top-right) */
       bbox.y0 = (MIN3(position->y[0], position->y[1], position->y[2]) + adj) >> FIXED_ORDER;
       bbox.y1 = (MAX3(position->y[0], position->y[1], position->y[2]) - 1 + adj) >> FIXED_ORDER;
+
+      /* Sample positions lie up to half a pixel off the pixel centers */
+      if (setup->fb_samples > 1) {
+         bbox.x0--;
+         bbox.y0--;
+         bbox.x1++;
+         bbox.y1++;
+      }
    }
 
    if (bbox.x1 < bbox.x0 ||
@@ -370,6 +382,18 @@ do_triangle_ccw(struct lp_setup_context *setup,
    tri->inputs.layer = layer;
    tri->inputs.viewport_index = viewport_index;
 
+   /* Interpolated z stays within the range of the vertex z, unless
+    * polygon offset moves it.  Unorm depth saturates at 0.0 and 1.0, and
+    * without depth clamping (see hiz_test) z is clipped to that range.
+    */
+   tri->inputs.hiz = setup->fs.current.variant->hiz_test &&
+                     setup->setup.variant->key.pgon_offset_units == 0.0f &&
+                     setup->setup.variant->key.pgon_offset_scale == 0.0f;
+   tri->inputs.zmin = MIN2(MIN3(v0[0][2], v1[0][2], v2[0][2]), 1.0f);
+   tri->inputs.zmax = (unsigned) ceil(CLAMP(MAX3(v0[0][2], v1[0][2], v2[0][2]),
+                                            0.0f, 1.0f) *
+                                      (double) LP_RAST_ZMAX_ONE);
+
    if (0)
       lp_dump_setup_coef(&setup->setup.variant->key,
 			 (const float (*)[4])GET_A0(&tri->inputs),
@@ -644,7 +668,8 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
       assert(iy0 == bbox->y1 / TILE_SIZE &&
 	     ix0 == bbox->x1 / TILE_SIZE);
 
-      if (nr_planes == 3) {
+      /* The contained-triangle rasterizers test pixel centers only */
+      if (nr_planes == 3 && setup->fb_samples == 1) {
          if (sz < 4)
          {
             /* Triangle is contained in a single 4x4 stamp:
@@ -683,7 +708,7 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
                                                 lp_rast_arg_triangle_contained(tri, px, py) );
          }
       }
-      else if (nr_planes == 4 && sz < 16) 
+      else if (nr_planes == 4 && sz < 16 && setup->fb_samples == 1)
       {
          px = MIN2(px, TILE_SIZE - 16);
          py = MIN2(py, TILE_SIZE - 16);
@@ -735,6 +760,15 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
          eo[i] = plane[i].eo << TILE_ORDER;
          xstep[i] = -(((int64_t)plane[i].dcdx) << TILE_ORDER);
          ystep[i] = ((int64_t)plane[i].dcdy) << TILE_ORDER;
+
+         /* Widen the tile tests by the largest sample offset so that
+          * rejected and fully covered tiles hold for every sample.
+          */
+         if (setup->fb_samples > 1) {
+            int64_t margin = ((int64_t) abs(plane[i].dcdx) + abs(plane[i].dcdy)) / 2;
+            eo[i] += margin;
+            ei[i] -= margin;
+         }
       }
 
 
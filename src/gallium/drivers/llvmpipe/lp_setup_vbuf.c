@@ -43,7 +43,8 @@
 #include "util/u_memory.h"
 
 
-#define LP_MAX_VBUF_INDEXES 1024
+/* Room for a whole vsplit segment of list primitives (DRAW_ELTS_SIZE) */
+#define LP_MAX_VBUF_INDEXES 4096
 #define LP_MAX_VBUF_SIZE    4096
 
   
@@ -0,0 +1,610 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Compute shaders.
+ *
+ * A TGSI compute shader is compiled once into a function that runs a
+ * whole block, one thread per SIMD lane and one vector of threads after
+ * another.  launch_grid hands the blocks out to the rasterizer threads,
+ * each of which has its own copy of the block's local memory.
+ *
+ * A BARRIER ends the loop over the vectors and starts another one, so
+ * every thread of the block finishes the code before the barrier before
+ * any thread runs the code after it.  The temporaries then live in
+ * memory, one set per vector, instead of in registers.  The address
+ * registers don't survive a barrier, which is fine for glsl_to_tgsi as
+ * it reloads them before every indirect access.  A barrier inside
+ * control flow can't be split this way and limits the block to a single
+ * vector, where it needs no code at all.
+ *
+ * GL compute shaders stay unavailable regardless: st/mesa doesn't
+ * dispatch compute work to gallium yet.
+ */
+
+#include "pipe/p_defines.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_swizzle.h"
+#include "gallivm/lp_bld_tgsi.h"
+#include "gallivm/lp_bld_type.h"
+#include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_flush.h"
+#include "lp_rast.h"
+#include "lp_screen.h"
+#include "lp_state.h"
+#include "lp_state_cs.h"
+#include "lp_texture.h"
+
+
+/**
+ * Resolves TGSI_RESOURCE_* addresses against the JIT function's
+ * arguments.
+ */
+struct lp_cs_iface
+{
+   struct lp_build_tgsi_cs_iface base;
+
+   LLVMValueRef input_ptr;
+   LLVMValueRef local_ptr;
+   LLVMValueRef global_ptr;
+
+   /* The loop running the block one vector (chunk) of threads at a time */
+   struct lp_build_context uint_bld;
+   struct lp_build_loop_state loop;
+   struct lp_build_mask_context *mask;
+   LLVMValueRef num_chunks;
+   LLVMValueRef num_threads;
+   LLVMValueRef lane;
+   LLVMValueRef size_x, size_y, size_xy;
+
+   /* Per chunk temporaries, if the shader has barriers */
+   LLVMValueRef temps_ptr;
+   unsigned temps_size;
+
+   /** A barrier was found inside control flow */
+   boolean nested_barrier;
+};
+
+
+static LLVMValueRef
+cs_resource_ptr(const struct lp_build_tgsi_cs_iface *cs_iface,
+                struct lp_build_tgsi_context *bld_base,
+                unsigned resource,
+                LLVMValueRef address)
+{
+   const struct lp_cs_iface *iface = (const struct lp_cs_iface *)cs_iface;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef slot, base;
+
+   switch (resource) {
+   case TGSI_RESOURCE_INPUT:
+      return LLVMBuildGEP(builder, iface->input_ptr, &address, 1, "");
+
+   case TGSI_RESOURCE_LOCAL:
+      return LLVMBuildGEP(builder, iface->local_ptr, &address, 1, "");
+
+   case TGSI_RESOURCE_GLOBAL:
+      /* see llvmpipe_set_global_binding() */
+      slot = LLVMBuildLShr(builder, address,
+                           lp_build_const_int32(gallivm,
+                                                LP_GLOBAL_OFFSET_BITS), "");
+      address = LLVMBuildAnd(builder, address,
+                             lp_build_const_int32(gallivm,
+                                                  (1 << LP_GLOBAL_OFFSET_BITS) - 1),
+                             "");
+      base = LLVMBuildLoad(builder,
+                           LLVMBuildGEP(builder, iface->global_ptr,
+                                        &slot, 1, ""), "");
+      return LLVMBuildGEP(builder, base, &address, 1, "");
+
+   default:
+      /* PIPE_COMPUTE_CAP_MAX_PRIVATE_SIZE is zero */
+      assert(!"unexpected compute resource");
+      return LLVMBuildGEP(builder, iface->local_ptr, &address, 1, "");
+   }
+}
+
+
+/**
+ * Bytes of temporaries for one chunk of threads.
+ */
+static unsigned
+cs_temps_size(const struct lp_compute_shader *shader)
+{
+   return (shader->info.file_max[TGSI_FILE_TEMPORARY] + 1) *
+          TGSI_NUM_CHANNELS * (lp_native_vector_width / 8);
+}
+
+
+/**
+ * Start running the next chunk of the block's threads.
+ */
+static void
+begin_chunk(struct lp_cs_iface *iface,
+            struct gallivm_state *gallivm,
+            struct lp_bld_tgsi_system_values *system_values,
+            LLVMValueRef *temps_array)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &iface->uint_bld;
+   LLVMValueRef first, thread;
+
+   lp_build_loop_begin(&iface->loop, gallivm, lp_build_const_int32(gallivm, 0));
+
+   /* Lane n of chunk c runs the block's (c * length + n)-th thread, x
+    * varying fastest.
+    */
+   first = LLVMBuildMul(builder, iface->loop.counter,
+                        lp_build_const_int32(gallivm, uint_bld->type.length), "");
+   thread = LLVMBuildAdd(builder, lp_build_broadcast_scalar(uint_bld, first),
+                         iface->lane, "");
+
+   system_values->thread_id[0] = LLVMBuildURem(builder, thread, iface->size_x, "");
+   system_values->thread_id[1] =
+      LLVMBuildURem(builder, LLVMBuildUDiv(builder, thread, iface->size_x, ""),
+                    iface->size_y, "");
+   system_values->thread_id[2] = LLVMBuildUDiv(builder, thread, iface->size_xy, "");
+
+   if (iface->temps_ptr) {
+      LLVMValueRef offset;
+
+      offset = LLVMBuildMul(builder, iface->loop.counter,
+                            lp_build_const_int32(gallivm, iface->temps_size), "");
+      *temps_array = LLVMBuildBitCast(builder,
+                                      LLVMBuildGEP(builder, iface->temps_ptr,
+                                                   &offset, 1, ""),
+                                      LLVMPointerType(uint_bld->vec_type, 0),
+                                      "temps");
+   }
+
+   lp_build_mask_begin(iface->mask, gallivm, uint_bld->type,
+                       lp_build_cmp(uint_bld, PIPE_FUNC_LESS,
+                                    thread, iface->num_threads));
+}
+
+
+static void
+end_chunk(struct lp_cs_iface *iface)
+{
+   lp_build_mask_end(iface->mask);
+   lp_build_loop_end(&iface->loop, iface->num_chunks, NULL);
+}
+
+
+static void
+cs_barrier(const struct lp_build_tgsi_cs_iface *cs_iface,
+           struct lp_build_tgsi_context *bld_base,
+           boolean top_level,
+           struct lp_bld_tgsi_system_values *system_values,
+           LLVMValueRef *temps_array)
+{
+   struct lp_cs_iface *iface = (struct lp_cs_iface *)cs_iface;
+
+   if (!top_level) {
+      iface->nested_barrier = TRUE;
+      return;
+   }
+
+   end_chunk(iface);
+   begin_chunk(iface, bld_base->base.gallivm, system_values, temps_array);
+}
+
+
+static struct lp_compute_shader_variant *
+generate_variant(struct lp_compute_shader *shader)
+{
+   struct lp_compute_shader_variant *variant;
+   struct gallivm_state *gallivm;
+   LLVMBuilderRef builder;
+   struct lp_type type;
+   struct lp_build_context *uint_bld;
+   struct lp_build_mask_context mask;
+   struct lp_bld_tgsi_system_values system_values;
+   struct lp_cs_iface cs_iface;
+   LLVMTypeRef int8_type, int32_type, arg_types[9], func_type;
+   LLVMValueRef function, block_size_ptr, grid_size_ptr;
+   LLVMValueRef elems[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef num_threads;
+   unsigned i;
+
+   variant = CALLOC_STRUCT(lp_compute_shader_variant);
+   if (!variant)
+      return NULL;
+
+   variant->gallivm = gallivm = gallivm_create();
+   if (!gallivm) {
+      FREE(variant);
+      return NULL;
+   }
+
+   memset(&type, 0, sizeof type);
+   type.floating = TRUE;
+   type.sign = TRUE;
+   type.width = 32;
+   type.length = lp_native_vector_width / 32;
+
+   memset(&cs_iface, 0, sizeof cs_iface);
+   uint_bld = &cs_iface.uint_bld;
+   lp_build_context_init(uint_bld, gallivm, lp_uint_type(type));
+
+   int8_type = LLVMInt8TypeInContext(gallivm->context);
+   int32_type = LLVMInt32TypeInContext(gallivm->context);
+
+   arg_types[0] = LLVMPointerType(int8_type, 0);                        /* input */
+   arg_types[1] = LLVMPointerType(int8_type, 0);                        /* local_mem */
+   arg_types[2] = LLVMPointerType(LLVMPointerType(int8_type, 0), 0);    /* global */
+   arg_types[3] = LLVMPointerType(int32_type, 0);                       /* block_size */
+   arg_types[4] = LLVMPointerType(int32_type, 0);                       /* grid_size */
+   arg_types[5] = int32_type;                                           /* block_x */
+   arg_types[6] = int32_type;                                           /* block_y */
+   arg_types[7] = int32_type;                                           /* block_z */
+   arg_types[8] = LLVMPointerType(int8_type, 0);                        /* temps */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
+                                arg_types, Elements(arg_types), 0);
+
+   function = LLVMAddFunction(gallivm->module, "cs", func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+   variant->function = function;
+
+   cs_iface.base.resource_ptr = cs_resource_ptr;
+   cs_iface.base.barrier = cs_barrier;
+   cs_iface.input_ptr = LLVMGetParam(function, 0);
+   cs_iface.local_ptr = LLVMGetParam(function, 1);
+   cs_iface.global_ptr = LLVMGetParam(function, 2);
+   block_size_ptr = LLVMGetParam(function, 3);
+   grid_size_ptr = LLVMGetParam(function, 4);
+
+   if (shader->info.opcode_count[TGSI_OPCODE_BARRIER]) {
+      cs_iface.temps_ptr = LLVMGetParam(function, 8);
+      cs_iface.temps_size = cs_temps_size(shader);
+      lp_build_name(cs_iface.temps_ptr, "temps");
+   }
+
+   lp_build_name(cs_iface.input_ptr, "input");
+   lp_build_name(cs_iface.local_ptr, "local_mem");
+   lp_build_name(cs_iface.global_ptr, "global");
+   lp_build_name(block_size_ptr, "block_size");
+   lp_build_name(grid_size_ptr, "grid_size");
+
+   builder = gallivm->builder;
+   LLVMPositionBuilderAtEnd(builder,
+                            LLVMAppendBasicBlockInContext(gallivm->context,
+                                                          function, "entry"));
+
+   memset(&system_values, 0, sizeof system_values);
+   for (i = 0; i < 3; i++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, i);
+
+      system_values.block_id[i] = LLVMGetParam(function, 5 + i);
+      lp_build_name(system_values.block_id[i], "block_%c", "xyz"[i]);
+      system_values.block_size[i] =
+         LLVMBuildLoad(builder,
+                       LLVMBuildGEP(builder, block_size_ptr, &index, 1, ""),
+                       "");
+      system_values.grid_size[i] =
+         LLVMBuildLoad(builder,
+                       LLVMBuildGEP(builder, grid_size_ptr, &index, 1, ""),
+                       "");
+   }
+
+   for (i = 0; i < type.length; i++) {
+      elems[i] = lp_build_const_int32(gallivm, i);
+   }
+   cs_iface.lane = LLVMConstVector(elems, type.length);
+
+   num_threads = LLVMBuildMul(builder, system_values.block_size[0],
+                              system_values.block_size[1], "");
+   num_threads = LLVMBuildMul(builder, num_threads,
+                              system_values.block_size[2], "");
+   cs_iface.num_chunks =
+      LLVMBuildUDiv(builder,
+                    LLVMBuildAdd(builder, num_threads,
+                                 lp_build_const_int32(gallivm, type.length - 1),
+                                 ""),
+                    lp_build_const_int32(gallivm, type.length), "num_chunks");
+
+   cs_iface.num_threads = lp_build_broadcast_scalar(uint_bld, num_threads);
+   cs_iface.size_x = lp_build_broadcast_scalar(uint_bld,
+                                               system_values.block_size[0]);
+   cs_iface.size_y = lp_build_broadcast_scalar(uint_bld,
+                                               system_values.block_size[1]);
+   cs_iface.size_xy = LLVMBuildMul(builder, cs_iface.size_x, cs_iface.size_y, "");
+   cs_iface.mask = &mask;
+
+   begin_chunk(&cs_iface, gallivm, &system_values, &cs_iface.base.temps_array);
+
+   lp_build_tgsi_soa(gallivm, shader->base.prog, type, &mask,
+                     NULL, NULL, &system_values, NULL, NULL, NULL,
+                     &shader->info, NULL, &cs_iface.base);
+
+   end_chunk(&cs_iface);
+
+   LLVMBuildRetVoid(builder);
+
+   variant->temps_size = cs_iface.temps_size;
+   variant->max_threads = cs_iface.nested_barrier ? type.length :
+                                                    LP_MAX_THREADS_PER_BLOCK;
+
+   gallivm_verify_function(gallivm, function);
+
+   if (gallivm_debug & GALLIVM_DEBUG_IR) {
+      lp_debug_dump_value(function);
+   }
+
+   gallivm_compile_module(gallivm);
+
+   variant->jit_function = (lp_jit_cs_func)
+      gallivm_jit_function(gallivm, function);
+
+   return variant;
+}
+
+
+static void
+free_variant(struct lp_compute_shader_variant *variant)
+{
+   gallivm_free_function(variant->gallivm, variant->function,
+                         variant->jit_function);
+   gallivm_destroy(variant->gallivm);
+   FREE(variant);
+}
+
+
+static void *
+llvmpipe_create_compute_state(struct pipe_context *pipe,
+                              const struct pipe_compute_state *templ)
+{
+   struct lp_compute_shader *shader;
+
+   shader = CALLOC_STRUCT(lp_compute_shader);
+   if (!shader)
+      return NULL;
+
+   shader->base = *templ;
+
+   /* copy shader tokens, the ones passed in will go away. */
+   shader->base.prog = tgsi_dup_tokens(templ->prog);
+   if (!shader->base.prog) {
+      FREE(shader);
+      return NULL;
+   }
+
+   tgsi_scan_shader(shader->base.prog, &shader->info);
+
+   if (LP_DEBUG & DEBUG_TGSI) {
+      debug_printf("llvmpipe: Create compute shader %p:\n", (void *)shader);
+      tgsi_dump(shader->base.prog, 0);
+   }
+
+   return shader;
+}
+
+
+static void
+llvmpipe_bind_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   llvmpipe->cs = (struct lp_compute_shader *)cs;
+}
+
+
+static void
+llvmpipe_delete_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct lp_compute_shader *shader = (struct lp_compute_shader *)cs;
+
+   if (!shader)
+      return;
+
+   if (shader->variant)
+      free_variant(shader->variant);
+
+   FREE((void *)shader->base.prog);
+   FREE(shader);
+}
+
+
+/**
+ * Global buffers have no address the shader could use directly, so each
+ * handle gets the buffer's slot in its top bits; the offset the state
+ * tracker already wrote there stays in the low bits.  The JIT code looks
+ * the slot up in the table of base addresses passed to every launch.
+ */
+static void
+llvmpipe_set_global_binding(struct pipe_context *pipe,
+                            unsigned first, unsigned count,
+                            struct pipe_resource **resources,
+                            uint32_t **handles)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(first + count <= LP_MAX_GLOBAL_BUFFERS);
+
+   for (i = 0; i < count; i++) {
+      pipe_resource_reference(&llvmpipe->global_buffers[first + i],
+                              resources ? resources[i] : NULL);
+
+      if (resources && resources[i]) {
+         assert(*handles[i] < (1 << LP_GLOBAL_OFFSET_BITS));
+         *handles[i] += (first + i) << LP_GLOBAL_OFFSET_BITS;
+      }
+   }
+}
+
+
+/** State shared by all the blocks of one launch_grid call */
+struct lp_cs_launch
+{
+   lp_jit_cs_func func;
+   const void *input;
+   uint8_t *global[LP_MAX_GLOBAL_BUFFERS];
+   uint8_t *local_mem;      /**< one local_size chunk per thread */
+   unsigned local_size;
+   uint8_t *temps;          /**< one temps_size chunk per thread */
+   unsigned temps_size;
+   uint32_t block_size[3];
+   uint32_t grid_size[3];
+};
+
+
+static void
+run_block(void *data, unsigned block, unsigned thread_index)
+{
+   struct lp_cs_launch *launch = (struct lp_cs_launch *)data;
+   unsigned x = block % launch->grid_size[0];
+   unsigned y = (block / launch->grid_size[0]) % launch->grid_size[1];
+   unsigned z = block / (launch->grid_size[0] * launch->grid_size[1]);
+
+   launch->func(launch->input,
+                launch->local_mem + thread_index * launch->local_size,
+                launch->global,
+                launch->block_size,
+                launch->grid_size,
+                x, y, z,
+                launch->temps + thread_index * launch->temps_size);
+}
+
+
+static void
+llvmpipe_launch_grid(struct pipe_context *pipe,
+                     const uint *block_layout, const uint *grid_layout,
+                     uint32_t pc, const void *input)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct lp_compute_shader *shader = llvmpipe->cs;
+   struct lp_compute_shader_variant *variant;
+   struct lp_cs_launch launch;
+   struct lp_rast_compute_job job;
+   const unsigned vector_length = lp_native_vector_width / 32;
+   unsigned num_threads, num_chunks;
+   unsigned i;
+
+   if (!shader)
+      return;
+
+   if (!shader->variant) {
+      shader->variant = generate_variant(shader);
+      if (!shader->variant)
+         return;
+   }
+   variant = shader->variant;
+
+   num_threads = block_layout[0] * block_layout[1] * block_layout[2];
+   if (!num_threads)
+      return;
+
+   if (block_layout[0] > LP_MAX_BLOCK_SIZE_XY ||
+       block_layout[1] > LP_MAX_BLOCK_SIZE_XY ||
+       block_layout[2] > LP_MAX_BLOCK_SIZE_Z ||
+       num_threads > variant->max_threads ||
+       shader->base.req_local_mem > LP_MAX_LOCAL_SIZE ||
+       shader->base.req_input_mem > LP_MAX_INPUT_SIZE) {
+      debug_printf("llvmpipe: unsupported compute block %ux%ux%u "
+                   "(at most %u threads for this shader)\n",
+                   block_layout[0], block_layout[1], block_layout[2],
+                   variant->max_threads);
+      return;
+   }
+
+   num_chunks = (num_threads + vector_length - 1) / vector_length;
+
+   /* The grid may read what was just rendered, and rendering queued after
+    * it may read what the grid writes.
+    */
+   llvmpipe_finish(pipe, __FUNCTION__);
+
+   memset(&launch, 0, sizeof launch);
+   launch.func = variant->jit_function;
+   launch.input = input;
+   for (i = 0; i < LP_MAX_GLOBAL_BUFFERS; i++) {
+      if (llvmpipe->global_buffers[i])
+         launch.global[i] = llvmpipe_resource_data(llvmpipe->global_buffers[i]);
+   }
+   for (i = 0; i < 3; i++) {
+      launch.block_size[i] = block_layout[i];
+      launch.grid_size[i] = grid_layout[i];
+   }
+
+   launch.local_size = align(shader->base.req_local_mem, 16);
+   if (launch.local_size) {
+      launch.local_mem = align_malloc(MAX2(1, screen->num_threads) *
+                                      launch.local_size, 16);
+      if (!launch.local_mem)
+         return;
+   }
+
+   launch.temps_size = num_chunks * variant->temps_size;
+   if (launch.temps_size) {
+      launch.temps = align_malloc(MAX2(1, screen->num_threads) *
+                                  launch.temps_size,
+                                  lp_native_vector_width / 8);
+      if (!launch.temps) {
+         align_free(launch.local_mem);
+         return;
+      }
+   }
+
+   job.run = run_block;
+   job.data = &launch;
+   job.num_blocks = grid_layout[0] * grid_layout[1] * grid_layout[2];
+
+   if (job.num_blocks) {
+      pipe_mutex_lock(screen->rast_mutex);
+      lp_rast_compute(screen->rast, &job);
+      pipe_mutex_unlock(screen->rast_mutex);
+   }
+
+   align_free(launch.temps);
+   align_free(launch.local_mem);
+}
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe)
+{
+   llvmpipe->pipe.create_compute_state = llvmpipe_create_compute_state;
+   llvmpipe->pipe.bind_compute_state = llvmpipe_bind_compute_state;
+   llvmpipe->pipe.delete_compute_state = llvmpipe_delete_compute_state;
+   llvmpipe->pipe.set_global_binding = llvmpipe_set_global_binding;
+   llvmpipe->pipe.launch_grid = llvmpipe_launch_grid;
+}
@@ -0,0 +1,72 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#ifndef LP_STATE_CS_H_
+#define LP_STATE_CS_H_
+
+
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
+#include "gallivm/lp_bld.h"
+#include "lp_jit.h"
+
+
+struct gallivm_state;
+
+
+/**
+ * JIT code for a compute shader.  Nothing in it depends on the launch
+ * parameters, so each shader has exactly one.
+ */
+struct lp_compute_shader_variant
+{
+   struct gallivm_state *gallivm;
+
+   LLVMValueRef function;
+   lp_jit_cs_func jit_function;
+
+   /** Largest block the code can run */
+   unsigned max_threads;
+   /** Bytes of temporaries kept across barriers per vector of threads */
+   unsigned temps_size;
+};
+
+
+/** Subclass of pipe_compute_state */
+struct lp_compute_shader
+{
+   struct pipe_compute_state base;   /**< base.prog holds TGSI tokens */
+
+   struct tgsi_shader_info info;
+
+   /** Compiled on first launch */
+   struct lp_compute_shader_variant *variant;
+};
+
+
+#endif /* LP_STATE_CS_H_ */
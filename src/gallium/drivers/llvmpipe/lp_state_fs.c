@@ -101,6 +101,9 @@
 #include "lp_flush.h"
 #include "lp_state_fs.h"
 #include "lp_rast.h"
+#include "lp_disk_cache.h"
+#include "lp_compile_queue.h"
+#include "lp_screen.h"
 
 
 /** Fragment shader number (for debugging) */
@@ -417,7 +420,7 @@ generate_fs_loop(struct gallivm_state *gallivm,
    lp_build_tgsi_soa(gallivm, tokens, type, &mask,
                      consts_ptr, num_consts_ptr, &system_values,
                      interp->inputs,
-                     outputs, sampler, &shader->info.base, NULL);
+                     outputs, sampler, &shader->info.base, NULL, NULL);
 
    /* Alpha test */
    if (key->alpha.enabled) {
@@ -2511,37 +2514,107 @@ lp_debug_fs_variant(const struct lp_fragment_shader_variant *variant)
    tgsi_dump(variant->shader->base.tokens, 0);
    dump_fs_variant_key(&variant->key);
    debug_printf("variant->opaque = %u\n", variant->opaque);
+   debug_printf("variant->hiz_test = %u\n", variant->hiz_test);
+   debug_printf("variant->hiz_write = %u\n", variant->hiz_write);
    debug_printf("\n");
 }
 
 
+/**
+ * Build the identifier of a variant for the on-disk shader cache: the
+ * TGSI tokens followed by the variant key.
+ * The returned buffer must be freed with FREE().
+ */
+static void *
+make_disk_cache_id(const struct lp_fragment_shader *shader,
+                   const struct lp_fragment_shader_variant_key *key,
+                   unsigned *size)
+{
+   const unsigned tokens_size =
+      tgsi_num_tokens(shader->base.tokens) * sizeof(struct tgsi_token);
+   uint8_t *id;
+
+   id = MALLOC(tokens_size + shader->variant_key_size);
+   if (!id)
+      return NULL;
+
+   memcpy(id, shader->base.tokens, tokens_size);
+   memcpy(id + tokens_size, key, shader->variant_key_size);
+
+   *size = tokens_size + shader->variant_key_size;
+   return id;
+}
+
+
+/**
+ * Find the fragment functions in a module loaded from the shader cache.
+ * They were named by generate_fragment() in the process which built them.
+ */
+static boolean
+find_cached_functions(struct lp_fragment_shader_variant *variant)
+{
+   LLVMValueRef func;
+
+   for (func = LLVMGetFirstFunction(variant->gallivm->module);
+        func;
+        func = LLVMGetNextFunction(func)) {
+      const char *name = LLVMGetValueName(func);
+      size_t len = strlen(name);
+
+      if (LLVMIsDeclaration(func))
+         continue;
+
+      if (len > 8 && strcmp(name + len - 8, "_partial") == 0) {
+         variant->function[RAST_EDGE_TEST] = func;
+      }
+      else if (len > 6 && strcmp(name + len - 6, "_whole") == 0) {
+         variant->function[RAST_WHOLE] = func;
+      }
+   }
+
+   if (!variant->function[RAST_EDGE_TEST] ||
+       (variant->opaque && !variant->function[RAST_WHOLE])) {
+      variant->function[RAST_EDGE_TEST] = NULL;
+      variant->function[RAST_WHOLE] = NULL;
+      return FALSE;
+   }
+
+   variant->nr_instrs += lp_build_count_instructions(variant->function[RAST_EDGE_TEST]);
+   if (variant->function[RAST_WHOLE])
+      variant->nr_instrs += lp_build_count_instructions(variant->function[RAST_WHOLE]);
+
+   return TRUE;
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
+ * \param no  variant number, for debugging/profiling
+ * \param context  LLVM context to build the variant in, or NULL for the
+ *                 global gallivm context
  */
 static struct lp_fragment_shader_variant *
 generate_variant(struct llvmpipe_context *lp,
                  struct lp_fragment_shader *shader,
-                 const struct lp_fragment_shader_variant_key *key)
+                 const struct lp_fragment_shader_variant_key *key,
+                 unsigned no,
+                 LLVMContextRef context)
 {
    struct lp_fragment_shader_variant *variant;
    const struct util_format_description *cbuf0_format_desc;
    boolean fullcolormask;
+   void *cache_id = NULL;
+   unsigned cache_id_size = 0;
 
    variant = CALLOC_STRUCT(lp_fragment_shader_variant);
    if(!variant)
       return NULL;
 
-   variant->gallivm = gallivm_create();
-   if (!variant->gallivm) {
-      FREE(variant);
-      return NULL;
-   }
-
    variant->shader = shader;
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
-   variant->no = shader->variants_created++;
+   variant->no = no;
 
    memcpy(&variant->key, key, shader->variant_key_size);
 
@@ -2565,6 +2638,39 @@ generate_variant(struct llvmpipe_context *lp,
          !shader->info.base.uses_kill
       ? TRUE : FALSE;
 
+   /*
+    * Hi-Z: a LESS/LEQUAL depth test with interpolated z can be decided
+    * per block from a primitive's minimum depth.  Stencil ops have side
+    * effects on failing fragments, so they disable it.
+    */
+   variant->hiz_test =
+         key->depth.enabled &&
+         (key->depth.func == PIPE_FUNC_LESS ||
+          key->depth.func == PIPE_FUNC_LEQUAL) &&
+         !key->stencil[0].enabled &&
+         !key->depth_clamp &&
+         !shader->info.base.writes_z;
+
+   variant->hiz_keep =
+         !key->depth.enabled ||
+         !key->depth.writemask ||
+         key->depth.func == PIPE_FUNC_LESS ||
+         key->depth.func == PIPE_FUNC_LEQUAL ||
+         key->depth.func == PIPE_FUNC_EQUAL ||
+         key->depth.func == PIPE_FUNC_NEVER;
+
+   /*
+    * Fragments that are neither killed nor fail the depth test write their
+    * interpolated z, so a block fully covered by a primitive ends up no
+    * deeper than the primitive's maximum z.
+    */
+   variant->hiz_write =
+         variant->hiz_test &&
+         key->depth.writemask &&
+         !key->alpha.enabled &&
+         !key->blend.alpha_to_coverage &&
+         !shader->info.base.uses_kill;
+
    if ((shader->info.base.num_tokens <= 1) &&
        !key->depth.enabled && !key->stencil[0].enabled) {
       variant->ps_inv_multiplier = 0;
@@ -2576,18 +2682,45 @@ generate_variant(struct llvmpipe_context *lp,
       lp_debug_fs_variant(variant);
    }
 
+   if (lp_disk_cache_enabled()) {
+      cache_id = make_disk_cache_id(shader, key, &cache_id_size);
+      if (cache_id) {
+         variant->gallivm = lp_disk_cache_load(context, cache_id, cache_id_size);
+      }
+   }
+
+   if (variant->gallivm && !find_cached_functions(variant)) {
+      gallivm_destroy(variant->gallivm);
+      variant->gallivm = NULL;
+   }
+
+   if (!variant->gallivm) {
+      variant->gallivm = context ? gallivm_create_in_context(context)
+                                 : gallivm_create();
+      if (!variant->gallivm) {
+         FREE(cache_id);
+         FREE(variant);
+         return NULL;
+      }
+   }
+
    lp_jit_init_types(variant);
-   
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
+
+   if (variant->function[RAST_EDGE_TEST] == NULL) {
       generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
 
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
       if (variant->opaque) {
          /* Specialized shader, which doesn't need to read the color buffer. */
          generate_fragment(lp, shader, variant, RAST_WHOLE);
       }
+
+      if (cache_id) {
+         lp_disk_cache_store(variant->gallivm, cache_id, cache_id_size);
+      }
    }
 
+   FREE(cache_id);
+
    /*
     * Compile everything
     */
@@ -2612,6 +2745,218 @@ generate_variant(struct llvmpipe_context *lp,
 }
 
 
+static void
+make_variant_key(struct llvmpipe_context *lp,
+                 struct lp_fragment_shader *shader,
+                 struct lp_fragment_shader_variant_key *key);
+
+
+/**
+ * Fragment shader variant compiled on a background thread.
+ */
+struct lp_fs_compile_job
+{
+   struct lp_compile_job base;
+
+   struct llvmpipe_context *lp;
+   struct lp_fragment_shader *shader;
+   struct lp_fragment_shader_variant_key key;
+   unsigned variant_no;
+
+   /** The result, valid once the job is done */
+   struct lp_fragment_shader_variant *variant;
+};
+
+
+/**
+ * Destruction of a variant which was compiled on a background thread.
+ */
+struct lp_fs_destroy_job
+{
+   struct lp_compile_job base;
+
+   struct lp_fragment_shader_variant *variant;
+};
+
+
+static void
+execute_fs_compile_job(struct lp_compile_job *base,
+                       LLVMContextRef context)
+{
+   struct lp_fs_compile_job *job = (struct lp_fs_compile_job *) base;
+
+   job->variant = generate_variant(job->lp, job->shader, &job->key,
+                                   job->variant_no, context);
+   if (job->variant) {
+      job->variant->worker = base->worker;
+   }
+}
+
+
+/**
+ * Free the variant's JIT'd functions and the variant itself.
+ */
+static void
+free_variant(struct lp_fragment_shader_variant *variant)
+{
+   unsigned i;
+
+   for (i = 0; i < Elements(variant->function); i++) {
+      if (variant->function[i]) {
+         gallivm_free_function(variant->gallivm,
+                               variant->function[i],
+                               variant->jit_function[i]);
+      }
+   }
+
+   gallivm_destroy(variant->gallivm);
+
+   FREE(variant);
+}
+
+
+static void
+execute_fs_destroy_job(struct lp_compile_job *base,
+                       LLVMContextRef context)
+{
+   struct lp_fs_destroy_job *job = (struct lp_fs_destroy_job *) base;
+
+   free_variant(job->variant);
+}
+
+
+/**
+ * Free a variant which is no longer referenced.  Variants compiled in the
+ * background must be freed by the thread owning their LLVM context.
+ */
+static void
+destroy_variant(struct lp_fragment_shader_variant *variant)
+{
+   if (variant->worker) {
+      struct lp_fs_destroy_job *job = CALLOC_STRUCT(lp_fs_destroy_job);
+
+      /* If we're out of memory, leak the variant rather than racing with
+       * the worker thread.
+       */
+      if (job) {
+         lp_compile_job_init(&job->base, execute_fs_destroy_job, TRUE);
+         job->variant = variant;
+         lp_compile_queue_submit_to(variant->worker, &job->base);
+      }
+   }
+   else {
+      free_variant(variant);
+   }
+}
+
+
+/**
+ * Start compiling the variant for the current state in the background,
+ * so that it is hopefully ready by the time the shader is used.
+ */
+static void
+start_fs_compile_job(struct llvmpipe_context *lp,
+                     struct lp_fragment_shader *shader)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_fs_compile_job *job;
+
+   assert(!shader->pending_job);
+
+   /* make_variant_key() needs these */
+   if (!lp->rasterizer || !lp->depth_stencil || !lp->blend)
+      return;
+
+   job = CALLOC_STRUCT(lp_fs_compile_job);
+   if (!job)
+      return;
+
+   lp_compile_job_init(&job->base, execute_fs_compile_job, FALSE);
+   job->lp = lp;
+   job->shader = shader;
+   make_variant_key(lp, shader, &job->key);
+   job->variant_no = shader->variants_created++;
+
+   shader->pending_job = job;
+
+   lp_compile_queue_submit(screen->compile_queue, &job->base);
+}
+
+
+/**
+ * Check if we've exceeded the max number of shader variants or
+ * instructions, and if so free 25% of the variants (the least recently
+ * used ones).  Called before adding a new variant to the lists.
+ */
+static void
+cull_fs_variants(struct llvmpipe_context *lp)
+{
+   unsigned i;
+   unsigned variants_to_cull;
+
+   variants_to_cull = lp->nr_fs_variants >= LP_MAX_SHADER_VARIANTS ? LP_MAX_SHADER_VARIANTS / 4 : 0;
+
+   if (variants_to_cull ||
+       lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS) {
+      struct pipe_context *pipe = &lp->pipe;
+
+      /*
+       * XXX: we need to flush the context until we have some sort of
+       * reference counting in fragment shaders as they may still be binned
+       * Flushing alone might not be sufficient we need to wait on it too.
+       */
+      llvmpipe_finish(pipe, __FUNCTION__);
+
+      /*
+       * We need to re-check lp->nr_fs_variants because an arbitrarliy large
+       * number of shader variants (potentially all of them) could be
+       * pending for destruction on flush.
+       */
+
+      for (i = 0; i < variants_to_cull || lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS; i++) {
+         struct lp_fs_variant_list_item *item;
+         if (is_empty_list(&lp->fs_variants_list)) {
+            break;
+         }
+         item = last_elem(&lp->fs_variants_list);
+         assert(item);
+         assert(item->base);
+         llvmpipe_remove_shader_variant(lp, item->base);
+      }
+   }
+}
+
+
+/**
+ * Wait for the shader's background compile job and add the resulting
+ * variant to the variant lists, culling old variants first just like
+ * the synchronous path does.
+ */
+static void
+finish_fs_compile_job(struct llvmpipe_context *lp,
+                      struct lp_fragment_shader *shader)
+{
+   struct lp_fs_compile_job *job = shader->pending_job;
+   struct lp_fragment_shader_variant *variant;
+
+   lp_compile_job_wait(&job->base);
+
+   variant = job->variant;
+   if (variant) {
+      cull_fs_variants(lp);
+      insert_at_head(&shader->variants, &variant->list_item_local);
+      insert_at_head(&lp->fs_variants_list, &variant->list_item_global);
+      lp->nr_fs_variants++;
+      lp->nr_fs_instrs += variant->nr_instrs;
+      shader->variants_cached++;
+      llvmpipe_variant_count++;
+   }
+
+   lp_compile_job_destroy(&job->base);
+   shader->pending_job = NULL;
+}
+
+
 static void *
 llvmpipe_create_fs_state(struct pipe_context *pipe,
                          const struct pipe_shader_state *templ)
@@ -2703,6 +3048,10 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
       debug_printf("\n");
    }
 
+   if (llvmpipe_screen(pipe->screen)->compile_queue) {
+      start_fs_compile_job(llvmpipe, shader);
+   }
+
    return shader;
 }
 
@@ -2732,8 +3081,6 @@ void
 llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                                struct lp_fragment_shader_variant *variant)
 {
-   unsigned i;
-
    if (gallivm_debug & GALLIVM_DEBUG_IR) {
       debug_printf("llvmpipe: del fs #%u var #%u v created #%u v cached"
                    " #%u v total cached #%u\n",
@@ -2744,17 +3091,6 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants);
    }
 
-   /* free all the variant's JIT'd functions */
-   for (i = 0; i < Elements(variant->function); i++) {
-      if (variant->function[i]) {
-         gallivm_free_function(variant->gallivm,
-                               variant->function[i],
-                               variant->jit_function[i]);
-      }
-   }
-
-   gallivm_destroy(variant->gallivm);
-
    /* remove from shader's list */
    remove_from_list(&variant->list_item_local);
    variant->shader->variants_cached--;
@@ -2764,7 +3100,8 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
    lp->nr_fs_variants--;
    lp->nr_fs_instrs -= variant->nr_instrs;
 
-   FREE(variant);
+   /* free the variant's JIT'd functions */
+   destroy_variant(variant);
 }
 
 
@@ -2784,6 +3121,10 @@ llvmpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
     */
    llvmpipe_finish(pipe, __FUNCTION__);
 
+   if (shader->pending_job) {
+      finish_fs_compile_job(llvmpipe, shader);
+   }
+
    /* Delete all the variants */
    li = first_elem(&shader->variants);
    while(!at_end(&shader->variants, li)) {
@@ -3070,6 +3411,16 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
 
    make_variant_key(lp, shader, &key);
 
+   /* Pick up the variant compiled in the background once it is ready.
+    * If it is the one we need right now, wait for it rather than
+    * compiling it a second time.
+    */
+   if (shader->pending_job &&
+       (lp_compile_job_is_done(&shader->pending_job->base) ||
+        memcmp(&shader->pending_job->key, &key, shader->variant_key_size) == 0)) {
+      finish_fs_compile_job(lp, shader);
+   }
+
    /* Search the variants for one which matches the key */
    li = first_elem(&shader->variants);
    while(!at_end(&shader->variants, li)) {
@@ -3089,8 +3440,6 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
    else {
       /* variant not found, create it now */
       int64_t t0, t1, dt;
-      unsigned i;
-      unsigned variants_to_cull;
 
       if (0) {
          debug_printf("%u variants,\t%u instrs,\t%u instrs/variant\n",
@@ -3099,45 +3448,14 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
                       lp->nr_fs_variants ? lp->nr_fs_instrs / lp->nr_fs_variants : 0);
       }
 
-      /* First, check if we've exceeded the max number of shader variants.
-       * If so, free 25% of them (the least recently used ones).
-       */
-      variants_to_cull = lp->nr_fs_variants >= LP_MAX_SHADER_VARIANTS ? LP_MAX_SHADER_VARIANTS / 4 : 0;
-
-      if (variants_to_cull ||
-          lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS) {
-         struct pipe_context *pipe = &lp->pipe;
-
-         /*
-          * XXX: we need to flush the context until we have some sort of
-          * reference counting in fragment shaders as they may still be binned
-          * Flushing alone might not be sufficient we need to wait on it too.
-          */
-         llvmpipe_finish(pipe, __FUNCTION__);
-
-         /*
-          * We need to re-check lp->nr_fs_variants because an arbitrarliy large
-          * number of shader variants (potentially all of them) could be
-          * pending for destruction on flush.
-          */
-
-         for (i = 0; i < variants_to_cull || lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS; i++) {
-            struct lp_fs_variant_list_item *item;
-            if (is_empty_list(&lp->fs_variants_list)) {
-               break;
-            }
-            item = last_elem(&lp->fs_variants_list);
-            assert(item);
-            assert(item->base);
-            llvmpipe_remove_shader_variant(lp, item->base);
-         }
-      }
+      cull_fs_variants(lp);
 
       /*
        * Generate the new variant.
        */
       t0 = os_time_get();
-      variant = generate_variant(lp, shader, &key);
+      variant = generate_variant(lp, shader, &key,
+                                 shader->variants_created++, NULL);
       t1 = os_time_get();
       dt = t1 - t0;
       LP_COUNT_ADD(llvm_compile_time, dt);
@@ -38,6 +38,10 @@
 #include "lp_bld_interp.h" /* for struct lp_shader_input */
 
 
+struct lp_compile_worker;
+struct lp_fs_compile_job;
+
+
 struct tgsi_token;
 struct lp_fragment_shader;
 
@@ -100,6 +104,13 @@ struct lp_fragment_shader_variant
    boolean opaque;
    uint8_t ps_inv_multiplier;
 
+   /** Fragments can be rejected against the per-block Hi-Z bounds */
+   boolean hiz_test;
+   /** Depth writes can only lower stored depth, so Hi-Z bounds stay valid */
+   boolean hiz_keep;
+   /** A block fully covered by a primitive ends up no deeper than its zmax */
+   boolean hiz_write;
+
    struct gallivm_state *gallivm;
 
    LLVMTypeRef jit_context_ptr_type;
@@ -118,6 +129,9 @@ struct lp_fragment_shader_variant
 
    /* For debugging/profiling purposes */
    unsigned no;
+
+   /** Compile thread owning the LLVM context, if built in the background */
+   struct lp_compile_worker *worker;
 };
 
 
@@ -140,6 +154,9 @@ struct lp_fragment_shader
 
    /** Fragment shader input interpolation info */
    struct lp_shader_input inputs[PIPE_MAX_SHADER_INPUTS];
+
+   /** Variant being compiled in the background, if any */
+   struct lp_fs_compile_job *pending_job;
 };
 
 
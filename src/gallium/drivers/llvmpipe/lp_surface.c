@@ -25,6 +25,8 @@
  * 
  **************************************************************************/
 
+#include "util/u_format.h"
+#include "util/u_memory.h"
 #include "util/u_rect.h"
 #include "util/u_surface.h"
 #include "lp_context.h"
@@ -159,13 +161,17 @@ lp_resource_copy(struct pipe_context *pipe,
          = llvmpipe_get_texture_image_address(dst_tex, dstz,
                                               dst_level);
 
-      if (dst_linear_ptr && src_linear_ptr) {
-         util_copy_box(dst_linear_ptr, format,
+      /* multisample copies go between resources of equal sample count */
+      const unsigned samples = MAX2(1, MIN2(src->nr_samples, dst->nr_samples));
+      unsigned s;
+
+      for (s = 0; dst_linear_ptr && src_linear_ptr && s < samples; s++) {
+         util_copy_box(dst_linear_ptr + s * dst_tex->sample_stride, format,
                        llvmpipe_resource_stride(&dst_tex->base, dst_level),
                        dst_tex->img_stride[dst_level],
                        dstx, dsty, 0,
                        width, height, depth,
-                       src_linear_ptr,
+                       src_linear_ptr + s * src_tex->sample_stride,
                        llvmpipe_resource_stride(&src_tex->base, src_level),
                        src_tex->img_stride[src_level],
                        src_box->x, src_box->y, 0);
@@ -174,6 +180,192 @@ lp_resource_copy(struct pipe_context *pipe,
 }
 
 
+/**
+ * Compute which bits of a block of \p format hold the components
+ * selected by \p mask (PIPE_MASK_x), one byte mask per byte of the block.
+ * \return TRUE if the whole block is selected
+ */
+static boolean
+resolve_block_mask(enum pipe_format format, unsigned mask, ubyte *bytes)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   const boolean zs = desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS;
+   boolean all = TRUE;
+   unsigned c, i, b;
+
+   memset(bytes, 0, desc->block.bits / 8);
+
+   for (c = 0; c < desc->nr_channels; c++) {
+      const struct util_format_channel_description *chan = &desc->channel[c];
+      boolean write = chan->type == UTIL_FORMAT_TYPE_VOID;
+
+      for (i = 0; i < 4; i++) {
+         if (desc->swizzle[i] == c) {
+            if (zs)
+               write |= (mask & (i == 0 ? PIPE_MASK_Z : PIPE_MASK_S)) != 0;
+            else
+               write |= (mask & (PIPE_MASK_R << i)) != 0;
+         }
+      }
+
+      if (!write) {
+         all = FALSE;
+         continue;
+      }
+
+      for (b = chan->shift; b < chan->shift + chan->size; b++)
+         bytes[b / 8] |= 1 << (b % 8);
+   }
+
+   return all;
+}
+
+
+/**
+ * Resolve a multisample resource into a single-sample one.
+ * Color samples are averaged in float; depth/stencil and integer formats,
+ * which can't be averaged, take sample 0.  Only 1:1 blits are handled,
+ * optionally flipped, as that's all GL allows for multisample sources.
+ * Components not in info->mask keep their destination values.
+ */
+static void
+lp_resolve_blit(struct pipe_context *pipe,
+                const struct pipe_blit_info *info)
+{
+   struct llvmpipe_resource *src_tex = llvmpipe_resource(info->src.resource);
+   struct llvmpipe_resource *dst_tex = llvmpipe_resource(info->dst.resource);
+   const enum pipe_format src_format = info->src.format;
+   const enum pipe_format dst_format = info->dst.format;
+   const unsigned samples = src_tex->base.nr_samples;
+   const unsigned width = abs(info->dst.box.width);
+   const unsigned height = abs(info->dst.box.height);
+   const boolean flip_x = (info->src.box.width < 0) != (info->dst.box.width < 0);
+   const boolean flip_y = (info->src.box.height < 0) != (info->dst.box.height < 0);
+   const unsigned src_x = MIN2(info->src.box.x, info->src.box.x + info->src.box.width);
+   const unsigned src_y = MIN2(info->src.box.y, info->src.box.y + info->src.box.height);
+   const unsigned dst_x = MIN2(info->dst.box.x, info->dst.box.x + info->dst.box.width);
+   const unsigned dst_y = MIN2(info->dst.box.y, info->dst.box.y + info->dst.box.height);
+   const unsigned src_stride = llvmpipe_resource_stride(&src_tex->base, info->src.level);
+   const unsigned dst_stride = llvmpipe_resource_stride(&dst_tex->base, info->dst.level);
+   const boolean average = !util_format_is_depth_or_stencil(src_format) &&
+                           !util_format_is_pure_integer(src_format);
+   const unsigned bpp = util_format_get_blocksize(src_format);
+   ubyte block_mask[16];
+   boolean whole_block;
+   float *row, *sum;
+   unsigned z;
+
+   if (abs(info->src.box.width) != width ||
+       abs(info->src.box.height) != height ||
+       info->src.box.depth != info->dst.box.depth ||
+       info->scissor_enable ||
+       (!average && (src_format != dst_format || flip_x))) {
+      debug_printf("llvmpipe: unsupported resolve %s -> %s\n",
+                   util_format_short_name(src_format),
+                   util_format_short_name(dst_format));
+      return;
+   }
+
+   assert(bpp <= sizeof block_mask);
+   whole_block = resolve_block_mask(dst_format, info->mask, block_mask);
+   if (!whole_block) {
+      unsigned b;
+
+      for (b = 0; b < bpp && !block_mask[b]; b++)
+         ;
+      if (b == bpp)
+         return; /* no component selected */
+   }
+
+   llvmpipe_flush_resource(pipe,
+                           info->dst.resource, info->dst.level,
+                           FALSE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE, /* do_not_block */
+                           "resolve dest");
+
+   llvmpipe_flush_resource(pipe,
+                           info->src.resource, info->src.level,
+                           TRUE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE, /* do_not_block */
+                           "resolve src");
+
+   row = MALLOC(width * 4 * sizeof(float));
+   sum = MALLOC(width * 4 * sizeof(float));
+   if (!row || !sum)
+      goto out;
+
+   for (z = 0; z < info->src.box.depth; z++) {
+      const ubyte *src_map =
+         llvmpipe_get_texture_image(src_tex, info->src.box.z + z,
+                                    info->src.level, LP_TEX_USAGE_READ);
+      ubyte *dst_map =
+         llvmpipe_get_texture_image(dst_tex, info->dst.box.z + z,
+                                    info->dst.level, LP_TEX_USAGE_READ_WRITE);
+      unsigned y;
+
+      if (!src_map || !dst_map)
+         goto out;
+
+      for (y = 0; y < height; y++) {
+         const unsigned sy = src_y + (flip_y ? height - 1 - y : y);
+         unsigned s, i;
+
+         if (!average) {
+            ubyte *dst_row = dst_map + (dst_y + y) * dst_stride + dst_x * bpp;
+            const ubyte *src_row = src_map + sy * src_stride + src_x * bpp;
+
+            if (whole_block) {
+               memcpy(dst_row, src_row, width * bpp);
+            }
+            else {
+               for (i = 0; i < width * bpp; i++) {
+                  const ubyte m = block_mask[i % bpp];
+                  dst_row[i] = (dst_row[i] & ~m) | (src_row[i] & m);
+               }
+            }
+            continue;
+         }
+
+         util_format_read_4f(src_format, sum, 0, src_map, src_stride,
+                             src_x, sy, width, 1);
+         for (s = 1; s < samples; s++) {
+            util_format_read_4f(src_format, row, 0,
+                                src_map + s * src_tex->sample_stride,
+                                src_stride, src_x, sy, width, 1);
+            for (i = 0; i < width * 4; i++)
+               sum[i] += row[i];
+         }
+
+         for (i = 0; i < width; i++) {
+            const unsigned si = flip_x ? width - 1 - i : i;
+            row[i * 4 + 0] = sum[si * 4 + 0] / samples;
+            row[i * 4 + 1] = sum[si * 4 + 1] / samples;
+            row[i * 4 + 2] = sum[si * 4 + 2] / samples;
+            row[i * 4 + 3] = sum[si * 4 + 3] / samples;
+         }
+
+         if (!whole_block) {
+            util_format_read_4f(dst_format, sum, 0, dst_map, dst_stride,
+                                dst_x, dst_y + y, width, 1);
+            for (i = 0; i < width * 4; i++) {
+               if (!(info->mask & (PIPE_MASK_R << (i % 4))))
+                  row[i] = sum[i];
+            }
+         }
+
+         util_format_write_4f(dst_format, row, 0, dst_map, dst_stride,
+                              dst_x, dst_y + y, width, 1);
+      }
+   }
+
+out:
+   FREE(row);
+   FREE(sum);
+}
+
+
 static void lp_blit(struct pipe_context *pipe,
                     const struct pipe_blit_info *blit_info)
 {
@@ -181,10 +373,8 @@ static void lp_blit(struct pipe_context *pipe,
    struct pipe_blit_info info = *blit_info;
 
    if (info.src.resource->nr_samples > 1 &&
-       info.dst.resource->nr_samples <= 1 &&
-       !util_format_is_depth_or_stencil(info.src.resource->format) &&
-       !util_format_is_pure_integer(info.src.resource->format)) {
-      debug_printf("llvmpipe: color resolve unimplemented\n");
+       info.dst.resource->nr_samples <= 1) {
+      lp_resolve_blit(pipe, &info);
       return;
    }
 
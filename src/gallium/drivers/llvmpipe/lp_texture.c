@@ -148,7 +148,8 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
       }
 
       total_size += (uint64_t) lpr->num_slices_faces[level]
-                  * (uint64_t) lpr->img_stride[level];
+                  * (uint64_t) lpr->img_stride[level]
+                  * (uint64_t) MAX2(1, pt->nr_samples);
       if (total_size > LP_MAX_TEXTURE_SIZE) {
          goto fail;
       }
@@ -774,6 +775,15 @@ alloc_image_data(struct llvmpipe_resource *lpr)
          lpr->linear_mip_offsets[level] = offset;
          offset += align(buffer_size, alignment);
       }
+      /*
+       * Multisample resources store one complete single-sample image
+       * per sample, sample_stride bytes apart.  Sample 0 is what
+       * transfers and copies see.
+       */
+      if (lpr->base.nr_samples > 1) {
+         lpr->sample_stride = offset;
+         offset *= lpr->base.nr_samples;
+      }
       lpr->linear_img.data = align_malloc(offset, alignment);
       if (lpr->linear_img.data) {
          memset(lpr->linear_img.data, 0, offset);
@@ -900,6 +910,7 @@ llvmpipe_resource_size(const struct pipe_resource *resource)
          if (lpr->linear_img.data)
             size += tex_image_size(lpr, lvl);
       }
+      size *= MAX2(1, resource->nr_samples);
    }
    else {
       size = resource->width0;
@@ -75,6 +75,8 @@ struct llvmpipe_resource
    unsigned num_slices_faces[LP_MAX_TEXTURE_LEVELS];
    /** Offset to start of mipmap level, in bytes */
    unsigned linear_mip_offsets[LP_MAX_TEXTURE_LEVELS];
+   /** Offset between the images of consecutive samples, in bytes */
+   unsigned sample_stride;
 
    /**
     * Display target, for textures with the PIPE_BIND_DISPLAY_TARGET
@@ -190,6 +192,14 @@ llvmpipe_layer_stride(struct pipe_resource *resource,
 }
 
 
+static INLINE unsigned
+llvmpipe_sample_stride(struct pipe_resource *resource)
+{
+   struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+   return lpr->sample_stride;
+}
+
+
 static INLINE unsigned
 llvmpipe_resource_stride(struct pipe_resource *resource,
                          unsigned level)
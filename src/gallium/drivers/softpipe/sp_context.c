@@ -33,6 +33,7 @@
 #include "draw/draw_context.h"
 #include "draw/draw_vbuf.h"
 #include "pipe/p_defines.h"
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_pstipple.h"
@@ -44,6 +45,7 @@
 #include "sp_context.h"
 #include "sp_flush.h"
 #include "sp_prim_vbuf.h"
+#include "sp_rast_thread.h"
 #include "sp_state.h"
 #include "sp_surface.h"
 #include "sp_tile_cache.h"
@@ -54,6 +56,9 @@
 #include "sp_tex_sample.h"
 
 
+DEBUG_GET_ONCE_NUM_OPTION(softpipe_num_threads, "SOFTPIPE_NUM_THREADS", 0)
+
+
 static void
 softpipe_destroy( struct pipe_context *pipe )
 {
@@ -75,17 +80,7 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
-   if (softpipe->quad.shade)
-      softpipe->quad.shade->destroy( softpipe->quad.shade );
-
-   if (softpipe->quad.depth_test)
-      softpipe->quad.depth_test->destroy( softpipe->quad.depth_test );
-
-   if (softpipe->quad.blend)
-      softpipe->quad.blend->destroy( softpipe->quad.blend );
-
-   if (softpipe->quad.pstipple)
-      softpipe->quad.pstipple->destroy( softpipe->quad.pstipple );
+   sp_rast_threads_destroy(softpipe);
 
    for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
       sp_destroy_tile_cache(softpipe->cbuf_cache[i]);
@@ -114,8 +109,6 @@ softpipe_destroy( struct pipe_context *pipe )
       pipe_resource_reference(&softpipe->vertex_buffer[i].buffer, NULL);
    }
 
-   tgsi_exec_machine_destroy(softpipe->fs_machine);
-
    for (i = 0; i < PIPE_SHADER_TYPES; i++) {
       FREE(softpipe->tgsi.sampler[i]);
    }
@@ -193,6 +186,7 @@ softpipe_create_context( struct pipe_screen *screen,
 {
    struct softpipe_screen *sp_screen = softpipe_screen(screen);
    struct softpipe_context *softpipe = CALLOC_STRUCT(softpipe_context);
+   unsigned num_threads;
    uint i, sh;
 
    util_init_math();
@@ -231,14 +225,6 @@ softpipe_create_context( struct pipe_screen *screen,
    softpipe->pipe.create_video_codec = vl_create_decoder;
    softpipe->pipe.create_video_buffer = vl_video_buffer_create;
 
-   /*
-    * Alloc caches for accessing drawing surfaces and textures.
-    * Must be before quad stage setup!
-    */
-   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
-      softpipe->cbuf_cache[i] = sp_create_tile_cache( &softpipe->pipe );
-   softpipe->zsbuf_cache = sp_create_tile_cache( &softpipe->pipe );
-
    /* Allocate texture caches */
    for (sh = 0; sh < Elements(softpipe->tex_cache); sh++) {
       for (i = 0; i < Elements(softpipe->tex_cache[0]); i++) {
@@ -248,13 +234,24 @@ softpipe_create_context( struct pipe_screen *screen,
       }
    }
 
-   softpipe->fs_machine = tgsi_exec_machine_create();
+   /* Rasterizer threads, with their quad pipelines */
+   num_threads = 1 + debug_get_option_softpipe_num_threads();
+   if (!sp_rast_threads_create(softpipe, MIN2(num_threads, SP_MAX_THREADS)))
+      goto fail;
 
-   /* setup quad rendering stages */
-   softpipe->quad.shade = sp_quad_shade_stage(softpipe);
-   softpipe->quad.depth_test = sp_quad_depth_test_stage(softpipe);
-   softpipe->quad.blend = sp_quad_blend_stage(softpipe);
-   softpipe->quad.pstipple = sp_quad_polygon_stipple_stage(softpipe);
+   /*
+    * Alloc caches for accessing drawing surfaces, shared by the threads.
+    */
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      softpipe->cbuf_cache[i] = sp_create_tile_cache(&softpipe->pipe,
+                                                     softpipe->num_threads);
+      if (!softpipe->cbuf_cache[i])
+         goto fail;
+   }
+   softpipe->zsbuf_cache = sp_create_tile_cache(&softpipe->pipe,
+                                                softpipe->num_threads);
+   if (!softpipe->zsbuf_cache)
+      goto fail;
 
 
    /*
@@ -36,7 +36,9 @@
 
 #include "draw/draw_vertex.h"
 
+#include "sp_limits.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast_thread.h"
 
 
 /** Do polygon stipple in the draw module? */
@@ -151,21 +153,23 @@ struct softpipe_context {
       struct pipe_sampler_view *sampler_view;
    } pstipple;
 
-   /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *pstipple;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
-
    /** TGSI exec things */
    struct {
       struct sp_tgsi_sampler *sampler[PIPE_SHADER_TYPES];
    } tgsi;
 
-   struct tgsi_exec_machine *fs_machine;
+   /**
+    * Rasterizer threads, each with its own quad pipeline, fragment
+    * shader machine and texture caches.  thread[0] is this context's
+    * thread.
+    */
+   struct sp_rast_thread *thread[SP_MAX_THREADS];
+   unsigned num_threads;
+
+   /** The work the helper threads are currently doing */
+   sp_rast_func thread_func;
+   void *thread_data;
+   boolean threads_exit;
 
    /** The primitive drawing context */
    struct draw_context *draw;
@@ -178,6 +182,7 @@ struct softpipe_context {
 
    boolean dirty_render_cache;
 
+   /** Render target tile caches, shared by the rasterizer threads */
    struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
    struct softpipe_tile_cache *zsbuf_cache;
 
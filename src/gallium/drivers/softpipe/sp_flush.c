@@ -36,6 +36,7 @@
 #include "sp_flush.h"
 #include "sp_context.h"
 #include "sp_state.h"
+#include "sp_rast_thread.h"
 #include "sp_tile_cache.h"
 #include "sp_tex_tile_cache.h"
 #include "util/u_memory.h"
@@ -48,7 +49,7 @@ softpipe_flush( struct pipe_context *pipe,
                 struct pipe_fence_handle **fence )
 {
    struct softpipe_context *softpipe = softpipe_context(pipe);
-   uint i;
+   uint i, t;
 
    draw_flush(softpipe->draw);
 
@@ -60,6 +61,13 @@ softpipe_flush( struct pipe_context *pipe,
             sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
          }
       }
+
+      /* the helper threads' fragment texture caches */
+      for (t = 1; t < softpipe->num_threads; t++) {
+         for (i = 0; i < softpipe->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+            sp_flush_tex_tile_cache(softpipe->thread[t]->tex_cache[i]);
+         }
+      }
    }
 
    /* If this is a swapbuffers, just flush color buffers.
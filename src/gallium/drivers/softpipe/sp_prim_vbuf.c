@@ -37,6 +37,7 @@
 
 
 #include "sp_context.h"
+#include "sp_rast_thread.h"
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "sp_prim_vbuf.h"
@@ -46,8 +47,10 @@
 #include "util/u_prim.h"
 
 
-#define SP_MAX_VBUF_INDEXES 1024
+/* vsplit hands over up to 4096 indices of list primitives at a time */
+#define SP_MAX_VBUF_INDEXES 4096
 #define SP_MAX_VBUF_SIZE    4096
+#define SP_THREADED_VBUF_SCALE 16
 
 typedef const float (*cptrf4)[4];
 
@@ -58,7 +61,6 @@ struct softpipe_vbuf_render
 {
    struct vbuf_render base;
    struct softpipe_context *softpipe;
-   struct setup_context *setup;
 
    uint prim;
    uint vertex_size;
@@ -136,9 +138,16 @@ static void
 sp_vbuf_set_primitive(struct vbuf_render *vbr, unsigned prim)
 {
    struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
-   struct setup_context *setup_ctx = cvbr->setup;
-   
-   sp_setup_prepare( setup_ctx );
+   struct softpipe_context *softpipe = cvbr->softpipe;
+   unsigned i;
+
+   /* thread 0 goes first, as it validates the derived state */
+   for (i = 0; i < softpipe->num_threads; i++) {
+      if (i > 0)
+         sp_rast_thread_update_samplers(softpipe->thread[i]);
+
+      sp_setup_prepare( softpipe->thread[i]->setup );
+   }
 
    cvbr->softpipe->reduced_prim = u_reduced_prim(prim);
    cvbr->prim = prim;
@@ -153,17 +162,32 @@ static INLINE cptrf4 get_vert( const void *vertex_buffer,
 }
 
 
+/**
+ * A batch of primitives for the rasterizer threads.
+ */
+struct sp_vbuf_batch
+{
+   struct softpipe_vbuf_render *cvbr;
+   const ushort *indices;  /**< NULL for draw_arrays */
+   uint start;
+   uint nr;
+};
+
+
 /**
  * draw elements / indexed primitives
  */
 static void
-sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
+sp_vbuf_render_elements(struct sp_rast_thread *thread, void *data)
 {
-   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   const struct sp_vbuf_batch *batch = (const struct sp_vbuf_batch *) data;
+   struct softpipe_vbuf_render *cvbr = batch->cvbr;
    struct softpipe_context *softpipe = cvbr->softpipe;
    const unsigned stride = softpipe->vertex_info_vbuf.size * sizeof(float);
    const void *vertex_buffer = cvbr->vertex_buffer;
-   struct setup_context *setup = cvbr->setup;
+   struct setup_context *setup = thread->setup;
+   const ushort *indices = batch->indices;
+   const uint nr = batch->nr;
    const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
    unsigned i;
 
@@ -353,14 +377,16 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
  * It's up to us to convert the vertex array into point/line/tri prims.
  */
 static void
-sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
+sp_vbuf_render_arrays(struct sp_rast_thread *thread, void *data)
 {
-   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   const struct sp_vbuf_batch *batch = (const struct sp_vbuf_batch *) data;
+   struct softpipe_vbuf_render *cvbr = batch->cvbr;
    struct softpipe_context *softpipe = cvbr->softpipe;
-   struct setup_context *setup = cvbr->setup;
+   struct setup_context *setup = thread->setup;
    const unsigned stride = softpipe->vertex_info_vbuf.size * sizeof(float);
    const void *vertex_buffer =
-      (void *) get_vert(cvbr->vertex_buffer, start, stride);
+      (void *) get_vert(cvbr->vertex_buffer, batch->start, stride);
+   const uint nr = batch->nr;
    const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
    unsigned i;
 
@@ -587,6 +613,34 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    }
 }
 
+static void
+sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
+{
+   struct sp_vbuf_batch batch;
+
+   batch.cvbr = softpipe_vbuf_render(vbr);
+   batch.indices = indices;
+   batch.start = 0;
+   batch.nr = nr;
+
+   sp_rast_threads_run(batch.cvbr->softpipe, sp_vbuf_render_elements, &batch);
+}
+
+
+static void
+sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
+{
+   struct sp_vbuf_batch batch;
+
+   batch.cvbr = softpipe_vbuf_render(vbr);
+   batch.indices = NULL;
+   batch.start = start;
+   batch.nr = nr;
+
+   sp_rast_threads_run(batch.cvbr->softpipe, sp_vbuf_render_arrays, &batch);
+}
+
+
 /*
  * FIXME: it is unclear if primitives_storage_needed (which is generally
  * the same as pipe query num_primitives_generated) should increase
@@ -635,7 +689,6 @@ sp_vbuf_destroy(struct vbuf_render *vbr)
    struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
    if (cvbr->vertex_buffer)
       align_free(cvbr->vertex_buffer);
-   sp_setup_destroy_context(cvbr->setup);
    FREE(cvbr);
 }
 
@@ -653,6 +706,14 @@ sp_create_vbuf_backend(struct softpipe_context *sp)
    cvbr->base.max_indices = SP_MAX_VBUF_INDEXES;
    cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE;
 
+   /* Each batch is a round trip through the rasterizer threads, so give
+    * them bigger ones to work on.
+    */
+   if (sp->num_threads > 1) {
+      cvbr->base.max_indices *= SP_THREADED_VBUF_SCALE;
+      cvbr->base.max_vertex_buffer_bytes *= SP_THREADED_VBUF_SCALE;
+   }
+
    cvbr->base.get_vertex_info = sp_vbuf_get_vertex_info;
    cvbr->base.allocate_vertices = sp_vbuf_allocate_vertices;
    cvbr->base.map_vertices = sp_vbuf_map_vertices;
@@ -667,7 +728,5 @@ sp_create_vbuf_backend(struct softpipe_context *sp)
 
    cvbr->softpipe = sp;
 
-   cvbr->setup = sp_setup_create_context(cvbr->softpipe);
-
    return &cvbr->base;
 }
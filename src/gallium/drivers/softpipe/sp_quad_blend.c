@@ -38,6 +38,7 @@
 #include "sp_context.h"
 #include "sp_state.h"
 #include "sp_quad.h"
+#include "sp_rast_thread.h"
 #include "sp_tile_cache.h"
 #include "sp_quad_pipe.h"
 
@@ -933,7 +934,7 @@ blend_fallback(struct quad_stage *qs,
          const uint blend_buf = blend->independent_blend_enable ? cbuf : 0;
          float dest[4][TGSI_QUAD_SIZE];
          struct softpipe_cached_tile *tile
-            = sp_get_cached_tile(softpipe->cbuf_cache[cbuf],
+            = sp_get_cached_tile(softpipe->cbuf_cache[cbuf], qs->thread->id,
                                  quads[0]->input.x0, 
                                  quads[0]->input.y0);
          const boolean clamp = bqs->clamp[cbuf];
@@ -1036,7 +1037,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0], qs->thread->id,
                            quads[0]->input.x0, 
                            quads[0]->input.y0);
 
@@ -1110,7 +1111,7 @@ blend_single_add_one_one(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0], qs->thread->id,
                            quads[0]->input.x0, 
                            quads[0]->input.y0);
 
@@ -1179,6 +1180,7 @@ single_output_color(struct quad_stage *qs,
 
    struct softpipe_cached_tile *tile
       = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+                           qs->thread->id,
                            quads[0]->input.x0, 
                            quads[0]->input.y0);
 
@@ -1296,14 +1298,15 @@ static void blend_destroy(struct quad_stage *qs)
 }
 
 
-struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe )
+struct quad_stage *sp_quad_blend_stage( struct sp_rast_thread *thread )
 {
    struct blend_quad_stage *stage = CALLOC_STRUCT(blend_quad_stage);
 
    if (!stage)
       return NULL;
 
-   stage->base.softpipe = softpipe;
+   stage->base.softpipe = thread->softpipe;
+   stage->base.thread = thread;
    stage->base.begin = blend_begin;
    stage->base.run = choose_blend_quad;
    stage->base.destroy = blend_destroy;
@@ -38,6 +38,7 @@
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast_thread.h"
 #include "sp_tile_cache.h"
 #include "sp_state.h"           /* for sp_fragment_shader */
 
@@ -785,7 +786,8 @@ depth_test_quads_fallback(struct quad_stage *qs,
 
       data.ps = qs->softpipe->framebuffer.zsbuf;
       data.format = data.ps->format;
-      data.tile = sp_get_cached_tile(qs->softpipe->zsbuf_cache, 
+      data.tile = sp_get_cached_tile(qs->softpipe->zsbuf_cache,
+                                     qs->thread->id,
                                      quads[0]->input.x0, 
                                      quads[0]->input.y0);
 
@@ -822,7 +824,7 @@ depth_test_quads_fallback(struct quad_stage *qs,
 
    if (qs->softpipe->active_query_count) {
       for (i = 0; i < nr; i++) 
-         qs->softpipe->occlusion_count += mask_count[quads[i]->inout.mask];
+         qs->thread->occlusion_count += mask_count[quads[i]->inout.mask];
    }
 
    if (nr)
@@ -970,11 +972,12 @@ depth_test_destroy(struct quad_stage *qs)
 
 
 struct quad_stage *
-sp_quad_depth_test_stage(struct softpipe_context *softpipe)
+sp_quad_depth_test_stage(struct sp_rast_thread *thread)
 {
    struct quad_stage *stage = CALLOC_STRUCT(quad_stage);
 
-   stage->softpipe = softpipe;
+   stage->softpipe = thread->softpipe;
+   stage->thread = thread;
    stage->begin = depth_test_begin;
    stage->run = choose_depth_test;
    stage->destroy = depth_test_destroy;
@@ -27,15 +27,16 @@
 
 
 #include "sp_context.h"
+#include "sp_rast_thread.h"
 #include "sp_state.h"
 #include "pipe/p_shader_tokens.h"
 
 
 static void
-insert_stage_at_head(struct softpipe_context *sp, struct quad_stage *quad)
+insert_stage_at_head(struct sp_rast_thread *thread, struct quad_stage *quad)
 {
-   quad->next = sp->quad.first;
-   sp->quad.first = quad;
+   quad->next = thread->quad.first;
+   thread->quad.first = quad;
 }
 
 
@@ -49,21 +50,26 @@ sp_build_quad_pipeline(struct softpipe_context *sp)
       !sp->fs_variant->info.uses_kill &&
       !sp->fs_variant->info.writes_z &&
       !sp->fs_variant->info.writes_stencil;
+   unsigned i;
 
-   sp->quad.first = sp->quad.blend;
+   for (i = 0; i < sp->num_threads; i++) {
+      struct sp_rast_thread *thread = sp->thread[i];
 
-   if (early_depth_test) {
-      insert_stage_at_head( sp, sp->quad.shade );
-      insert_stage_at_head( sp, sp->quad.depth_test );
-   }
-   else {
-      insert_stage_at_head( sp, sp->quad.depth_test );
-      insert_stage_at_head( sp, sp->quad.shade );
-   }
+      thread->quad.first = thread->quad.blend;
+
+      if (early_depth_test) {
+         insert_stage_at_head( thread, thread->quad.shade );
+         insert_stage_at_head( thread, thread->quad.depth_test );
+      }
+      else {
+         insert_stage_at_head( thread, thread->quad.depth_test );
+         insert_stage_at_head( thread, thread->quad.shade );
+      }
 
 #if !DO_PSTIPPLE_IN_DRAW_MODULE && !DO_PSTIPPLE_IN_HELPER_MODULE
-   if (sp->rasterizer->poly_stipple_enable)
-      insert_stage_at_head( sp, sp->quad.pstipple );
+      if (sp->rasterizer->poly_stipple_enable)
+         insert_stage_at_head( thread, thread->quad.pstipple );
 #endif
+   }
 }
 
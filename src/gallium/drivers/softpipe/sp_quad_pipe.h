@@ -33,6 +33,7 @@
 
 
 struct softpipe_context;
+struct sp_rast_thread;
 struct quad_header;
 
 
@@ -43,6 +44,7 @@ struct quad_header;
  */
 struct quad_stage {
    struct softpipe_context *softpipe;
+   struct sp_rast_thread *thread;  /**< the thread this pipeline belongs to */
 
    struct quad_stage *next;
 
@@ -55,15 +57,15 @@ struct quad_stage {
 };
 
 
-struct quad_stage *sp_quad_polygon_stipple_stage( struct softpipe_context *softpipe );
+struct quad_stage *sp_quad_polygon_stipple_stage( struct sp_rast_thread *thread );
 struct quad_stage *sp_quad_earlyz_stage( struct softpipe_context *softpipe );
-struct quad_stage *sp_quad_shade_stage( struct softpipe_context *softpipe );
+struct quad_stage *sp_quad_shade_stage( struct sp_rast_thread *thread );
 struct quad_stage *sp_quad_alpha_test_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_stencil_test_stage( struct softpipe_context *softpipe );
-struct quad_stage *sp_quad_depth_test_stage( struct softpipe_context *softpipe );
+struct quad_stage *sp_quad_depth_test_stage( struct sp_rast_thread *thread );
 struct quad_stage *sp_quad_occlusion_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_coverage_stage( struct softpipe_context *softpipe );
-struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
+struct quad_stage *sp_quad_blend_stage( struct sp_rast_thread *thread );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
@@ -6,6 +6,7 @@
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast_thread.h"
 #include "pipe/p_defines.h"
 #include "util/u_memory.h"
 
@@ -68,11 +69,12 @@ static void stipple_destroy(struct quad_stage *qs)
 
 
 struct quad_stage *
-sp_quad_polygon_stipple_stage( struct softpipe_context *softpipe )
+sp_quad_polygon_stipple_stage( struct sp_rast_thread *thread )
 {
    struct quad_stage *stage = CALLOC_STRUCT(quad_stage);
 
-   stage->softpipe = softpipe;
+   stage->softpipe = thread->softpipe;
+   stage->thread = thread;
    stage->begin = stipple_begin;
    stage->run = stipple_quad;
    stage->destroy = stipple_destroy;
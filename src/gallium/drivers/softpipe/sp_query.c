@@ -36,6 +36,7 @@
 #include "sp_context.h"
 #include "sp_query.h"
 #include "sp_state.h"
+#include "sp_tile_cache.h"
 
 struct softpipe_query {
    unsigned type;
@@ -67,7 +68,10 @@ softpipe_create_query(struct pipe_context *pipe,
           type == PIPE_QUERY_PIPELINE_STATISTICS ||
           type == PIPE_QUERY_GPU_FINISHED ||
           type == PIPE_QUERY_TIMESTAMP ||
-          type == PIPE_QUERY_TIMESTAMP_DISJOINT);
+          type == PIPE_QUERY_TIMESTAMP_DISJOINT ||
+          type == SP_QUERY_TILE_CACHE_HITS ||
+          type == SP_QUERY_TILE_CACHE_MISSES ||
+          type == SP_QUERY_TILE_CACHE_CONVERSIONS);
    sq = CALLOC_STRUCT( softpipe_query );
    sq->type = type;
 
@@ -82,12 +86,45 @@ softpipe_destroy_query(struct pipe_context *pipe, struct pipe_query *q)
 }
 
 
+/**
+ * Current value of the given SP_QUERY_TILE_CACHE_* counter, summed over
+ * the color and depth/stencil tile caches.
+ */
+static uint64_t
+softpipe_tile_cache_count(struct softpipe_context *softpipe, unsigned type)
+{
+   uint64_t count = 0;
+   unsigned i;
+
+   for (i = 0; i <= PIPE_MAX_COLOR_BUFS; i++) {
+      struct softpipe_tile_cache *tc = i < PIPE_MAX_COLOR_BUFS ?
+         softpipe->cbuf_cache[i] : softpipe->zsbuf_cache;
+
+      switch (type) {
+      case SP_QUERY_TILE_CACHE_HITS:
+         count += tc->hits;
+         break;
+      case SP_QUERY_TILE_CACHE_MISSES:
+         count += tc->misses;
+         break;
+      default:
+         count += tc->conversions;
+         break;
+      }
+   }
+
+   return count;
+}
+
+
 static void
 softpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
 {
    struct softpipe_context *softpipe = softpipe_context( pipe );
    struct softpipe_query *sq = softpipe_query(q);
 
+   sp_rast_threads_get_counters(softpipe);
+
    switch (sq->type) {
    case PIPE_QUERY_OCCLUSION_COUNTER:
    case PIPE_QUERY_OCCLUSION_PREDICATE:
@@ -123,6 +160,11 @@ softpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
              sizeof(sq->stats));
       softpipe->active_statistics_queries++;
       break;
+   case SP_QUERY_TILE_CACHE_HITS:
+   case SP_QUERY_TILE_CACHE_MISSES:
+   case SP_QUERY_TILE_CACHE_CONVERSIONS:
+      sq->start = softpipe_tile_cache_count(softpipe, sq->type);
+      break;
    default:
       assert(0);
       break;
@@ -138,6 +180,8 @@ softpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct softpipe_context *softpipe = softpipe_context( pipe );
    struct softpipe_query *sq = softpipe_query(q);
 
+   sp_rast_threads_get_counters(softpipe);
+
    softpipe->active_query_count--;
    switch (sq->type) {
    case PIPE_QUERY_OCCLUSION_COUNTER:
@@ -194,6 +238,11 @@ softpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
 
       softpipe->active_statistics_queries--;
       break;
+   case SP_QUERY_TILE_CACHE_HITS:
+   case SP_QUERY_TILE_CACHE_MISSES:
+   case SP_QUERY_TILE_CACHE_CONVERSIONS:
+      sq->end = softpipe_tile_cache_count(softpipe, sq->type);
+      break;
    default:
       assert(0);
       break;
@@ -281,6 +330,28 @@ softpipe_check_render_cond(struct softpipe_context *sp)
 }
 
 
+int
+softpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   static const struct pipe_driver_query_info queries[] = {
+      {"tile-cache-hits", SP_QUERY_TILE_CACHE_HITS, 0, FALSE},
+      {"tile-cache-misses", SP_QUERY_TILE_CACHE_MISSES, 0, FALSE},
+      {"tile-cache-conversions", SP_QUERY_TILE_CACHE_CONVERSIONS, 0, FALSE}
+   };
+
+   if (!info)
+      return Elements(queries);
+
+   if (index >= Elements(queries))
+      return 0;
+
+   *info = queries[index];
+   return 1;
+}
+
+
 void softpipe_init_query_funcs(struct softpipe_context *softpipe )
 {
    softpipe->pipe.create_query = softpipe_create_query;
@@ -32,6 +32,16 @@
 #ifndef SP_QUERY_H
 #define SP_QUERY_H
 
+struct pipe_driver_query_info;
+struct pipe_screen;
+
+
+/* Driver queries, see softpipe_get_driver_query_info() */
+#define SP_QUERY_TILE_CACHE_HITS         (PIPE_QUERY_DRIVER_SPECIFIC + 0)
+#define SP_QUERY_TILE_CACHE_MISSES       (PIPE_QUERY_DRIVER_SPECIFIC + 1)
+#define SP_QUERY_TILE_CACHE_CONVERSIONS  (PIPE_QUERY_DRIVER_SPECIFIC + 2)
+
+
 extern boolean
 softpipe_check_render_cond(struct softpipe_context *sp);
 
@@ -39,5 +49,10 @@ softpipe_check_render_cond(struct softpipe_context *sp);
 struct softpipe_context;
 extern void softpipe_init_query_funcs(struct softpipe_context * );
 
+extern int
+softpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info);
+
 
 #endif /* SP_QUERY_H */
@@ -0,0 +1,324 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Rasterizer threads.
+ *
+ * The framebuffer is split into the tile cache's TILE_SIZE x TILE_SIZE
+ * tiles and every tile is owned by exactly one thread (see
+ * sp_tile_owner()).  For each batch of primitives from the draw module
+ * all the threads run setup on every primitive, but only pass the quads
+ * in their own tiles down their own quad pipeline.
+ *
+ * The threads share the context's render target tile caches, which hold
+ * every tile of the surface unless memory runs out.  A tile is only ever
+ * touched by one thread and primitives are processed in order, so the
+ * tiles are rendered exactly as in the single threaded case.  Should a
+ * cache have to evict tiles, which ones it evicts depends on timing, and
+ * blending with colors that went through the surface format may differ
+ * in the last bit, as it already does when the single threaded cache
+ * evicts.
+ *
+ * All state changes, clears and flushes happen on the context's thread
+ * while the helper threads are idle between batches.
+ */
+
+
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "tgsi/tgsi_exec.h"
+#include "sp_context.h"
+#include "sp_quad_pipe.h"
+#include "sp_rast_thread.h"
+#include "sp_setup.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_tile_cache.h"
+
+
+static PIPE_THREAD_ROUTINE(sp_rast_thread_func, init_data)
+{
+   struct sp_rast_thread *thread = (struct sp_rast_thread *) init_data;
+   struct softpipe_context *softpipe = thread->softpipe;
+
+   for (;;) {
+      pipe_semaphore_wait(&thread->work_ready);
+
+      if (softpipe->threads_exit)
+         break;
+
+      softpipe->thread_func(thread, softpipe->thread_data);
+
+      pipe_semaphore_signal(&thread->work_done);
+   }
+
+   return 0;
+}
+
+
+static void
+sp_rast_thread_destroy(struct sp_rast_thread *thread)
+{
+   uint i;
+
+   if (thread->setup)
+      sp_setup_destroy_context(thread->setup);
+
+   if (thread->quad.shade)
+      thread->quad.shade->destroy( thread->quad.shade );
+
+   if (thread->quad.depth_test)
+      thread->quad.depth_test->destroy( thread->quad.depth_test );
+
+   if (thread->quad.blend)
+      thread->quad.blend->destroy( thread->quad.blend );
+
+   if (thread->quad.pstipple)
+      thread->quad.pstipple->destroy( thread->quad.pstipple );
+
+   for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++)
+      sp_destroy_tex_tile_cache(thread->tex_cache[i]);
+
+   tgsi_exec_machine_destroy(thread->fs_machine);
+
+   /* thread 0 borrows the context's sampler */
+   if (thread->id > 0)
+      FREE(thread->fs_sampler);
+
+   FREE(thread);
+}
+
+
+static struct sp_rast_thread *
+sp_rast_thread_create(struct softpipe_context *softpipe,
+                      unsigned id, unsigned num_threads)
+{
+   struct sp_rast_thread *thread = CALLOC_STRUCT(sp_rast_thread);
+   uint i;
+
+   if (!thread)
+      return NULL;
+
+   thread->softpipe = softpipe;
+   thread->id = id;
+   thread->num_threads = num_threads;
+
+   /*
+    * Alloc caches for accessing textures.
+    * Must be before quad stage setup!
+    */
+   if (id == 0) {
+      thread->fs_sampler = softpipe->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   }
+   else {
+      thread->fs_sampler = sp_create_tgsi_sampler();
+      if (!thread->fs_sampler)
+         goto fail;
+
+      for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+         thread->tex_cache[i] = sp_create_tex_tile_cache(&softpipe->pipe);
+         if (!thread->tex_cache[i])
+            goto fail;
+      }
+   }
+
+   thread->fs_machine = tgsi_exec_machine_create();
+   if (!thread->fs_machine)
+      goto fail;
+
+   /* setup quad rendering stages */
+   thread->quad.shade = sp_quad_shade_stage(thread);
+   thread->quad.depth_test = sp_quad_depth_test_stage(thread);
+   thread->quad.blend = sp_quad_blend_stage(thread);
+   thread->quad.pstipple = sp_quad_polygon_stipple_stage(thread);
+
+   thread->setup = sp_setup_create_context(thread);
+   if (!thread->setup)
+      goto fail;
+
+   return thread;
+
+fail:
+   sp_rast_thread_destroy(thread);
+   return NULL;
+}
+
+
+/**
+ * Create the context's rasterizer threads.  Thread 0 runs on the
+ * context's own thread; the other num_threads - 1 are helpers.  If a
+ * helper thread can't be started, the context makes do with the ones
+ * that could.
+ */
+boolean
+sp_rast_threads_create(struct softpipe_context *softpipe,
+                       unsigned num_threads)
+{
+   unsigned i;
+
+   assert(num_threads >= 1 && num_threads <= SP_MAX_THREADS);
+
+   for (i = 0; i < num_threads; i++) {
+      struct sp_rast_thread *thread =
+         sp_rast_thread_create(softpipe, i, num_threads);
+      if (!thread)
+         return FALSE;
+
+      if (i > 0) {
+         pipe_semaphore_init(&thread->work_ready, 0);
+         pipe_semaphore_init(&thread->work_done, 0);
+         thread->thread = pipe_thread_create(sp_rast_thread_func, thread);
+         if (!thread->thread) {
+            debug_printf("softpipe: failed to create rasterizer thread %u\n",
+                         i);
+            pipe_semaphore_destroy(&thread->work_ready);
+            pipe_semaphore_destroy(&thread->work_done);
+            sp_rast_thread_destroy(thread);
+            break;
+         }
+      }
+
+      softpipe->thread[i] = thread;
+      softpipe->num_threads = i + 1;
+   }
+
+   /* deal the tiles out among the threads we actually got */
+   for (i = 0; i < softpipe->num_threads; i++)
+      softpipe->thread[i]->num_threads = softpipe->num_threads;
+
+   return TRUE;
+}
+
+
+void
+sp_rast_threads_destroy(struct softpipe_context *softpipe)
+{
+   unsigned i;
+
+   softpipe->threads_exit = TRUE;
+   for (i = 1; i < softpipe->num_threads; i++)
+      pipe_semaphore_signal(&softpipe->thread[i]->work_ready);
+
+   for (i = 0; i < softpipe->num_threads; i++) {
+      struct sp_rast_thread *thread = softpipe->thread[i];
+
+      if (i > 0) {
+         pipe_thread_wait(thread->thread);
+         pipe_semaphore_destroy(&thread->work_ready);
+         pipe_semaphore_destroy(&thread->work_done);
+      }
+
+      sp_rast_thread_destroy(thread);
+      softpipe->thread[i] = NULL;
+   }
+
+   softpipe->num_threads = 0;
+}
+
+
+/**
+ * Run func on every rasterizer thread and wait for all of them to finish.
+ */
+void
+sp_rast_threads_run(struct softpipe_context *softpipe,
+                    sp_rast_func func, void *data)
+{
+   unsigned i;
+
+   if (softpipe->num_threads == 1) {
+      func(softpipe->thread[0], data);
+      return;
+   }
+
+   softpipe->thread_func = func;
+   softpipe->thread_data = data;
+
+   for (i = 1; i < softpipe->num_threads; i++)
+      pipe_semaphore_signal(&softpipe->thread[i]->work_ready);
+
+   func(softpipe->thread[0], data);
+
+   for (i = 1; i < softpipe->num_threads; i++)
+      pipe_semaphore_wait(&softpipe->thread[i]->work_done);
+}
+
+
+/**
+ * Bring a helper thread's fragment sampler in line with the context's,
+ * pointing the sampler views at the thread's own texture caches.
+ */
+void
+sp_rast_thread_update_samplers(struct sp_rast_thread *thread)
+{
+   struct softpipe_context *softpipe = thread->softpipe;
+   struct sp_tgsi_sampler *sampler = thread->fs_sampler;
+   unsigned i;
+
+   assert(thread->id > 0);
+
+   memcpy(sampler, softpipe->tgsi.sampler[PIPE_SHADER_FRAGMENT],
+          sizeof(*sampler));
+
+   for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+      struct softpipe_tex_tile_cache *tc = thread->tex_cache[i];
+
+      sp_tex_tile_cache_set_sampler_view(tc,
+                        softpipe->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+
+      if (tc->texture) {
+         struct softpipe_resource *spt = softpipe_resource(tc->texture);
+         if (spt->timestamp != tc->timestamp) {
+            sp_tex_tile_cache_validate_texture(tc);
+            tc->timestamp = spt->timestamp;
+         }
+      }
+
+      if (sampler->sp_sview[i].cache)
+         sampler->sp_sview[i].cache = tc;
+   }
+}
+
+
+/**
+ * Add the threads' occlusion and fragment shader invocation counts to
+ * the context's.  Must not be called while a batch is being rendered.
+ */
+void
+sp_rast_threads_get_counters(struct softpipe_context *softpipe)
+{
+   unsigned i;
+
+   for (i = 0; i < softpipe->num_threads; i++) {
+      struct sp_rast_thread *thread = softpipe->thread[i];
+
+      softpipe->occlusion_count += thread->occlusion_count;
+      softpipe->pipeline_statistics.ps_invocations += thread->ps_invocations;
+      thread->occlusion_count = 0;
+      thread->ps_invocations = 0;
+   }
+}
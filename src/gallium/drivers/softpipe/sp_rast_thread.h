@@ -0,0 +1,120 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#ifndef SP_RAST_THREAD_H
+#define SP_RAST_THREAD_H
+
+#include "os/os_thread.h"
+#include "pipe/p_state.h"
+#include "sp_tile_cache.h"
+
+
+struct softpipe_context;
+struct setup_context;
+struct quad_stage;
+struct sp_tgsi_sampler;
+struct softpipe_tex_tile_cache;
+struct tgsi_exec_machine;
+
+
+/**
+ * Fragment processing state private to one rasterizer thread.
+ *
+ * Thread 0 is the context's own thread.  With SOFTPIPE_NUM_THREADS set,
+ * the framebuffer tiles are dealt out among all the threads; every thread
+ * runs setup for each primitive but only emits the quads that fall in
+ * the tiles it owns.  The render target tile caches are shared.
+ */
+struct sp_rast_thread
+{
+   struct softpipe_context *softpipe;
+   unsigned id;
+   unsigned num_threads;
+
+   struct setup_context *setup;
+
+   /** Software quad rendering pipeline */
+   struct {
+      struct quad_stage *shade;
+      struct quad_stage *depth_test;
+      struct quad_stage *blend;
+      struct quad_stage *pstipple;
+      struct quad_stage *first; /**< points to one of the above stages */
+   } quad;
+
+   struct tgsi_exec_machine *fs_machine;
+
+   /**
+    * Fragment shader sampler.  Thread 0 uses the context's, the others
+    * keep a copy of it which points at their own texture caches.
+    */
+   struct sp_tgsi_sampler *fs_sampler;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
+   /** Added to the context's counters by sp_rast_threads_get_counters() */
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+
+   pipe_thread thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+};
+
+
+typedef void (*sp_rast_func)(struct sp_rast_thread *thread, void *data);
+
+
+boolean
+sp_rast_threads_create(struct softpipe_context *softpipe,
+                       unsigned num_threads);
+
+void
+sp_rast_threads_destroy(struct softpipe_context *softpipe);
+
+void
+sp_rast_threads_run(struct softpipe_context *softpipe,
+                    sp_rast_func func, void *data);
+
+void
+sp_rast_thread_update_samplers(struct sp_rast_thread *thread);
+
+void
+sp_rast_threads_get_counters(struct softpipe_context *softpipe);
+
+
+/**
+ * Does the given thread render the framebuffer tile containing (x, y)?
+ */
+static INLINE boolean
+sp_rast_thread_owns_tile(const struct sp_rast_thread *thread, int x, int y)
+{
+   return thread->num_threads == 1 ||
+          sp_tile_owner(tile_address(x, y), thread->num_threads) == thread->id;
+}
+
+
+#endif /* SP_RAST_THREAD_H */
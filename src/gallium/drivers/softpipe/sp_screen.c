@@ -45,6 +45,7 @@
 #include "sp_context.h"
 #include "sp_fence.h"
 #include "sp_public.h"
+#include "sp_query.h"
 
 DEBUG_GET_ONCE_BOOL_OPTION(use_llvm, "SOFTPIPE_USE_LLVM", FALSE)
 
@@ -414,6 +415,7 @@ softpipe_create_screen(struct sw_winsys *winsys)
    screen->base.is_video_format_supported = vl_video_buffer_is_format_supported;
    screen->base.context_create = softpipe_create_context;
    screen->base.flush_frontbuffer = softpipe_flush_frontbuffer;
+   screen->base.get_driver_query_info = softpipe_get_driver_query_info;
 
    screen->use_llvm = debug_get_option_use_llvm();
 
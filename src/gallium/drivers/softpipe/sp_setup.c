@@ -35,6 +35,7 @@
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast_thread.h"
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "draw/draw_context.h"
@@ -74,6 +75,7 @@ struct edge {
  */
 struct setup_context {
    struct softpipe_context *softpipe;
+   struct sp_rast_thread *thread;  /**< the thread we're rasterizing for */
 
    /* Vertices are just an array of floats making up each attribute in
     * turn.  Currently fixed at 4 floats, but should change in time.
@@ -160,14 +162,16 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
 {
    quad_clip( setup, quad );
 
-   if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
+   if (quad->inout.mask &&
+       sp_rast_thread_owns_tile(setup->thread,
+                                quad->input.x0, quad->input.y0)) {
+      struct quad_stage *pipe = setup->thread->quad.first;
 
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      pipe->run( pipe, &quad, 1 );
    }
 }
 
@@ -202,7 +206,7 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
+   struct quad_stage *pipe = setup->thread->quad.first;
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -228,6 +232,13 @@ flush_spans(struct setup_context *setup)
       unsigned mask0 = ~skipmask_left0 & ~skipmask_right0;
       unsigned mask1 = ~skipmask_left1 & ~skipmask_right1;
 
+      /* A chunk never straddles a tile, so when several threads are
+       * rasterizing, each quad batch is either ours as a whole or
+       * belongs to another thread.
+       */
+      if (!sp_rast_thread_owns_tile(setup->thread, x, setup->span.y))
+         continue;
+
       if (mask0 | mask1) {
          do {
             unsigned quadmask = (mask0 & 3) | ((mask1 & 3) << 2);
@@ -852,7 +863,8 @@ sp_setup_tri(struct setup_context *setup,
 
    flush_spans( setup );
 
-   if (setup->softpipe->active_statistics_queries) {
+   /* every thread sets up every primitive; only count them once */
+   if (setup->softpipe->active_statistics_queries && setup->thread->id == 0) {
       setup->softpipe->pipeline_statistics.c_primitives++;
    }
 
@@ -1409,7 +1421,7 @@ sp_setup_prepare(struct setup_context *setup)
    /* Note: nr_attrs is only used for debugging (vertex printing) */
    setup->nr_vertex_attrs = draw_num_shader_outputs(sp->draw);
 
-   sp->quad.first->begin( sp->quad.first );
+   setup->thread->quad.first->begin( setup->thread->quad.first );
 
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
@@ -1432,15 +1444,19 @@ sp_setup_destroy_context(struct setup_context *setup)
 
 
 /**
- * Create a new primitive setup/render stage.
+ * Create a new primitive setup/render stage for the given rasterizer thread.
  */
 struct setup_context *
-sp_setup_create_context(struct softpipe_context *softpipe)
+sp_setup_create_context(struct sp_rast_thread *thread)
 {
    struct setup_context *setup = CALLOC_STRUCT(setup_context);
    unsigned i;
 
-   setup->softpipe = softpipe;
+   if (!setup)
+      return NULL;
+
+   setup->softpipe = thread->softpipe;
+   setup->thread = thread;
 
    for (i = 0; i < MAX_QUADS; i++) {
       setup->quad[i].coef = setup->coef;
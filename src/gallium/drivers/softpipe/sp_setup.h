@@ -29,6 +29,7 @@
 
 struct setup_context;
 struct softpipe_context;
+struct sp_rast_thread;
 
 void 
 sp_setup_tri( struct setup_context *setup,
@@ -46,7 +47,7 @@ sp_setup_point( struct setup_context *setup,
              const float (*v0)[4] );
 
 
-struct setup_context *sp_setup_create_context( struct softpipe_context *softpipe );
+struct setup_context *sp_setup_create_context( struct sp_rast_thread *thread );
 void sp_setup_prepare( struct setup_context *setup );
 void sp_setup_destroy_context( struct setup_context *setup );
 
@@ -261,14 +261,20 @@ update_fragment_shader(struct softpipe_context *softpipe, unsigned prim)
       key.polygon_stipple = softpipe->rasterizer->poly_stipple_enable;
 
    if (softpipe->fs) {
+      unsigned i;
+
       softpipe->fs_variant = softpipe_find_fs_variant(softpipe,
                                                       softpipe->fs, &key);
 
-      /* prepare the TGSI interpreter for FS execution */
-      softpipe->fs_variant->prepare(softpipe->fs_variant, 
-                                    softpipe->fs_machine,
-                                    (struct tgsi_sampler *) softpipe->
-                                    tgsi.sampler[PIPE_SHADER_FRAGMENT]);
+      /* prepare each rasterizer thread's TGSI interpreter for FS execution */
+      for (i = 0; i < softpipe->num_threads; i++) {
+         struct sp_rast_thread *thread = softpipe->thread[i];
+
+         softpipe->fs_variant->prepare(softpipe->fs_variant,
+                                       thread->fs_machine,
+                                       (struct tgsi_sampler *)
+                                          thread->fs_sampler);
+      }
    }
    else {
       softpipe->fs_variant = NULL;
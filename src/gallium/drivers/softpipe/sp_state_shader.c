@@ -38,6 +38,7 @@
 #include "draw/draw_vs.h"
 #include "draw/draw_gs.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_scan.h"
 #include "tgsi/tgsi_parse.h"
 
@@ -178,6 +179,7 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
    struct softpipe_context *softpipe = softpipe_context(pipe);
    struct sp_fragment_shader *state = fs;
    struct sp_fragment_shader_variant *var, *next_var;
+   unsigned i;
 
    assert(fs != softpipe->fs);
 
@@ -192,7 +194,14 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       draw_delete_fragment_shader(softpipe->draw, var->draw_shader);
 #endif
 
-      var->delete(var, softpipe->fs_machine);
+      /* the helper threads' machines only need unbinding */
+      for (i = 1; i < softpipe->num_threads; i++) {
+         struct tgsi_exec_machine *machine = softpipe->thread[i]->fs_machine;
+         if (machine->Tokens == var->tokens)
+            tgsi_exec_machine_bind_shader(machine, NULL, NULL);
+      }
+
+      var->delete(var, softpipe->thread[0]->fs_machine);
    }
 
    draw_delete_fragment_shader(softpipe->draw, state->draw_shader);
@@ -2843,7 +2843,7 @@ sample_cube(struct sp_sampler_view *sp_sview,
    /* Not actually used, but the intermediate steps that do the
     * dereferencing don't know it.
     */
-   static float pppp[4] = { 0, 0, 0, 0 };
+   float pppp[4];
 
    pppp[0] = c0[0];
    pppp[1] = c0[1];
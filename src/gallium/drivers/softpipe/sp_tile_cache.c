@@ -39,17 +39,19 @@
 #include "sp_tile_cache.h"
 
 static struct softpipe_cached_tile *
-sp_alloc_tile(struct softpipe_tile_cache *tc);
+sp_alloc_tile(struct softpipe_tile_cache *tc, unsigned thread);
 
 
 /**
- * Return the position in the cache for the tile that contains win pos (x,y).
- * We currently use a direct mapped cache so this is like a hack key.
- * At some point we should investige something more sophisticated, like
- * a LRU replacement policy.
+ * Return the hash bucket for the tile at the given address.  There are at
+ * least as many buckets as tiles in the surface, so this is collision
+ * free unless growing the table failed.
  */
-#define CACHE_POS(x, y) \
-   (((x) + (y) * 5) % NUM_ENTRIES)
+static INLINE unsigned
+tile_hash(const struct softpipe_tile_cache *tc, union tile_address addr)
+{
+   return (addr.bits.x + addr.bits.y * tc->tiles_x) & tc->hash_mask;
+}
 
 
 
@@ -80,11 +82,125 @@ clear_clear_flag(uint *bitvec, union tile_address addr)
 }
    
 
+/**
+ * Forget all cached tiles, without writing them back.
+ */
+static void
+sp_tile_cache_reset(struct softpipe_tile_cache *tc)
+{
+   uint pos;
+
+   memset(tc->hash, 0, (tc->hash_mask + 1) * sizeof(tc->hash[0]));
+   LIST_INITHEAD(&tc->lru);
+   LIST_INITHEAD(&tc->free);
+
+   for (pos = 0; pos < tc->num_entries; pos++) {
+      tc->entries[pos].addr.bits.invalid = 1;
+      LIST_ADDTAIL(&tc->entries[pos].list, &tc->free);
+   }
+
+   for (pos = 0; pos < SP_MAX_THREADS; pos++) {
+      tc->last_tile[pos].addr.bits.invalid = 1;
+      tc->num_cached[pos] = 0;
+   }
+}
+
+
+/**
+ * Free the tiles of the entries from first on.  They are allocated again
+ * when needed.  Nothing may be cached in those entries.
+ */
+static void
+sp_tile_cache_release_tiles(struct softpipe_tile_cache *tc, uint first)
+{
+   uint pos;
+
+   for (pos = first; pos < tc->max_entries; pos++) {
+      FREE(tc->entries[pos].tile);
+      tc->entries[pos].tile = NULL;
+   }
+}
+
+
+/**
+ * Make room for at least num_entries entries and as many hash buckets.
+ * If memory runs out, the cache keeps its current size and will evict
+ * tiles instead.  Nothing may be cached at this point.
+ */
+static void
+sp_tile_cache_grow(struct softpipe_tile_cache *tc, uint num_entries)
+{
+   uint num_buckets = util_next_power_of_two(num_entries);
+
+   if (num_entries > tc->max_entries) {
+      struct sp_tile_cache_entry *entries =
+         CALLOC(num_entries, sizeof(*entries));
+
+      if (entries) {
+         uint pos;
+
+         /* keep the tiles already allocated */
+         for (pos = 0; pos < tc->max_entries; pos++)
+            entries[pos].tile = tc->entries[pos].tile;
+
+         FREE(tc->entries);
+         tc->entries = entries;
+         tc->max_entries = num_entries;
+      }
+   }
+
+   if (num_buckets > tc->hash_mask + 1) {
+      struct sp_tile_cache_entry **hash =
+         CALLOC(num_buckets, sizeof(*hash));
+
+      if (hash) {
+         FREE(tc->hash);
+         tc->hash = hash;
+         tc->hash_mask = num_buckets - 1;
+      }
+   }
+}
+
+
+/**
+ * Size the cache for the surface it is about to cache: enough entries
+ * to hold all of its tiles, within SP_TILE_CACHE_MIN/MAX_ENTRIES.
+ * Nothing may be cached at this point.
+ */
+static void
+sp_tile_cache_resize(struct softpipe_tile_cache *tc,
+                     const struct pipe_surface *ps)
+{
+   uint tiles_y, num_tiles, num_entries;
+
+   assert(LIST_IS_EMPTY(&tc->lru));
+
+   tc->tiles_x = (ps->width + TILE_SIZE - 1) / TILE_SIZE;
+   tiles_y = (ps->height + TILE_SIZE - 1) / TILE_SIZE;
+   num_tiles = tc->tiles_x * tiles_y;
+
+   num_entries = CLAMP(num_tiles, SP_TILE_CACHE_MIN_ENTRIES,
+                       SP_TILE_CACHE_MAX_ENTRIES);
+   sp_tile_cache_grow(tc, num_entries);
+   tc->num_entries = MIN2(num_entries, tc->max_entries);
+
+   /* the threads can't all be allowed to fill the cache with their tiles */
+   if (tc->num_threads > 1 && tc->num_entries < num_tiles)
+      tc->thread_quota = tc->num_entries / tc->num_threads;
+   else
+      tc->thread_quota = 0;
+
+   sp_tile_cache_reset(tc);
+
+   /* don't hold on to the previous surface's tiles */
+   sp_tile_cache_release_tiles(tc, SP_TILE_CACHE_MIN_ENTRIES);
+}
+
+
 struct softpipe_tile_cache *
-sp_create_tile_cache( struct pipe_context *pipe )
+sp_create_tile_cache( struct pipe_context *pipe, unsigned num_threads )
 {
    struct softpipe_tile_cache *tc;
-   uint pos;
    int maxLevels, maxTexSize;
 
    /* sanity checking: max sure MAX_WIDTH/HEIGHT >= largest texture image */
@@ -99,21 +215,24 @@ sp_create_tile_cache( struct pipe_context *pipe )
    tc = CALLOC_STRUCT( softpipe_tile_cache );
    if (tc) {
       tc->pipe = pipe;
-      for (pos = 0; pos < Elements(tc->tile_addrs); pos++) {
-         tc->tile_addrs[pos].bits.invalid = 1;
-      }
-      tc->last_tile_addr.bits.invalid = 1;
+      tc->num_threads = num_threads;
+      pipe_mutex_init(tc->mutex);
+
+      sp_tile_cache_grow(tc, SP_TILE_CACHE_MIN_ENTRIES);
+      tc->num_entries = SP_TILE_CACHE_MIN_ENTRIES;
 
       /* this allocation allows us to guarantee that allocation
        * failures are never fatal later
        */
       tc->tile = MALLOC_STRUCT( softpipe_cached_tile );
-      if (!tc->tile)
-      {
-         FREE(tc);
+      if (!tc->tile || tc->max_entries < SP_TILE_CACHE_MIN_ENTRIES ||
+          !tc->hash) {
+         sp_destroy_tile_cache(tc);
          return NULL;
       }
 
+      sp_tile_cache_reset(tc);
+
       /* XXX this code prevents valgrind warnings about use of uninitialized
        * memory in programs that don't clear the surface before rendering.
        * However, it breaks clearing in other situations (such as in
@@ -134,16 +253,18 @@ sp_destroy_tile_cache(struct softpipe_tile_cache *tc)
    if (tc) {
       uint pos;
 
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         /*assert(tc->entries[pos].x < 0);*/
-         FREE( tc->entries[pos] );
+      for (pos = 0; pos < tc->max_entries; pos++) {
+         FREE( tc->entries[pos].tile );
       }
+      FREE( tc->entries );
+      FREE( tc->hash );
       FREE( tc->tile );
 
       if (tc->transfer) {
          tc->pipe->transfer_unmap(tc->pipe, tc->transfer);
       }
 
+      pipe_mutex_destroy(tc->mutex);
       FREE( tc );
    }
 }
@@ -184,6 +305,22 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
       }
 
       tc->depth_stencil = util_format_is_depth_or_stencil(ps->format);
+
+      /* Color tiles of most formats can be converted in place, which
+       * saves pipe_get/put_tile_rgba_format() a malloc and a copy.
+       */
+      tc->direct_format = NULL;
+      if (!tc->depth_stencil && !util_format_is_pure_integer(ps->format)) {
+         const struct util_format_description *desc =
+            util_format_description(ps->format);
+
+         if (desc->block.width == 1 && desc->block.height == 1 &&
+             desc->block.bits % 8 == 0 &&
+             desc->pack_rgba_float && desc->unpack_rgba_float)
+            tc->direct_format = desc;
+      }
+
+      sp_tile_cache_resize(tc, ps);
    }
 }
 
@@ -317,7 +454,7 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
 
    assert(pt->resource);
    if (!tc->tile)
-      tc->tile = sp_alloc_tile(tc);
+      tc->tile = sp_alloc_tile(tc, 0);
 
    /* clear the scratch tile to the clear value */
    if (tc->depth_stencil) {
@@ -339,6 +476,7 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
                                  tc->tile->data.any, 0/*STRIDE*/);
             }
             else {
+               tc->conversions++;
                if (util_format_is_pure_uint(tc->surface->format)) {
                   pipe_put_tile_ui_format(pt, tc->transfer_map,
                                           x, y, TILE_SIZE, TILE_SIZE,
@@ -368,45 +506,136 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
 #endif
 }
 
+/**
+ * Write a cached tile back to the surface.
+ */
 static void
-sp_flush_tile(struct softpipe_tile_cache* tc, unsigned pos)
+sp_tile_cache_put_tile(struct softpipe_tile_cache *tc,
+                       union tile_address addr,
+                       struct softpipe_cached_tile *tile)
 {
-   if (!tc->tile_addrs[pos].bits.invalid) {
-      if (tc->depth_stencil) {
-         pipe_put_tile_raw(tc->transfer, tc->transfer_map,
-                           tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                           tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                           TILE_SIZE, TILE_SIZE,
-                           tc->entries[pos]->data.depth32, 0/*STRIDE*/);
+   struct pipe_transfer *pt = tc->transfer;
+   const uint x = addr.bits.x * TILE_SIZE;
+   const uint y = addr.bits.y * TILE_SIZE;
+
+   if (tc->depth_stencil) {
+      pipe_put_tile_raw(pt, tc->transfer_map,
+                        x, y, TILE_SIZE, TILE_SIZE,
+                        tile->data.depth32, 0/*STRIDE*/);
+      return;
+   }
+
+   tc->conversions++;
+
+   if (tc->direct_format) {
+      const struct util_format_description *desc = tc->direct_format;
+      uint w = TILE_SIZE, h = TILE_SIZE;
+
+      if (!u_clip_tile(x, y, &w, &h, &pt->box)) {
+         ubyte *dst = (ubyte *) tc->transfer_map +
+                      y * pt->stride + x * (desc->block.bits / 8);
+
+         desc->pack_rgba_float(dst, pt->stride,
+                               (const float *) tile->data.color,
+                               TILE_SIZE * 4 * sizeof(float), w, h);
       }
-      else {
-         if (util_format_is_pure_uint(tc->surface->format)) {
-            pipe_put_tile_ui_format(tc->transfer, tc->transfer_map,
-                                    tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                    tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                    TILE_SIZE, TILE_SIZE,
-                                    tc->surface->format,
-                                    (unsigned *) tc->entries[pos]->data.colorui128);
-         } else if (util_format_is_pure_sint(tc->surface->format)) {
-            pipe_put_tile_i_format(tc->transfer, tc->transfer_map,
-                                   tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                   tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                   TILE_SIZE, TILE_SIZE,
-                                   tc->surface->format,
-                                   (int *) tc->entries[pos]->data.colori128);
-         } else {
-            pipe_put_tile_rgba_format(tc->transfer, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (float *) tc->entries[pos]->data.color);
-         }
+   }
+   else if (util_format_is_pure_uint(tc->surface->format)) {
+      pipe_put_tile_ui_format(pt, tc->transfer_map,
+                              x, y, TILE_SIZE, TILE_SIZE,
+                              tc->surface->format,
+                              (unsigned *) tile->data.colorui128);
+   } else if (util_format_is_pure_sint(tc->surface->format)) {
+      pipe_put_tile_i_format(pt, tc->transfer_map,
+                             x, y, TILE_SIZE, TILE_SIZE,
+                             tc->surface->format,
+                             (int *) tile->data.colori128);
+   } else {
+      pipe_put_tile_rgba_format(pt, tc->transfer_map,
+                                x, y, TILE_SIZE, TILE_SIZE,
+                                tc->surface->format,
+                                (float *) tile->data.color);
+   }
+}
+
+
+/**
+ * Read a tile from the surface.  This may run concurrently for tiles
+ * owned by different threads, so the caller counts the conversion.
+ */
+static void
+sp_tile_cache_get_tile(struct softpipe_tile_cache *tc,
+                       union tile_address addr,
+                       struct softpipe_cached_tile *tile)
+{
+   struct pipe_transfer *pt = tc->transfer;
+   const uint x = addr.bits.x * TILE_SIZE;
+   const uint y = addr.bits.y * TILE_SIZE;
+
+   if (tc->depth_stencil) {
+      pipe_get_tile_raw(pt, tc->transfer_map,
+                        x, y, TILE_SIZE, TILE_SIZE,
+                        tile->data.depth32, 0/*STRIDE*/);
+      return;
+   }
+
+   if (tc->direct_format) {
+      const struct util_format_description *desc = tc->direct_format;
+      uint w = TILE_SIZE, h = TILE_SIZE;
+
+      if (!u_clip_tile(x, y, &w, &h, &pt->box)) {
+         const ubyte *src = (const ubyte *) tc->transfer_map +
+                            y * pt->stride + x * (desc->block.bits / 8);
+
+         desc->unpack_rgba_float((float *) tile->data.color,
+                                 TILE_SIZE * 4 * sizeof(float),
+                                 src, pt->stride, w, h);
       }
-      tc->tile_addrs[pos].bits.invalid = 1;  /* mark as empty */
+   }
+   else if (util_format_is_pure_uint(tc->surface->format)) {
+      pipe_get_tile_ui_format(pt, tc->transfer_map,
+                              x, y, TILE_SIZE, TILE_SIZE,
+                              tc->surface->format,
+                              (unsigned *) tile->data.colorui128);
+   } else if (util_format_is_pure_sint(tc->surface->format)) {
+      pipe_get_tile_i_format(pt, tc->transfer_map,
+                             x, y, TILE_SIZE, TILE_SIZE,
+                             tc->surface->format,
+                             (int *) tile->data.colori128);
+   } else {
+      pipe_get_tile_rgba_format(pt, tc->transfer_map,
+                                x, y, TILE_SIZE, TILE_SIZE,
+                                tc->surface->format,
+                                (float *) tile->data.color);
    }
 }
 
+
+/**
+ * Put a cached tile back in the framebuffer and return its entry to the
+ * free list.
+ */
+static void
+sp_tile_cache_evict(struct softpipe_tile_cache *tc,
+                    struct sp_tile_cache_entry *entry)
+{
+   struct sp_tile_cache_entry **link = &tc->hash[tile_hash(tc, entry->addr)];
+
+   assert(!entry->addr.bits.invalid);
+
+   sp_tile_cache_put_tile(tc, entry->addr, entry->tile);
+
+   while (*link != entry)
+      link = &(*link)->hash_next;
+   *link = entry->hash_next;
+
+   tc->num_cached[sp_tile_owner(entry->addr, tc->num_threads)]--;
+
+   entry->addr.bits.invalid = 1;
+   LIST_DEL(&entry->list);
+   LIST_ADD(&entry->list, &tc->free);
+}
+
 /**
  * Flush the tile cache: write all dirty tiles back to the transfer.
  * any tiles "flagged" as cleared will be "really" cleared.
@@ -415,26 +644,23 @@ void
 sp_flush_tile_cache(struct softpipe_tile_cache *tc)
 {
    struct pipe_transfer *pt = tc->transfer;
-   int inuse = 0, pos;
+   int inuse = 0;
 
    if (pt) {
-      /* caching a drawing transfer */
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         struct softpipe_cached_tile *tile = tc->entries[pos];
-         if (!tile)
-         {
-            assert(tc->tile_addrs[pos].bits.invalid);
-            continue;
-         }
+      struct sp_tile_cache_entry *entry;
 
-         sp_flush_tile(tc, pos);
+      /* caching a drawing transfer */
+      LIST_FOR_EACH_ENTRY(entry, &tc->lru, list) {
+         sp_tile_cache_put_tile(tc, entry->addr, entry->tile);
          ++inuse;
       }
 
-      sp_tile_cache_flush_clear(tc);
+      sp_tile_cache_reset(tc);
 
+      /* only keep a small cache's worth of tiles between frames */
+      sp_tile_cache_release_tiles(tc, SP_TILE_CACHE_MIN_ENTRIES);
 
-      tc->last_tile_addr.bits.invalid = 1;
+      sp_tile_cache_flush_clear(tc);
    }
 
 #if 0
@@ -442,8 +668,13 @@ sp_flush_tile_cache(struct softpipe_tile_cache *tc)
 #endif
 }
 
+/**
+ * Allocate memory for a tile.  If that fails, take the memory of a tile
+ * of the calling thread, or of an unused entry.  Must be called with the
+ * mutex held, or while no other thread is drawing.
+ */
 static struct softpipe_cached_tile *
-sp_alloc_tile(struct softpipe_tile_cache *tc)
+sp_alloc_tile(struct softpipe_tile_cache *tc, unsigned thread)
 {
    struct softpipe_cached_tile * tile = MALLOC_STRUCT(softpipe_cached_tile);
    if (!tile)
@@ -452,13 +683,20 @@ sp_alloc_tile(struct softpipe_tile_cache *tc)
       if (!tc->tile)
       {
          unsigned pos;
-         for (pos = 0; pos < Elements(tc->entries); ++pos) {
-            if (!tc->entries[pos])
+         for (pos = 0; pos < tc->max_entries; ++pos) {
+            struct sp_tile_cache_entry *entry = &tc->entries[pos];
+            if (!entry->tile)
+               continue;
+
+            /* other threads may be drawing to their tiles */
+            if (!entry->addr.bits.invalid &&
+                sp_tile_owner(entry->addr, tc->num_threads) != thread)
                continue;
 
-            sp_flush_tile(tc, pos);
-            tc->tile = tc->entries[pos];
-            tc->entries[pos] = NULL;
+            if (!entry->addr.bits.invalid)
+               sp_tile_cache_evict(tc, entry);
+            tc->tile = entry->tile;
+            entry->tile = NULL;
             break;
          }
 
@@ -470,119 +708,121 @@ sp_alloc_tile(struct softpipe_tile_cache *tc)
       tile = tc->tile;
       tc->tile = NULL;
 
-      tc->last_tile_addr.bits.invalid = 1;
+      tc->last_tile[thread].addr.bits.invalid = 1;
    }
    return tile;
 }
 
 /**
- * Get a tile from the cache.
- * \param x, y  position of tile, in pixels
+ * Return the least recently used tile of the given thread.
+ */
+static struct sp_tile_cache_entry *
+sp_tile_cache_lru_entry(struct softpipe_tile_cache *tc, unsigned thread)
+{
+   struct list_head *node;
+
+   for (node = tc->lru.prev; node != &tc->lru; node = node->prev) {
+      struct sp_tile_cache_entry *entry =
+         LIST_ENTRY(struct sp_tile_cache_entry, node, list);
+
+      if (sp_tile_owner(entry->addr, tc->num_threads) == thread)
+         return entry;
+   }
+
+   return NULL;
+}
+
+/**
+ * Get a tile from the cache, evicting the calling thread's least recently
+ * used tile if the cache is full.
+ * \param thread  the rasterizer thread, which must own the tile
+ * \param addr  address of the tile
  */
 struct softpipe_cached_tile *
-sp_find_cached_tile(struct softpipe_tile_cache *tc, 
+sp_find_cached_tile(struct softpipe_tile_cache *tc, unsigned thread,
                     union tile_address addr )
 {
    struct pipe_transfer *pt = tc->transfer;
-   /* cache pos/entry: */
-   const int pos = CACHE_POS(addr.bits.x,
-                             addr.bits.y);
-   struct softpipe_cached_tile *tile = tc->entries[pos];
-
-   if (!tile) {
-      tile = sp_alloc_tile(tc);
-      tc->entries[pos] = tile;
+   const unsigned bucket = tile_hash(tc, addr);
+   const boolean threaded = tc->num_threads > 1;
+   struct sp_tile_cache_entry *entry;
+   boolean cleared = FALSE;
+
+   assert(sp_tile_owner(addr, tc->num_threads) == thread);
+
+   if (threaded)
+      pipe_mutex_lock(tc->mutex);
+
+   for (entry = tc->hash[bucket]; entry; entry = entry->hash_next) {
+      if (entry->addr.value == addr.value)
+         break;
    }
 
-   if (addr.value != tc->tile_addrs[pos].value) {
+   if (entry) {
+      tc->hits++;
+
+      /* move to the front of the LRU list */
+      LIST_DEL(&entry->list);
+      LIST_ADD(&entry->list, &tc->lru);
+
+      if (threaded)
+         pipe_mutex_unlock(tc->mutex);
+   }
+   else {
+      tc->misses++;
 
       assert(pt->resource);
-      if (tc->tile_addrs[pos].bits.invalid == 0) {
-         /* put dirty tile back in framebuffer */
-         if (tc->depth_stencil) {
-            pipe_put_tile_raw(pt, tc->transfer_map,
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_put_tile_ui_format(pt, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_put_tile_i_format(pt, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (int *) tile->data.colori128);
-            } else {
-               pipe_put_tile_rgba_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
+      if (LIST_IS_EMPTY(&tc->free) ||
+          (tc->thread_quota &&
+           tc->num_cached[thread] >= tc->thread_quota)) {
+         /* put the least recently used tile back in framebuffer */
+         entry = sp_tile_cache_lru_entry(tc, thread);
+         assert(entry);
+         sp_tile_cache_evict(tc, entry);
       }
 
-      tc->tile_addrs[pos] = addr;
+      entry = LIST_ENTRY(struct sp_tile_cache_entry, tc->free.next, list);
+      LIST_DEL(&entry->list);
+
+      if (!entry->tile)
+         entry->tile = sp_alloc_tile(tc, thread);
+
+      entry->addr = addr;
+      entry->hash_next = tc->hash[bucket];
+      tc->hash[bucket] = entry;
+      LIST_ADD(&entry->list, &tc->lru);
+      tc->num_cached[thread]++;
 
       if (is_clear_flag_set(tc->clear_flags, addr)) {
+         clear_clear_flag(tc->clear_flags, addr);
+         cleared = TRUE;
+      }
+      else if (!tc->depth_stencil) {
+         tc->conversions++;
+      }
+
+      /* Nobody else uses this tile, so fill it in without the lock. */
+      if (threaded)
+         pipe_mutex_unlock(tc->mutex);
+
+      if (cleared) {
          /* don't get tile from framebuffer, just clear it */
          if (tc->depth_stencil) {
-            clear_tile(tile, pt->resource->format, tc->clear_val);
+            clear_tile(entry->tile, pt->resource->format, tc->clear_val);
          }
          else {
-            clear_tile_rgba(tile, pt->resource->format, &tc->clear_color);
+            clear_tile_rgba(entry->tile, pt->resource->format, &tc->clear_color);
          }
-         clear_clear_flag(tc->clear_flags, addr);
       }
       else {
          /* get new tile data from transfer */
-         if (tc->depth_stencil) {
-            pipe_get_tile_raw(pt, tc->transfer_map,
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_get_tile_ui_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_get_tile_i_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (int *) tile->data.colori128);
-            } else {
-               pipe_get_tile_rgba_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
+         sp_tile_cache_get_tile(tc, addr, entry->tile);
       }
    }
 
-   tc->last_tile = tile;
-   tc->last_tile_addr = addr;
-   return tile;
+   tc->last_tile[thread].tile = entry->tile;
+   tc->last_tile[thread].addr = addr;
+   return entry->tile;
 }
 
 
@@ -599,8 +839,6 @@ sp_tile_cache_clear(struct softpipe_tile_cache *tc,
                     const union pipe_color_union *color,
                     uint64_t clearValue)
 {
-   uint pos;
-
    tc->clear_color = *color;
 
    tc->clear_val = clearValue;
@@ -608,8 +846,5 @@ sp_tile_cache_clear(struct softpipe_tile_cache *tc,
    /* set flags to indicate all the tiles are cleared */
    memset(tc->clear_flags, 255, sizeof(tc->clear_flags));
 
-   for (pos = 0; pos < Elements(tc->tile_addrs); pos++) {
-      tc->tile_addrs[pos].bits.invalid = 1;
-   }
-   tc->last_tile_addr.bits.invalid = 1;
+   sp_tile_cache_reset(tc);
 }
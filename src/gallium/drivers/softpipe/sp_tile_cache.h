@@ -30,10 +30,14 @@
 
 
 #include "pipe/p_compiler.h"
+#include "os/os_thread.h"
+#include "util/u_double_list.h"
+#include "sp_limits.h"
 #include "sp_texture.h"
 
 
 struct softpipe_tile_cache;
+struct util_format_description;
 
 
 /**
@@ -75,7 +79,30 @@ struct softpipe_cached_tile
    } data;
 };
 
-#define NUM_ENTRIES 50
+/**
+ * Smallest number of tiles the cache holds.  Above that, the capacity
+ * follows the size of the surface being cached, so that the whole
+ * framebuffer is kept without evictions, up to SP_TILE_CACHE_MAX_ENTRIES.
+ * Only the first SP_TILE_CACHE_MIN_ENTRIES tiles are kept across flushes.
+ */
+#define SP_TILE_CACHE_MIN_ENTRIES 50
+
+/**
+ * Most memory the tiles of one cache may take: enough for a 1920x1080
+ * surface.  Larger surfaces evict tiles in LRU order.
+ */
+#define SP_TILE_CACHE_MAX_SIZE (32 * 1024 * 1024)
+#define SP_TILE_CACHE_MAX_ENTRIES \
+   (SP_TILE_CACHE_MAX_SIZE / sizeof(struct softpipe_cached_tile))
+
+
+struct sp_tile_cache_entry
+{
+   union tile_address addr;
+   struct softpipe_cached_tile *tile;  /**< allocated on first use */
+   struct sp_tile_cache_entry *hash_next;
+   struct list_head list;  /**< in the cache's lru or free list */
+};
 
 
 struct softpipe_tile_cache
@@ -85,8 +112,23 @@ struct softpipe_tile_cache
    struct pipe_transfer *transfer;
    void *transfer_map;
 
-   union tile_address tile_addrs[NUM_ENTRIES];
-   struct softpipe_cached_tile *entries[NUM_ENTRIES];
+   /**
+    * Pack and unpack color tiles straight from/to the mapped surface
+    * rather than going through pipe_get/put_tile_rgba_format().
+    */
+   const struct util_format_description *direct_format;
+
+   unsigned num_entries;  /**< current capacity */
+   unsigned max_entries;  /**< size of the entries array */
+   unsigned tiles_x;      /**< surface width in tiles, for hashing */
+   struct sp_tile_cache_entry *entries;
+
+   /** Hash buckets for finding cached tiles, a power of two of them */
+   struct sp_tile_cache_entry **hash;
+   unsigned hash_mask;
+   struct list_head lru;   /**< cached tiles, most recently used first */
+   struct list_head free;  /**< unused entries */
+
    uint clear_flags[(MAX_WIDTH / TILE_SIZE) * (MAX_HEIGHT / TILE_SIZE) / 32];
    union pipe_color_union clear_color; /**< for color bufs */
    uint64_t clear_val;        /**< for z+stencil */
@@ -94,13 +136,42 @@ struct softpipe_tile_cache
 
    struct softpipe_cached_tile *tile;  /**< scratch tile for clears */
 
-   union tile_address last_tile_addr;
-   struct softpipe_cached_tile *last_tile;  /**< most recently retrieved tile */
+   /**
+    * The cache is shared by all rasterizer threads, each of which only
+    * draws to the tiles it owns (see sp_tile_owner()).  With more than
+    * one thread, lookups that miss last_tile take the mutex, and a thread
+    * only ever evicts its own tiles.  The data of a tile is only touched
+    * by the thread owning it.
+    */
+   unsigned num_threads;
+   pipe_mutex mutex;
+
+   /**
+    * Tiles each thread may keep, or 0 for no limit.  Only set when the
+    * cache couldn't grow to hold the whole surface, so that every thread
+    * always has a tile of its own to evict.
+    */
+   unsigned thread_quota;
+   unsigned num_cached[SP_MAX_THREADS];
+
+   /**
+    * Counters for the SP_QUERY_TILE_CACHE_* queries.  Lookups which hit
+    * last_tile in sp_get_cached_tile() are not counted.
+    */
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t conversions;  /**< color tiles packed or unpacked */
+
+   /** Each thread's most recently retrieved tile */
+   struct {
+      union tile_address addr;
+      struct softpipe_cached_tile *tile;
+   } last_tile[SP_MAX_THREADS];
 };
 
 
 extern struct softpipe_tile_cache *
-sp_create_tile_cache( struct pipe_context *pipe );
+sp_create_tile_cache( struct pipe_context *pipe, unsigned num_threads );
 
 extern void
 sp_destroy_tile_cache(struct softpipe_tile_cache *tc);
@@ -121,7 +192,7 @@ sp_tile_cache_clear(struct softpipe_tile_cache *tc,
                     uint64_t clearValue);
 
 extern struct softpipe_cached_tile *
-sp_find_cached_tile(struct softpipe_tile_cache *tc, 
+sp_find_cached_tile(struct softpipe_tile_cache *tc, unsigned thread,
                     union tile_address addr );
 
 
@@ -138,18 +209,31 @@ tile_address( unsigned x,
    return addr;
 }
 
-/* Quickly retrieve tile if it matches last lookup.
+/**
+ * Return the rasterizer thread that renders the given tile when the
+ * framebuffer is split among num_threads threads.  Tiles are dealt out
+ * along diagonals so that each thread gets an even share of any
+ * reasonably sized region.
+ */
+static INLINE unsigned
+sp_tile_owner(union tile_address addr, unsigned num_threads)
+{
+   return (addr.bits.x + addr.bits.y) % num_threads;
+}
+
+
+/* Quickly retrieve tile if it matches the thread's last lookup.
  */
 static INLINE struct softpipe_cached_tile *
-sp_get_cached_tile(struct softpipe_tile_cache *tc, 
+sp_get_cached_tile(struct softpipe_tile_cache *tc, unsigned thread,
                    int x, int y )
 {
    union tile_address addr = tile_address( x, y );
 
-   if (tc->last_tile_addr.value == addr.value)
-      return tc->last_tile;
+   if (tc->last_tile[thread].addr.value == addr.value)
+      return tc->last_tile[thread].tile;
 
-   return sp_find_cached_tile( tc, addr );
+   return sp_find_cached_tile( tc, thread, addr );
 }
 
 
@@ -0,0 +1,238 @@
+/**************************************************************************
+ *
+ * Copyright 2013 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case for the draw module's post-transform vertex cache.
+ *
+ * Draws an indexed triangle list through softpipe whose triangles share
+ * vertices with their neighbours, and which has more indices than a
+ * plain vsplit segment (1024).  Every vertex must only be shaded once,
+ * including those shared by triangles on either side of a segment
+ * boundary.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "draw/draw_context.h"
+#include "softpipe/sp_context.h"
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+
+
+#define WIDTH 64
+#define HEIGHT 64
+
+/** Triangles in the list, each sharing two vertices with the previous one */
+#define NUM_TRIS 1000
+#define NUM_VERTS (NUM_TRIS + 2)
+#define NUM_INDICES (NUM_TRIS * 3)
+
+
+static void
+setup_state(struct pipe_context *pipe, struct pipe_resource *target,
+            struct pipe_surface **surf, void **vs, void **fs, void **cso)
+{
+   const uint semantic_names[] = { TGSI_SEMANTIC_POSITION };
+   const uint semantic_indexes[] = { 0 };
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_viewport_state viewport;
+   struct pipe_framebuffer_state fb;
+   struct pipe_surface surf_tmpl;
+   struct pipe_vertex_element velem;
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   cso[0] = pipe->create_blend_state(pipe, &blend);
+   pipe->bind_blend_state(pipe, cso[0]);
+
+   memset(&dsa, 0, sizeof dsa);
+   cso[1] = pipe->create_depth_stencil_alpha_state(pipe, &dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe, cso[1]);
+
+   memset(&rast, 0, sizeof rast);
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.half_pixel_center = 1;
+   rast.depth_clip = 1;
+   cso[2] = pipe->create_rasterizer_state(pipe, &rast);
+   pipe->bind_rasterizer_state(pipe, cso[2]);
+
+   memset(&velem, 0, sizeof velem);
+   velem.src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   cso[3] = pipe->create_vertex_elements_state(pipe, 1, &velem);
+   pipe->bind_vertex_elements_state(pipe, cso[3]);
+
+   memset(&viewport, 0, sizeof viewport);
+   viewport.scale[0] = WIDTH / 2.0f;
+   viewport.scale[1] = HEIGHT / 2.0f;
+   viewport.scale[2] = 0.5f;
+   viewport.scale[3] = 1.0f;
+   viewport.translate[0] = WIDTH / 2.0f;
+   viewport.translate[1] = HEIGHT / 2.0f;
+   viewport.translate[2] = 0.5f;
+   pipe->set_viewport_states(pipe, 0, 1, &viewport);
+
+   memset(&surf_tmpl, 0, sizeof surf_tmpl);
+   surf_tmpl.format = target->format;
+   *surf = pipe->create_surface(pipe, target, &surf_tmpl);
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = WIDTH;
+   fb.height = HEIGHT;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = *surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   *vs = util_make_vertex_passthrough_shader(pipe, 1, semantic_names,
+                                             semantic_indexes);
+   pipe->bind_vs_state(pipe, *vs);
+
+   *fs = util_make_empty_fragment_shader(pipe);
+   pipe->bind_fs_state(pipe, *fs);
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct draw_context *draw;
+   struct pipe_resource tmpl, *target;
+   struct pipe_surface *surf;
+   struct pipe_vertex_buffer vbuf;
+   struct pipe_index_buffer ibuf;
+   void *vs, *fs, *cso[4];
+   float (*verts)[4];
+   ushort *indices;
+   uint64_t hits, misses, hits0, misses0;
+   unsigned i;
+   int ret = 0;
+
+   screen = softpipe_create_screen(null_sw_create());
+   if (!screen) {
+      printf("failed to create screen\n");
+      return 1;
+   }
+   pipe = screen->context_create(screen, NULL);
+   draw = softpipe_context(pipe)->draw;
+
+   memset(&tmpl, 0, sizeof tmpl);
+   tmpl.target = PIPE_TEXTURE_2D;
+   tmpl.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   tmpl.width0 = WIDTH;
+   tmpl.height0 = HEIGHT;
+   tmpl.depth0 = 1;
+   tmpl.array_size = 1;
+   tmpl.bind = PIPE_BIND_RENDER_TARGET;
+   target = screen->resource_create(screen, &tmpl);
+
+   setup_state(pipe, target, &surf, &vs, &fs, cso);
+
+   /* a zig-zag strip of thin triangles, drawn as a list */
+   verts = MALLOC(NUM_VERTS * sizeof *verts);
+   for (i = 0; i < NUM_VERTS; i++) {
+      verts[i][0] = -0.9f + 1.8f * i / NUM_VERTS;
+      verts[i][1] = i & 1 ? 0.5f : -0.5f;
+      verts[i][2] = 0.0f;
+      verts[i][3] = 1.0f;
+   }
+
+   indices = MALLOC(NUM_INDICES * sizeof *indices);
+   for (i = 0; i < NUM_TRIS; i++) {
+      indices[i * 3 + 0] = i;
+      indices[i * 3 + 1] = i + 1;
+      indices[i * 3 + 2] = i + 2;
+   }
+
+   memset(&vbuf, 0, sizeof vbuf);
+   vbuf.stride = sizeof *verts;
+   vbuf.user_buffer = verts;
+   pipe->set_vertex_buffers(pipe, 0, 1, &vbuf);
+
+   memset(&ibuf, 0, sizeof ibuf);
+   ibuf.index_size = sizeof *indices;
+   ibuf.user_buffer = indices;
+   pipe->set_index_buffer(pipe, &ibuf);
+
+   /* Without an index range, vsplit can't fetch the vertices linearly and
+    * goes through its cache.
+    */
+   draw_get_vcache_stats(draw, &hits0, &misses0);
+   util_draw_elements(pipe, 0, PIPE_PRIM_TRIANGLES, 0, NUM_INDICES);
+   pipe->flush(pipe, NULL, 0);
+   draw_get_vcache_stats(draw, &hits, &misses);
+   hits -= hits0;
+   misses -= misses0;
+
+   printf("%u indices, %u vertices: %llu hits, %llu misses\n",
+          NUM_INDICES, NUM_VERTS,
+          (unsigned long long) hits, (unsigned long long) misses);
+
+   if (misses != NUM_VERTS || hits != NUM_INDICES - NUM_VERTS) {
+      printf("FAIL: vertices were shaded more than once\n");
+      ret = 1;
+   }
+   else {
+      printf("PASS\n");
+   }
+
+   pipe->set_index_buffer(pipe, NULL);
+   pipe->bind_vs_state(pipe, NULL);
+   pipe->bind_fs_state(pipe, NULL);
+   pipe->delete_vs_state(pipe, vs);
+   pipe->delete_fs_state(pipe, fs);
+   pipe->bind_blend_state(pipe, NULL);
+   pipe->delete_blend_state(pipe, cso[0]);
+   pipe->bind_depth_stencil_alpha_state(pipe, NULL);
+   pipe->delete_depth_stencil_alpha_state(pipe, cso[1]);
+   pipe->bind_rasterizer_state(pipe, NULL);
+   pipe->delete_rasterizer_state(pipe, cso[2]);
+   pipe->bind_vertex_elements_state(pipe, NULL);
+   pipe->delete_vertex_elements_state(pipe, cso[3]);
+   pipe_surface_reference(&surf, NULL);
+   pipe_resource_reference(&target, NULL);
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+
+   FREE(indices);
+   FREE(verts);
+
+   return ret;
+}
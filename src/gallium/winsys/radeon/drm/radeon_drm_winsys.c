@@ -627,7 +627,10 @@ PUBLIC struct radeon_winsys *radeon_drm_winsys_create(int fd)
     ws->kman = radeon_bomgr_create(ws);
     if (!ws->kman)
         goto fail;
-    ws->cman = pb_cache_manager_create(ws->kman, 1000000);
+    /* Cache at most 1/8 of the memory, freed buffers are kept for 1 second. */
+    ws->cman = pb_cache_manager_create(ws->kman, 1000000,
+                                       ((uint64_t)ws->info.vram_size +
+                                        ws->info.gart_size) / 8);
     if (!ws->cman)
         goto fail;
 
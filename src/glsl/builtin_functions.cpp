@@ -369,6 +369,7 @@ public:
    void release();
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
+   ir_function_signature *find_exact(const char *name, exec_list *parameters);
 
    /**
     * A shader to hold all the built-in signatures; created by this module.
@@ -386,9 +387,26 @@ private:
    ir_variable *gl_ModelViewProjectionMatrix;
    ir_variable *gl_Vertex;
 
+   /**
+    * Name of the built-in function create_builtins() should generate, or
+    * NULL to generate all of them.
+    *
+    * Built-ins are generated lazily, one function (with all of its
+    * signatures) at a time, the first time a shader calls them.  Most
+    * shaders only use a handful of the several hundred built-ins, so this
+    * saves both the time and the memory of building IR nobody uses.
+    */
+   const char *wanted;
+
+   bool want(const char *name) const
+   {
+      return wanted == NULL || strcmp(name, wanted) == 0;
+   }
+
    void create_shader();
    void create_intrinsics();
    void create_builtins();
+   ir_function *get_function(const char *name);
 
    /**
     * IR builder helpers:
@@ -646,7 +664,8 @@ private:
 builtin_builder::builtin_builder()
    : shader(NULL),
      gl_ModelViewProjectionMatrix(NULL),
-     gl_Vertex(NULL)
+     gl_Vertex(NULL),
+     wanted(NULL)
 {
    mem_ctx = NULL;
 }
@@ -669,7 +688,7 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     */
    state->uses_builtin_functions = true;
 
-   ir_function *f = shader->symbols->get_function(name);
+   ir_function *f = get_function(name);
    if (f == NULL)
       return NULL;
 
@@ -680,6 +699,39 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
    return sig;
 }
 
+/**
+ * Find the built-in signature whose parameter types exactly match those of
+ * \c parameters, a list of ir_variables, regardless of availability.
+ */
+ir_function_signature *
+builtin_builder::find_exact(const char *name, exec_list *parameters)
+{
+   ir_function *f = get_function(name);
+   if (f == NULL)
+      return NULL;
+
+   return f->exact_matching_signature(NULL, parameters);
+}
+
+/**
+ * Look up a built-in function, generating it first if necessary.
+ */
+ir_function *
+builtin_builder::get_function(const char *name)
+{
+   ir_function *f = shader->symbols->get_function(name);
+   if (f == NULL) {
+      /* Not generated yet (or not a built-in at all); generate it now. */
+      wanted = name;
+      create_builtins();
+      wanted = NULL;
+
+      f = shader->symbols->get_function(name);
+   }
+
+   return f;
+}
+
 void
 builtin_builder::initialize()
 {
@@ -687,10 +739,13 @@ builtin_builder::initialize()
    if (mem_ctx != NULL)
       return;
 
+   /* Only the intrinsics are created up front, since the built-ins that are
+    * implemented in terms of them look them up by name.  Everything else is
+    * generated on demand by find().
+    */
    mem_ctx = ralloc_context(NULL);
    create_shader();
    create_intrinsics();
-   create_builtins();
 }
 
 void
@@ -753,11 +808,21 @@ builtin_builder::create_intrinsics()
 /**
  * Create ir_function and ir_function_signature objects for each built-in.
  *
- * Contains a list of every available built-in.
+ * Contains a list of every available built-in.  If \c wanted is set, only
+ * the function of that name is created.
  */
 void
 builtin_builder::create_builtins()
 {
+/* Skip building the signatures of functions other than the wanted one;
+ * they're only evaluated when the predicate passes.
+ */
+#define add_function(NAME, ...)                         \
+   do {                                                 \
+      if (want(NAME))                                   \
+         this->add_function(NAME, __VA_ARGS__);         \
+   } while (0)
+
 #define F(NAME)                                 \
    add_function(#NAME,                          \
                 _##NAME(glsl_type::float_type), \
@@ -2232,6 +2297,7 @@ builtin_builder::create_builtins()
 #undef FIU
 #undef FIUB
 #undef FIU2_MIXED
+#undef add_function
 }
 
 void
@@ -2266,6 +2332,9 @@ builtin_builder::add_image_function(const char *name,
                                     unsigned num_arguments,
                                     unsigned flags)
 {
+   if (!want(name))
+      return;
+
    static const glsl_type *const types[] = {
       glsl_type::image1D_type,
       glsl_type::image2D_type,
@@ -4384,10 +4453,34 @@ _mesa_glsl_find_builtin_function(_mesa_glsl_parse_state *state,
    return s;
 }
 
+ir_function_signature *
+_mesa_glsl_find_exact_builtin_function(const char *name,
+                                       exec_list *parameters)
+{
+   ir_function_signature * s;
+   _glthread_LOCK_MUTEX(builtins_lock);
+   builtins.initialize();
+   s = builtins.find_exact(name, parameters);
+   _glthread_UNLOCK_MUTEX(builtins_lock);
+   return s;
+}
+
 gl_shader *
 _mesa_glsl_get_builtin_function_shader()
 {
    return builtins.shader;
 }
 
+void
+_mesa_glsl_lock_builtin_functions()
+{
+   _glthread_LOCK_MUTEX(builtins_lock);
+}
+
+void
+_mesa_glsl_unlock_builtin_functions()
+{
+   _glthread_UNLOCK_MUTEX(builtins_lock);
+}
+
 /** @} */
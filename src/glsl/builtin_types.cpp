@@ -251,6 +251,26 @@ const glsl_type *const deprecated_types[] = {
    glsl_type::struct_gl_FogParameters_type,
 };
 
+const glsl_type *
+_mesa_glsl_find_builtin_type(const char *name)
+{
+   for (unsigned i = 0; i < Elements(builtin_type_versions); i++) {
+      if (strcmp(builtin_type_versions[i].type->name, name) == 0)
+         return builtin_type_versions[i].type;
+   }
+
+   for (unsigned i = 0; i < Elements(deprecated_types); i++) {
+      if (strcmp(deprecated_types[i]->name, name) == 0)
+         return deprecated_types[i];
+   }
+
+   /* Only added by the OES_EGL_image_external extension. */
+   if (strcmp(glsl_type::samplerExternalOES_type->name, name) == 0)
+      return glsl_type::samplerExternalOES_type;
+
+   return NULL;
+}
+
 static inline void
 add_type(glsl_symbol_table *symbols, const glsl_type *const type)
 {
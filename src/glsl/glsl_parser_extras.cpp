@@ -24,6 +24,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 extern "C" {
 #include "main/core.h" /* for struct gl_context */
@@ -37,6 +38,7 @@ extern "C" {
 #include "glsl_parser.h"
 #include "ir_optimization.h"
 #include "loop_analysis.h"
+#include "shader_cache.h"
 
 /**
  * Format a short human-readable description of the given GLSL version.
@@ -1398,6 +1400,12 @@ void
 _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
                           bool dump_ast, bool dump_hir)
 {
+   const bool use_cache = !dump_ast && !dump_hir &&
+      !(ctx->Shader.Flags & GLSL_NO_CACHE);
+
+   if (use_cache && _mesa_glsl_cache_lookup(ctx, shader))
+      return;
+
    struct _mesa_glsl_parse_state *state =
       new(shader) _mesa_glsl_parse_state(ctx, shader->Stage, shader);
    const char *source = shader->Source;
@@ -1441,8 +1449,7 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       /* Do some optimization at compile time to reduce shader IR size
        * and reduce later work if the same shader is linked multiple times
        */
-      while (do_common_optimization(shader->ir, false, false, 32, options))
-         ;
+      do_common_optimization_loop(shader->ir, false, false, 32, options);
 
       validate_ir_tree(shader->ir);
    }
@@ -1470,9 +1477,286 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
    reparent_ir(shader->ir, shader->ir);
 
    ralloc_free(state);
+
+   if (use_cache && shader->CompileStatus)
+      _mesa_glsl_cache_store(ctx, shader);
 }
 
 } /* extern "C" */
+
+/** Upper bound on the number of passes do_common_optimization() runs. */
+#define MAX_COMMON_OPTIMIZATION_PASSES 32
+
+namespace {
+
+/**
+ * Statistics for one optimization pass, printed at exit when
+ * MESA_GLSL_OPT_STATS is set.
+ *
+ * Each do_common_optimization() run gathers its own, which are added to
+ * the process-wide totals under pass_stats_lock when it finishes, so
+ * concurrent compiles don't race on the counters.
+ */
+struct opt_pass_stats {
+   const char *name;
+   unsigned runs;
+   unsigned skips;
+   unsigned progress;
+   int64_t time_ns;
+};
+
+/**
+ * Bookkeeping for one do_common_optimization() run over a shader.
+ *
+ * Each pass is a deterministic function of the IR, so a pass that reported
+ * no progress will keep reporting none until another pass changes the IR.
+ * When running to a fixpoint, \c generation counts the passes that made
+ * progress, and a pass that came up empty in the current generation is
+ * skipped instead of walking the whole IR again.
+ */
+class common_optimization_state {
+public:
+   common_optimization_state(bool incremental);
+   ~common_optimization_state();
+
+   void begin_iteration()
+   {
+      pass = 0;
+   }
+
+   bool begin_pass(const char *name);
+   bool end_pass(bool progress);
+
+private:
+   bool incremental;
+   unsigned generation;
+   unsigned pass;
+
+   /**
+    * One more than the generation in which each pass last reported no
+    * progress, or 0 if it may make progress.
+    */
+   unsigned clean_generation[MAX_COMMON_OPTIMIZATION_PASSES];
+
+   /** Statistics of this run, by pass slot; NULL if not gathered. */
+   opt_pass_stats *stats;
+   int64_t start_time;
+};
+
+} /* anonymous namespace */
+
+static opt_pass_stats pass_stats[MAX_COMMON_OPTIMIZATION_PASSES];
+_glthread_DECLARE_STATIC_MUTEX(pass_stats_lock);
+
+static bool
+opt_stats_enabled(void)
+{
+   static int enabled = -1;
+
+   if (enabled < 0)
+      enabled = getenv("MESA_GLSL_OPT_STATS") != NULL;
+
+   return enabled;
+}
+
+static int64_t
+get_time_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+   return (int64_t) clock() * (1000000000 / CLOCKS_PER_SEC);
+#endif
+}
+
+/**
+ * Find the totals for a pass.  Must be called with pass_stats_lock held.
+ */
+static opt_pass_stats *
+get_pass_stats(const char *name)
+{
+   for (unsigned i = 0; i < Elements(pass_stats); i++) {
+      if (pass_stats[i].name == NULL)
+         pass_stats[i].name = name;
+      if (strcmp(pass_stats[i].name, name) == 0)
+         return &pass_stats[i];
+   }
+
+   return NULL;
+}
+
+common_optimization_state::common_optimization_state(bool incremental)
+   : incremental(incremental), generation(0), pass(0),
+     stats(NULL), start_time(0)
+{
+   memset(clean_generation, 0, sizeof(clean_generation));
+
+   if (opt_stats_enabled())
+      stats = (opt_pass_stats *) calloc(MAX_COMMON_OPTIMIZATION_PASSES,
+                                        sizeof(opt_pass_stats));
+}
+
+/**
+ * Adds the statistics of this run to the process-wide totals.
+ */
+common_optimization_state::~common_optimization_state()
+{
+   if (stats == NULL)
+      return;
+
+   _glthread_LOCK_MUTEX(pass_stats_lock);
+   for (unsigned i = 0; i < MAX_COMMON_OPTIMIZATION_PASSES; i++) {
+      const opt_pass_stats *st = &stats[i];
+      opt_pass_stats *total;
+
+      if (st->name == NULL)
+         continue;
+
+      total = get_pass_stats(st->name);
+      if (total == NULL)
+         continue;
+
+      total->runs += st->runs;
+      total->skips += st->skips;
+      total->progress += st->progress;
+      total->time_ns += st->time_ns;
+   }
+   _glthread_UNLOCK_MUTEX(pass_stats_lock);
+
+   free(stats);
+}
+
+/**
+ * Returns whether the next pass needs to run.
+ */
+bool
+common_optimization_state::begin_pass(const char *name)
+{
+   assert(pass < MAX_COMMON_OPTIMIZATION_PASSES);
+
+   if (stats)
+      stats[pass].name = name;
+
+   if (incremental && clean_generation[pass] == generation + 1) {
+      if (stats)
+         stats[pass].skips++;
+      pass++;
+      return false;
+   }
+
+   if (stats)
+      start_time = get_time_ns();
+
+   return true;
+}
+
+/**
+ * Records the result of the pass started by begin_pass().
+ */
+bool
+common_optimization_state::end_pass(bool progress)
+{
+   if (stats) {
+      stats[pass].time_ns += get_time_ns() - start_time;
+      stats[pass].runs++;
+      if (progress)
+         stats[pass].progress++;
+   }
+
+   if (progress) {
+      generation++;
+      clean_generation[pass] = 0;
+   } else {
+      clean_generation[pass] = generation + 1;
+   }
+
+   pass++;
+   return progress;
+}
+
+static bool
+do_loop_optimizations(exec_list *ir, unsigned max_unroll_iterations)
+{
+   bool progress = false;
+
+   loop_state *ls = analyze_loop_variables(ir);
+   if (ls->loop_found) {
+      progress = set_loop_controls(ir, ls) || progress;
+      progress = unroll_loops(ir, ls, max_unroll_iterations) || progress;
+   }
+   delete ls;
+
+   return progress;
+}
+
+static bool
+run_common_optimization(exec_list *ir, bool linked,
+                        bool uniform_locations_assigned,
+                        unsigned max_unroll_iterations,
+                        const struct gl_shader_compiler_options *options,
+                        common_optimization_state *state)
+{
+   bool progress = false;
+
+   state->begin_iteration();
+
+#define OPT(PASS, ...)                                                  \
+   do {                                                                 \
+      if (state->begin_pass(#PASS))                                     \
+         progress = state->end_pass(PASS(__VA_ARGS__)) || progress;     \
+   } while (0)
+
+   OPT(lower_instructions, ir, SUB_TO_ADD_NEG);
+
+   if (linked) {
+      OPT(do_function_inlining, ir);
+      OPT(do_dead_functions, ir);
+      OPT(do_structure_splitting, ir);
+   }
+   OPT(do_if_simplification, ir);
+   OPT(opt_flatten_nested_if_blocks, ir);
+   OPT(do_copy_propagation, ir);
+   OPT(do_copy_propagation_elements, ir);
+
+   if (options->OptimizeForAOS && !linked)
+      OPT(opt_flip_matrices, ir);
+
+   if (linked && options->OptimizeForAOS) {
+      OPT(do_vectorize, ir);
+   }
+
+   if (linked)
+      OPT(do_dead_code, ir, uniform_locations_assigned);
+   else
+      OPT(do_dead_code_unlinked, ir);
+   OPT(do_dead_code_local, ir);
+   OPT(do_tree_grafting, ir);
+   OPT(do_constant_propagation, ir);
+   if (linked)
+      OPT(do_constant_variable, ir);
+   else
+      OPT(do_constant_variable_unlinked, ir);
+   OPT(do_constant_folding, ir);
+   OPT(do_cse, ir);
+   OPT(do_algebraic, ir);
+   OPT(do_lower_jumps, ir);
+   OPT(do_vec_index_to_swizzle, ir);
+   OPT(lower_vector_insert, ir, false);
+   OPT(do_swizzle_swizzle, ir);
+   OPT(do_noop_swizzle, ir);
+
+   OPT(optimize_split_arrays, ir, linked);
+   OPT(optimize_redundant_jumps, ir);
+
+   OPT(do_loop_optimizations, ir, max_unroll_iterations);
+
+#undef OPT
+
+   return progress;
+}
+
 /**
  * Do the set of common optimizations passes
  *
@@ -1497,58 +1781,64 @@ do_common_optimization(exec_list *ir, bool linked,
 		       unsigned max_unroll_iterations,
                        const struct gl_shader_compiler_options *options)
 {
-   GLboolean progress = GL_FALSE;
+   common_optimization_state state(false);
 
-   progress = lower_instructions(ir, SUB_TO_ADD_NEG) || progress;
+   return run_common_optimization(ir, linked, uniform_locations_assigned,
+                                  max_unroll_iterations, options, &state);
+}
 
-   if (linked) {
-      progress = do_function_inlining(ir) || progress;
-      progress = do_dead_functions(ir) || progress;
-      progress = do_structure_splitting(ir) || progress;
-   }
-   progress = do_if_simplification(ir) || progress;
-   progress = opt_flatten_nested_if_blocks(ir) || progress;
-   progress = do_copy_propagation(ir) || progress;
-   progress = do_copy_propagation_elements(ir) || progress;
+/**
+ * Run the common optimization passes until none of them makes progress.
+ *
+ * This is equivalent to calling do_common_optimization() in a loop until it
+ * returns false, except that passes which can't make progress because the
+ * IR hasn't changed since they last ran are skipped.
+ *
+ * \return true if any pass made progress.
+ */
+bool
+do_common_optimization_loop(exec_list *ir, bool linked,
+                            bool uniform_locations_assigned,
+                            unsigned max_unroll_iterations,
+                            const struct gl_shader_compiler_options *options)
+{
+   common_optimization_state state(true);
+   bool progress = false;
 
-   if (options->OptimizeForAOS && !linked)
-      progress = opt_flip_matrices(ir) || progress;
+   while (run_common_optimization(ir, linked, uniform_locations_assigned,
+                                  max_unroll_iterations, options, &state))
+      progress = true;
 
-   if (linked && options->OptimizeForAOS) {
-      progress = do_vectorize(ir) || progress;
+   return progress;
+}
+
+/**
+ * Print the statistics gathered when MESA_GLSL_OPT_STATS is set.
+ */
+static void
+print_opt_stats(void)
+{
+   _glthread_LOCK_MUTEX(pass_stats_lock);
+
+   if (!opt_stats_enabled() || pass_stats[0].name == NULL) {
+      _glthread_UNLOCK_MUTEX(pass_stats_lock);
+      return;
    }
 
-   if (linked)
-      progress = do_dead_code(ir, uniform_locations_assigned) || progress;
-   else
-      progress = do_dead_code_unlinked(ir) || progress;
-   progress = do_dead_code_local(ir) || progress;
-   progress = do_tree_grafting(ir) || progress;
-   progress = do_constant_propagation(ir) || progress;
-   if (linked)
-      progress = do_constant_variable(ir) || progress;
-   else
-      progress = do_constant_variable_unlinked(ir) || progress;
-   progress = do_constant_folding(ir) || progress;
-   progress = do_cse(ir) || progress;
-   progress = do_algebraic(ir) || progress;
-   progress = do_lower_jumps(ir) || progress;
-   progress = do_vec_index_to_swizzle(ir) || progress;
-   progress = lower_vector_insert(ir, false) || progress;
-   progress = do_swizzle_swizzle(ir) || progress;
-   progress = do_noop_swizzle(ir) || progress;
-
-   progress = optimize_split_arrays(ir, linked) || progress;
-   progress = optimize_redundant_jumps(ir) || progress;
+   fprintf(stderr, "%-32s %10s %10s %10s %12s\n",
+           "pass", "runs", "skipped", "progress", "time (ms)");
+   for (unsigned i = 0; i < Elements(pass_stats); i++) {
+      const opt_pass_stats *st = &pass_stats[i];
 
-   loop_state *ls = analyze_loop_variables(ir);
-   if (ls->loop_found) {
-      progress = set_loop_controls(ir, ls) || progress;
-      progress = unroll_loops(ir, ls, max_unroll_iterations) || progress;
+      if (st->name == NULL)
+         break;
+
+      fprintf(stderr, "%-32s %10u %10u %10u %12.3f\n",
+              st->name, st->runs, st->skips, st->progress,
+              st->time_ns / 1000000.0);
    }
-   delete ls;
 
-   return progress;
+   _glthread_UNLOCK_MUTEX(pass_stats_lock);
 }
 
 extern "C" {
@@ -1563,6 +1853,8 @@ extern "C" {
 void
 _mesa_destroy_shader_compiler(void)
 {
+   print_opt_stats();
+
    _mesa_destroy_shader_compiler_caches();
 
    _mesa_glsl_release_types();
@@ -1576,6 +1868,7 @@ _mesa_destroy_shader_compiler(void)
 void
 _mesa_destroy_shader_compiler_caches(void)
 {
+   _mesa_glsl_release_shader_cache();
    _mesa_glsl_release_builtin_functions();
 }
 
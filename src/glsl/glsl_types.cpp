@@ -36,6 +36,45 @@ hash_table *glsl_type::record_types = NULL;
 hash_table *glsl_type::interface_types = NULL;
 void *glsl_type::mem_ctx = NULL;
 
+/**
+ * Protects glsl_type::mem_ctx and the type hash tables.
+ *
+ * It is never held while a glsl_type is constructed, since the constructors
+ * and operator new take it themselves.
+ */
+_glthread_DECLARE_STATIC_MUTEX(glsl_type_mutex);
+
+void *
+glsl_type::operator new(size_t size)
+{
+   void *type;
+
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
+   if (glsl_type::mem_ctx == NULL) {
+      glsl_type::mem_ctx = ralloc_context(NULL);
+      assert(glsl_type::mem_ctx != NULL);
+   }
+
+   type = ralloc_size(glsl_type::mem_ctx, size);
+   assert(type != NULL);
+
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
+
+   return type;
+}
+
+void
+glsl_type::operator delete(void *type)
+{
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+   ralloc_free(type);
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
+}
+
+/**
+ * Must be called with glsl_type_mutex held.
+ */
 void
 glsl_type::init_ralloc_type_ctx(void)
 {
@@ -55,9 +94,14 @@ glsl_type::glsl_type(GLenum gl_type,
    vector_elements(vector_elements), matrix_columns(matrix_columns),
    length(0)
 {
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
    init_ralloc_type_ctx();
    assert(name != NULL);
    this->name = ralloc_strdup(this->mem_ctx, name);
+
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
+
    /* Neither dimension is zero or both dimensions are zero.
     */
    assert((vector_elements == 0) == (matrix_columns == 0));
@@ -73,9 +117,14 @@ glsl_type::glsl_type(GLenum gl_type, glsl_base_type base_type,
    sampler_array(array), sampler_type(type), interface_packing(0),
    length(0)
 {
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
    init_ralloc_type_ctx();
    assert(name != NULL);
    this->name = ralloc_strdup(this->mem_ctx, name);
+
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
+
    memset(& fields, 0, sizeof(fields));
 
    if (base_type == GLSL_TYPE_SAMPLER) {
@@ -97,6 +146,8 @@ glsl_type::glsl_type(const glsl_struct_field *fields, unsigned num_fields,
 {
    unsigned int i;
 
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
    init_ralloc_type_ctx();
    assert(name != NULL);
    this->name = ralloc_strdup(this->mem_ctx, name);
@@ -112,6 +163,8 @@ glsl_type::glsl_type(const glsl_struct_field *fields, unsigned num_fields,
       this->fields.structure[i].sample = fields[i].sample;
       this->fields.structure[i].row_major = fields[i].row_major;
    }
+
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
 }
 
 glsl_type::glsl_type(const glsl_struct_field *fields, unsigned num_fields,
@@ -125,6 +178,8 @@ glsl_type::glsl_type(const glsl_struct_field *fields, unsigned num_fields,
 {
    unsigned int i;
 
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
    init_ralloc_type_ctx();
    assert(name != NULL);
    this->name = ralloc_strdup(this->mem_ctx, name);
@@ -140,6 +195,8 @@ glsl_type::glsl_type(const glsl_struct_field *fields, unsigned num_fields,
       this->fields.structure[i].sample = fields[i].sample;
       this->fields.structure[i].row_major = fields[i].row_major;
    }
+
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
 }
 
 
@@ -287,6 +344,8 @@ const glsl_type *glsl_type::get_scalar_type() const
 void
 _mesa_glsl_release_types(void)
 {
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
    if (glsl_type::array_types != NULL) {
       hash_table_dtor(glsl_type::array_types);
       glsl_type::array_types = NULL;
@@ -296,6 +355,13 @@ _mesa_glsl_release_types(void)
       hash_table_dtor(glsl_type::record_types);
       glsl_type::record_types = NULL;
    }
+
+   if (glsl_type::interface_types != NULL) {
+      hash_table_dtor(glsl_type::interface_types);
+      glsl_type::interface_types = NULL;
+   }
+
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
 }
 
 
@@ -318,7 +384,10 @@ glsl_type::glsl_type(const glsl_type *array, unsigned length) :
     * NUL.
     */
    const unsigned name_length = strlen(array->name) + 10 + 3;
+
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
    char *const n = (char *) ralloc_size(this->mem_ctx, name_length);
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
 
    if (length == 0)
       snprintf(n, name_length, "%s[]", array->name);
@@ -454,12 +523,6 @@ glsl_type::get_instance(unsigned base_type, unsigned rows, unsigned columns)
 const glsl_type *
 glsl_type::get_array_instance(const glsl_type *base, unsigned array_size)
 {
-
-   if (array_types == NULL) {
-      array_types = hash_table_ctor(64, hash_table_string_hash,
-				    hash_table_string_compare);
-   }
-
    /* Generate a name using the base type pointer in the key.  This is
     * done because the name of the base type may not be unique across
     * shaders.  For example, two shaders may have different record types
@@ -468,11 +531,33 @@ glsl_type::get_array_instance(const glsl_type *base, unsigned array_size)
    char key[128];
    snprintf(key, sizeof(key), "%p[%u]", (void *) base, array_size);
 
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
+   if (array_types == NULL) {
+      array_types = hash_table_ctor(64, hash_table_string_hash,
+				    hash_table_string_compare);
+   }
+
    const glsl_type *t = (glsl_type *) hash_table_find(array_types, key);
+
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
+
    if (t == NULL) {
-      t = new glsl_type(base, array_size);
+      const glsl_type *new_type = new glsl_type(base, array_size);
 
-      hash_table_insert(array_types, (void *) t, ralloc_strdup(mem_ctx, key));
+      _glthread_LOCK_MUTEX(glsl_type_mutex);
+
+      /* Another thread may have added the same type in the meantime; the
+       * first one wins so that types can still be compared by pointer.
+       */
+      t = (glsl_type *) hash_table_find(array_types, key);
+      if (t == NULL) {
+         t = new_type;
+         hash_table_insert(array_types, (void *) t,
+                           ralloc_strdup(mem_ctx, key));
+      }
+
+      _glthread_UNLOCK_MUTEX(glsl_type_mutex);
    }
 
    assert(t->base_type == GLSL_TYPE_ARRAY);
@@ -563,15 +648,29 @@ glsl_type::get_record_instance(const glsl_struct_field *fields,
 {
    const glsl_type key(fields, num_fields, name);
 
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
    if (record_types == NULL) {
       record_types = hash_table_ctor(64, record_key_hash, record_key_compare);
    }
 
    const glsl_type *t = (glsl_type *) hash_table_find(record_types, & key);
+
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
+
    if (t == NULL) {
-      t = new glsl_type(fields, num_fields, name);
+      const glsl_type *new_type = new glsl_type(fields, num_fields, name);
+
+      _glthread_LOCK_MUTEX(glsl_type_mutex);
 
-      hash_table_insert(record_types, (void *) t, t);
+      /* See get_array_instance(). */
+      t = (glsl_type *) hash_table_find(record_types, & key);
+      if (t == NULL) {
+         t = new_type;
+         hash_table_insert(record_types, (void *) t, t);
+      }
+
+      _glthread_UNLOCK_MUTEX(glsl_type_mutex);
    }
 
    assert(t->base_type == GLSL_TYPE_STRUCT);
@@ -590,15 +689,29 @@ glsl_type::get_interface_instance(const glsl_struct_field *fields,
 {
    const glsl_type key(fields, num_fields, packing, block_name);
 
+   _glthread_LOCK_MUTEX(glsl_type_mutex);
+
    if (interface_types == NULL) {
       interface_types = hash_table_ctor(64, record_key_hash, record_key_compare);
    }
 
    const glsl_type *t = (glsl_type *) hash_table_find(interface_types, & key);
+
+   _glthread_UNLOCK_MUTEX(glsl_type_mutex);
+
    if (t == NULL) {
-      t = new glsl_type(fields, num_fields, packing, block_name);
+      const glsl_type *new_type = new glsl_type(fields, num_fields, packing, block_name);
+
+      _glthread_LOCK_MUTEX(glsl_type_mutex);
+
+      /* See get_array_instance(). */
+      t = (glsl_type *) hash_table_find(interface_types, & key);
+      if (t == NULL) {
+         t = new_type;
+         hash_table_insert(interface_types, (void *) t, t);
+      }
 
-      hash_table_insert(interface_types, (void *) t, t);
+      _glthread_UNLOCK_MUTEX(glsl_type_mutex);
    }
 
    assert(t->base_type == GLSL_TYPE_INTERFACE);
@@ -43,6 +43,15 @@ _mesa_glsl_initialize_types(struct _mesa_glsl_parse_state *state);
 extern void
 _mesa_glsl_release_types(void);
 
+struct glsl_type;
+
+/**
+ * Find a built-in type (including the built-in structures) by name,
+ * regardless of language version and extensions.
+ */
+extern const struct glsl_type *
+_mesa_glsl_find_builtin_type(const char *name);
+
 #ifdef __cplusplus
 }
 #endif
@@ -99,27 +108,11 @@ struct glsl_type {
 
    /* Callers of this ralloc-based new need not call delete. It's
     * easier to just ralloc_free 'mem_ctx' (or any of its ancestors). */
-   static void* operator new(size_t size)
-   {
-      if (glsl_type::mem_ctx == NULL) {
-	 glsl_type::mem_ctx = ralloc_context(NULL);
-	 assert(glsl_type::mem_ctx != NULL);
-      }
-
-      void *type;
-
-      type = ralloc_size(glsl_type::mem_ctx, size);
-      assert(type != NULL);
-
-      return type;
-   }
+   static void* operator new(size_t size);
 
    /* If the user *does* call delete, that's OK, we will just
     * ralloc_free in that case. */
-   static void operator delete(void *type)
-   {
-      ralloc_free(type);
-   }
+   static void operator delete(void *type);
 
    /**
     * \name Vector and matrix element counts
@@ -571,6 +564,10 @@ private:
     * ralloc context for all glsl_type allocations
     *
     * Set on the first call to \c glsl_type::new.
+    *
+    * Types are created by compiles running on any thread, so this and the
+    * hash tables below are only accessed with the type mutex in
+    * glsl_types.cpp held.
     */
    static void *mem_ctx;
 
@@ -2318,9 +2318,29 @@ extern ir_function_signature *
 _mesa_glsl_find_builtin_function(_mesa_glsl_parse_state *state,
                                  const char *name, exec_list *actual_parameters);
 
+/**
+ * Find the built-in signature taking exactly the types of the ir_variables
+ * in \c parameters, ignoring availability.  Used to re-resolve calls to
+ * built-ins in IR that was not produced by this process.
+ */
+extern ir_function_signature *
+_mesa_glsl_find_exact_builtin_function(const char *name,
+                                       exec_list *parameters);
+
 extern gl_shader *
 _mesa_glsl_get_builtin_function_shader(void);
 
+/**
+ * Built-in functions are generated on demand, so the built-in shader may
+ * change while another thread compiles.  Hold this lock while inspecting
+ * the shader returned by _mesa_glsl_get_builtin_function_shader().
+ */
+extern void
+_mesa_glsl_lock_builtin_functions(void);
+
+extern void
+_mesa_glsl_unlock_builtin_functions(void);
+
 extern void
 _mesa_glsl_release_functions(void);
 
@@ -69,6 +69,10 @@ bool do_common_optimization(exec_list *ir, bool linked,
 			    bool uniform_locations_assigned,
 			    unsigned max_unroll_iterations,
                             const struct gl_shader_compiler_options *options);
+bool do_common_optimization_loop(exec_list *ir, bool linked,
+                                 bool uniform_locations_assigned,
+                                 unsigned max_unroll_iterations,
+                                 const struct gl_shader_compiler_options *options);
 
 bool do_algebraic(exec_list *instructions);
 bool do_constant_folding(exec_list *instructions);
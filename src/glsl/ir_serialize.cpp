@@ -0,0 +1,1306 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file ir_serialize.cpp
+ *
+ * Binary serialization of GLSL IR, see ir_serialize.h.
+ *
+ * Every node starts with its ir_node_type; a NULL node is written as
+ * ir_type_unset.  Variables and function signatures are numbered in the
+ * order they are written, and references to them (dereferences, calls)
+ * are written as those numbers.  A reference to something that hasn't
+ * been written yet makes serialization fail, which never happens for the
+ * IR the front-end produces: GLSL requires declarations before use.
+ *
+ * Expression and texture opcodes are written as their names, so that
+ * adding an opcode doesn't silently change the meaning of stored IR.
+ */
+
+#include "main/macros.h"
+#include "ir.h"
+#include "ir_serialize.h"
+#include "glsl_types.h"
+#include "program/hash_table.h"
+
+#define NULL_MARKER (~0u)
+
+
+memory_writer::memory_writer(void *mem_ctx)
+   : mem_ctx(mem_ctx), data(NULL), size(0), capacity(0), failed(false)
+{
+}
+
+void
+memory_writer::write(const void *src, size_t n)
+{
+   if (this->failed)
+      return;
+
+   if (this->size + n > this->capacity) {
+      size_t capacity = MAX2(MAX2(this->capacity * 2, this->size + n), 4096);
+      char *data = (char *) reralloc_size(this->mem_ctx, this->data, capacity);
+      if (data == NULL) {
+         this->failed = true;
+         return;
+      }
+      this->data = data;
+      this->capacity = capacity;
+   }
+
+   memcpy(this->data + this->size, src, n);
+   this->size += n;
+}
+
+void
+memory_writer::write_uint32(uint32_t value)
+{
+   write(&value, sizeof(value));
+}
+
+void
+memory_writer::write_string(const char *str)
+{
+   if (str == NULL) {
+      write_uint32(NULL_MARKER);
+      return;
+   }
+
+   uint32_t len = strlen(str);
+   write_uint32(len);
+   write(str, len);
+}
+
+
+memory_reader::memory_reader(const void *data, size_t size)
+   : current((const char *) data), end((const char *) data + size),
+     overrun(false)
+{
+}
+
+bool
+memory_reader::read(void *dst, size_t n)
+{
+   if (this->overrun || (size_t) (this->end - this->current) < n) {
+      this->overrun = true;
+      memset(dst, 0, n);
+      return false;
+   }
+
+   memcpy(dst, this->current, n);
+   this->current += n;
+   return true;
+}
+
+uint32_t
+memory_reader::read_uint32()
+{
+   uint32_t value;
+   read(&value, sizeof(value));
+   return value;
+}
+
+char *
+memory_reader::read_string(void *mem_ctx)
+{
+   uint32_t len = read_uint32();
+
+   if (this->overrun || len == NULL_MARKER)
+      return NULL;
+
+   if ((size_t) (this->end - this->current) < len) {
+      this->overrun = true;
+      return NULL;
+   }
+
+   char *str = ralloc_strndup(mem_ctx, this->current, len);
+   this->current += len;
+   return str;
+}
+
+
+void
+serialize_glsl_type(memory_writer *w, const glsl_type *type)
+{
+   if (type == NULL) {
+      w->write_uint32(NULL_MARKER);
+      return;
+   }
+
+   w->write_uint32(type->base_type);
+
+   switch (type->base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_BOOL:
+      w->write_uint32(type->vector_elements);
+      w->write_uint32(type->matrix_columns);
+      break;
+
+   case GLSL_TYPE_ARRAY:
+      serialize_glsl_type(w, type->fields.array);
+      w->write_uint32(type->length);
+      break;
+
+   case GLSL_TYPE_STRUCT:
+   case GLSL_TYPE_INTERFACE: {
+      /* Built-in structures are static instances, which a structural
+       * lookup would not return.
+       */
+      const bool builtin = type->base_type == GLSL_TYPE_STRUCT &&
+         _mesa_glsl_find_builtin_type(type->name) == type;
+
+      w->write_string(type->name);
+      w->write_uint32(builtin);
+      if (builtin)
+         break;
+
+      w->write_uint32(type->interface_packing);
+      w->write_uint32(type->length);
+      for (unsigned i = 0; i < type->length; i++) {
+         const glsl_struct_field *field = &type->fields.structure[i];
+
+         serialize_glsl_type(w, field->type);
+         w->write_string(field->name);
+         w->write_uint32(field->row_major);
+         w->write_uint32(field->location);
+         w->write_uint32(field->interpolation);
+         w->write_uint32(field->centroid);
+         w->write_uint32(field->sample);
+      }
+      break;
+   }
+
+   default:
+      /* Samplers, images, atomic counters and void only exist as
+       * built-in types.
+       */
+      w->write_string(type->name);
+      break;
+   }
+}
+
+
+const glsl_type *
+deserialize_glsl_type(memory_reader *r, bool *error)
+{
+   const uint32_t base_type = r->read_uint32();
+
+   *error = r->overrun;
+   if (r->overrun || base_type == NULL_MARKER)
+      return NULL;
+
+   const glsl_type *type = NULL;
+
+   switch (base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_BOOL: {
+      const unsigned rows = r->read_uint32();
+      const unsigned columns = r->read_uint32();
+
+      type = glsl_type::get_instance(base_type, rows, columns);
+      if (type == glsl_type::error_type)
+         type = NULL;
+      break;
+   }
+
+   case GLSL_TYPE_ARRAY: {
+      const glsl_type *element = deserialize_glsl_type(r, error);
+      const unsigned length = r->read_uint32();
+
+      if (element != NULL && !r->overrun)
+         type = glsl_type::get_array_instance(element, length);
+      break;
+   }
+
+   case GLSL_TYPE_STRUCT:
+   case GLSL_TYPE_INTERFACE: {
+      void *mem_ctx = ralloc_context(NULL);
+      const char *name = r->read_string(mem_ctx);
+      const bool builtin = r->read_uint32();
+
+      if (name == NULL || r->overrun) {
+         /* malformed */
+      } else if (builtin) {
+         type = _mesa_glsl_find_builtin_type(name);
+         if (type != NULL && type->base_type != base_type)
+            type = NULL;
+      } else {
+         const unsigned packing = r->read_uint32();
+         const unsigned length = r->read_uint32();
+         glsl_struct_field *fields = NULL;
+         bool ok = !r->overrun && length <= (size_t) (r->end - r->current);
+
+         if (ok)
+            fields = rzalloc_array(mem_ctx, glsl_struct_field, length);
+
+         for (unsigned i = 0; ok && i < length; i++) {
+            fields[i].type = deserialize_glsl_type(r, error);
+            fields[i].name = r->read_string(mem_ctx);
+            fields[i].row_major = r->read_uint32();
+            fields[i].location = r->read_uint32();
+            fields[i].interpolation = r->read_uint32();
+            fields[i].centroid = r->read_uint32();
+            fields[i].sample = r->read_uint32();
+            ok = fields[i].type != NULL && fields[i].name != NULL &&
+                 !r->overrun;
+         }
+
+         if (ok && base_type == GLSL_TYPE_STRUCT)
+            type = glsl_type::get_record_instance(fields, length, name);
+         else if (ok)
+            type = glsl_type::get_interface_instance(fields, length,
+                                                     (glsl_interface_packing) packing,
+                                                     name);
+      }
+
+      ralloc_free(mem_ctx);
+      break;
+   }
+
+   default: {
+      char *name = r->read_string(NULL);
+
+      if (name != NULL) {
+         type = _mesa_glsl_find_builtin_type(name);
+         if (type != NULL && type->base_type != base_type)
+            type = NULL;
+      }
+      ralloc_free(name);
+      break;
+   }
+   }
+
+   *error = type == NULL || r->overrun;
+   return *error ? NULL : type;
+}
+
+
+namespace {
+
+class ir_serializer {
+public:
+   ir_serializer(memory_writer *w)
+      : w(w), next_id(0), failed(false)
+   {
+      this->ids = hash_table_ctor(0, hash_table_pointer_hash,
+                                  hash_table_pointer_compare);
+   }
+
+   ~ir_serializer()
+   {
+      hash_table_dtor(this->ids);
+   }
+
+   void write_list(exec_list *list);
+   void write_ir(ir_instruction *ir);
+
+   memory_writer *w;
+   struct hash_table *ids;
+   unsigned next_id;
+   bool failed;
+
+private:
+   void add_id(ir_instruction *ir)
+   {
+      /* Stored off by one, so that id 0 isn't confused with "not found". */
+      hash_table_insert(this->ids, (void *) (uintptr_t) ++this->next_id, ir);
+   }
+
+   void write_id(ir_instruction *ir)
+   {
+      uintptr_t id = (uintptr_t) hash_table_find(this->ids, ir);
+      if (id == 0)
+         this->failed = true;
+      this->w->write_uint32(id - 1);
+   }
+
+   void write_type(const glsl_type *type)
+   {
+      serialize_glsl_type(this->w, type);
+   }
+
+   void write_variable(ir_variable *var);
+   void write_function(ir_function *f);
+   void write_call(ir_call *call);
+   void write_constant(ir_constant *c);
+   void write_texture(ir_texture *tex);
+};
+
+
+void
+ir_serializer::write_list(exec_list *list)
+{
+   unsigned count = 0;
+   foreach_list(node, list)
+      count++;
+
+   this->w->write_uint32(count);
+   foreach_list(node, list)
+      write_ir((ir_instruction *) node);
+}
+
+
+void
+ir_serializer::write_variable(ir_variable *var)
+{
+   add_id(var);
+
+   write_type(var->type);
+   this->w->write_string(var->name);
+   this->w->write(&var->data, sizeof(var->data));
+
+   const glsl_type *ifc_type = var->get_interface_type();
+   write_type(ifc_type);
+   if (var->is_interface_instance()) {
+      this->w->write_uint32(var->max_ifc_array_access != NULL);
+      if (var->max_ifc_array_access != NULL)
+         this->w->write(var->max_ifc_array_access,
+                        ifc_type->length * sizeof(unsigned));
+   }
+
+   this->w->write_uint32(var->num_state_slots);
+   if (var->num_state_slots)
+      this->w->write(var->state_slots,
+                     var->num_state_slots * sizeof(var->state_slots[0]));
+
+   this->w->write_string(var->warn_extension);
+   write_ir(var->constant_value);
+   write_ir(var->constant_initializer);
+}
+
+
+void
+ir_serializer::write_function(ir_function *f)
+{
+   this->w->write_string(f->name);
+   write_list(&f->signatures);
+}
+
+
+void
+ir_serializer::write_call(ir_call *call)
+{
+   ir_function_signature *callee = call->callee;
+
+   /* Built-ins live in a shader of their own, so they are looked up again
+    * on load by name and parameter types instead.
+    */
+   this->w->write_uint32(callee->is_builtin());
+   if (callee->is_builtin()) {
+      unsigned count = 0;
+      foreach_list(node, &callee->parameters)
+         count++;
+
+      this->w->write_string(callee->function_name());
+      this->w->write_uint32(count);
+      foreach_list(node, &callee->parameters)
+         write_type(((ir_variable *) node)->type);
+   } else {
+      write_id(callee);
+   }
+
+   write_ir(call->return_deref);
+   write_list(&call->actual_parameters);
+}
+
+
+void
+ir_serializer::write_constant(ir_constant *c)
+{
+   write_type(c->type);
+
+   switch (c->type->base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_BOOL:
+      this->w->write(&c->value, sizeof(c->value));
+      break;
+   case GLSL_TYPE_ARRAY:
+      for (unsigned i = 0; i < c->type->length; i++)
+         write_ir(c->array_elements[i]);
+      break;
+   case GLSL_TYPE_STRUCT:
+      write_list(&c->components);
+      break;
+   default:
+      this->failed = true;
+      break;
+   }
+}
+
+
+void
+ir_serializer::write_texture(ir_texture *tex)
+{
+   this->w->write_string(tex->opcode_string());
+   write_type(tex->type);
+   write_ir(tex->sampler);
+   write_ir(tex->coordinate);
+   write_ir(tex->projector);
+   write_ir(tex->shadow_comparitor);
+   write_ir(tex->offset);
+
+   switch (tex->op) {
+   case ir_tex:
+   case ir_lod:
+   case ir_query_levels:
+      break;
+   case ir_txb:
+      write_ir(tex->lod_info.bias);
+      break;
+   case ir_txl:
+   case ir_txf:
+   case ir_txs:
+      write_ir(tex->lod_info.lod);
+      break;
+   case ir_txf_ms:
+      write_ir(tex->lod_info.sample_index);
+      break;
+   case ir_txd:
+      write_ir(tex->lod_info.grad.dPdx);
+      write_ir(tex->lod_info.grad.dPdy);
+      break;
+   case ir_tg4:
+      write_ir(tex->lod_info.component);
+      break;
+   }
+}
+
+
+void
+ir_serializer::write_ir(ir_instruction *ir)
+{
+   if (ir == NULL) {
+      this->w->write_uint32(ir_type_unset);
+      return;
+   }
+
+   this->w->write_uint32(ir->ir_type);
+
+   switch (ir->ir_type) {
+   case ir_type_variable:
+      write_variable((ir_variable *) ir);
+      break;
+
+   case ir_type_function:
+      write_function((ir_function *) ir);
+      break;
+
+   case ir_type_function_signature: {
+      ir_function_signature *sig = (ir_function_signature *) ir;
+
+      add_id(sig);
+      write_type(sig->return_type);
+      this->w->write_uint32(sig->is_defined);
+      this->w->write_uint32(sig->is_intrinsic);
+      this->w->write_uint32(sig->is_builtin());
+      write_list(&sig->parameters);
+      if (sig->is_builtin()) {
+         /* Only prototypes of built-ins are imported into shaders. */
+         if (sig->is_defined)
+            this->failed = true;
+      } else {
+         write_list(&sig->body);
+      }
+      break;
+   }
+
+   case ir_type_assignment: {
+      ir_assignment *assign = (ir_assignment *) ir;
+
+      write_ir(assign->lhs);
+      write_ir(assign->rhs);
+      write_ir(assign->condition);
+      this->w->write_uint32(assign->write_mask);
+      break;
+   }
+
+   case ir_type_call:
+      write_call((ir_call *) ir);
+      break;
+
+   case ir_type_if: {
+      ir_if *iif = (ir_if *) ir;
+
+      write_ir(iif->condition);
+      write_list(&iif->then_instructions);
+      write_list(&iif->else_instructions);
+      break;
+   }
+
+   case ir_type_loop:
+      write_list(&((ir_loop *) ir)->body_instructions);
+      break;
+
+   case ir_type_return:
+      write_ir(((ir_return *) ir)->value);
+      break;
+
+   case ir_type_discard:
+      write_ir(((ir_discard *) ir)->condition);
+      break;
+
+   case ir_type_loop_jump:
+      this->w->write_uint32(((ir_loop_jump *) ir)->mode);
+      break;
+
+   case ir_type_emit_vertex:
+   case ir_type_end_primitive:
+      break;
+
+   case ir_type_expression: {
+      ir_expression *expr = (ir_expression *) ir;
+
+      this->w->write_string(expr->operator_string());
+      write_type(expr->type);
+      for (unsigned i = 0; i < Elements(expr->operands); i++)
+         write_ir(expr->operands[i]);
+      break;
+   }
+
+   case ir_type_texture:
+      write_texture((ir_texture *) ir);
+      break;
+
+   case ir_type_swizzle: {
+      ir_swizzle *swiz = (ir_swizzle *) ir;
+
+      write_ir(swiz->val);
+      this->w->write_uint32(swiz->mask.x);
+      this->w->write_uint32(swiz->mask.y);
+      this->w->write_uint32(swiz->mask.z);
+      this->w->write_uint32(swiz->mask.w);
+      this->w->write_uint32(swiz->mask.num_components);
+      this->w->write_uint32(swiz->mask.has_duplicates);
+      break;
+   }
+
+   case ir_type_dereference_variable:
+      write_id(((ir_dereference_variable *) ir)->var);
+      break;
+
+   case ir_type_dereference_array: {
+      ir_dereference_array *deref = (ir_dereference_array *) ir;
+
+      write_ir(deref->array);
+      write_ir(deref->array_index);
+      break;
+   }
+
+   case ir_type_dereference_record: {
+      ir_dereference_record *deref = (ir_dereference_record *) ir;
+
+      write_ir(deref->record);
+      this->w->write_string(deref->field);
+      break;
+   }
+
+   case ir_type_constant:
+      write_constant((ir_constant *) ir);
+      break;
+
+   default:
+      this->failed = true;
+      break;
+   }
+}
+
+
+class ir_deserializer {
+public:
+   ir_deserializer(memory_reader *r, void *mem_ctx)
+      : r(r), mem_ctx(mem_ctx), objects(NULL), num_objects(0),
+        max_objects(0), failed(false)
+   {
+      this->tmp_ctx = ralloc_context(NULL);
+   }
+
+   ~ir_deserializer()
+   {
+      ralloc_free(this->tmp_ctx);
+   }
+
+   bool read_list(exec_list *list);
+   ir_instruction *read_ir();
+
+   memory_reader *r;
+   void *mem_ctx;
+
+   /** Temporary allocations, freed with the deserializer. */
+   void *tmp_ctx;
+
+   /** Variables and signatures, indexed by the ids they were written with. */
+   ir_instruction **objects;
+   unsigned num_objects;
+   unsigned max_objects;
+
+   bool failed;
+
+private:
+   /**
+    * Reserve the next id; objects are registered before their contents are
+    * read, in the order the serializer numbered them.
+    */
+   unsigned add_id()
+   {
+      if (this->num_objects == this->max_objects) {
+         unsigned capacity = MAX2(this->max_objects * 2, 16);
+         ir_instruction **objects =
+            reralloc(this->tmp_ctx, this->objects, ir_instruction *, capacity);
+         if (objects == NULL) {
+            this->failed = true;
+            return 0;
+         }
+         this->objects = objects;
+         this->max_objects = capacity;
+      }
+      this->objects[this->num_objects] = NULL;
+      return this->num_objects++;
+   }
+
+   ir_instruction *read_id(ir_node_type type)
+   {
+      uint32_t id = this->r->read_uint32();
+
+      if (id >= this->num_objects || this->objects[id] == NULL ||
+          this->objects[id]->ir_type != type) {
+         this->failed = true;
+         return NULL;
+      }
+      return this->objects[id];
+   }
+
+   const glsl_type *read_type(bool allow_null)
+   {
+      bool error;
+      const glsl_type *type = deserialize_glsl_type(this->r, &error);
+      if (error || (type == NULL && !allow_null))
+         this->failed = true;
+      return type;
+   }
+
+   /** Read an optional rvalue. */
+   ir_rvalue *read_rvalue()
+   {
+      ir_instruction *ir = read_ir();
+      if (ir == NULL)
+         return NULL;
+
+      ir_rvalue *rv = ir->as_rvalue();
+      if (rv == NULL)
+         this->failed = true;
+      return rv;
+   }
+
+   ir_rvalue *read_required_rvalue()
+   {
+      ir_rvalue *rv = read_rvalue();
+      if (rv == NULL)
+         this->failed = true;
+      return rv;
+   }
+
+   ir_dereference *read_dereference()
+   {
+      ir_rvalue *rv = read_required_rvalue();
+      ir_dereference *deref = rv ? rv->as_dereference() : NULL;
+      if (deref == NULL)
+         this->failed = true;
+      return deref;
+   }
+
+   ir_constant *read_constant_or_null()
+   {
+      ir_instruction *ir = read_ir();
+      if (ir == NULL)
+         return NULL;
+
+      ir_constant *c = ir->as_constant();
+      if (c == NULL)
+         this->failed = true;
+      return c;
+   }
+
+   bool ok() const
+   {
+      return !this->failed && !this->r->overrun;
+   }
+
+   ir_variable *read_variable();
+   ir_function *read_function();
+   ir_function_signature *read_signature(ir_function *f);
+   ir_call *read_call();
+   ir_expression *read_expression();
+   ir_texture *read_texture();
+   ir_swizzle *read_swizzle();
+   ir_constant *read_constant();
+};
+
+
+bool
+ir_deserializer::read_list(exec_list *list)
+{
+   const uint32_t count = this->r->read_uint32();
+
+   for (uint32_t i = 0; i < count && ok(); i++) {
+      ir_instruction *ir = read_ir();
+      if (ir == NULL) {
+         this->failed = true;
+         break;
+      }
+      list->push_tail(ir);
+   }
+
+   return ok();
+}
+
+
+ir_variable *
+ir_deserializer::read_variable()
+{
+   const unsigned id = add_id();
+   const glsl_type *type = read_type(false);
+   const char *name = this->r->read_string(this->tmp_ctx);
+   ir_variable::ir_variable_data data;
+
+   this->r->read(&data, sizeof(data));
+   if (!ok())
+      return NULL;
+
+   ir_variable *var =
+      new(this->mem_ctx) ir_variable(type, name, (ir_variable_mode) data.mode);
+   memcpy(&var->data, &data, sizeof(var->data));
+   this->objects[id] = var;
+
+   const glsl_type *ifc_type = read_type(true);
+   if (ifc_type != NULL) {
+      var->init_interface_type(ifc_type);
+      if (var->is_interface_instance() && this->r->read_uint32()) {
+         if (var->max_ifc_array_access == NULL) {
+            this->failed = true;
+            return NULL;
+         }
+         this->r->read(var->max_ifc_array_access,
+                       ifc_type->length * sizeof(unsigned));
+      }
+   }
+
+   var->num_state_slots = this->r->read_uint32();
+   if (var->num_state_slots) {
+      if (var->num_state_slots > (size_t) (this->r->end - this->r->current)) {
+         this->failed = true;
+         return NULL;
+      }
+      var->state_slots = ralloc_array(var, ir_state_slot,
+                                      var->num_state_slots);
+      this->r->read(var->state_slots,
+                    var->num_state_slots * sizeof(var->state_slots[0]));
+   }
+
+   var->warn_extension = this->r->read_string(var);
+   var->constant_value = read_constant_or_null();
+   var->constant_initializer = read_constant_or_null();
+
+   return ok() ? var : NULL;
+}
+
+
+ir_function_signature *
+ir_deserializer::read_signature(ir_function *f)
+{
+   if (this->r->read_uint32() != ir_type_function_signature) {
+      this->failed = true;
+      return NULL;
+   }
+
+   const unsigned id = add_id();
+   const glsl_type *return_type = read_type(false);
+   const bool is_defined = this->r->read_uint32();
+   const bool is_intrinsic = this->r->read_uint32();
+   const bool is_builtin = this->r->read_uint32();
+   exec_list parameters;
+
+   if (!read_list(&parameters))
+      return NULL;
+
+   foreach_list(node, &parameters) {
+      if (((ir_instruction *) node)->as_variable() == NULL) {
+         this->failed = true;
+         return NULL;
+      }
+   }
+
+   ir_function_signature *sig;
+
+   if (is_builtin) {
+      /* Import the prototype from the built-in shader, as
+       * match_function_by_name() does.
+       */
+      ir_function_signature *builtin =
+         _mesa_glsl_find_exact_builtin_function(f->name, &parameters);
+
+      if (builtin == NULL || builtin->return_type != return_type) {
+         this->failed = true;
+         return NULL;
+      }
+
+      sig = builtin->clone_prototype(f, NULL);
+      f->add_signature(sig);
+      this->objects[id] = sig;
+   } else {
+      sig = new(this->mem_ctx) ir_function_signature(return_type);
+      parameters.move_nodes_to(&sig->parameters);
+      sig->is_defined = is_defined;
+      sig->is_intrinsic = is_intrinsic;
+      f->add_signature(sig);
+      this->objects[id] = sig;
+
+      if (!read_list(&sig->body))
+         return NULL;
+   }
+
+   return sig;
+}
+
+
+ir_function *
+ir_deserializer::read_function()
+{
+   const char *name = this->r->read_string(this->tmp_ctx);
+   if (name == NULL || !ok()) {
+      this->failed = true;
+      return NULL;
+   }
+
+   ir_function *f = new(this->mem_ctx) ir_function(name);
+
+   const uint32_t count = this->r->read_uint32();
+   for (uint32_t i = 0; i < count && ok(); i++)
+      read_signature(f);
+
+   return ok() ? f : NULL;
+}
+
+
+ir_call *
+ir_deserializer::read_call()
+{
+   ir_function_signature *callee;
+
+   if (this->r->read_uint32()) {
+      const char *name = this->r->read_string(this->tmp_ctx);
+      const uint32_t count = this->r->read_uint32();
+      exec_list parameters;
+
+      /* Dummy parameters, only used to look up the signature. */
+      for (uint32_t i = 0; i < count && ok(); i++) {
+         const glsl_type *type = read_type(false);
+         if (type != NULL)
+            parameters.push_tail(new(this->tmp_ctx)
+                                 ir_variable(type, NULL, ir_var_function_in));
+      }
+
+      if (name == NULL || !ok()) {
+         this->failed = true;
+         return NULL;
+      }
+
+      callee = _mesa_glsl_find_exact_builtin_function(name, &parameters);
+   } else {
+      callee = (ir_function_signature *) read_id(ir_type_function_signature);
+   }
+
+   ir_dereference_variable *return_deref = NULL;
+   ir_rvalue *ret = read_rvalue();
+   if (ret != NULL) {
+      return_deref = ret->as_dereference_variable();
+      if (return_deref == NULL)
+         this->failed = true;
+   }
+
+   exec_list actual_parameters;
+   read_list(&actual_parameters);
+   foreach_list(node, &actual_parameters) {
+      if (((ir_instruction *) node)->as_rvalue() == NULL)
+         this->failed = true;
+   }
+
+   if (callee == NULL || !ok()) {
+      this->failed = true;
+      return NULL;
+   }
+
+   return new(this->mem_ctx) ir_call(callee, return_deref,
+                                     &actual_parameters);
+}
+
+
+ir_expression *
+ir_deserializer::read_expression()
+{
+   const char *name = this->r->read_string(this->tmp_ctx);
+   const glsl_type *type = read_type(false);
+   ir_rvalue *op[4];
+
+   for (unsigned i = 0; i < Elements(op); i++)
+      op[i] = read_rvalue();
+
+   if (name == NULL || !ok())
+      return NULL;
+
+   const int operation = ir_expression::get_operator(name);
+   if (operation < 0) {
+      this->failed = true;
+      return NULL;
+   }
+
+   ir_expression *expr =
+      new(this->mem_ctx) ir_expression(operation, type,
+                                       op[0], op[1], op[2], op[3]);
+
+   for (unsigned i = 0; i < expr->get_num_operands(); i++) {
+      if (expr->operands[i] == NULL) {
+         this->failed = true;
+         return NULL;
+      }
+   }
+
+   return expr;
+}
+
+
+ir_texture *
+ir_deserializer::read_texture()
+{
+   const char *name = this->r->read_string(this->tmp_ctx);
+   if (name == NULL || !ok()) {
+      this->failed = true;
+      return NULL;
+   }
+
+   const int op = ir_texture::get_opcode(name);
+   if (op < 0) {
+      this->failed = true;
+      return NULL;
+   }
+
+   ir_texture *tex = new(this->mem_ctx) ir_texture((ir_texture_opcode) op);
+   tex->type = read_type(false);
+   tex->sampler = read_dereference();
+   tex->coordinate = read_rvalue();
+   tex->projector = read_rvalue();
+   tex->shadow_comparitor = read_rvalue();
+   tex->offset = read_rvalue();
+
+   switch (tex->op) {
+   case ir_tex:
+   case ir_lod:
+   case ir_query_levels:
+      break;
+   case ir_txb:
+      tex->lod_info.bias = read_required_rvalue();
+      break;
+   case ir_txl:
+   case ir_txf:
+   case ir_txs:
+      tex->lod_info.lod = read_required_rvalue();
+      break;
+   case ir_txf_ms:
+      tex->lod_info.sample_index = read_required_rvalue();
+      break;
+   case ir_txd:
+      tex->lod_info.grad.dPdx = read_required_rvalue();
+      tex->lod_info.grad.dPdy = read_required_rvalue();
+      break;
+   case ir_tg4:
+      tex->lod_info.component = read_required_rvalue();
+      break;
+   }
+
+   return ok() ? tex : NULL;
+}
+
+
+ir_swizzle *
+ir_deserializer::read_swizzle()
+{
+   ir_rvalue *val = read_required_rvalue();
+   ir_swizzle_mask mask;
+
+   memset(&mask, 0, sizeof(mask));
+   mask.x = this->r->read_uint32();
+   mask.y = this->r->read_uint32();
+   mask.z = this->r->read_uint32();
+   mask.w = this->r->read_uint32();
+   mask.num_components = this->r->read_uint32();
+   mask.has_duplicates = this->r->read_uint32();
+
+   if (!ok() || mask.num_components < 1 || mask.num_components > 4) {
+      this->failed = true;
+      return NULL;
+   }
+
+   return new(this->mem_ctx) ir_swizzle(val, mask);
+}
+
+
+ir_constant *
+ir_deserializer::read_constant()
+{
+   const glsl_type *type = read_type(false);
+   if (!ok())
+      return NULL;
+
+   switch (type->base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_BOOL: {
+      ir_constant_data data;
+
+      if (!this->r->read(&data, sizeof(data)))
+         return NULL;
+      return new(this->mem_ctx) ir_constant(type, &data);
+   }
+
+   case GLSL_TYPE_ARRAY:
+   case GLSL_TYPE_STRUCT: {
+      exec_list values;
+
+      if (type->base_type == GLSL_TYPE_ARRAY) {
+         for (unsigned i = 0; i < type->length && ok(); i++) {
+            ir_constant *c = read_constant_or_null();
+            if (c == NULL || c->type != type->fields.array)
+               this->failed = true;
+            else
+               values.push_tail(c);
+         }
+      } else {
+         read_list(&values);
+
+         unsigned i = 0;
+         foreach_list(node, &values) {
+            ir_constant *c = ((ir_instruction *) node)->as_constant();
+            if (c == NULL || i >= type->length ||
+                c->type != type->fields.structure[i].type)
+               this->failed = true;
+            i++;
+         }
+         if (i != type->length)
+            this->failed = true;
+      }
+
+      if (!ok())
+         return NULL;
+      return new(this->mem_ctx) ir_constant(type, &values);
+   }
+
+   default:
+      this->failed = true;
+      return NULL;
+   }
+}
+
+
+ir_instruction *
+ir_deserializer::read_ir()
+{
+   const uint32_t ir_type = this->r->read_uint32();
+
+   if (!ok() || ir_type == ir_type_unset)
+      return NULL;
+
+   ir_instruction *ir = NULL;
+
+   switch (ir_type) {
+   case ir_type_variable:
+      ir = read_variable();
+      break;
+
+   case ir_type_function:
+      ir = read_function();
+      break;
+
+   case ir_type_assignment: {
+      ir_dereference *lhs = read_dereference();
+      ir_rvalue *rhs = read_required_rvalue();
+      ir_rvalue *condition = read_rvalue();
+      const unsigned write_mask = this->r->read_uint32();
+
+      if (!ok())
+         return NULL;
+
+      /* The constructor asserts this. */
+      if ((lhs->type->is_scalar() || lhs->type->is_vector()) &&
+          _mesa_bitcount(write_mask & 0xf) != rhs->type->vector_elements) {
+         this->failed = true;
+         return NULL;
+      }
+
+      ir = new(this->mem_ctx) ir_assignment(lhs, rhs, condition, write_mask);
+      break;
+   }
+
+   case ir_type_call:
+      ir = read_call();
+      break;
+
+   case ir_type_if: {
+      ir_rvalue *condition = read_required_rvalue();
+      if (!ok())
+         return NULL;
+
+      ir_if *iif = new(this->mem_ctx) ir_if(condition);
+      read_list(&iif->then_instructions);
+      read_list(&iif->else_instructions);
+      ir = iif;
+      break;
+   }
+
+   case ir_type_loop: {
+      ir_loop *loop = new(this->mem_ctx) ir_loop();
+      read_list(&loop->body_instructions);
+      ir = loop;
+      break;
+   }
+
+   case ir_type_return: {
+      ir_rvalue *value = read_rvalue();
+      ir = ok() ? new(this->mem_ctx) ir_return(value) : NULL;
+      break;
+   }
+
+   case ir_type_discard: {
+      ir_rvalue *condition = read_rvalue();
+      ir = ok() ? new(this->mem_ctx) ir_discard(condition) : NULL;
+      break;
+   }
+
+   case ir_type_loop_jump: {
+      const uint32_t mode = this->r->read_uint32();
+      if (mode != ir_loop_jump::jump_break &&
+          mode != ir_loop_jump::jump_continue) {
+         this->failed = true;
+         return NULL;
+      }
+      ir = new(this->mem_ctx) ir_loop_jump((ir_loop_jump::jump_mode) mode);
+      break;
+   }
+
+   case ir_type_emit_vertex:
+      ir = new(this->mem_ctx) ir_emit_vertex();
+      break;
+
+   case ir_type_end_primitive:
+      ir = new(this->mem_ctx) ir_end_primitive();
+      break;
+
+   case ir_type_expression:
+      ir = read_expression();
+      break;
+
+   case ir_type_texture:
+      ir = read_texture();
+      break;
+
+   case ir_type_swizzle:
+      ir = read_swizzle();
+      break;
+
+   case ir_type_dereference_variable: {
+      ir_variable *var = (ir_variable *) read_id(ir_type_variable);
+      ir = var ? new(this->mem_ctx) ir_dereference_variable(var) : NULL;
+      break;
+   }
+
+   case ir_type_dereference_array: {
+      ir_rvalue *array = read_required_rvalue();
+      ir_rvalue *index = read_required_rvalue();
+
+      if (!ok())
+         return NULL;
+
+      if (!array->type->is_array() && !array->type->is_matrix() &&
+          !array->type->is_vector()) {
+         this->failed = true;
+         return NULL;
+      }
+
+      ir = new(this->mem_ctx) ir_dereference_array(array, index);
+      break;
+   }
+
+   case ir_type_dereference_record: {
+      ir_rvalue *record = read_required_rvalue();
+      const char *field = this->r->read_string(this->tmp_ctx);
+
+      if (!ok() || field == NULL ||
+          (!record->type->is_record() && !record->type->is_interface()) ||
+          record->type->field_type(field)->is_error()) {
+         this->failed = true;
+         return NULL;
+      }
+
+      ir = new(this->mem_ctx) ir_dereference_record(record, field);
+      break;
+   }
+
+   case ir_type_constant:
+      ir = read_constant();
+      break;
+
+   default:
+      break;
+   }
+
+   if (ir == NULL)
+      this->failed = true;
+
+   return ok() ? ir : NULL;
+}
+
+} /* anonymous namespace */
+
+
+bool
+serialize_ir(memory_writer *writer, exec_list *instructions)
+{
+   ir_serializer s(writer);
+
+   s.write_list(instructions);
+   return !s.failed && !writer->failed;
+}
+
+
+bool
+deserialize_ir(memory_reader *reader, void *mem_ctx, exec_list *instructions)
+{
+   ir_deserializer d(reader, mem_ctx);
+
+   return d.read_list(instructions);
+}
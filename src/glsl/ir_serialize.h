@@ -0,0 +1,114 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef IR_SERIALIZE_H
+#define IR_SERIALIZE_H
+
+/**
+ * \file ir_serialize.h
+ *
+ * Binary serialization of GLSL IR.
+ *
+ * This is used to keep compiled shaders across processes.  The format is
+ * only meant to be read back by the same build of Mesa: it contains raw
+ * structure contents in host byte order, so anything that stores it must
+ * also record which build wrote it.
+ *
+ * Types are written structurally and resolved to the same glsl_type
+ * instances on load, and calls to built-in functions are re-resolved by
+ * name and parameter types, so deserialized IR can be linked with IR
+ * compiled in the current process.
+ */
+
+#include "ir.h"
+
+/**
+ * A growable, ralloc-allocated buffer that data is appended to.
+ */
+struct memory_writer {
+   memory_writer(void *mem_ctx);
+
+   void write(const void *src, size_t size);
+   void write_uint32(uint32_t value);
+
+   /** Write a string; NULL is allowed. */
+   void write_string(const char *str);
+
+   void *mem_ctx;
+   char *data;
+   size_t size;
+   size_t capacity;
+
+   /** Set when growing the buffer failed; later writes are dropped. */
+   bool failed;
+};
+
+/**
+ * Reads data written by memory_writer.  Reading past the end sets
+ * \c overrun and returns zeros.
+ */
+struct memory_reader {
+   memory_reader(const void *data, size_t size);
+
+   bool read(void *dst, size_t size);
+   uint32_t read_uint32();
+
+   /** Read a string into \c mem_ctx; returns NULL for a NULL string. */
+   char *read_string(void *mem_ctx);
+
+   const char *current;
+   const char *end;
+   bool overrun;
+};
+
+/**
+ * Serialize a list of IR instructions.
+ *
+ * \return false if the IR can't be serialized (e.g. it refers to variables
+ *         or functions outside of the list); nothing useful has been
+ *         written in that case.
+ */
+bool
+serialize_ir(memory_writer *writer, exec_list *instructions);
+
+/**
+ * Read back a list of IR instructions written by serialize_ir().
+ *
+ * \return false if the data is malformed; \c instructions may then hold a
+ *         partial list, which the caller should free.
+ */
+bool
+deserialize_ir(memory_reader *reader, void *mem_ctx, exec_list *instructions);
+
+void
+serialize_glsl_type(memory_writer *writer, const glsl_type *type);
+
+/**
+ * \return the type, or NULL if a NULL type was written or the data is
+ *         malformed (\c *error tells them apart).
+ */
+const glsl_type *
+deserialize_glsl_type(memory_reader *reader, bool *error);
+
+#endif /* IR_SERIALIZE_H */
@@ -1497,7 +1497,9 @@ link_intrastage_shaders(void *mem_ctx,
       memcpy(linking_shaders, shader_list, num_shaders * sizeof(gl_shader *));
       linking_shaders[num_shaders] = _mesa_glsl_get_builtin_function_shader();
 
+      _mesa_glsl_lock_builtin_functions();
       ok = link_function_calls(prog, linked, linking_shaders, num_shaders + 1);
+      _mesa_glsl_unlock_builtin_functions();
 
       free(linking_shaders);
    } else {
@@ -2280,8 +2282,8 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
 
       unsigned max_unroll = ctx->ShaderCompilerOptions[i].MaxUnrollIterations;
 
-      while (do_common_optimization(prog->_LinkedShaders[i]->ir, true, false, max_unroll, &ctx->ShaderCompilerOptions[i]))
-	 ;
+      do_common_optimization_loop(prog->_LinkedShaders[i]->ir, true, false,
+                                  max_unroll, &ctx->ShaderCompilerOptions[i]);
    }
 
    /* Mark all generic shader inputs and outputs as unpaired. */
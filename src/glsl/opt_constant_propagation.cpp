@@ -93,7 +93,7 @@ public:
    {
       progress = false;
       killed_all = false;
-      mem_ctx = ralloc_context(0);
+      mem_ctx = ralloc_arena_context(NULL);
       this->acp = new(mem_ctx) exec_list;
       this->kills = new(mem_ctx) exec_list;
    }
@@ -73,7 +73,7 @@ public:
    ir_copy_propagation_visitor()
    {
       progress = false;
-      mem_ctx = ralloc_context(0);
+      mem_ctx = ralloc_arena_context(NULL);
       this->acp = new(mem_ctx) exec_list;
       this->kills = new(mem_ctx) exec_list;
    }
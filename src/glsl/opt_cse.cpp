@@ -94,7 +94,7 @@ public:
       : validate_instructions(validate_instructions)
    {
       progress = false;
-      mem_ctx = ralloc_context(NULL);
+      mem_ctx = ralloc_arena_context(NULL);
       this->ae = new(mem_ctx) exec_list;
    }
    ~cse_visitor()
@@ -68,12 +68,64 @@ struct ralloc_header
    struct ralloc_header *next;
 
    void (*destructor)(void *);
+
+   /**
+    * The arena children of this block are allocated out of, or NULL.
+    *
+    * This is set both for the context returned by ralloc_arena_context(),
+    * which owns the arena, and for every block allocated out of the arena.
+    */
+   struct ralloc_arena *arena;
 };
 
 typedef struct ralloc_header ralloc_header;
 
+/** Size of the slabs an arena allocates its blocks from. */
+#define RALLOC_SLAB_SIZE (32 * 1024)
+
+struct ralloc_slab
+{
+   struct ralloc_slab *next;
+};
+
+/* Keep the blocks handed out of a slab 8-byte aligned. */
+#define SLAB_HEADER_SIZE ((sizeof(struct ralloc_slab) + 7) & ~(size_t) 7)
+
+struct ralloc_arena
+{
+   /** The context created by ralloc_arena_context(), or NULL once freed. */
+   ralloc_header *owner;
+
+   /**
+    * Number of references on the arena: one from the owner, plus one for
+    * each block allocated out of the arena whose parent is outside of it
+    * (for example, because it was stolen into another context).
+    */
+   unsigned refs;
+
+   /** All slabs allocated so far, so they can be freed together. */
+   struct ralloc_slab *slabs;
+
+   /** Free space at the end of the current slab. */
+   char *next;
+   size_t left;
+};
+
+/**
+ * Blocks allocated out of an arena are preceded by their size, so that
+ * reralloc knows how much to copy.
+ */
+struct arena_block_prefix
+{
+   size_t size;
+};
+
+#define ARENA_PREFIX_SIZE ((sizeof(struct arena_block_prefix) + 7) & ~(size_t) 7)
+
 static void unlink_block(ralloc_header *info);
 static void unsafe_free(ralloc_header *info);
+static ralloc_header *arena_alloc_block(struct ralloc_arena *arena,
+                                        size_t size);
 
 static ralloc_header *
 get_header(const void *ptr)
@@ -108,19 +160,56 @@ ralloc_context(const void *ctx)
 }
 
 void *
-ralloc_size(const void *ctx, size_t size)
+ralloc_arena_context(const void *ctx)
 {
-   void *block = calloc(1, size + sizeof(ralloc_header));
+   struct ralloc_arena *arena = calloc(1, sizeof(struct ralloc_arena));
    ralloc_header *info;
    ralloc_header *parent;
 
-   if (unlikely(block == NULL))
+   if (unlikely(arena == NULL))
+      return NULL;
+
+   /* The owner itself is allocated normally, even if ctx belongs to another
+    * arena, so that it can be identified by arena->owner.
+    */
+   info = calloc(1, sizeof(ralloc_header));
+   if (unlikely(info == NULL)) {
+      free(arena);
       return NULL;
-   info = (ralloc_header *) block;
+   }
    parent = ctx != NULL ? get_header(ctx) : NULL;
 
    add_child(parent, info);
 
+#ifdef DEBUG
+   info->canary = CANARY;
+#endif
+
+   info->arena = arena;
+   arena->owner = info;
+   arena->refs = 1;
+
+   return PTR_FROM_HEADER(info);
+}
+
+void *
+ralloc_size(const void *ctx, size_t size)
+{
+   ralloc_header *info;
+   ralloc_header *parent;
+
+   parent = ctx != NULL ? get_header(ctx) : NULL;
+
+   if (parent != NULL && parent->arena != NULL)
+      info = arena_alloc_block(parent->arena, size);
+   else
+      info = (ralloc_header *) calloc(1, size + sizeof(ralloc_header));
+
+   if (unlikely(info == NULL))
+      return NULL;
+
+   add_child(parent, info);
+
 #ifdef DEBUG
    info->canary = CANARY;
 #endif
@@ -137,6 +226,101 @@ rzalloc_size(const void *ctx, size_t size)
    return ptr;
 }
 
+/**
+ * Whether \p info was allocated out of an arena (as opposed to owning it).
+ */
+static bool
+in_arena(const ralloc_header *info)
+{
+   return info->arena != NULL && info->arena->owner != info;
+}
+
+/**
+ * Whether \p info, if it were a child of \p parent, would hold a reference
+ * on the arena it was allocated out of.
+ */
+static bool
+is_arena_root(const ralloc_header *info, const ralloc_header *parent)
+{
+   return in_arena(info) && (parent == NULL || parent->arena != info->arena);
+}
+
+static ralloc_header *
+arena_alloc_block(struct ralloc_arena *arena, size_t size)
+{
+   struct arena_block_prefix *prefix;
+   ralloc_header *info;
+   size_t block_size;
+   char *ptr;
+
+   block_size = ARENA_PREFIX_SIZE + sizeof(ralloc_header) + size;
+   block_size = (block_size + 7) & ~(size_t) 7;
+
+   if (block_size > arena->left) {
+      struct ralloc_slab *slab;
+
+      if (block_size > RALLOC_SLAB_SIZE / 4) {
+         /* Give large blocks a slab of their own rather than wasting the
+          * remainder of the current one.
+          */
+         slab = calloc(1, SLAB_HEADER_SIZE + block_size);
+         if (unlikely(slab == NULL))
+            return NULL;
+
+         slab->next = arena->slabs;
+         arena->slabs = slab;
+         ptr = (char *) slab + SLAB_HEADER_SIZE;
+         goto done;
+      }
+
+      slab = calloc(1, SLAB_HEADER_SIZE + RALLOC_SLAB_SIZE);
+      if (unlikely(slab == NULL))
+         return NULL;
+
+      slab->next = arena->slabs;
+      arena->slabs = slab;
+      arena->next = (char *) slab + SLAB_HEADER_SIZE;
+      arena->left = RALLOC_SLAB_SIZE;
+   }
+
+   /* Slabs are zeroed and blocks are never reused, so no need to clear. */
+   ptr = arena->next;
+   arena->next += block_size;
+   arena->left -= block_size;
+
+done:
+   prefix = (struct arena_block_prefix *) ptr;
+   prefix->size = size;
+
+   info = (ralloc_header *) (ptr + ARENA_PREFIX_SIZE);
+   info->arena = arena;
+   return info;
+}
+
+static size_t
+arena_block_size(const ralloc_header *info)
+{
+   const struct arena_block_prefix *prefix = (const struct arena_block_prefix *)
+      ((const char *) info - ARENA_PREFIX_SIZE);
+   return prefix->size;
+}
+
+static void
+arena_unref(struct ralloc_arena *arena)
+{
+   struct ralloc_slab *slab, *next;
+
+   assert(arena->refs > 0);
+   if (--arena->refs > 0)
+      return;
+
+   for (slab = arena->slabs; slab != NULL; slab = next) {
+      next = slab->next;
+      free(slab);
+   }
+   free(arena);
+}
+
 /* helper function - assumes ptr != NULL */
 static void *
 resize(void *ptr, size_t size)
@@ -144,10 +328,28 @@ resize(void *ptr, size_t size)
    ralloc_header *child, *old, *info;
 
    old = get_header(ptr);
-   info = realloc(old, size + sizeof(ralloc_header));
 
-   if (info == NULL)
-      return NULL;
+   if (in_arena(old)) {
+      /* Arena blocks can't grow in place; copy to a new block and leave the
+       * old one to be reclaimed with the arena.
+       */
+      size_t old_size = arena_block_size(old);
+
+      info = arena_alloc_block(old->arena, size);
+      if (info == NULL)
+         return NULL;
+
+      memcpy(info, old, sizeof(ralloc_header) +
+             (old_size < size ? old_size : size));
+   } else {
+      info = realloc(old, size + sizeof(ralloc_header));
+
+      if (info == NULL)
+         return NULL;
+
+      if (info->arena != NULL && info->arena->owner == old)
+         info->arena->owner = info;
+   }
 
    /* Update parent and sibling's links to the reallocated node. */
    if (info != old && info->parent != NULL) {
@@ -214,6 +416,13 @@ ralloc_free(void *ptr)
       return;
 
    info = get_header(ptr);
+
+   /* Once unlinked, an arena block holds a reference on its arena until
+    * unsafe_free() drops it.
+    */
+   if (in_arena(info) && !is_arena_root(info, info->parent))
+      info->arena->refs++;
+
    unlink_block(info);
    unsafe_free(info);
 }
@@ -252,7 +461,19 @@ unsafe_free(ralloc_header *info)
    if (info->destructor != NULL)
       info->destructor(PTR_FROM_HEADER(info));
 
-   free(info);
+   if (in_arena(info)) {
+      /* The memory is released along with the rest of the arena. */
+      if (is_arena_root(info, info->parent))
+         arena_unref(info->arena);
+   } else if (info->arena != NULL) {
+      struct ralloc_arena *arena = info->arena;
+
+      arena->owner = NULL;
+      free(info);
+      arena_unref(arena);
+   } else {
+      free(info);
+   }
 }
 
 void
@@ -266,6 +487,16 @@ ralloc_steal(const void *new_ctx, void *ptr)
    info = get_header(ptr);
    parent = get_header(new_ctx);
 
+   if (in_arena(info)) {
+      bool was_root = is_arena_root(info, info->parent);
+      bool is_root = is_arena_root(info, parent);
+
+      if (is_root && !was_root)
+         info->arena->refs++;
+      else if (was_root && !is_root)
+         arena_unref(info->arena);
+   }
+
    unlink_block(info);
 
    add_child(parent, info);
@@ -91,6 +91,22 @@ extern "C" {
  */
 void *ralloc_context(const void *ctx);
 
+/**
+ * Allocate a new arena-backed ralloc context.
+ *
+ * All memory allocated out of the returned context, or out of any of its
+ * descendants, is carved sequentially out of large slabs instead of being
+ * allocated with a separate \c malloc each.  Freeing individual blocks only
+ * runs their destructors; the slabs are released all at once, which makes
+ * this a good fit for large numbers of short-lived, tiny allocations such as
+ * the bookkeeping of an optimization pass.
+ *
+ * The usual ralloc semantics still apply: blocks may be stolen out of the
+ * arena with \c ralloc_steal, in which case the slabs are kept alive until
+ * those blocks have been freed as well.
+ */
+void *ralloc_arena_context(const void *ctx);
+
 /**
  * Allocate memory chained off of the given context.
  *
@@ -0,0 +1,638 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file shader_cache.cpp
+ *
+ * Cache of compiled shaders, see shader_cache.h.
+ *
+ * The cache lives for the whole process and is shared by all contexts.
+ * Everything the front-end reads from the context is part of the key, so
+ * contexts with different versions, extensions or limits never share
+ * entries.  It is a small LRU list; the source is compared in full, the
+ * checksum only serves to reject most candidates quickly.
+ *
+ * When MESA_GLSL_CACHE_DIR names a directory, entries are also written
+ * there with ir_serialize.h, so later processes can skip the front-end too.
+ * Each entry is one file, named after a hash of its identifier (a header
+ * describing this build, the key and the source).  The identifier is
+ * stored at the start of the file and compared in full on lookup, so hash
+ * collisions and files written by other builds are treated as misses.
+ * Files are written under a temporary name and renamed into place.
+ */
+
+#include <stdio.h>
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "main/core.h"
+#include "main/imports.h"
+#include "glsl_symbol_table.h"
+#include "main/hash_table.h"
+#include "ir.h"
+#include "ir_serialize.h"
+#include "list.h"
+#include "ralloc.h"
+#include "shader_cache.h"
+
+/** Maximum number of compiled shaders kept around in memory. */
+#define SHADER_CACHE_SIZE 64
+
+/**
+ * Bump when the layout of cache files changes in a way the checks in
+ * disk_cache_header don't catch.
+ */
+#define SHADER_CACHE_MAGIC "GLSLIR01"
+
+namespace {
+
+/**
+ * Everything besides the source that influences the result of a compile.
+ */
+struct shader_cache_key {
+   gl_api API;
+   GLuint Version;
+   gl_shader_stage Stage;
+   struct gl_extensions Extensions;
+   struct gl_constants Const;
+   struct gl_shader_compiler_options Options;
+};
+
+struct shader_cache_entry {
+   struct exec_node link;
+
+   struct shader_cache_key key;
+   GLuint checksum;
+   char *source;
+
+   /** IR after the compile-time optimizations, owned by the entry. */
+   exec_list *ir;
+
+   char *info_log;
+   unsigned version;
+   GLboolean is_es;
+   bool uses_builtin_functions;
+
+   struct gl_uniform_block *uniform_blocks;
+   unsigned num_uniform_blocks;
+
+   /** Layout qualifier state from set_shader_inout_layout(). */
+   GLint vertices_out;
+   GLenum input_type;
+   GLenum output_type;
+   unsigned local_size[3];
+};
+
+/**
+ * Start of each cache file, followed by the key, the source and the
+ * payload.  Everything up to the payload is the entry's identifier.
+ */
+struct disk_cache_header {
+   char magic[8];
+   char mesa_version[32];
+   uint32_t pointer_size;
+   uint32_t variable_data_size;
+   uint32_t key_size;
+   uint32_t source_size;
+};
+
+struct disk_cache_trailer {
+   uint32_t payload_size;
+   uint32_t payload_hash;
+};
+
+} /* anonymous namespace */
+
+static exec_list cache;
+static unsigned cache_size;
+_glthread_DECLARE_STATIC_MUTEX(cache_lock);
+
+
+static void
+make_key(struct shader_cache_key *key, const struct gl_context *ctx,
+         gl_shader_stage stage)
+{
+   /* The key is compared with memcmp(), so make sure padding is zero. */
+   memset(key, 0, sizeof *key);
+
+   key->API = ctx->API;
+   key->Version = ctx->Version;
+   key->Stage = stage;
+   memcpy(&key->Extensions, &ctx->Extensions, sizeof key->Extensions);
+   memcpy(&key->Const, &ctx->Const, sizeof key->Const);
+   memcpy(&key->Options, &ctx->ShaderCompilerOptions[stage],
+          sizeof key->Options);
+
+   /* The extension string is per-context, but derived from the flags. */
+   key->Extensions.String = NULL;
+   key->Extensions.Count = 0;
+}
+
+
+/**
+ * Copy an array of uniform blocks, including the names they point to.
+ */
+static struct gl_uniform_block *
+copy_uniform_blocks(void *mem_ctx, const struct gl_uniform_block *blocks,
+                    unsigned num_blocks)
+{
+   if (num_blocks == 0)
+      return NULL;
+
+   struct gl_uniform_block *copy =
+      ralloc_array(mem_ctx, struct gl_uniform_block, num_blocks);
+
+   memcpy(copy, blocks, sizeof(*copy) * num_blocks);
+
+   for (unsigned i = 0; i < num_blocks; i++) {
+      copy[i].Name = ralloc_strdup(copy, blocks[i].Name);
+      copy[i].Uniforms = ralloc_array(copy, struct gl_uniform_buffer_variable,
+                                      blocks[i].NumUniforms);
+      memcpy(copy[i].Uniforms, blocks[i].Uniforms,
+             sizeof(*copy[i].Uniforms) * blocks[i].NumUniforms);
+
+      for (unsigned j = 0; j < blocks[i].NumUniforms; j++) {
+         struct gl_uniform_buffer_variable *ubo_var = &copy[i].Uniforms[j];
+
+         if (ubo_var->Name == ubo_var->IndexName) {
+            ubo_var->Name = ralloc_strdup(copy, ubo_var->Name);
+            ubo_var->IndexName = ubo_var->Name;
+         } else {
+            ubo_var->Name = ralloc_strdup(copy, ubo_var->Name);
+            ubo_var->IndexName = ralloc_strdup(copy, ubo_var->IndexName);
+         }
+      }
+   }
+
+   return copy;
+}
+
+
+/**
+ * Fill in \c shader from a cache entry, as _mesa_glsl_compile_shader() does.
+ */
+static void
+restore_shader(struct gl_shader *shader, const shader_cache_entry *entry)
+{
+   ralloc_free(shader->ir);
+   shader->ir = new(shader) exec_list;
+   clone_ir_list(shader->ir, shader->ir, entry->ir);
+
+   /* The compile-time symbol table is only used to look up global functions
+    * and variables, so rebuild it from the IR like the linker does.
+    */
+   shader->symbols = new(shader) glsl_symbol_table;
+   foreach_list(node, shader->ir) {
+      ir_instruction *const inst = (ir_instruction *) node;
+      ir_variable *var;
+      ir_function *func;
+
+      if ((func = inst->as_function()) != NULL) {
+         shader->symbols->add_function(func);
+      } else if ((var = inst->as_variable()) != NULL) {
+         shader->symbols->add_variable(var);
+      }
+   }
+
+   if (shader->InfoLog)
+      ralloc_free(shader->InfoLog);
+
+   shader->CompileStatus = GL_TRUE;
+   shader->InfoLog = ralloc_strdup(shader, entry->info_log);
+   shader->Version = entry->version;
+   shader->IsES = entry->is_es;
+   shader->uses_builtin_functions = entry->uses_builtin_functions;
+
+   if (shader->UniformBlocks)
+      ralloc_free(shader->UniformBlocks);
+   shader->NumUniformBlocks = entry->num_uniform_blocks;
+   shader->UniformBlocks = copy_uniform_blocks(shader,
+                                               entry->uniform_blocks,
+                                               entry->num_uniform_blocks);
+
+   shader->Geom.VerticesOut = entry->vertices_out;
+   shader->Geom.InputType = entry->input_type;
+   shader->Geom.OutputType = entry->output_type;
+   for (int i = 0; i < 3; i++)
+      shader->Comp.LocalSize[i] = entry->local_size[i];
+}
+
+
+/**
+ * Add an entry to the front of the in-memory cache, evicting the least
+ * recently used one if the cache is full.
+ */
+static void
+add_entry(shader_cache_entry *entry)
+{
+   _glthread_LOCK_MUTEX(cache_lock);
+
+   cache.push_head(&entry->link);
+   if (++cache_size > SHADER_CACHE_SIZE) {
+      shader_cache_entry *last =
+         exec_node_data(shader_cache_entry, cache.get_tail(), link);
+      last->link.remove();
+      ralloc_free(last);
+      cache_size--;
+   }
+
+   _glthread_UNLOCK_MUTEX(cache_lock);
+}
+
+
+static const char *
+disk_cache_dir(void)
+{
+   const char *dir = getenv("MESA_GLSL_CACHE_DIR");
+   return dir && dir[0] ? dir : NULL;
+}
+
+
+/**
+ * Build the identifier of an entry: header, key and source.
+ */
+static char *
+make_disk_id(void *mem_ctx, const struct shader_cache_key *key,
+             const char *source, size_t *size)
+{
+   const size_t source_size = strlen(source);
+   struct disk_cache_header header;
+
+   memset(&header, 0, sizeof header);
+   memcpy(header.magic, SHADER_CACHE_MAGIC, sizeof header.magic);
+#ifdef PACKAGE_VERSION
+   snprintf(header.mesa_version, sizeof header.mesa_version,
+            "%s", PACKAGE_VERSION);
+#endif
+   header.pointer_size = sizeof(void *);
+   header.variable_data_size = sizeof(ir_variable::ir_variable_data);
+   header.key_size = sizeof *key;
+   header.source_size = source_size;
+
+   *size = sizeof header + sizeof *key + source_size;
+
+   char *id = (char *) ralloc_size(mem_ctx, *size);
+   if (id == NULL)
+      return NULL;
+
+   memcpy(id, &header, sizeof header);
+   memcpy(id + sizeof header, key, sizeof *key);
+   memcpy(id + sizeof header + sizeof *key, source, source_size);
+   return id;
+}
+
+
+static char *
+make_disk_filename(void *mem_ctx, const char *id, size_t id_size)
+{
+   return ralloc_asprintf(mem_ctx, "%s/%08x.glsl", disk_cache_dir(),
+                          _mesa_hash_data(id, id_size));
+}
+
+
+/**
+ * Serialize everything restore_shader() needs from an entry.
+ */
+static bool
+serialize_entry(memory_writer *w, const shader_cache_entry *entry)
+{
+   w->write_string(entry->info_log);
+   w->write_uint32(entry->version);
+   w->write_uint32(entry->is_es);
+   w->write_uint32(entry->uses_builtin_functions);
+   w->write_uint32(entry->vertices_out);
+   w->write_uint32(entry->input_type);
+   w->write_uint32(entry->output_type);
+   for (int i = 0; i < 3; i++)
+      w->write_uint32(entry->local_size[i]);
+
+   w->write_uint32(entry->num_uniform_blocks);
+   for (unsigned i = 0; i < entry->num_uniform_blocks; i++) {
+      const struct gl_uniform_block *block = &entry->uniform_blocks[i];
+
+      w->write_string(block->Name);
+      w->write_uint32(block->Binding);
+      w->write_uint32(block->UniformBufferSize);
+      w->write_uint32(block->_Packing);
+      w->write_uint32(block->NumUniforms);
+      for (unsigned j = 0; j < block->NumUniforms; j++) {
+         const struct gl_uniform_buffer_variable *ubo_var =
+            &block->Uniforms[j];
+
+         w->write_string(ubo_var->Name);
+         w->write_uint32(ubo_var->IndexName == ubo_var->Name);
+         if (ubo_var->IndexName != ubo_var->Name)
+            w->write_string(ubo_var->IndexName);
+         serialize_glsl_type(w, ubo_var->Type);
+         w->write_uint32(ubo_var->Offset);
+         w->write_uint32(ubo_var->RowMajor);
+      }
+   }
+
+   return serialize_ir(w, entry->ir) && !w->failed;
+}
+
+
+static bool
+deserialize_entry(memory_reader *r, shader_cache_entry *entry)
+{
+   bool error = false;
+
+   entry->info_log = r->read_string(entry);
+   entry->version = r->read_uint32();
+   entry->is_es = r->read_uint32();
+   entry->uses_builtin_functions = r->read_uint32();
+   entry->vertices_out = r->read_uint32();
+   entry->input_type = r->read_uint32();
+   entry->output_type = r->read_uint32();
+   for (int i = 0; i < 3; i++)
+      entry->local_size[i] = r->read_uint32();
+
+   entry->num_uniform_blocks = r->read_uint32();
+   if (r->overrun || entry->info_log == NULL ||
+       entry->num_uniform_blocks > (size_t) (r->end - r->current))
+      return false;
+
+   entry->uniform_blocks =
+      rzalloc_array(entry, struct gl_uniform_block, entry->num_uniform_blocks);
+
+   for (unsigned i = 0; i < entry->num_uniform_blocks && !error; i++) {
+      struct gl_uniform_block *block = &entry->uniform_blocks[i];
+
+      block->Name = r->read_string(entry->uniform_blocks);
+      block->Binding = r->read_uint32();
+      block->UniformBufferSize = r->read_uint32();
+      block->_Packing = (enum gl_uniform_block_packing) r->read_uint32();
+      block->NumUniforms = r->read_uint32();
+      if (r->overrun || block->NumUniforms > (size_t) (r->end - r->current))
+         return false;
+
+      block->Uniforms = rzalloc_array(entry->uniform_blocks,
+                                      struct gl_uniform_buffer_variable,
+                                      block->NumUniforms);
+
+      for (unsigned j = 0; j < block->NumUniforms && !error; j++) {
+         struct gl_uniform_buffer_variable *ubo_var = &block->Uniforms[j];
+
+         ubo_var->Name = r->read_string(entry->uniform_blocks);
+         if (r->read_uint32())
+            ubo_var->IndexName = ubo_var->Name;
+         else
+            ubo_var->IndexName = r->read_string(entry->uniform_blocks);
+         ubo_var->Type = deserialize_glsl_type(r, &error);
+         ubo_var->Offset = r->read_uint32();
+         ubo_var->RowMajor = r->read_uint32();
+      }
+   }
+
+   if (error || r->overrun)
+      return false;
+
+   entry->ir = new(entry) exec_list;
+   return deserialize_ir(r, entry, entry->ir) && r->current == r->end;
+}
+
+
+/**
+ * Read a whole file into a ralloc'ed buffer.
+ */
+static char *
+read_file(void *mem_ctx, const char *filename, size_t *size)
+{
+   FILE *f = fopen(filename, "rb");
+   if (f == NULL)
+      return NULL;
+
+   char *data = NULL;
+   long length;
+
+   if (fseek(f, 0, SEEK_END) == 0 && (length = ftell(f)) > 0 &&
+       fseek(f, 0, SEEK_SET) == 0) {
+      data = (char *) ralloc_size(mem_ctx, length);
+      if (data && fread(data, 1, length, f) != (size_t) length) {
+         ralloc_free(data);
+         data = NULL;
+      }
+      *size = length;
+   }
+
+   fclose(f);
+   return data;
+}
+
+
+/**
+ * Look the shader up in the on-disk cache.
+ *
+ * \return a new entry (not yet in the in-memory cache) or NULL.
+ */
+static shader_cache_entry *
+disk_cache_load(const struct shader_cache_key *key, GLuint checksum,
+                const char *source)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   shader_cache_entry *entry = NULL;
+   size_t id_size, size;
+   char *id, *data;
+
+   id = make_disk_id(mem_ctx, key, source, &id_size);
+   if (id == NULL)
+      goto done;
+
+   data = read_file(mem_ctx, make_disk_filename(mem_ctx, id, id_size), &size);
+   if (data == NULL || size < id_size + sizeof(disk_cache_trailer) ||
+       memcmp(data, id, id_size) != 0)
+      goto done;
+
+   struct disk_cache_trailer trailer;
+   memcpy(&trailer, data + id_size, sizeof trailer);
+   if (trailer.payload_size != size - id_size - sizeof trailer ||
+       trailer.payload_hash !=
+       _mesa_hash_data(data + id_size + sizeof trailer, trailer.payload_size))
+      goto done;
+
+   {
+      memory_reader r(data + id_size + sizeof trailer, trailer.payload_size);
+
+      entry = rzalloc(NULL, shader_cache_entry);
+      memcpy(&entry->key, key, sizeof *key);
+      entry->checksum = checksum;
+      entry->source = ralloc_strdup(entry, source);
+
+      if (!deserialize_entry(&r, entry)) {
+         ralloc_free(entry);
+         entry = NULL;
+      }
+   }
+
+done:
+   ralloc_free(mem_ctx);
+   return entry;
+}
+
+
+/**
+ * Write an entry to the on-disk cache.  Failures are silently ignored.
+ */
+static void
+disk_cache_store(const shader_cache_entry *entry)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   memory_writer w(mem_ctx);
+   struct disk_cache_trailer trailer;
+   size_t id_size;
+   char *id, *filename, *tmp_filename;
+   FILE *f;
+   bool ok;
+
+   if (!serialize_entry(&w, entry))
+      goto done;
+
+   id = make_disk_id(mem_ctx, &entry->key, entry->source, &id_size);
+   if (id == NULL)
+      goto done;
+
+   trailer.payload_size = w.size;
+   trailer.payload_hash = _mesa_hash_data(w.data, w.size);
+
+   filename = make_disk_filename(mem_ctx, id, id_size);
+   tmp_filename = ralloc_asprintf(mem_ctx, "%s.%u.%p", filename,
+                                  (unsigned) getpid(), (void *) entry);
+
+   f = fopen(tmp_filename, "wb");
+   if (f == NULL)
+      goto done;
+
+   ok = fwrite(id, 1, id_size, f) == id_size &&
+        fwrite(&trailer, 1, sizeof trailer, f) == sizeof trailer &&
+        fwrite(w.data, 1, w.size, f) == w.size;
+   ok = fclose(f) == 0 && ok;
+
+   if (!ok || rename(tmp_filename, filename) != 0)
+      remove(tmp_filename);
+
+done:
+   ralloc_free(mem_ctx);
+}
+
+
+extern "C" bool
+_mesa_glsl_cache_lookup(struct gl_context *ctx, struct gl_shader *shader)
+{
+   struct shader_cache_key key;
+   GLuint checksum;
+   bool found = false;
+
+   make_key(&key, ctx, shader->Stage);
+   checksum = _mesa_str_checksum(shader->Source);
+
+   _glthread_LOCK_MUTEX(cache_lock);
+
+   foreach_list(node, &cache) {
+      shader_cache_entry *entry =
+         exec_node_data(shader_cache_entry, node, link);
+
+      if (entry->checksum == checksum &&
+          memcmp(&entry->key, &key, sizeof key) == 0 &&
+          strcmp(entry->source, shader->Source) == 0) {
+         /* Move to the front of the LRU list. */
+         entry->link.remove();
+         cache.push_head(&entry->link);
+
+         restore_shader(shader, entry);
+         found = true;
+         break;
+      }
+   }
+
+   _glthread_UNLOCK_MUTEX(cache_lock);
+
+   if (!found && disk_cache_dir()) {
+      shader_cache_entry *entry =
+         disk_cache_load(&key, checksum, shader->Source);
+
+      if (entry) {
+         restore_shader(shader, entry);
+         add_entry(entry);
+         found = true;
+      }
+   }
+
+   return found;
+}
+
+
+extern "C" void
+_mesa_glsl_cache_store(struct gl_context *ctx, const struct gl_shader *shader)
+{
+   shader_cache_entry *entry = rzalloc(NULL, shader_cache_entry);
+
+   make_key(&entry->key, ctx, shader->Stage);
+   entry->checksum = _mesa_str_checksum(shader->Source);
+   entry->source = ralloc_strdup(entry, shader->Source);
+
+   entry->ir = new(entry) exec_list;
+   clone_ir_list(entry->ir, entry->ir, shader->ir);
+
+   entry->info_log = ralloc_strdup(entry, shader->InfoLog ? shader->InfoLog : "");
+   entry->version = shader->Version;
+   entry->is_es = shader->IsES;
+   entry->uses_builtin_functions = shader->uses_builtin_functions;
+   entry->num_uniform_blocks = shader->NumUniformBlocks;
+   entry->uniform_blocks = copy_uniform_blocks(entry,
+                                               shader->UniformBlocks,
+                                               shader->NumUniformBlocks);
+   entry->vertices_out = shader->Geom.VerticesOut;
+   entry->input_type = shader->Geom.InputType;
+   entry->output_type = shader->Geom.OutputType;
+   for (int i = 0; i < 3; i++)
+      entry->local_size[i] = shader->Comp.LocalSize[i];
+
+   /* Written before the entry is shared, as it may be evicted right away. */
+   if (disk_cache_dir())
+      disk_cache_store(entry);
+
+   add_entry(entry);
+}
+
+
+extern "C" void
+_mesa_glsl_release_shader_cache(void)
+{
+   _glthread_LOCK_MUTEX(cache_lock);
+
+   foreach_list_safe(node, &cache) {
+      shader_cache_entry *entry =
+         exec_node_data(shader_cache_entry, node, link);
+
+      entry->link.remove();
+      ralloc_free(entry);
+   }
+   cache_size = 0;
+
+   _glthread_UNLOCK_MUTEX(cache_lock);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+/**
+ * \file shader_cache.h
+ *
+ * Cache of compiled shaders.
+ *
+ * Applications frequently compile the same source more than once, either
+ * because it is shared between several programs or because they recreate
+ * their shaders.  The result of running the front-end and the compile-time
+ * optimizations only depends on the source, the stage and the context's
+ * compiler-visible state, so the IR of a successful compile is kept and
+ * cloned into later shaders with an identical key.
+ *
+ * If MESA_GLSL_CACHE_DIR is set, entries are also serialized to files in
+ * that directory, so that later processes can skip the compile as well.
+ */
+
+#include "main/core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Look up \c shader->Source in the cache.
+ *
+ * On a hit, the shader is filled in (IR, symbol table, info log, version,
+ * uniform blocks and layout state) exactly as a compile would have done it
+ * and true is returned.
+ */
+extern bool
+_mesa_glsl_cache_lookup(struct gl_context *ctx, struct gl_shader *shader);
+
+/**
+ * Add the result of successfully compiling \c shader to the cache.
+ */
+extern void
+_mesa_glsl_cache_store(struct gl_context *ctx, const struct gl_shader *shader);
+
+/**
+ * Free all cached shaders.
+ */
+extern void
+_mesa_glsl_release_shader_cache(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* SHADER_CACHE_H */
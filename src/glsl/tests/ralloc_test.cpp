@@ -22,6 +22,7 @@
  */
 #include <gtest/gtest.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "ralloc.h"
 
@@ -36,3 +37,132 @@ TEST(ralloc_test, null_parent)
    EXPECT_EQ(NULL, ralloc_parent(mem_ctx));
 }
 /*@}*/
+
+/**
+ * \name Arena contexts
+ */
+/*@{*/
+static int destructor_calls;
+
+static void
+count_destructor(void *ptr)
+{
+   (void) ptr;
+   destructor_calls++;
+}
+
+TEST(ralloc_arena_test, children_have_parent)
+{
+   void *arena = ralloc_arena_context(NULL);
+   void *a = ralloc_size(arena, 16);
+   void *b = ralloc_context(a);
+   char *s = ralloc_strdup(b, "hello");
+
+   EXPECT_EQ(arena, ralloc_parent(a));
+   EXPECT_EQ(a, ralloc_parent(b));
+   EXPECT_EQ(b, ralloc_parent(s));
+   EXPECT_STREQ("hello", s);
+
+   ralloc_free(arena);
+}
+
+TEST(ralloc_arena_test, destructors_run)
+{
+   void *arena = ralloc_arena_context(NULL);
+   void *a = ralloc_size(arena, 8);
+   void *b = ralloc_size(a, 8);
+   void *c = ralloc_size(arena, 8);
+
+   ralloc_set_destructor(a, count_destructor);
+   ralloc_set_destructor(b, count_destructor);
+   ralloc_set_destructor(c, count_destructor);
+
+   destructor_calls = 0;
+   ralloc_free(a);
+   EXPECT_EQ(2, destructor_calls);
+
+   ralloc_free(arena);
+   EXPECT_EQ(3, destructor_calls);
+}
+
+TEST(ralloc_arena_test, large_and_many_blocks)
+{
+   void *arena = ralloc_arena_context(NULL);
+   char *big = (char *) ralloc_size(arena, 1024 * 1024);
+
+   memset(big, 0xab, 1024 * 1024);
+
+   for (unsigned i = 0; i < 100000; i++) {
+      unsigned *p = (unsigned *) ralloc_size(arena, sizeof(unsigned) * (i % 7 + 1));
+      *p = i;
+      EXPECT_EQ(0u, ((uintptr_t) p) % 8);
+   }
+
+   EXPECT_EQ((char) 0xab, big[1024 * 1024 - 1]);
+
+   ralloc_free(arena);
+}
+
+TEST(ralloc_arena_test, reralloc_keeps_contents)
+{
+   void *arena = ralloc_arena_context(NULL);
+   int *array = ralloc_array(arena, int, 4);
+   void *child = ralloc_context(array);
+
+   for (int i = 0; i < 4; i++)
+      array[i] = i;
+
+   array = reralloc(arena, array, int, 1000);
+   for (int i = 0; i < 4; i++)
+      EXPECT_EQ(i, array[i]);
+   EXPECT_EQ(arena, ralloc_parent(array));
+   EXPECT_EQ(array, ralloc_parent(child));
+
+   ralloc_free(arena);
+}
+
+TEST(ralloc_arena_test, steal_outlives_arena)
+{
+   void *ctx = ralloc_context(NULL);
+   void *arena = ralloc_arena_context(NULL);
+   char *s = ralloc_strdup(arena, "survivor");
+   void *child = ralloc_size(s, 32);
+
+   ralloc_set_destructor(child, count_destructor);
+
+   ralloc_steal(ctx, s);
+   EXPECT_EQ(ctx, ralloc_parent(s));
+
+   /* The slabs must stay around as long as the stolen string does. */
+   ralloc_free(arena);
+   EXPECT_STREQ("survivor", s);
+
+   /* Allocating out of a stolen block still works. */
+   char *t = ralloc_strdup(s, "more");
+   EXPECT_STREQ("more", t);
+
+   destructor_calls = 0;
+   ralloc_free(ctx);
+   EXPECT_EQ(1, destructor_calls);
+}
+
+TEST(ralloc_arena_test, steal_back_in)
+{
+   void *ctx = ralloc_context(NULL);
+   void *arena = ralloc_arena_context(NULL);
+   void *a = ralloc_size(arena, 8);
+   void *b = ralloc_size(arena, 8);
+   void *regular = ralloc_size(ctx, 8);
+
+   ralloc_steal(ctx, a);
+   ralloc_steal(b, a);
+   EXPECT_EQ(b, ralloc_parent(a));
+
+   /* Regular blocks can be stolen into an arena context too. */
+   ralloc_steal(arena, regular);
+   EXPECT_EQ(arena, ralloc_parent(regular));
+
+   ralloc_free(ctx);
+   ralloc_free(arena);
+}
+/*@}*/
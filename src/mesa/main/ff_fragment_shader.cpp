@@ -1344,8 +1344,7 @@ create_new_program(struct gl_context *ctx, struct state_key *key)
    const struct gl_shader_compiler_options *options =
       &ctx->ShaderCompilerOptions[MESA_SHADER_FRAGMENT];
 
-   while (do_common_optimization(p.shader->ir, false, false, 32, options))
-      ;
+   do_common_optimization_loop(p.shader->ir, false, false, 32, options);
    reparent_ir(p.shader->ir, p.shader->ir);
 
    p.shader->CompileStatus = true;
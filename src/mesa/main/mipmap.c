@@ -37,9 +37,14 @@
 #include "texstore.h"
 #include "image.h"
 #include "macros.h"
+#include "parallel.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 
 
 static GLint
@@ -136,6 +141,136 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
    } while(0)
 /*@}*/
 
+#ifdef __SSE2__
+
+/**
+ * \name SSE2 versions of the 2:1 RGBA cases of do_row().
+ * These are where nearly all the time goes when generating the mipmaps of
+ * large textures.  They return the number of dest pixels done and leave
+ * the rest to the C code.  The results are identical to the C code's,
+ * except that the sign of a half float NaN may differ (it depends on the
+ * order the compiler picks for the operands of the additions).
+ */
+/*@{*/
+
+static GLuint
+do_row_ubyte4_sse2(const GLubyte *rowA, const GLubyte *rowB,
+                   GLuint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   for (i = 0; i + 4 <= dstWidth; i += 4) {
+      const __m128i a0 = _mm_loadu_si128((const __m128i *) (rowA + i * 8));
+      const __m128i a1 = _mm_loadu_si128((const __m128i *) (rowA + i * 8 + 16));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *) (rowB + i * 8));
+      const __m128i b1 = _mm_loadu_si128((const __m128i *) (rowB + i * 8 + 16));
+      __m128i s01, s23, s45, s67, d0, d1;
+
+      /* sum the two rows, two source pixels per register */
+      s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                          _mm_unpacklo_epi8(b0, zero));
+      s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                          _mm_unpackhi_epi8(b0, zero));
+      s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                          _mm_unpacklo_epi8(b1, zero));
+      s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                          _mm_unpackhi_epi8(b1, zero));
+
+      /* sum horizontally adjacent pixels and divide by four */
+      d0 = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23),
+                         _mm_unpackhi_epi64(s01, s23));
+      d1 = _mm_add_epi16(_mm_unpacklo_epi64(s45, s67),
+                         _mm_unpackhi_epi64(s45, s67));
+      d0 = _mm_srli_epi16(d0, 2);
+      d1 = _mm_srli_epi16(d1, 2);
+
+      _mm_storeu_si128((__m128i *) (dst + i * 4), _mm_packus_epi16(d0, d1));
+   }
+
+   return i;
+}
+
+
+static GLuint
+do_row_float4_sse2(const GLfloat *rowA, const GLfloat *rowB,
+                   GLuint dstWidth, GLfloat *dst)
+{
+   const __m128 quarter = _mm_set1_ps(0.25F);
+   GLuint i;
+
+   /* same order of additions as the C code */
+   for (i = 0; i < dstWidth; i++) {
+      const __m128 aj = _mm_loadu_ps(rowA + i * 8);
+      const __m128 ak = _mm_loadu_ps(rowA + i * 8 + 4);
+      const __m128 bj = _mm_loadu_ps(rowB + i * 8);
+      const __m128 bk = _mm_loadu_ps(rowB + i * 8 + 4);
+      __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(aj, ak), bj), bk);
+
+      _mm_storeu_ps(dst + i * 4, _mm_mul_ps(sum, quarter));
+   }
+
+   return i;
+}
+
+
+/**
+ * Convert four half floats, zero extended to 32 bits, to floats.  Gives
+ * the same results as _mesa_half_to_float() except for NaN payloads,
+ * which _mesa_float_to_half() discards.
+ */
+static inline __m128
+half4_to_float4_sse2(__m128i h)
+{
+   const __m128i abs_mask = _mm_set1_epi32(0x7fff);
+   const __m128i em = _mm_and_si128(h, abs_mask);
+   const __m128i sign = _mm_slli_epi32(_mm_andnot_si128(abs_mask, h), 16);
+   const __m128i infnan = _mm_cmpgt_epi32(em, _mm_set1_epi32(0x7bff));
+   __m128 f;
+
+   /* rebias the exponent by multiplying by 2^112, which also gets
+    * denormals right
+    */
+   f = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(em, 13)),
+                  _mm_castsi128_ps(_mm_set1_epi32(0x77800000)));
+   f = _mm_or_ps(f, _mm_castsi128_ps(_mm_and_si128(infnan,
+                                     _mm_set1_epi32(0x7f800000))));
+   return _mm_or_ps(f, _mm_castsi128_ps(sign));
+}
+
+
+static GLuint
+do_row_half4_sse2(const GLhalfARB *rowA, const GLhalfARB *rowB,
+                  GLuint dstWidth, GLhalfARB *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128 quarter = _mm_set1_ps(0.25F);
+   GLuint i;
+
+   for (i = 0; i < dstWidth; i++) {
+      const __m128i a = _mm_loadu_si128((const __m128i *) (rowA + i * 8));
+      const __m128i b = _mm_loadu_si128((const __m128i *) (rowB + i * 8));
+      const __m128 aj = half4_to_float4_sse2(_mm_unpacklo_epi16(a, zero));
+      const __m128 ak = half4_to_float4_sse2(_mm_unpackhi_epi16(a, zero));
+      const __m128 bj = half4_to_float4_sse2(_mm_unpacklo_epi16(b, zero));
+      const __m128 bk = half4_to_float4_sse2(_mm_unpackhi_epi16(b, zero));
+      __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(aj, ak), bj), bk);
+      GLfloat avg[4];
+
+      _mm_storeu_ps(avg, _mm_mul_ps(sum, quarter));
+      dst[i * 4 + 0] = _mesa_float_to_half(avg[0]);
+      dst[i * 4 + 1] = _mesa_float_to_half(avg[1]);
+      dst[i * 4 + 2] = _mesa_float_to_half(avg[2]);
+      dst[i * 4 + 3] = _mesa_float_to_half(avg[3]);
+   }
+
+   return i;
+}
+
+/*@}*/
+
+#endif /* __SSE2__ */
+
 
 /**
  * Average together two rows of a source image to produce a single new
@@ -165,7 +300,12 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
       const GLubyte(*rowA)[4] = (const GLubyte(*)[4]) srcRowA;
       const GLubyte(*rowB)[4] = (const GLubyte(*)[4]) srcRowB;
       GLubyte(*dst)[4] = (GLubyte(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+      i = 0;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = do_row_ubyte4_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i][0] = (rowA[j][0] + rowA[k][0] + rowB[j][0] + rowB[k][0]) / 4;
          dst[i][1] = (rowA[j][1] + rowA[k][1] + rowB[j][1] + rowB[k][1]) / 4;
@@ -353,7 +493,12 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
       const GLfloat(*rowA)[4] = (const GLfloat(*)[4]) srcRowA;
       const GLfloat(*rowB)[4] = (const GLfloat(*)[4]) srcRowB;
       GLfloat(*dst)[4] = (GLfloat(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+      i = 0;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = do_row_float4_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i][0] = (rowA[j][0] + rowA[k][0] +
                       rowB[j][0] + rowB[k][0]) * 0.25F;
@@ -409,7 +554,12 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
       const GLhalfARB(*rowA)[4] = (const GLhalfARB(*)[4]) srcRowA;
       const GLhalfARB(*rowB)[4] = (const GLhalfARB(*)[4]) srcRowB;
       GLhalfARB(*dst)[4] = (GLhalfARB(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+      i = 0;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = do_row_half4_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          for (comp = 0; comp < 4; comp++) {
             GLfloat aj, ak, bj, bk;
@@ -1411,6 +1561,89 @@ do_row_3D(GLenum datatype, GLuint comps, GLint srcWidth,
  * border texels, depending on the scale-down factor.
  */
 
+/**
+ * The rows of one or more dest images, which are generated in parallel.
+ * Dest image i is made from source images srcImages[i * srcImageStep]
+ * and, for 3D textures, srcImages[i * srcImageStep + srcImageOffset].
+ */
+struct mipmap_rows
+{
+   GLenum datatype;
+   GLuint comps;
+   GLint srcWidth, dstWidth;     /**< row lengths, without border */
+   GLint rowsPerImage;           /**< dest rows, without border */
+   GLboolean is3D;
+
+   const GLubyte * const *srcImages;
+   GLint srcImageStep, srcImageOffset;
+   GLint srcOffset;              /**< offset of the first row, in bytes */
+   GLint srcRowStep;             /**< bytes from one dest row's source to the next */
+   GLint srcRowOffset;           /**< bytes between the rows to average */
+
+   GLubyte * const *dstImages;
+   GLint dstOffset;              /**< offset of the first row, in bytes */
+   GLint dstRowStride;
+};
+
+
+static void
+do_mipmap_rows(void *data, unsigned first, unsigned last)
+{
+   const struct mipmap_rows *rows = (const struct mipmap_rows *) data;
+   unsigned n;
+
+   for (n = first; n < last; n++) {
+      const GLint img = n / rows->rowsPerImage;
+      const GLint row = n % rows->rowsPerImage;
+      const GLubyte *srcA = rows->srcImages[img * rows->srcImageStep]
+         + rows->srcOffset + row * rows->srcRowStep;
+      GLubyte *dst = rows->dstImages[img]
+         + rows->dstOffset + row * rows->dstRowStride;
+
+      if (rows->is3D) {
+         const GLubyte *srcB =
+            rows->srcImages[img * rows->srcImageStep + rows->srcImageOffset]
+            + rows->srcOffset + row * rows->srcRowStep;
+
+         do_row_3D(rows->datatype, rows->comps, rows->srcWidth,
+                   srcA, srcA + rows->srcRowOffset,
+                   srcB, srcB + rows->srcRowOffset,
+                   rows->dstWidth, dst);
+      }
+      else {
+         do_row(rows->datatype, rows->comps, rows->srcWidth,
+                srcA, srcA + rows->srcRowOffset,
+                rows->dstWidth, dst);
+      }
+   }
+}
+
+
+/**
+ * Dest pixels per thread.  Smaller images aren't worth starting threads
+ * for.
+ */
+#define MIPMAP_PIXELS_PER_THREAD (64 * 1024)
+
+
+/**
+ * Generate the rows of numImages dest images, splitting large images
+ * across threads.
+ */
+static void
+make_mipmap_rows(const struct mipmap_rows *rows, GLint numImages)
+{
+   const GLint count = numImages * rows->rowsPerImage;
+
+   if (count <= 0 || rows->dstWidth <= 0)
+      return;
+
+   _mesa_parallel_for(count,
+                      MAX2(MIPMAP_PIXELS_PER_THREAD / rows->dstWidth, 1),
+                      do_mipmap_rows, (void *) rows);
+}
+
+
 static void
 make_1d_mipmap(GLenum datatype, GLuint comps, GLint border,
                GLint srcWidth, const GLubyte *srcPtr,
@@ -1441,93 +1674,120 @@ make_1d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
+/**
+ * Fill in the border of a 2D dest image.
+ */
+static void
+make_2d_mipmap_border(GLenum datatype, GLuint comps,
+                      GLint srcWidth, GLint srcHeight,
+                      const GLubyte *srcPtr,
+                      GLint dstWidth, GLint dstHeight,
+                      GLubyte *dstPtr)
+{
+   const GLint bpt = bytes_per_pixel(datatype, comps);
+   const GLint srcWidthNB = srcWidth - 2;  /* sizes w/out border */
+   const GLint dstWidthNB = dstWidth - 2;
+   const GLint dstHeightNB = dstHeight - 2;
+   GLint row;
+
+   /* This is ugly but probably won't be used much */
+   /* fill in dest border */
+   /* lower-left border pixel */
+   assert(dstPtr);
+   assert(srcPtr);
+   memcpy(dstPtr, srcPtr, bpt);
+   /* lower-right border pixel */
+   memcpy(dstPtr + (dstWidth - 1) * bpt,
+          srcPtr + (srcWidth - 1) * bpt, bpt);
+   /* upper-left border pixel */
+   memcpy(dstPtr + dstWidth * (dstHeight - 1) * bpt,
+          srcPtr + srcWidth * (srcHeight - 1) * bpt, bpt);
+   /* upper-right border pixel */
+   memcpy(dstPtr + (dstWidth * dstHeight - 1) * bpt,
+          srcPtr + (srcWidth * srcHeight - 1) * bpt, bpt);
+   /* lower border */
+   do_row(datatype, comps, srcWidthNB,
+          srcPtr + bpt,
+          srcPtr + bpt,
+          dstWidthNB, dstPtr + bpt);
+   /* upper border */
+   do_row(datatype, comps, srcWidthNB,
+          srcPtr + (srcWidth * (srcHeight - 1) + 1) * bpt,
+          srcPtr + (srcWidth * (srcHeight - 1) + 1) * bpt,
+          dstWidthNB,
+          dstPtr + (dstWidth * (dstHeight - 1) + 1) * bpt);
+   /* left and right borders */
+   if (srcHeight == dstHeight) {
+      /* copy border pixel from src to dst */
+      for (row = 1; row < srcHeight; row++) {
+         memcpy(dstPtr + dstWidth * row * bpt,
+                srcPtr + srcWidth * row * bpt, bpt);
+         memcpy(dstPtr + (dstWidth * row + dstWidth - 1) * bpt,
+                srcPtr + (srcWidth * row + srcWidth - 1) * bpt, bpt);
+      }
+   }
+   else {
+      /* average two src pixels each dest pixel */
+      for (row = 0; row < dstHeightNB; row += 2) {
+         do_row(datatype, comps, 1,
+                srcPtr + (srcWidth * (row * 2 + 1)) * bpt,
+                srcPtr + (srcWidth * (row * 2 + 2)) * bpt,
+                1, dstPtr + (dstWidth * row + 1) * bpt);
+         do_row(datatype, comps, 1,
+                srcPtr + (srcWidth * (row * 2 + 1) + srcWidth - 1) * bpt,
+                srcPtr + (srcWidth * (row * 2 + 2) + srcWidth - 1) * bpt,
+                1, dstPtr + (dstWidth * row + 1 + dstWidth - 1) * bpt);
+      }
+   }
+}
+
+
 static void
 make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
                GLint srcWidth, GLint srcHeight,
-	       const GLubyte *srcPtr, GLint srcRowStride,
+	       const GLubyte **srcPtr, GLint srcRowStride,
                GLint dstWidth, GLint dstHeight,
-	       GLubyte *dstPtr, GLint dstRowStride)
+	       GLubyte **dstPtr, GLint dstRowStride,
+               GLint numImages)
 {
    const GLint bpt = bytes_per_pixel(datatype, comps);
-   const GLint srcWidthNB = srcWidth - 2 * border;  /* sizes w/out border */
-   const GLint dstWidthNB = dstWidth - 2 * border;
-   const GLint dstHeightNB = dstHeight - 2 * border;
-   const GLubyte *srcA, *srcB;
-   GLubyte *dst;
-   GLint row, srcRowStep;
-
-   /* Compute src and dst pointers, skipping any border */
-   srcA = srcPtr + border * ((srcWidth + 1) * bpt);
+   struct mipmap_rows rows;
+   GLint img;
+
+   rows.datatype = datatype;
+   rows.comps = comps;
+   rows.srcWidth = srcWidth - 2 * border;  /* sizes w/out border */
+   rows.dstWidth = dstWidth - 2 * border;
+   rows.rowsPerImage = dstHeight - 2 * border;
+   rows.is3D = GL_FALSE;
+
+   /* Compute src and dst offsets, skipping any border */
+   rows.srcImages = srcPtr;
+   rows.srcImageStep = 1;
+   rows.srcImageOffset = 0;
+   rows.srcOffset = border * ((srcWidth + 1) * bpt);
    if (srcHeight > 1 && srcHeight > dstHeight) {
       /* sample from two source rows */
-      srcB = srcA + srcRowStride;
-      srcRowStep = 2;
+      rows.srcRowOffset = srcRowStride;
+      rows.srcRowStep = 2 * srcRowStride;
    }
    else {
       /* sample from one source row */
-      srcB = srcA;
-      srcRowStep = 1;
+      rows.srcRowOffset = 0;
+      rows.srcRowStep = srcRowStride;
    }
 
-   dst = dstPtr + border * ((dstWidth + 1) * bpt);
+   rows.dstImages = dstPtr;
+   rows.dstOffset = border * ((dstWidth + 1) * bpt);
+   rows.dstRowStride = dstRowStride;
 
-   for (row = 0; row < dstHeightNB; row++) {
-      do_row(datatype, comps, srcWidthNB, srcA, srcB,
-             dstWidthNB, dst);
-      srcA += srcRowStep * srcRowStride;
-      srcB += srcRowStep * srcRowStride;
-      dst += dstRowStride;
-   }
+   make_mipmap_rows(&rows, numImages);
 
-   /* This is ugly but probably won't be used much */
    if (border > 0) {
-      /* fill in dest border */
-      /* lower-left border pixel */
-      assert(dstPtr);
-      assert(srcPtr);
-      memcpy(dstPtr, srcPtr, bpt);
-      /* lower-right border pixel */
-      memcpy(dstPtr + (dstWidth - 1) * bpt,
-             srcPtr + (srcWidth - 1) * bpt, bpt);
-      /* upper-left border pixel */
-      memcpy(dstPtr + dstWidth * (dstHeight - 1) * bpt,
-             srcPtr + srcWidth * (srcHeight - 1) * bpt, bpt);
-      /* upper-right border pixel */
-      memcpy(dstPtr + (dstWidth * dstHeight - 1) * bpt,
-             srcPtr + (srcWidth * srcHeight - 1) * bpt, bpt);
-      /* lower border */
-      do_row(datatype, comps, srcWidthNB,
-             srcPtr + bpt,
-             srcPtr + bpt,
-             dstWidthNB, dstPtr + bpt);
-      /* upper border */
-      do_row(datatype, comps, srcWidthNB,
-             srcPtr + (srcWidth * (srcHeight - 1) + 1) * bpt,
-             srcPtr + (srcWidth * (srcHeight - 1) + 1) * bpt,
-             dstWidthNB,
-             dstPtr + (dstWidth * (dstHeight - 1) + 1) * bpt);
-      /* left and right borders */
-      if (srcHeight == dstHeight) {
-         /* copy border pixel from src to dst */
-         for (row = 1; row < srcHeight; row++) {
-            memcpy(dstPtr + dstWidth * row * bpt,
-                   srcPtr + srcWidth * row * bpt, bpt);
-            memcpy(dstPtr + (dstWidth * row + dstWidth - 1) * bpt,
-                   srcPtr + (srcWidth * row + srcWidth - 1) * bpt, bpt);
-         }
-      }
-      else {
-         /* average two src pixels each dest pixel */
-         for (row = 0; row < dstHeightNB; row += 2) {
-            do_row(datatype, comps, 1,
-                   srcPtr + (srcWidth * (row * 2 + 1)) * bpt,
-                   srcPtr + (srcWidth * (row * 2 + 2)) * bpt,
-                   1, dstPtr + (dstWidth * row + 1) * bpt);
-            do_row(datatype, comps, 1,
-                   srcPtr + (srcWidth * (row * 2 + 1) + srcWidth - 1) * bpt,
-                   srcPtr + (srcWidth * (row * 2 + 2) + srcWidth - 1) * bpt,
-                   1, dstPtr + (dstWidth * row + 1 + dstWidth - 1) * bpt);
-         }
+      for (img = 0; img < numImages; img++) {
+         make_2d_mipmap_border(datatype, comps, srcWidth, srcHeight,
+                               srcPtr[img], dstWidth, dstHeight,
+                               dstPtr[img]);
       }
    }
 }
@@ -1546,10 +1806,11 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
    const GLint dstWidthNB = dstWidth - 2 * border;
    const GLint dstHeightNB = dstHeight - 2 * border;
    const GLint dstDepthNB = dstDepth - 2 * border;
-   GLint img, row;
+   GLint img;
    GLint bytesPerSrcImage, bytesPerDstImage;
    GLint bytesPerSrcRow, bytesPerDstRow;
    GLint srcImageOffset, srcRowOffset;
+   struct mipmap_rows rows;
 
    (void) srcDepthNB; /* silence warnings */
 
@@ -1579,51 +1840,39 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
           srcWidth, srcHeight, srcDepth, dstWidth, dstHeight, dstDepth);
    */
 
-   for (img = 0; img < dstDepthNB; img++) {
-      /* first source image pointer, skipping border */
-      const GLubyte *imgSrcA = srcPtr[img * 2 + border]
-         + bytesPerSrcRow * border + bpt * border;
-      /* second source image pointer, skipping border */
-      const GLubyte *imgSrcB = srcPtr[img * 2 + srcImageOffset + border]
-         + bytesPerSrcRow * border + bpt * border;
+   rows.datatype = datatype;
+   rows.comps = comps;
+   rows.srcWidth = srcWidthNB;
+   rows.dstWidth = dstWidthNB;
+   rows.rowsPerImage = dstHeightNB;
+   rows.is3D = GL_TRUE;
 
-      /* address of the dest image, skipping border */
-      GLubyte *imgDst = dstPtr[img + border]
-         + bytesPerDstRow * border + bpt * border;
+   /* source and dest images and rows, skipping border */
+   rows.srcImages = srcPtr + border;
+   rows.srcImageStep = 2;
+   rows.srcImageOffset = srcImageOffset;
+   rows.srcOffset = bytesPerSrcRow * border + bpt * border;
+   rows.srcRowStep = bytesPerSrcRow + srcRowOffset;
+   rows.srcRowOffset = srcRowOffset;
 
-      /* setup the four source row pointers and the dest row pointer */
-      const GLubyte *srcImgARowA = imgSrcA;
-      const GLubyte *srcImgARowB = imgSrcA + srcRowOffset;
-      const GLubyte *srcImgBRowA = imgSrcB;
-      const GLubyte *srcImgBRowB = imgSrcB + srcRowOffset;
-      GLubyte *dstImgRow = imgDst;
+   rows.dstImages = dstPtr + border;
+   rows.dstOffset = bytesPerDstRow * border + bpt * border;
+   rows.dstRowStride = bytesPerDstRow;
 
-      for (row = 0; row < dstHeightNB; row++) {
-         do_row_3D(datatype, comps, srcWidthNB, 
-                   srcImgARowA, srcImgARowB,
-                   srcImgBRowA, srcImgBRowB,
-                   dstWidthNB, dstImgRow);
-
-         /* advance to next rows */
-         srcImgARowA += bytesPerSrcRow + srcRowOffset;
-         srcImgARowB += bytesPerSrcRow + srcRowOffset;
-         srcImgBRowA += bytesPerSrcRow + srcRowOffset;
-         srcImgBRowB += bytesPerSrcRow + srcRowOffset;
-         dstImgRow += bytesPerDstRow;
-      }
-   }
+   make_mipmap_rows(&rows, dstDepthNB);
 
 
    /* Luckily we can leverage the make_2d_mipmap() function here! */
    if (border > 0) {
       /* do front border image */
       make_2d_mipmap(datatype, comps, 1,
-                     srcWidth, srcHeight, srcPtr[0], srcRowStride,
-                     dstWidth, dstHeight, dstPtr[0], dstRowStride);
+                     srcWidth, srcHeight, &srcPtr[0], srcRowStride,
+                     dstWidth, dstHeight, &dstPtr[0], dstRowStride, 1);
       /* do back border image */
       make_2d_mipmap(datatype, comps, 1,
-                     srcWidth, srcHeight, srcPtr[srcDepth - 1], srcRowStride,
-                     dstWidth, dstHeight, dstPtr[dstDepth - 1], dstRowStride);
+                     srcWidth, srcHeight, &srcPtr[srcDepth - 1], srcRowStride,
+                     dstWidth, dstHeight, &dstPtr[dstDepth - 1], dstRowStride,
+                     1);
 
       /* do four remaining border edges that span the image slices */
       if (srcDepth == dstDepth) {
@@ -1726,8 +1975,8 @@ _mesa_generate_mipmap_level(GLenum target,
    case GL_TEXTURE_CUBE_MAP_POSITIVE_Z_ARB:
    case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z_ARB:
       make_2d_mipmap(datatype, comps, border,
-                     srcWidth, srcHeight, srcData[0], srcRowStride,
-                     dstWidth, dstHeight, dstData[0], dstRowStride);
+                     srcWidth, srcHeight, srcData, srcRowStride,
+                     dstWidth, dstHeight, dstData, dstRowStride, 1);
       break;
    case GL_TEXTURE_3D:
       make_3d_mipmap(datatype, comps, border,
@@ -1746,11 +1995,9 @@ _mesa_generate_mipmap_level(GLenum target,
       }
       break;
    case GL_TEXTURE_2D_ARRAY_EXT:
-      for (i = 0; i < dstDepth; i++) {
-	 make_2d_mipmap(datatype, comps, border,
-			srcWidth, srcHeight, srcData[i], srcRowStride,
-			dstWidth, dstHeight, dstData[i], dstRowStride);
-      }
+      make_2d_mipmap(datatype, comps, border,
+                     srcWidth, srcHeight, srcData, srcRowStride,
+                     dstWidth, dstHeight, dstData, dstRowStride, dstDepth);
       break;
    case GL_TEXTURE_RECTANGLE_NV:
    case GL_TEXTURE_EXTERNAL_OES:
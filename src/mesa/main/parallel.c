@@ -0,0 +1,141 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  VMware, Inc.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file parallel.c
+ * Splitting large loops across threads.
+ *
+ * Core Mesa lives in a driver that may be unloaded at any time, so rather
+ * than keeping a pool of idle threads around we start the helper threads
+ * for each loop and join them before returning.  Callers pass a minimum
+ * number of items per thread, so that only loops which are expensive
+ * compared to thread creation are ever split.
+ */
+
+
+#include "c11/threads.h"
+#include "imports.h"
+#include "macros.h"
+#include "parallel.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+
+/**
+ * Return the number of threads to split large loops across.  This is the
+ * number of online CPUs unless overridden with the MESA_NUM_THREADS
+ * environment variable; 1 disables threading.
+ */
+unsigned
+_mesa_num_threads(void)
+{
+   static int num_threads = 0;
+
+   if (num_threads == 0) {
+      const char *env = _mesa_getenv("MESA_NUM_THREADS");
+      int n = 1;
+
+      if (env) {
+         n = atoi(env);
+      }
+      else {
+#if defined(_SC_NPROCESSORS_ONLN)
+         n = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+      }
+
+      /* racing threads all compute the same value */
+      num_threads = CLAMP(n, 1, MESA_MAX_THREADS);
+   }
+
+   return num_threads;
+}
+
+
+struct parallel_job
+{
+   mesa_parallel_func func;
+   void *data;
+   unsigned first, last;
+};
+
+
+static int
+parallel_thread_func(void *arg)
+{
+   struct parallel_job *job = (struct parallel_job *) arg;
+
+   job->func(job->data, job->first, job->last);
+
+   return 0;
+}
+
+
+/**
+ * Call func for the items [0, count), in chunks on up to
+ * _mesa_num_threads() threads.  Each thread gets at least min_items
+ * items.  Returns when all the items have been processed.
+ */
+void
+_mesa_parallel_for(unsigned count, unsigned min_items,
+                   mesa_parallel_func func, void *data)
+{
+   struct parallel_job jobs[MESA_MAX_THREADS];
+   thrd_t threads[MESA_MAX_THREADS];
+   GLboolean started[MESA_MAX_THREADS];
+   unsigned num_threads, i;
+
+   num_threads = MIN2(_mesa_num_threads(), count / MAX2(min_items, 1));
+   if (num_threads <= 1) {
+      func(data, 0, count);
+      return;
+   }
+
+   for (i = 0; i < num_threads; i++) {
+      jobs[i].func = func;
+      jobs[i].data = data;
+      jobs[i].first = (unsigned) ((uint64_t) count * i / num_threads);
+      jobs[i].last = (unsigned) ((uint64_t) count * (i + 1) / num_threads);
+   }
+
+   /* The first chunk is done on the calling thread.  If a helper thread
+    * can't be started its chunk is done there too.
+    */
+   for (i = 1; i < num_threads; i++) {
+      started[i] = thrd_create(&threads[i], parallel_thread_func,
+                               &jobs[i]) == thrd_success;
+   }
+
+   func(data, jobs[0].first, jobs[0].last);
+
+   for (i = 1; i < num_threads; i++) {
+      if (started[i])
+         thrd_join(threads[i], NULL);
+      else
+         func(data, jobs[i].first, jobs[i].last);
+   }
+}
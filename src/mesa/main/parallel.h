@@ -0,0 +1,64 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  VMware, Inc.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file parallel.h
+ * Splitting large loops (mipmap generation, texture stores) across threads.
+ */
+
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Upper bound for MESA_NUM_THREADS */
+#define MESA_MAX_THREADS 16
+
+
+/**
+ * Process the items [first, last) of a parallel loop.
+ */
+typedef void (*mesa_parallel_func)(void *data, unsigned first, unsigned last);
+
+
+extern unsigned
+_mesa_num_threads(void);
+
+extern void
+_mesa_parallel_for(unsigned count, unsigned min_items,
+                   mesa_parallel_func func, void *data);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* PARALLEL_H */
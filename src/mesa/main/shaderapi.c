@@ -92,6 +92,8 @@ get_shader_flags(void)
          flags |= GLSL_USE_PROG;
       if (strstr(env, "errors"))
          flags |= GLSL_REPORT_ERRORS;
+      if (strstr(env, "nocache"))
+         flags |= GLSL_NO_CACHE;
    }
 
    return flags;
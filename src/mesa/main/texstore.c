@@ -60,6 +60,7 @@
 #include "mipmap.h"
 #include "mtypes.h"
 #include "pack.h"
+#include "parallel.h"
 #include "pbo.h"
 #include "imports.h"
 #include "texcompress.h"
@@ -74,6 +75,10 @@
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 
 enum {
    ZERO = 4, 
@@ -662,6 +667,53 @@ _mesa_make_temp_ubyte_image(struct gl_context *ctx, GLuint dims,
 }
 
 
+#ifdef __SSE2__
+
+/**
+ * SSE2 version of swizzle_copy() for four components in and out, which is
+ * the common RGBA <-> BGRA/ABGR case.  Returns the number of pixels done.
+ */
+static GLuint
+swizzle_copy_4to4_sse2(GLubyte *dst, const GLubyte *src,
+                       const GLubyte *map, GLuint count)
+{
+   const __m128i byte_mask = _mm_set1_epi32(0xff);
+   __m128i srcShift[4], dstShift[4], consts;
+   GLuint i, j, numChans = 0;
+   GLuint one = 0;
+
+   /* channels which are copied, and channels which are constant */
+   for (j = 0; j < 4; j++) {
+      if (map[j] < 4) {
+         srcShift[numChans] = _mm_cvtsi32_si128(map[j] * 8);
+         dstShift[numChans] = _mm_cvtsi32_si128(j * 8);
+         numChans++;
+      }
+      else if (map[j] == ONE) {
+         one |= 0xffu << (j * 8);
+      }
+   }
+   consts = _mm_set1_epi32(one);
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) (src + i * 4));
+      __m128i d = consts;
+
+      for (j = 0; j < numChans; j++) {
+         const __m128i c = _mm_and_si128(_mm_srl_epi32(p, srcShift[j]),
+                                         byte_mask);
+         d = _mm_or_si128(d, _mm_sll_epi32(c, dstShift[j]));
+      }
+
+      _mm_storeu_si128((__m128i *) (dst + i * 4), d);
+   }
+
+   return i;
+}
+
+#endif /* __SSE2__ */
+
+
 /**
  * Copy GLubyte pixels from <src> to <dst> with swizzling.
  * \param dst  destination pixels
@@ -710,6 +762,14 @@ swizzle_copy(GLubyte *dst, GLuint dstComponents, const GLubyte *src,
    case 4:
       switch (srcComponents) {
       case 4:
+#ifdef __SSE2__
+         {
+            const GLuint done = swizzle_copy_4to4_sse2(dst, src, map, count);
+            dst += done * 4;
+            src += done * 4;
+            count -= done;
+         }
+#endif
          SWZ_CPY(dst, src, count, 4, 4);
          break;
       case 3:
@@ -2783,7 +2843,33 @@ _mesa_texstore_rgba_float16(TEXSTORE_PARAMS)
           baseInternalFormat == GL_RG);
    ASSERT(_mesa_get_format_bytes(dstFormat) == components * sizeof(GLhalfARB));
 
-   {
+   if (!ctx->_ImageTransferState &&
+       !srcPacking->SwapBytes &&
+       srcType == GL_FLOAT &&
+       srcFormat == baseInternalFormat &&
+       baseInternalFormat == baseFormat) {
+      /* convert straight from the user's floats, no temp image needed */
+      const GLint srcRowStride =
+         _mesa_image_row_stride(srcPacking, srcWidth, srcFormat, srcType);
+      GLint img, row;
+      for (img = 0; img < srcDepth; img++) {
+         const GLubyte *srcRow = (const GLubyte *)
+            _mesa_image_address(dims, srcPacking, srcAddr, srcWidth,
+                                srcHeight, srcFormat, srcType, img, 0, 0);
+         GLubyte *dstRow = dstSlices[img];
+         for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = (const GLfloat *) srcRow;
+            GLhalfARB *dstTexel = (GLhalfARB *) dstRow;
+            GLint i;
+            for (i = 0; i < srcWidth * components; i++) {
+               dstTexel[i] = _mesa_float_to_half(src[i]);
+            }
+            dstRow += dstRowStride;
+            srcRow += srcRowStride;
+         }
+      }
+   }
+   else {
       /* general path */
       const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
                                                  baseInternalFormat,
@@ -3939,12 +4025,10 @@ _mesa_texstore_memcpy(TEXSTORE_PARAMS)
 
 
 /**
- * Store user data into texture memory.
- * Called via glTex[Sub]Image1/2/3D()
- * \return GL_TRUE for success, GL_FALSE for failure (out of memory).
+ * Store a user image, or a band of its rows, into texture memory.
  */
-GLboolean
-_mesa_texstore(TEXSTORE_PARAMS)
+static GLboolean
+texstore_rect(TEXSTORE_PARAMS)
 {
    StoreTexImageFunc storeImage;
    GLboolean success;
@@ -3968,6 +4052,120 @@ _mesa_texstore(TEXSTORE_PARAMS)
 }
 
 
+/**
+ * Source pixels per thread.  Smaller images aren't worth starting threads
+ * for.
+ */
+#define TEXSTORE_PIXELS_PER_THREAD (64 * 1024)
+
+
+/**
+ * A texture image being stored in bands of rows by several threads.
+ */
+struct texstore_rows
+{
+   struct gl_context *ctx;
+   GLuint dims;
+   GLenum baseInternalFormat;
+   mesa_format dstFormat;
+   GLint dstRowStride;
+   GLubyte *dstImage;
+   GLint srcWidth, srcHeight;
+   GLenum srcFormat, srcType;
+   const GLvoid *srcAddr;
+   const struct gl_pixelstore_attrib *srcPacking;
+   GLuint firstRow;          /**< added to the row numbers passed in */
+   GLboolean success;
+};
+
+
+static void
+texstore_rows(void *data, unsigned first, unsigned last)
+{
+   struct texstore_rows *rows = (struct texstore_rows *) data;
+   struct gl_pixelstore_attrib packing = *rows->srcPacking;
+   GLubyte *dst;
+
+   first += rows->firstRow;
+   last += rows->firstRow;
+
+   /* Skip to the first row of the band.  The image height still has to
+    * be the whole image's, for GL_UNPACK_SKIP_IMAGES.
+    *
+    * Inverted images are addressed from their last row, which
+    * _mesa_image_address() finds from the band's height rather than the
+    * image's, so skip back over the rows below the band instead.
+    */
+   if (packing.Invert)
+      packing.SkipRows -= rows->srcHeight - last;
+   else
+      packing.SkipRows += first;
+   if (packing.ImageHeight == 0)
+      packing.ImageHeight = rows->srcHeight;
+
+   dst = rows->dstImage + (GLintptr) first * rows->dstRowStride;
+
+   if (!texstore_rect(rows->ctx, rows->dims, rows->baseInternalFormat,
+                      rows->dstFormat, rows->dstRowStride, &dst,
+                      rows->srcWidth, last - first, 1,
+                      rows->srcFormat, rows->srcType, rows->srcAddr,
+                      &packing)) {
+      rows->success = GL_FALSE;
+   }
+}
+
+
+/**
+ * Store user data into texture memory.
+ * Called via glTex[Sub]Image1/2/3D()
+ * Large 2D images are split into bands of rows which are stored by
+ * several threads.
+ * \return GL_TRUE for success, GL_FALSE for failure (out of memory).
+ */
+GLboolean
+_mesa_texstore(TEXSTORE_PARAMS)
+{
+   const GLint minRows = MAX2(TEXSTORE_PIXELS_PER_THREAD / MAX2(srcWidth, 1),
+                              1);
+   struct texstore_rows rows;
+
+   if (dims < 2 || srcDepth != 1 || srcHeight < 2 * minRows ||
+       _mesa_num_threads() == 1 ||
+       _mesa_is_format_compressed(dstFormat)) {
+      return texstore_rect(ctx, dims, baseInternalFormat,
+                           dstFormat, dstRowStride, dstSlices,
+                           srcWidth, srcHeight, srcDepth,
+                           srcFormat, srcType, srcAddr, srcPacking);
+   }
+
+   rows.ctx = ctx;
+   rows.dims = dims;
+   rows.baseInternalFormat = baseInternalFormat;
+   rows.dstFormat = dstFormat;
+   rows.dstRowStride = dstRowStride;
+   rows.dstImage = dstSlices[0];
+   rows.srcWidth = srcWidth;
+   rows.srcHeight = srcHeight;
+   rows.srcFormat = srcFormat;
+   rows.srcType = srcType;
+   rows.srcAddr = srcAddr;
+   rows.srcPacking = srcPacking;
+   rows.firstRow = 0;
+   rows.success = GL_TRUE;
+
+   /* Store the first band on this thread before starting any others.
+    * Several of the store and pack functions fill in lookup tables the
+    * first time they're used, which mustn't race.
+    */
+   texstore_rows(&rows, 0, minRows);
+
+   rows.firstRow = minRows;
+   _mesa_parallel_for(srcHeight - minRows, minRows, texstore_rows, &rows);
+
+   return rows.success;
+}
+
+
 /**
  * Normally, we'll only _write_ texel data to a texture when we map it.
  * But if the user is providing depth or stencil values and the texture
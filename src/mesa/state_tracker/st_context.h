@@ -196,6 +196,14 @@ struct st_context
    /* The number of vertex buffers from the last call of validate_arrays. */
    unsigned last_num_vbuffers;
 
+   /** Shader variant cache counters, indexed by PIPE_SHADER_x.
+    * Dumped at context destruction with ST_DEBUG=variants.
+    */
+   struct {
+      unsigned lookups[PIPE_SHADER_TYPES];
+      unsigned created[PIPE_SHADER_TYPES];
+   } variant_stats;
+
    int32_t draw_stamp;
    int32_t read_stamp;
 
@@ -33,6 +33,7 @@
 
 #include "main/imports.h"
 #include "main/hash.h"
+#include "main/hash_table.h"
 #include "main/mtypes.h"
 #include "program/prog_parameter.h"
 #include "program/prog_print.h"
@@ -55,6 +56,95 @@
 
 
 
+/*
+ * Each program keeps its variants both in a linked list (for walking and
+ * freeing them) and in a hash table keyed on the variant key, so finding
+ * the variant for the current state doesn't depend on how many variants
+ * the program has accumulated.  The table stores a pointer to the key
+ * embedded in each variant; it's created on first use.
+ *
+ * Programs and their variants are shared between contexts, so the list and
+ * table are only touched with the shared state's mutex held.  It's dropped
+ * while a new variant is translated; that's safe as the key includes the
+ * context, and no other thread can be creating the same variant.
+ */
+
+static bool
+vp_key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct st_vp_variant_key)) == 0;
+}
+
+static bool
+fp_key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct st_fp_variant_key)) == 0;
+}
+
+static bool
+gp_key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct st_gp_variant_key)) == 0;
+}
+
+
+static void *
+variant_table_search(struct hash_table *ht, const void *key, size_t key_size)
+{
+   struct hash_entry *entry;
+
+   if (!ht)
+      return NULL;
+
+   entry = _mesa_hash_table_search(ht, _mesa_hash_data(key, key_size), key);
+   return entry ? entry->data : NULL;
+}
+
+
+/**
+ * Add a variant to a program's table, creating the table if needed.
+ * \param key  the key embedded in the variant (must outlive the entry)
+ */
+static void
+variant_table_insert(struct hash_table **ht,
+                     bool (*key_equal)(const void *a, const void *b),
+                     const void *key, size_t key_size, void *variant)
+{
+   if (!*ht) {
+      *ht = _mesa_hash_table_create(NULL, key_equal);
+      if (!*ht)
+         return;
+   }
+
+   _mesa_hash_table_insert(*ht, _mesa_hash_data(key, key_size), key, variant);
+}
+
+
+static void
+variant_table_remove(struct hash_table *ht, const void *key, size_t key_size)
+{
+   struct hash_entry *entry;
+
+   if (!ht)
+      return;
+
+   entry = _mesa_hash_table_search(ht, _mesa_hash_data(key, key_size), key);
+   if (entry)
+      _mesa_hash_table_remove(ht, entry);
+}
+
+
+static void
+variant_table_destroy(struct hash_table **ht)
+{
+   if (*ht) {
+      _mesa_hash_table_destroy(*ht, NULL);
+      *ht = NULL;
+   }
+}
+
+
+
 /**
  * Delete a vertex program variant.  Note the caller must unlink
  * the variant from the linked list.
@@ -85,6 +175,8 @@ st_release_vp_variants( struct st_context *st,
 {
    struct st_vp_variant *vpv;
 
+   _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
+
    for (vpv = stvp->variants; vpv; ) {
       struct st_vp_variant *next = vpv->next;
       delete_vp_variant(st, vpv);
@@ -92,6 +184,9 @@ st_release_vp_variants( struct st_context *st,
    }
 
    stvp->variants = NULL;
+   variant_table_destroy(&stvp->variant_table);
+
+   _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
 }
 
 
@@ -121,6 +216,8 @@ st_release_fp_variants(struct st_context *st, struct st_fragment_program *stfp)
 {
    struct st_fp_variant *fpv;
 
+   _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
+
    for (fpv = stfp->variants; fpv; ) {
       struct st_fp_variant *next = fpv->next;
       delete_fp_variant(st, fpv);
@@ -128,6 +225,9 @@ st_release_fp_variants(struct st_context *st, struct st_fragment_program *stfp)
    }
 
    stfp->variants = NULL;
+   variant_table_destroy(&stfp->variant_table);
+
+   _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
 }
 
 
@@ -153,6 +253,8 @@ st_release_gp_variants(struct st_context *st, struct st_geometry_program *stgp)
 {
    struct st_gp_variant *gpv;
 
+   _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
+
    for (gpv = stgp->variants; gpv; ) {
       struct st_gp_variant *next = gpv->next;
       delete_gp_variant(st, gpv);
@@ -160,6 +262,9 @@ st_release_gp_variants(struct st_context *st, struct st_geometry_program *stgp)
    }
 
    stgp->variants = NULL;
+   variant_table_destroy(&stgp->variant_table);
+
+   _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
 }
 
 
@@ -418,20 +523,25 @@ st_get_vp_variant(struct st_context *st,
 {
    struct st_vp_variant *vpv;
 
+   st->variant_stats.lookups[PIPE_SHADER_VERTEX]++;
+
    /* Search for existing variant */
-   for (vpv = stvp->variants; vpv; vpv = vpv->next) {
-      if (memcmp(&vpv->key, key, sizeof(*key)) == 0) {
-         break;
-      }
-   }
+   _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
+   vpv = variant_table_search(stvp->variant_table, key, sizeof(*key));
+   _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
 
    if (!vpv) {
       /* create now */
       vpv = st_translate_vertex_program(st, stvp, key);
       if (vpv) {
-         /* insert into list */
+         /* insert into list and table */
+         _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
          vpv->next = stvp->variants;
          stvp->variants = vpv;
+         variant_table_insert(&stvp->variant_table, vp_key_equal,
+                              &vpv->key, sizeof(vpv->key), vpv);
+         _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
+         st->variant_stats.created[PIPE_SHADER_VERTEX]++;
       }
    }
 
@@ -807,20 +917,25 @@ st_get_fp_variant(struct st_context *st,
 {
    struct st_fp_variant *fpv;
 
+   st->variant_stats.lookups[PIPE_SHADER_FRAGMENT]++;
+
    /* Search for existing variant */
-   for (fpv = stfp->variants; fpv; fpv = fpv->next) {
-      if (memcmp(&fpv->key, key, sizeof(*key)) == 0) {
-         break;
-      }
-   }
+   _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
+   fpv = variant_table_search(stfp->variant_table, key, sizeof(*key));
+   _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
 
    if (!fpv) {
       /* create new */
       fpv = st_translate_fragment_program(st, stfp, key);
       if (fpv) {
-         /* insert into list */
+         /* insert into list and table */
+         _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
          fpv->next = stfp->variants;
          stfp->variants = fpv;
+         variant_table_insert(&stfp->variant_table, fp_key_equal,
+                              &fpv->key, sizeof(fpv->key), fpv);
+         _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
+         st->variant_stats.created[PIPE_SHADER_FRAGMENT]++;
       }
    }
 
@@ -1174,20 +1289,25 @@ st_get_gp_variant(struct st_context *st,
 {
    struct st_gp_variant *gpv;
 
+   st->variant_stats.lookups[PIPE_SHADER_GEOMETRY]++;
+
    /* Search for existing variant */
-   for (gpv = stgp->variants; gpv; gpv = gpv->next) {
-      if (memcmp(&gpv->key, key, sizeof(*key)) == 0) {
-         break;
-      }
-   }
+   _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
+   gpv = variant_table_search(stgp->variant_table, key, sizeof(*key));
+   _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
 
    if (!gpv) {
       /* create new */
       gpv = st_translate_geometry_program(st, stgp, key);
       if (gpv) {
-         /* insert into list */
+         /* insert into list and table */
+         _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
          gpv->next = stgp->variants;
          stgp->variants = gpv;
+         variant_table_insert(&stgp->variant_table, gp_key_equal,
+                              &gpv->key, sizeof(gpv->key), gpv);
+         _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
+         st->variant_stats.created[PIPE_SHADER_GEOMETRY]++;
       }
    }
 
@@ -1256,11 +1376,14 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
          struct st_vertex_program *stvp = (struct st_vertex_program *) program;
          struct st_vp_variant *vpv, **prevPtr = &stvp->variants;
 
+         _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
          for (vpv = stvp->variants; vpv; ) {
             struct st_vp_variant *next = vpv->next;
             if (vpv->key.st == st) {
-               /* unlink from list */
+               /* unlink from list and table */
                *prevPtr = next;
+               variant_table_remove(stvp->variant_table, &vpv->key,
+                                    sizeof(vpv->key));
                /* destroy this variant */
                delete_vp_variant(st, vpv);
             }
@@ -1269,6 +1392,7 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
             }
             vpv = next;
          }
+         _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
       }
       break;
    case GL_FRAGMENT_PROGRAM_ARB:
@@ -1277,11 +1401,14 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
             (struct st_fragment_program *) program;
          struct st_fp_variant *fpv, **prevPtr = &stfp->variants;
 
+         _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
          for (fpv = stfp->variants; fpv; ) {
             struct st_fp_variant *next = fpv->next;
             if (fpv->key.st == st) {
-               /* unlink from list */
+               /* unlink from list and table */
                *prevPtr = next;
+               variant_table_remove(stfp->variant_table, &fpv->key,
+                                    sizeof(fpv->key));
                /* destroy this variant */
                delete_fp_variant(st, fpv);
             }
@@ -1290,6 +1417,7 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
             }
             fpv = next;
          }
+         _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
       }
       break;
    case MESA_GEOMETRY_PROGRAM:
@@ -1298,11 +1426,14 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
             (struct st_geometry_program *) program;
          struct st_gp_variant *gpv, **prevPtr = &stgp->variants;
 
+         _glthread_LOCK_MUTEX(st->ctx->Shared->Mutex);
          for (gpv = stgp->variants; gpv; ) {
             struct st_gp_variant *next = gpv->next;
             if (gpv->key.st == st) {
-               /* unlink from list */
+               /* unlink from list and table */
                *prevPtr = next;
+               variant_table_remove(stgp->variant_table, &gpv->key,
+                                    sizeof(gpv->key));
                /* destroy this variant */
                delete_gp_variant(st, gpv);
             }
@@ -1311,6 +1442,7 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
             }
             gpv = next;
          }
+         _glthread_UNLOCK_MUTEX(st->ctx->Shared->Mutex);
       }
       break;
    default:
@@ -1380,6 +1512,16 @@ destroy_program_variants_cb(GLuint key, void *data, void *userData)
 void
 st_destroy_program_variants(struct st_context *st)
 {
+   ST_DBG(DEBUG_VARIANTS,
+          "st: shader variants: vs %u lookups/%u created, "
+          "fs %u lookups/%u created, gs %u lookups/%u created\n",
+          st->variant_stats.lookups[PIPE_SHADER_VERTEX],
+          st->variant_stats.created[PIPE_SHADER_VERTEX],
+          st->variant_stats.lookups[PIPE_SHADER_FRAGMENT],
+          st->variant_stats.created[PIPE_SHADER_FRAGMENT],
+          st->variant_stats.lookups[PIPE_SHADER_GEOMETRY],
+          st->variant_stats.created[PIPE_SHADER_GEOMETRY]);
+
    /* ARB vert/frag program */
    _mesa_HashWalk(st->ctx->Shared->Programs,
                   destroy_program_variants_cb, st);
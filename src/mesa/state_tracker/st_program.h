@@ -41,6 +41,9 @@
 #include "st_glsl_to_tgsi.h"
 
 
+struct hash_table;
+
+
 /** Fragment program variant key */
 struct st_fp_variant_key
 {
@@ -92,6 +95,9 @@ struct st_fragment_program
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
 
    struct st_fp_variant *variants;
+
+   /** The same variants, hashed by key for st_get_fp_variant() */
+   struct hash_table *variant_table;
 };
 
 
@@ -161,6 +167,9 @@ struct st_vertex_program
    /** List of translated variants of this vertex program.
     */
    struct st_vp_variant *variants;
+
+   /** The same variants, hashed by key for st_get_vp_variant() */
+   struct hash_table *variant_table;
 };
 
 
@@ -214,6 +223,9 @@ struct st_geometry_program
    struct pipe_shader_state tgsi;
 
    struct st_gp_variant *variants;
+
+   /** The same variants, hashed by key for st_get_gp_variant() */
+   struct hash_table *variant_table;
 };
 
 